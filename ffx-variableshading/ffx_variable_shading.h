@@ -25,36 +25,78 @@
 // VarianceCutoff Maximum luminance variance acceptable to accept reduced shading rate
 // MotionFactor Length of the motion vector * MotionFactor gets deducted from luminance variance
 // to allow lower VS rates on fast moving objects
+// ViewportOffset Upper left corner of the active region when rendering at a dynamic resolution into
+// surfaces allocated for the maximum one, Resolution is then the size of that region. Tiles keep
+// their place in the VRS image: the generator writes the tiles from ViewportOffset / TileSize on,
+// so a VRS image allocated for the maximum resolution never has to be recreated. 0 otherwise.
+//
+// Optional defines:
+// FFX_VARIABLESHADING_TILELISTS Additionally compact the tiles into one list per rate class,
+// so later passes can dispatch indirectly over only the tiles they care about
+// FFX_VARIABLESHADING_TILESTATS Additionally write per tile statistics (max 2x2 luminance range,
+// min/max luminance, max motion in pixels) for video encoders, see
+// FFX_VariableShading_ComputeQpOffsets in ffx_variable_shading_cpu.h
+// FFX_VARIABLESHADING_CAPPEDIMAGE Additionally write every tile's rate limited to 2X per axis,
+// for passes that must not go beyond 2x2 (e.g. alpha tested foliage) while others use the
+// additional shading rates. One analysis serves both images: a 4x4 block whose variance
+// allows 2X4, 4X2 or 4X4 allows 2X2, too.
+// FFX_VARIABLESHADING_CUTOFF_SCALE_1X2 (_2X1, _2X2, _2X4, _4X2, _4X4) Factor of VarianceCutoff for
+// one rate, 1.0 by default. Above 1 the rate is picked more often.
+// FFX_VARIABLESHADING_SKIP_NEIGHBOURHOOD Cheaper pass without widening the variances by the
+// neighbours' luminance range (base rates) or taking the neighbours' finer rates (additional rates)
+// FFX_VARIABLESHADING_RATE_CALLBACK The shader implements FFX_VariableShading_DecideRate, which maps
+// the variances of a tile (base rates) or 4x4 block (additional rates) to a rate instead of
+// FFX_VariableShading_DecideRateDefault. Its result is limited to 2X per axis without additional rates.
+//
+// Input mip level: the generator can run on a box filtered mip level of the luminance input.
+// FFX_VariableShading_SetInputMipLevel adjusts the constants; all positions passed to the
+// Read* functions are then in texels of that level and ReadMotionVec2D has to return
+// motion in texels of that level, too. The VRS image is the same as for full resolution input.
 //
 //////////////////////////////////////////////////////////////////////////
 
 #if defined(FFX_CPP)
+#if !defined(FFX_VARIABLESHADING_CPP_DEFINED)
+#define FFX_VARIABLESHADING_CPP_DEFINED
 struct FFX_VariableShading_CB
 {
     uint32_t    width, height;
     uint32_t    tileSize;
     float       varianceCutoff;
     float       motionFactor;
+    uint32_t    viewportX, viewportY;
 };
 
-static uint32_t FFX_VariableShading_DivideRoundingUp(uint32_t a, uint32_t b)
+static inline uint32_t FFX_VariableShading_DivideRoundingUp(uint32_t a, uint32_t b)
 {
     return (a + b - 1) / b;
 }
 
+#if defined(__D3DX12_H__)
 // return the resolution
-static void FFX_VariableShading_GetVrsImageResourceDesc(const uint32_t rtWidth, const uint32_t rtHeight, const uint32_t tileSize, CD3DX12_RESOURCE_DESC& VRSImageDesc)
+static inline void FFX_VariableShading_GetVrsImageResourceDesc(const uint32_t rtWidth, const uint32_t rtHeight, const uint32_t tileSize, CD3DX12_RESOURCE_DESC& VRSImageDesc)
 {
     uint32_t vrsImageWidth = FFX_VariableShading_DivideRoundingUp(rtWidth, tileSize);
     uint32_t vrsImageHeight = FFX_VariableShading_DivideRoundingUp(rtHeight, tileSize);
 
     VRSImageDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8_UINT, vrsImageWidth, vrsImageHeight, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
 }
+#endif
 
-static void FFX_VariableShading_GetDispatchInfo(const FFX_VariableShading_CB* cb, const bool useAditionalShadingRates, uint32_t& numThreadGroupsX, uint32_t& numThreadGroupsY)
+// the tiles of the VRS image the viewport covers: [firstTileX, firstTileX + tileCountX) x [firstTileY, firstTileY + tileCountY)
+static inline void FFX_VariableShading_GetViewportTiles(const FFX_VariableShading_CB* cb, uint32_t& firstTileX, uint32_t& firstTileY, uint32_t& tileCountX, uint32_t& tileCountY)
 {
-    uint32_t vrsImageWidth = FFX_VariableShading_DivideRoundingUp(cb->width, cb->tileSize);
-    uint32_t vrsImageHeight = FFX_VariableShading_DivideRoundingUp(cb->height, cb->tileSize);
+    firstTileX = cb->viewportX / cb->tileSize;
+    firstTileY = cb->viewportY / cb->tileSize;
+    tileCountX = FFX_VariableShading_DivideRoundingUp(cb->viewportX + cb->width, cb->tileSize) - firstTileX;
+    tileCountY = FFX_VariableShading_DivideRoundingUp(cb->viewportY + cb->height, cb->tileSize) - firstTileY;
+}
+
+// the dispatch only covers the viewport's tiles, it does not depend on the size of the VRS image
+static inline void FFX_VariableShading_GetDispatchInfo(const FFX_VariableShading_CB* cb, const bool useAditionalShadingRates, uint32_t& numThreadGroupsX, uint32_t& numThreadGroupsY)
+{
+    uint32_t firstTileX, firstTileY, vrsImageWidth, vrsImageHeight;
+    FFX_VariableShading_GetViewportTiles(cb, firstTileX, firstTileY, vrsImageWidth, vrsImageHeight);
 
     if (useAditionalShadingRates)
     {
@@ -80,6 +122,37 @@ static void FFX_VariableShading_GetDispatchInfo(const FFX_VariableShading_CB* cb
         }
     }
 }
+
+// the generator needs at least 8x8 texels per tile
+static inline uint32_t FFX_VariableShading_GetMaxInputMipLevel(const uint32_t tileSize)
+{
+    uint32_t mipLevel = 0;
+    while ((tileSize >> (mipLevel + 1)) >= 8)
+        ++mipLevel;
+    return mipLevel;
+}
+
+// Adjust the constants (set up for full resolution input) to run the generator on mip level mipLevel.
+// Neighbouring texels of a box filtered mip are 2^mipLevel pixels apart, so a gradient that passes the
+// cutoff at full resolution shows up scaled by that factor: the cutoff is multiplied by varianceScalePerLevel
+// per level. The motion term is subtracted from those scaled differences and motion vectors are in texels
+// of the level (half the length per level), so the motion factor is multiplied by 2 * varianceScalePerLevel.
+// FFX_VARIABLESHADING_TILESIZE has to match the adjusted tileSize.
+static inline void FFX_VariableShading_SetInputMipLevel(FFX_VariableShading_CB* cb, const uint32_t mipLevel, const float varianceScalePerLevel = 2.0f)
+{
+    for (uint32_t i = 0; i < mipLevel; ++i)
+    {
+        // the viewport keeps its tile alignment: texels covering any of its pixels are part of it
+        cb->width = FFX_VariableShading_DivideRoundingUp(cb->viewportX + cb->width, 2) - cb->viewportX / 2;
+        cb->height = FFX_VariableShading_DivideRoundingUp(cb->viewportY + cb->height, 2) - cb->viewportY / 2;
+        cb->viewportX /= 2;
+        cb->viewportY /= 2;
+        cb->tileSize /= 2;
+        cb->varianceCutoff *= varianceScalePerLevel;
+        cb->motionFactor *= 2.0f * varianceScalePerLevel;
+    }
+}
+#endif // FFX_VARIABLESHADING_CPP_DEFINED
 #elif defined(FFX_HLSL)
     // Constant Buffer
 cbuffer FFX_VariableShading_CB0
@@ -88,12 +161,26 @@ cbuffer FFX_VariableShading_CB0
     uint g_TileSize;
     float g_VarianceCutoff;
     float g_MotionFactor;
+    int2 g_ViewportOffset;
 }
 
 // Forward declaration of functions that need to be implemented by shader code using this technique
 float   FFX_VariableShading_ReadLuminance(int2 pos);
 float2  FFX_VariableShading_ReadMotionVec2D(int2 pos);
 void    FFX_VariableShading_WriteVrsImage(int2 pos, uint value);
+#if defined FFX_VARIABLESHADING_TILELISTS
+// reserve count consecutive entries in the list of rateClass and return the index of the first one
+// (e.g. InterlockedAdd on the ThreadGroupCountX of an indirect dispatch argument buffer)
+uint    FFX_VariableShading_ReserveTileListEntries(uint rateClass, uint count);
+void    FFX_VariableShading_WriteTileListEntry(uint rateClass, uint index, int2 tile);
+#endif
+#if defined FFX_VARIABLESHADING_TILESTATS
+// stats = (max 2x2 variance, min luminance, max luminance, max motion vector length)
+void    FFX_VariableShading_WriteTileStats(int2 tile, float4 stats);
+#endif
+#if defined FFX_VARIABLESHADING_CAPPEDIMAGE
+void    FFX_VariableShading_WriteCappedVrsImage(int2 pos, uint value);
+#endif
 
 static const uint FFX_VARIABLESHADING_RATE1D_1X = 0x0;
 static const uint FFX_VARIABLESHADING_RATE1D_2X = 0x1;
@@ -108,6 +195,100 @@ static const uint FFX_VARIABLESHADING_RATE_2X4 = FFX_VARIABLESHADING_MAKE_SHADIN
 static const uint FFX_VARIABLESHADING_RATE_4X2 = FFX_VARIABLESHADING_MAKE_SHADING_RATE(FFX_VARIABLESHADING_RATE1D_4X, FFX_VARIABLESHADING_RATE1D_2X); // 0x9;
 static const uint FFX_VARIABLESHADING_RATE_4X4 = FFX_VARIABLESHADING_MAKE_SHADING_RATE(FFX_VARIABLESHADING_RATE1D_4X, FFX_VARIABLESHADING_RATE1D_4X); // 0xa;
 
+// tile lists are ordered 1X1, 1X2, 2X1, 2X2, 2X4, 4X2, 4X4
+static const uint FFX_VARIABLESHADING_RATE_CLASS_COUNT = 7;
+static const uint FFX_VariableShading_RateClass[11] = { 0, 1, 0, 0, 2, 3, 4, 0, 0, 5, 6 };
+
+#ifndef FFX_VARIABLESHADING_CUTOFF_SCALE_1X2
+#define FFX_VARIABLESHADING_CUTOFF_SCALE_1X2 1.0
+#endif
+#ifndef FFX_VARIABLESHADING_CUTOFF_SCALE_2X1
+#define FFX_VARIABLESHADING_CUTOFF_SCALE_2X1 1.0
+#endif
+#ifndef FFX_VARIABLESHADING_CUTOFF_SCALE_2X2
+#define FFX_VARIABLESHADING_CUTOFF_SCALE_2X2 1.0
+#endif
+#ifndef FFX_VARIABLESHADING_CUTOFF_SCALE_2X4
+#define FFX_VARIABLESHADING_CUTOFF_SCALE_2X4 1.0
+#endif
+#ifndef FFX_VARIABLESHADING_CUTOFF_SCALE_4X2
+#define FFX_VARIABLESHADING_CUTOFF_SCALE_4X2 1.0
+#endif
+#ifndef FFX_VARIABLESHADING_CUTOFF_SCALE_4X4
+#define FFX_VARIABLESHADING_CUTOFF_SCALE_4X4 1.0
+#endif
+
+// variances of a tile (base rates) or a 4x4 block (additional rates), the rates a path does not evaluate
+// (2x4, 4x2 and 4x4 without additional rates) are +INF, as on the CPU
+struct FFX_VariableShading_RateStats
+{
+    float var2x1, var1x2, var2x2;
+    float var2x4, var4x2, var4x4;
+};
+
+#if defined FFX_VARIABLESHADING_RATE_CALLBACK
+uint    FFX_VariableShading_DecideRate(FFX_VariableShading_RateStats stats);
+#endif
+
+// the coarsest rate whose variance is below its cutoff
+uint FFX_VariableShading_DecideRateDefault(FFX_VariableShading_RateStats stats)
+{
+#if !defined FFX_VARIABLESHADING_ADDITIONALSHADINGRATES
+    if (stats.var2x2 < g_VarianceCutoff * FFX_VARIABLESHADING_CUTOFF_SCALE_2X2)
+        return FFX_VARIABLESHADING_RATE_2X2;
+
+    // when both directions pass, the one further below its cutoff (with a single cutoff: the lower variance)
+    float cutoff2x1 = g_VarianceCutoff * FFX_VARIABLESHADING_CUTOFF_SCALE_2X1;
+    float cutoff1x2 = g_VarianceCutoff * FFX_VARIABLESHADING_CUTOFF_SCALE_1X2;
+    bool preferVertical = (FFX_VARIABLESHADING_CUTOFF_SCALE_2X1 == FFX_VARIABLESHADING_CUTOFF_SCALE_1X2) ? (stats.var2x1 > stats.var1x2) : (stats.var2x1 - cutoff2x1 > stats.var1x2 - cutoff1x2);
+    if (preferVertical)
+        return FFX_VARIABLESHADING_MAKE_SHADING_RATE(FFX_VARIABLESHADING_RATE1D_1X, (stats.var1x2 > cutoff1x2) ? FFX_VARIABLESHADING_RATE1D_1X : FFX_VARIABLESHADING_RATE1D_2X);
+
+    return FFX_VARIABLESHADING_MAKE_SHADING_RATE((stats.var2x1 > cutoff2x1) ? FFX_VARIABLESHADING_RATE1D_1X : FFX_VARIABLESHADING_RATE1D_2X, FFX_VARIABLESHADING_RATE1D_1X);
+#else
+    if (stats.var4x4 < g_VarianceCutoff * FFX_VARIABLESHADING_CUTOFF_SCALE_4X4) return FFX_VARIABLESHADING_RATE_4X4;
+    if (stats.var4x2 < g_VarianceCutoff * FFX_VARIABLESHADING_CUTOFF_SCALE_4X2) return FFX_VARIABLESHADING_RATE_4X2;
+    if (stats.var2x4 < g_VarianceCutoff * FFX_VARIABLESHADING_CUTOFF_SCALE_2X4) return FFX_VARIABLESHADING_RATE_2X4;
+    if (stats.var2x2 < g_VarianceCutoff * FFX_VARIABLESHADING_CUTOFF_SCALE_2X2) return FFX_VARIABLESHADING_RATE_2X2;
+    if (stats.var2x1 < g_VarianceCutoff * FFX_VARIABLESHADING_CUTOFF_SCALE_2X1) return FFX_VARIABLESHADING_RATE_2X1;
+    if (stats.var1x2 < g_VarianceCutoff * FFX_VARIABLESHADING_CUTOFF_SCALE_1X2) return FFX_VARIABLESHADING_RATE_1X2;
+    return FFX_VARIABLESHADING_RATE_1X1;
+#endif
+}
+
+uint FFX_VariableShading_DecideTileRate(FFX_VariableShading_RateStats stats)
+{
+#if defined FFX_VARIABLESHADING_RATE_CALLBACK
+#if !defined FFX_VARIABLESHADING_ADDITIONALSHADINGRATES
+    uint maxRate1D = FFX_VARIABLESHADING_RATE1D_2X;
+#else
+    uint maxRate1D = FFX_VARIABLESHADING_RATE1D_4X;
+#endif
+    uint rate = FFX_VariableShading_DecideRate(stats);
+    return FFX_VARIABLESHADING_MAKE_SHADING_RATE(min((rate >> 2) & 3, maxRate1D), min(rate & 3, maxRate1D));
+#else
+    return FFX_VariableShading_DecideRateDefault(stats);
+#endif
+}
+
+// threadgroups work relative to the first tile of the viewport (see g_ViewportOffset)
+int2 FFX_VariableShading_GetViewportFirstTile()
+{
+    return g_ViewportOffset / int(g_TileSize);
+}
+
+int2 FFX_VariableShading_GetViewportTileCount()
+{
+    return (g_ViewportOffset + g_Resolution + int(g_TileSize) - 1) / int(g_TileSize) - FFX_VariableShading_GetViewportFirstTile();
+}
+
+// motion outside the viewport is 0, as it is outside the surface without one
+float2 FFX_VariableShading_ReadViewportMotionVec2D(int2 pos)
+{
+    bool inside = all(pos >= g_ViewportOffset) && all(pos < g_ViewportOffset + g_Resolution);
+    return inside ? FFX_VariableShading_ReadMotionVec2D(pos) : float2(0, 0);
+}
+
 #if !defined FFX_VARIABLESHADING_ADDITIONALSHADINGRATES
 #if FFX_VARIABLESHADING_TILESIZE == 8
 static const uint FFX_VariableShading_ThreadCount1D = 8;
@@ -147,15 +328,67 @@ static const uint FFX_VariableShading_NumBlocks = FFX_VariableShading_NumBlocks1
 groupshared uint FFX_VariableShading_LdsShadingRate[FFX_VariableShading_SampleCount];
 #endif
 
+#if defined FFX_VARIABLESHADING_TILESTATS
+// tile statistics only take samples inside the tiles of the threadgroup into account:
+// the base path samples 2x2 pixels starting one sample outside, the additional rates path 4x4 pixels without halo
+#if !defined FFX_VARIABLESHADING_ADDITIONALSHADINGRATES
+static const int FFX_VariableShading_StatsHalo = 1;
+#else
+static const int FFX_VariableShading_StatsHalo = 0;
+#endif
+static const uint FFX_VariableShading_StatsSamplesPerTile1D = FFX_VariableShading_ThreadCount1D / FFX_VariableShading_NumBlocks1D;
+
+// per tile: variance, min, max, motion as float bits (all values are non-negative, so uint compares work)
+groupshared uint FFX_VariableShading_LdsTileStats[FFX_VariableShading_NumBlocks * 4];
+
+void FFX_VariableShading_InitTileStats(uint Gidx)
+{
+    if (Gidx < FFX_VariableShading_NumBlocks * 4)
+    {
+        FFX_VariableShading_LdsTileStats[Gidx] = ((Gidx & 3) == 1) ? 0x7f800000 : 0; // min starts at +inf
+    }
+    GroupMemoryBarrierWithGroupSync();
+}
+
+void FFX_VariableShading_AccumulateTileStats(int2 sample2D, float variance, float2 minmax, float motion)
+{
+    int2 tileSample = sample2D - FFX_VariableShading_StatsHalo;
+    if (any(tileSample < 0) || any(tileSample >= int(FFX_VariableShading_ThreadCount1D)))
+        return;
+
+    uint2 tile = uint2(tileSample) / FFX_VariableShading_StatsSamplesPerTile1D;
+    uint offset = (tile.y * FFX_VariableShading_NumBlocks1D + tile.x) * 4;
+    InterlockedMax(FFX_VariableShading_LdsTileStats[offset + 0], asuint(max(0, variance)));
+    InterlockedMin(FFX_VariableShading_LdsTileStats[offset + 1], asuint(max(0, minmax.x)));
+    InterlockedMax(FFX_VariableShading_LdsTileStats[offset + 2], asuint(max(0, minmax.y)));
+    InterlockedMax(FFX_VariableShading_LdsTileStats[offset + 3], asuint(motion));
+}
+
+// call after the group sync following the sampling loop
+void FFX_VariableShading_StoreTileStats(uint3 Gid, uint Gidx)
+{
+    if (Gidx < FFX_VariableShading_NumBlocks)
+    {
+        int2 tile = Gid.xy * FFX_VariableShading_NumBlocks1D + uint2(Gidx % FFX_VariableShading_NumBlocks1D, Gidx / FFX_VariableShading_NumBlocks1D);
+        if (any(tile >= FFX_VariableShading_GetViewportTileCount()))
+            return;
+
+        uint offset = Gidx * 4;
+        FFX_VariableShading_WriteTileStats(FFX_VariableShading_GetViewportFirstTile() + tile, asfloat(uint4(
+            FFX_VariableShading_LdsTileStats[offset + 0],
+            FFX_VariableShading_LdsTileStats[offset + 1],
+            FFX_VariableShading_LdsTileStats[offset + 2],
+            FFX_VariableShading_LdsTileStats[offset + 3])));
+    }
+}
+#endif
+
 float FFX_VariableShading_GetLuminance(int2 pos)
 {
-    float2 v = FFX_VariableShading_ReadMotionVec2D(pos);
+    float2 v = FFX_VariableShading_ReadViewportMotionVec2D(pos);
     pos = pos - round(v);
-    // clamp to screen
-    if (pos.x < 0) pos.x = 0;
-    if (pos.y < 0) pos.y = 0;
-    if (pos.x >= g_Resolution.x) pos.x = g_Resolution.x - 1;
-    if (pos.y >= g_Resolution.y) pos.y = g_Resolution.y - 1;
+    // clamp to the viewport
+    pos = clamp(pos, g_ViewportOffset, g_ViewportOffset + g_Resolution - 1);
 
     return FFX_VariableShading_ReadLuminance(pos);
 }
@@ -166,6 +399,50 @@ int FFX_VariableShading_FlattenLdsOffset(int2 coord)
     return coord.y * FFX_VariableShading_SampleCount1D + coord.x;
 }
 
+// write the final shading rate of one tile, pos is relative to the first tile of the viewport
+void FFX_VariableShading_StoreTile(int2 pos, uint shadingRate)
+{
+    // threadgroups may cover tiles outside the viewport, these keep their contents and must not end up in a list
+    int2 tileCount = FFX_VariableShading_GetViewportTileCount();
+    bool valid = (pos.x < tileCount.x) && (pos.y < tileCount.y);
+    pos += FFX_VariableShading_GetViewportFirstTile();
+
+    if (valid)
+    {
+        FFX_VariableShading_WriteVrsImage(pos, shadingRate);
+
+#if defined FFX_VARIABLESHADING_CAPPEDIMAGE
+        // at most 2X per axis
+        FFX_VariableShading_WriteCappedVrsImage(pos, min(shadingRate & 0xc, 0x4) | min(shadingRate & 0x3, 0x1));
+#endif
+    }
+
+#if defined FFX_VARIABLESHADING_TILELISTS
+    uint rateClass = FFX_VariableShading_RateClass[shadingRate];
+
+    // compact with a wave level prefix sum: one atomic per wave and rate class
+    for (uint c = 0; c < FFX_VARIABLESHADING_RATE_CLASS_COUNT; ++c)
+    {
+        bool inClass = valid && (rateClass == c);
+        uint count = WaveActiveCountBits(inClass);
+        if (count == 0)
+            continue;
+
+        uint base = 0;
+        if (WaveIsFirstLane())
+        {
+            base = FFX_VariableShading_ReserveTileListEntries(c, count);
+        }
+        base = WaveReadLaneFirst(base);
+
+        if (inClass)
+        {
+            FFX_VariableShading_WriteTileListEntry(c, base + WavePrefixCountBits(inClass), pos);
+        }
+    }
+#endif
+}
+
 #if !defined FFX_VARIABLESHADING_ADDITIONALSHADINGRATES
 
 //--------------------------------------------------------------------------------------//
@@ -173,7 +450,7 @@ int FFX_VariableShading_FlattenLdsOffset(int2 coord)
 //--------------------------------------------------------------------------------------//
 void FFX_VariableShading_GenerateVrsImage(uint3 Gid, uint3 Gtid, uint Gidx)
 {
-    int2 tileOffset = Gid.xy * FFX_VariableShading_ThreadCount1D * 2;
+    int2 tileOffset = FFX_VariableShading_GetViewportFirstTile() * int(g_TileSize) + Gid.xy * FFX_VariableShading_ThreadCount1D * 2;
     int2 baseOffset = tileOffset + int2(-2, -2);
     uint index = Gidx;
 
@@ -183,6 +460,9 @@ void FFX_VariableShading_GenerateVrsImage(uint3 Gid, uint3 Gtid, uint Gidx)
         FFX_VariableShading_LdsGroupReduce = FFX_VARIABLESHADING_RATE_2X2;
     }
 #endif
+#if defined FFX_VARIABLESHADING_TILESTATS
+    FFX_VariableShading_InitTileStats(Gidx);
+#endif
 
     // sample source texture (using motion vectors)
     while (index < FFX_VariableShading_SampleCount)
@@ -202,7 +482,10 @@ void FFX_VariableShading_GenerateVrsImage(uint3 Gid, uint3 Gtid, uint Gidx)
         delta.z = minmax.y - minmax.x;
 
         // reduce variance value for fast moving pixels
-        float v = length(FFX_VariableShading_ReadMotionVec2D(baseOffset + index2D));
+        float v = length(FFX_VariableShading_ReadViewportMotionVec2D(baseOffset + index2D));
+#if defined FFX_VARIABLESHADING_TILESTATS
+        FFX_VariableShading_AccumulateTileStats(index2D / 2, delta.z, minmax, v);
+#endif
         v *= g_MotionFactor;
         delta -= v;
         minmax.y -= v;
@@ -217,12 +500,19 @@ void FFX_VariableShading_GenerateVrsImage(uint3 Gid, uint3 Gtid, uint Gidx)
 
     GroupMemoryBarrierWithGroupSync();
 
+#if defined FFX_VARIABLESHADING_TILESTATS
+    FFX_VariableShading_StoreTileStats(Gid, Gidx);
+#endif
+
     // upper left coordinate in LDS
     int2 threadUV = Gtid.xy;
 
     // look at neighbouring coarse pixels, to combat burn in effect due to frame dependence
     float3 delta = FFX_VariableShading_LdsVariance[FFX_VariableShading_FlattenLdsOffset(threadUV + int2(0, 0))];
 
+#if defined FFX_VARIABLESHADING_SKIP_NEIGHBOURHOOD
+    delta = max(0, delta);
+#else
     // read the minimum luminance for neighbouring coarse pixels
     float minNeighbour = FFX_VariableShading_LdsMin[FFX_VariableShading_FlattenLdsOffset(threadUV + int2(0, -1))];
     minNeighbour = min(minNeighbour, FFX_VariableShading_LdsMin[FFX_VariableShading_FlattenLdsOffset(threadUV + int2(-1, 0))]);
@@ -239,6 +529,7 @@ void FFX_VariableShading_GenerateVrsImage(uint3 Gid, uint3 Gtid, uint Gidx)
 
     // assume higher luminance based on min & max values gathered from neighbouring pixels
     delta = max(0, delta + dMin + dMax);
+#endif
 
     // Reduction: find maximum variance within VRS tile
 #if FFX_VARIABLESHADING_TILESIZE > 8
@@ -248,23 +539,8 @@ void FFX_VariableShading_GenerateVrsImage(uint3 Gid, uint3 Gtid, uint Gidx)
 
     if (WaveIsFirstLane())
     {
-        uint shadingRate = FFX_VARIABLESHADING_MAKE_SHADING_RATE(FFX_VARIABLESHADING_RATE1D_1X, FFX_VARIABLESHADING_RATE1D_1X);
-
-        if (delta.z < g_VarianceCutoff)
-        {
-            shadingRate = FFX_VARIABLESHADING_MAKE_SHADING_RATE(FFX_VARIABLESHADING_RATE1D_2X, FFX_VARIABLESHADING_RATE1D_2X);
-        }
-        else
-        {
-            if (delta.x > delta.y)
-            {
-                shadingRate = FFX_VARIABLESHADING_MAKE_SHADING_RATE(FFX_VARIABLESHADING_RATE1D_1X, (delta.y > g_VarianceCutoff) ? FFX_VARIABLESHADING_RATE1D_1X : FFX_VARIABLESHADING_RATE1D_2X);
-            }
-            else
-            {
-                shadingRate = FFX_VARIABLESHADING_MAKE_SHADING_RATE((delta.x > g_VarianceCutoff) ? FFX_VARIABLESHADING_RATE1D_1X : FFX_VARIABLESHADING_RATE1D_2X, FFX_VARIABLESHADING_RATE1D_1X);
-            }
-        }
+        FFX_VariableShading_RateStats stats = { delta.x, delta.y, delta.z, asfloat(0x7f800000), asfloat(0x7f800000), asfloat(0x7f800000) };
+        uint shadingRate = FFX_VariableShading_DecideTileRate(stats);
 
         InterlockedAnd(FFX_VariableShading_LdsGroupReduce, shadingRate);
     }
@@ -273,7 +549,7 @@ void FFX_VariableShading_GenerateVrsImage(uint3 Gid, uint3 Gtid, uint Gidx)
     if (Gidx == 0)
     {
         // Store
-        FFX_VariableShading_WriteVrsImage(Gid.xy, FFX_VariableShading_LdsGroupReduce);
+        FFX_VariableShading_StoreTile(Gid.xy, FFX_VariableShading_LdsGroupReduce);
     }
 #else
     // with tilesize=8 we compute 2x2 tiles in one 8x8 threadgroup
@@ -292,28 +568,11 @@ void FFX_VariableShading_GenerateVrsImage(uint3 Gid, uint3 Gtid, uint Gidx)
     // write out shading rates to VRS image
     if (Gidx < FFX_VariableShading_NumBlocks)
     {
-        float varH = diffX[Gidx];
-        float varV = diffY[Gidx];
-        float var = diffZ[Gidx];;
-        uint shadingRate = FFX_VARIABLESHADING_MAKE_SHADING_RATE(FFX_VARIABLESHADING_RATE1D_1X, FFX_VARIABLESHADING_RATE1D_1X);
+        FFX_VariableShading_RateStats stats = { diffX[Gidx], diffY[Gidx], diffZ[Gidx], asfloat(0x7f800000), asfloat(0x7f800000), asfloat(0x7f800000) };
+        uint shadingRate = FFX_VariableShading_DecideTileRate(stats);
 
-        if (var < g_VarianceCutoff)
-        {
-            shadingRate = FFX_VARIABLESHADING_MAKE_SHADING_RATE(FFX_VARIABLESHADING_RATE1D_2X, FFX_VARIABLESHADING_RATE1D_2X);
-        }
-        else
-        {
-            if (varH > varV)
-            {
-                shadingRate = FFX_VARIABLESHADING_MAKE_SHADING_RATE(FFX_VARIABLESHADING_RATE1D_1X, (varV > g_VarianceCutoff) ? FFX_VARIABLESHADING_RATE1D_1X : FFX_VARIABLESHADING_RATE1D_2X);
-            }
-            else
-            {
-                shadingRate = FFX_VARIABLESHADING_MAKE_SHADING_RATE((varH > g_VarianceCutoff) ? FFX_VARIABLESHADING_RATE1D_1X : FFX_VARIABLESHADING_RATE1D_2X, FFX_VARIABLESHADING_RATE1D_1X);
-            }
-        }
         // Store
-        FFX_VariableShading_WriteVrsImage(Gid.xy* FFX_VariableShading_NumBlocks1D + uint2(Gidx / FFX_VariableShading_NumBlocks1D, Gidx % FFX_VariableShading_NumBlocks1D), shadingRate);
+        FFX_VariableShading_StoreTile(Gid.xy* FFX_VariableShading_NumBlocks1D + uint2(Gidx / FFX_VariableShading_NumBlocks1D, Gidx % FFX_VariableShading_NumBlocks1D), shadingRate);
     }
 #endif
 }
@@ -325,16 +584,23 @@ void FFX_VariableShading_GenerateVrsImage(uint3 Gid, uint3 Gtid, uint Gidx)
 //--------------------------------------------------------------------------------------//
 void FFX_VariableShading_GenerateVrsImage(uint3 Gid, uint3 Gtid, uint Gidx)
 {
-    int2 tileOffset = Gid.xy * FFX_VariableShading_ThreadCount1D * 4;
+    int2 tileOffset = FFX_VariableShading_GetViewportFirstTile() * int(g_TileSize) + Gid.xy * FFX_VariableShading_ThreadCount1D * 4;
     int2 baseOffset = tileOffset;
     uint index = Gidx;
 
+#if defined FFX_VARIABLESHADING_TILESTATS
+    FFX_VariableShading_InitTileStats(Gidx);
+#endif
+
     while (index < FFX_VariableShading_SampleCount)
     {
         int2 index2D = 4 * int2(index % FFX_VariableShading_SampleCount1D, index / FFX_VariableShading_SampleCount1D);
 
         // reduce shading rate for fast moving pixels
-        float v = length(FFX_VariableShading_ReadMotionVec2D(baseOffset + index2D));
+        float v = length(FFX_VariableShading_ReadViewportMotionVec2D(baseOffset + index2D));
+#if defined FFX_VARIABLESHADING_TILESTATS
+        float statsMotion = v;
+#endif
         v *= g_MotionFactor;
 
         // compute variance for one 4x4 region
@@ -344,6 +610,10 @@ void FFX_VariableShading_GenerateVrsImage(uint3 Gid, uint3 Gtid, uint Gidx)
         float2 minmax4x2[2] = { float2(g_VarianceCutoff, 0.f), float2(g_VarianceCutoff, 0.f) };
         float2 minmax2x4[2] = { float2(g_VarianceCutoff, 0.f), float2(g_VarianceCutoff, 0.f) };
         float2 minmax4x4 = float2(g_VarianceCutoff, 0.f);
+#if defined FFX_VARIABLESHADING_TILESTATS
+        float statsVariance = 0;
+        float2 statsMinMax = float2(asfloat(0x7f800000), 0);
+#endif
 
         // computes variance for 2x2 tiles
         // also we need min/max for 2x4, 4x2 & 4x4 
@@ -365,6 +635,11 @@ void FFX_VariableShading_GenerateVrsImage(uint3 Gid, uint3 Gtid, uint Gidx)
                 delta.y = max(abs(lum.x - lum.y), abs(lum.z - lum.w));
                 delta.z = minmax.y - minmax.x;
 
+#if defined FFX_VARIABLESHADING_TILESTATS
+                statsVariance = max(statsVariance, delta.z);
+                statsMinMax = float2(min(statsMinMax.x, minmax.x), max(statsMinMax.y, minmax.y));
+#endif
+
                 // reduce shading rate for fast moving pixels
                 delta = max(0, delta - v);
 
@@ -383,19 +658,16 @@ void FFX_VariableShading_GenerateVrsImage(uint3 Gid, uint3 Gtid, uint Gidx)
             }
         }
 
+#if defined FFX_VARIABLESHADING_TILESTATS
+        FFX_VariableShading_AccumulateTileStats(index2D / 4, statsVariance, statsMinMax, statsMotion);
+#endif
+
         float var4x2 = max(0, max(minmax4x2[0].y - minmax4x2[0].x, minmax4x2[1].y - minmax4x2[1].x) - v);
         float var2x4 = max(0, max(minmax2x4[0].y - minmax2x4[0].x, minmax2x4[1].y - minmax2x4[1].x) - v);
         float var4x4 = max(0, minmax4x4.y - minmax4x4.x - v);
 
-        uint shadingRate = FFX_VARIABLESHADING_RATE_1X1;
-        if (var4x4 < g_VarianceCutoff) shadingRate = FFX_VARIABLESHADING_RATE_4X4;
-        else if (var4x2 < g_VarianceCutoff) shadingRate = FFX_VARIABLESHADING_RATE_4X2;
-        else if (var2x4 < g_VarianceCutoff) shadingRate = FFX_VARIABLESHADING_RATE_2X4;
-        else if (var2x2 < g_VarianceCutoff) shadingRate = FFX_VARIABLESHADING_RATE_2X2;
-        else if (var2x1 < g_VarianceCutoff) shadingRate = FFX_VARIABLESHADING_RATE_2X1;
-        else if (var1x2 < g_VarianceCutoff) shadingRate = FFX_VARIABLESHADING_RATE_1X2;
-
-        FFX_VariableShading_LdsShadingRate[index] = shadingRate;
+        FFX_VariableShading_RateStats stats = { var2x1, var1x2, var2x2, var2x4, var4x2, var4x4 };
+        FFX_VariableShading_LdsShadingRate[index] = FFX_VariableShading_DecideTileRate(stats);
 
         index += FFX_VariableShading_ThreadCount;
     }
@@ -406,6 +678,10 @@ void FFX_VariableShading_GenerateVrsImage(uint3 Gid, uint3 Gtid, uint Gidx)
     }
     GroupMemoryBarrierWithGroupSync();
 
+#if defined FFX_VARIABLESHADING_TILESTATS
+    FFX_VariableShading_StoreTileStats(Gid, Gidx);
+#endif
+
     int i = 0;
     int2 threadUV = Gtid.xy;
 
@@ -416,10 +692,12 @@ void FFX_VariableShading_GenerateVrsImage(uint3 Gid, uint3 Gtid, uint Gidx)
     }
     uint idx = (Gtid.y & (FFX_VariableShading_NumBlocks1D - 1)) * FFX_VariableShading_NumBlocks1D + (Gtid.x & (FFX_VariableShading_NumBlocks1D - 1));
     shadingRate[idx] = FFX_VariableShading_LdsShadingRate[FFX_VariableShading_FlattenLdsOffset(threadUV + int2(0, 0))];
+#if !defined FFX_VARIABLESHADING_SKIP_NEIGHBOURHOOD
     shadingRate[idx] = min(shadingRate[idx], FFX_VariableShading_LdsShadingRate[FFX_VariableShading_FlattenLdsOffset(threadUV + int2(0, -1))]);
     shadingRate[idx] = min(shadingRate[idx], FFX_VariableShading_LdsShadingRate[FFX_VariableShading_FlattenLdsOffset(threadUV + int2(-1, 0))]);
     shadingRate[idx] = min(shadingRate[idx], FFX_VariableShading_LdsShadingRate[FFX_VariableShading_FlattenLdsOffset(threadUV + int2(1, 0))]);
     shadingRate[idx] = min(shadingRate[idx], FFX_VariableShading_LdsShadingRate[FFX_VariableShading_FlattenLdsOffset(threadUV + int2(0, 1))]);
+#endif
 
     // wave-reduce
     for (i = 0; i < FFX_VariableShading_TilesPerGroup; ++i)
@@ -442,13 +720,13 @@ void FFX_VariableShading_GenerateVrsImage(uint3 Gid, uint3 Gtid, uint Gidx)
     // write out final rates
     if (Gidx < FFX_VariableShading_TilesPerGroup)
     {
-        FFX_VariableShading_WriteVrsImage( Gid.xy * FFX_VariableShading_NumBlocks1D + uint2(Gidx / FFX_VariableShading_NumBlocks1D, Gidx % FFX_VariableShading_NumBlocks1D), FFX_VariableShading_LdsGroupReduce[Gidx] );
+        FFX_VariableShading_StoreTile( Gid.xy * FFX_VariableShading_NumBlocks1D + uint2(Gidx / FFX_VariableShading_NumBlocks1D, Gidx % FFX_VariableShading_NumBlocks1D), FFX_VariableShading_LdsGroupReduce[Gidx] );
     }
 #else
     // write out final rates
     if (Gidx < FFX_VariableShading_TilesPerGroup)
     {
-        FFX_VariableShading_WriteVrsImage( Gid.xy * FFX_VariableShading_NumBlocks1D + uint2(Gidx / FFX_VariableShading_NumBlocks1D, Gidx % FFX_VariableShading_NumBlocks1D), shadingRate[Gidx] );
+        FFX_VariableShading_StoreTile( Gid.xy * FFX_VariableShading_NumBlocks1D + uint2(Gidx / FFX_VariableShading_NumBlocks1D, Gidx % FFX_VariableShading_NumBlocks1D), shadingRate[Gidx] );
     }
 #endif
 
@@ -0,0 +1,366 @@
+// FFX_VariableShading_Api.cpp
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// The C API of ffx_variable_shading_api.h over the CPU context of
+// ffx_variable_shading_cpu_context.h and the thread pool of
+// ffx_variable_shading_cpu_jobs.h. No C++ exception leaves this file.
+
+#include "ffx_variable_shading_api.h"
+#include "ffx_variable_shading_cpu_jobs.h"
+#include "ffx_variable_shading_cpu_luminance.h"
+
+#include <string.h>
+#include <chrono>
+#include <new>
+
+struct FFX_VariableShading_Context
+{
+    FFX_VariableShading_ContextDesc         desc;
+    FFX_VariableShading_CpuAllocator        allocator;
+    FFX_VariableShading_CpuContext          cpuContext;
+    FFX_VariableShading_CpuGeneratorConfig  config;
+    FFX_VariableShading_CpuThreadPool*      pool;       // NULL with a threadCount of 1
+    FFX_VariableShading_LuminanceTransform  transform;
+    float*                                  table;      // of the transform, NULL without
+    float*                                  luminance;  // transformed plane of the input level, NULL without a transform
+    uint32_t                                luminancePitch;
+    FFX_VariableShading_RateImage           image;
+    FFX_VariableShading_FrameStats          stats;
+};
+
+static_assert(sizeof(FFX_VariableShading_FrameStats::rateClassTileCounts) == FFX_VARIABLESHADING_RATE_CLASS_COUNT * sizeof(uint32_t), "one counter per rate class");
+
+static FFX_VariableShading_CB FFX_VariableShading_Api_GetCB(const FFX_VariableShading_ContextDesc& desc, uint32_t viewportX, uint32_t viewportY, uint32_t width, uint32_t height, float varianceCutoff, float motionFactor)
+{
+    FFX_VariableShading_CB cb;
+    cb.width = width;
+    cb.height = height;
+    cb.tileSize = desc.tileSize;
+    cb.varianceCutoff = varianceCutoff;
+    cb.motionFactor = motionFactor;
+    cb.viewportX = viewportX;
+    cb.viewportY = viewportY;
+    FFX_VariableShading_SetInputMipLevel(&cb, desc.inputMipLevel);
+    return cb;
+}
+
+// rows of the transformed plane per task
+static const uint32_t FFX_VARIABLESHADING_API_TRANSFORM_BAND_ROWS = 64;
+
+struct FFX_VariableShading_Api_TransformBands
+{
+    const FFX_VariableShading_LuminanceTransform*   transform;
+    const float*                                    src;
+    uint32_t                                        srcPitch;
+    float*                                          dst;
+    uint32_t                                        dstPitch;
+    uint32_t                                        width, height;
+};
+
+static void FFX_VariableShading_Api_TransformBand(const FFX_VariableShading_Api_TransformBands& bands, uint32_t band)
+{
+    const uint32_t firstRow = band * FFX_VARIABLESHADING_API_TRANSFORM_BAND_ROWS;
+    const uint32_t rowCount = std::min(FFX_VARIABLESHADING_API_TRANSFORM_BAND_ROWS, bands.height - firstRow);
+    FFX_VariableShading_TransformLuminanceRows(*bands.transform, bands.src, bands.srcPitch, bands.width, bands.height, firstRow, rowCount, bands.dst, bands.dstPitch);
+}
+
+static void FFX_VariableShading_Api_Free(FFX_VariableShading_Context* context)
+{
+    const FFX_VariableShading_CpuAllocator allocator = context->allocator;
+    if (context->luminance)
+        allocator.deallocate(allocator.userData, context->luminance);
+    if (context->table)
+        allocator.deallocate(allocator.userData, context->table);
+    if (context->pool)
+    {
+        context->pool->~FFX_VariableShading_CpuThreadPool();
+        allocator.deallocate(allocator.userData, context->pool);
+    }
+    context->~FFX_VariableShading_Context();
+    allocator.deallocate(allocator.userData, context);
+}
+
+void FFX_VariableShading_GetDefaultContextDesc(FFX_VariableShading_ContextDesc* desc)
+{
+    if (!desc)
+        return;
+
+    desc->version = FFX_VARIABLESHADING_API_VERSION;
+    desc->maxWidth = 0;
+    desc->maxHeight = 0;
+    desc->tileSize = 16;
+    desc->inputMipLevel = 0;
+    desc->additionalShadingRates = 1;
+    desc->neighbourhoodShape = FFX_VARIABLESHADING_NEIGHBOURHOOD_DIAMOND;
+    desc->neighbourhoodRadius = 1;
+    desc->threadCount = 0;
+    desc->allocator.allocate = NULL;
+    desc->allocator.deallocate = NULL;
+    desc->allocator.userData = NULL;
+    desc->luminanceTransform = FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_NONE;
+    desc->luminanceNits = 80.0f;
+    desc->luminanceEpsilon = 1.0f / 64.0f;
+}
+
+FFX_VariableShading_Result FFX_VariableShading_CreateContext(const FFX_VariableShading_ContextDesc* desc, FFX_VariableShading_Context** context)
+{
+    if (!desc || !context)
+        return FFX_VARIABLESHADING_ERROR_INVALID_ARGUMENT;
+    *context = NULL;
+
+    if ((desc->version < 1) || (desc->version > FFX_VARIABLESHADING_API_VERSION) ||
+        !desc->maxWidth || !desc->maxHeight ||
+        ((desc->tileSize != 8) && (desc->tileSize != 16) && (desc->tileSize != 32)) ||
+        (desc->inputMipLevel > FFX_VariableShading_GetMaxInputMipLevel(desc->tileSize)) ||
+        (desc->allocator.allocate && !desc->allocator.deallocate))
+        return FFX_VARIABLESHADING_ERROR_INVALID_ARGUMENT;
+
+    // revision 1 ends before the luminance transform
+    FFX_VariableShading_ContextDesc fullDesc;
+    FFX_VariableShading_GetDefaultContextDesc(&fullDesc);
+    memcpy(&fullDesc, desc, (desc->version < 2) ? offsetof(FFX_VariableShading_ContextDesc, luminanceTransform) : sizeof(fullDesc));
+    if ((fullDesc.luminanceTransform >= FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_COUNT) || !(fullDesc.luminanceNits > 0.0f) || !(fullDesc.luminanceEpsilon > 0.0f))
+        return FFX_VARIABLESHADING_ERROR_INVALID_ARGUMENT;
+
+    FFX_VariableShading_CpuAllocator allocator = FFX_VariableShading_GetDefaultCpuAllocator();
+    if (desc->allocator.allocate)
+    {
+        allocator.allocate = desc->allocator.allocate;
+        allocator.deallocate = desc->allocator.deallocate;
+        allocator.userData = desc->allocator.userData;
+    }
+
+    uint32_t threadCount = desc->threadCount ? desc->threadCount : std::thread::hardware_concurrency();
+    threadCount = std::min(std::max(threadCount, 1u), FFX_VARIABLESHADING_CPU_CONTEXT_MAX_WORKERS);
+
+    void* memory = allocator.allocate(allocator.userData, sizeof(FFX_VariableShading_Context), alignof(FFX_VariableShading_Context));
+    if (!memory)
+        return FFX_VARIABLESHADING_ERROR_OUT_OF_MEMORY;
+
+    FFX_VariableShading_Context* ctx = new (memory) FFX_VariableShading_Context;
+    ctx->desc = fullDesc;
+    ctx->desc.threadCount = threadCount;
+    ctx->allocator = allocator;
+    ctx->config = FFX_VariableShading_GetDefaultCpuGeneratorConfig();
+    ctx->config.threadCount = threadCount;
+    ctx->pool = NULL;
+    ctx->table = NULL;
+    ctx->luminance = NULL;
+    ctx->luminancePitch = 0;
+
+    FFX_VariableShading_CpuContextDesc cpuDesc = {};
+    cpuDesc.cb = FFX_VariableShading_Api_GetCB(*desc, 0, 0, desc->maxWidth, desc->maxHeight, 0.0f, 0.0f);
+    cpuDesc.additionalShadingRates = (desc->additionalShadingRates != 0);
+    cpuDesc.neighbourhoodShape = desc->neighbourhoodShape;
+    cpuDesc.neighbourhoodRadius = desc->neighbourhoodRadius;
+    cpuDesc.workerCount = threadCount;
+    cpuDesc.allocateVrsImage = true;
+    if (!FFX_VariableShading_CreateCpuContext(&ctx->cpuContext, cpuDesc, allocator))
+    {
+        ctx->~FFX_VariableShading_Context();
+        allocator.deallocate(allocator.userData, memory);
+        return FFX_VARIABLESHADING_ERROR_OUT_OF_MEMORY;
+    }
+
+    FFX_VariableShading_LuminanceTransformDesc transformDesc;
+    transformDesc.transform = fullDesc.luminanceTransform;
+    transformDesc.nits = fullDesc.luminanceNits;
+    transformDesc.epsilon = fullDesc.luminanceEpsilon;
+    if (transformDesc.transform != FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_NONE)
+    {
+        const size_t tableCount = FFX_VariableShading_GetLuminanceTableCount(transformDesc);
+        if (tableCount)
+            ctx->table = (float*)allocator.allocate(allocator.userData, tableCount * sizeof(float), FFX_VARIABLESHADING_CACHE_LINE_SIZE);
+        ctx->luminancePitch = cpuDesc.cb.width;
+        ctx->luminance = (float*)allocator.allocate(allocator.userData, (size_t)cpuDesc.cb.width * cpuDesc.cb.height * sizeof(float), FFX_VARIABLESHADING_CACHE_LINE_SIZE);
+        if ((tableCount && !ctx->table) || !ctx->luminance)
+        {
+            FFX_VariableShading_DestroyCpuContext(&ctx->cpuContext);
+            FFX_VariableShading_Api_Free(ctx);
+            return FFX_VARIABLESHADING_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    FFX_VariableShading_InitLuminanceTransform(&ctx->transform, transformDesc, ctx->table);
+
+    // until the first frame the whole image is shaded at full rate
+    memset(ctx->cpuContext.vrsImage, FFX_VARIABLESHADING_RATE_1X1, (size_t)ctx->cpuContext.vrsImagePitch * ctx->cpuContext.vrsImageHeight);
+    ctx->image.data = ctx->cpuContext.vrsImage;
+    ctx->image.width = FFX_VariableShading_DivideRoundingUp(desc->maxWidth, desc->tileSize);
+    ctx->image.height = FFX_VariableShading_DivideRoundingUp(desc->maxHeight, desc->tileSize);
+    ctx->image.pitch = ctx->cpuContext.vrsImagePitch;
+    ctx->image.tileSize = desc->tileSize;
+    ctx->image.firstTileX = 0;
+    ctx->image.firstTileY = 0;
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+
+    if (threadCount > 1)
+    {
+        void* poolMemory = allocator.allocate(allocator.userData, sizeof(FFX_VariableShading_CpuThreadPool), alignof(FFX_VariableShading_CpuThreadPool));
+        try
+        {
+            if (poolMemory)
+                ctx->pool = new (poolMemory) FFX_VariableShading_CpuThreadPool(threadCount);
+        }
+        catch (...)
+        {
+        }
+
+        if (!ctx->pool)
+        {
+            if (poolMemory)
+                allocator.deallocate(allocator.userData, poolMemory);
+            FFX_VariableShading_DestroyCpuContext(&ctx->cpuContext);
+            FFX_VariableShading_Api_Free(ctx);
+            return FFX_VARIABLESHADING_ERROR_OUT_OF_MEMORY;
+        }
+    }
+
+    *context = ctx;
+    return FFX_VARIABLESHADING_OK;
+}
+
+static FFX_VariableShading_Result FFX_VariableShading_Api_SubmitInputs(FFX_VariableShading_Context* context, const FFX_VariableShading_FrameInputs* inputs)
+{
+    if (!context || !inputs || !inputs->luminance)
+        return FFX_VARIABLESHADING_ERROR_INVALID_ARGUMENT;
+
+    const FFX_VariableShading_ContextDesc& desc = context->desc;
+    if ((inputs->viewportX >= desc.maxWidth) || (inputs->viewportY >= desc.maxHeight))
+        return FFX_VARIABLESHADING_ERROR_DOES_NOT_FIT;
+
+    const uint32_t width = inputs->viewportWidth ? inputs->viewportWidth : desc.maxWidth - inputs->viewportX;
+    const uint32_t height = inputs->viewportHeight ? inputs->viewportHeight : desc.maxHeight - inputs->viewportY;
+    if ((width > desc.maxWidth - inputs->viewportX) || (height > desc.maxHeight - inputs->viewportY))
+        return FFX_VARIABLESHADING_ERROR_DOES_NOT_FIT;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    const FFX_VariableShading_CB cb = FFX_VariableShading_Api_GetCB(desc, inputs->viewportX, inputs->viewportY, width, height, inputs->varianceCutoff, inputs->motionFactor);
+
+    FFX_VariableShading_CpuInputs cpuInputs = {};
+    cpuInputs.luminance = inputs->luminance;
+    cpuInputs.luminancePitch = inputs->luminancePitch;
+    cpuInputs.motionVectors = inputs->motionVectors;
+    cpuInputs.motionVectorPitch = inputs->motionVectorPitch;
+    cpuInputs.motionVectorWidth = inputs->viewportX + width;
+    cpuInputs.motionVectorHeight = inputs->viewportY + height;
+    cpuInputs.mipLevel = desc.inputMipLevel;
+    cpuInputs.neighbourhoodShape = desc.neighbourhoodShape;
+    cpuInputs.neighbourhoodRadius = desc.neighbourhoodRadius;
+
+    if (context->luminance)
+    {
+        // only the viewport is read, see FFX_VariableShading_GetLuminance
+        FFX_VariableShading_Api_TransformBands bands;
+        bands.transform = &context->transform;
+        bands.src = inputs->luminance + (size_t)cb.viewportY * inputs->luminancePitch + cb.viewportX;
+        bands.srcPitch = inputs->luminancePitch;
+        bands.dst = context->luminance + (size_t)cb.viewportY * context->luminancePitch + cb.viewportX;
+        bands.dstPitch = context->luminancePitch;
+        bands.width = cb.width;
+        bands.height = cb.height;
+        const uint32_t bandCount = FFX_VariableShading_DivideRoundingUp(cb.height, FFX_VARIABLESHADING_API_TRANSFORM_BAND_ROWS);
+        if (context->pool)
+            context->pool->ParallelFor(bandCount, [&bands](uint32_t band) { FFX_VariableShading_Api_TransformBand(bands, band); });
+        else
+            for (uint32_t band = 0; band < bandCount; ++band)
+                FFX_VariableShading_Api_TransformBand(bands, band);
+
+        cpuInputs.luminance = context->luminance;
+        cpuInputs.luminancePitch = context->luminancePitch;
+    }
+
+    FFX_VariableShading_CpuContext* cpuContext = &context->cpuContext;
+    bool generated;
+    if (context->pool)
+    {
+        FFX_VariableShading_ThreadPoolParallelFor parallelFor = { context->pool };
+        generated = FFX_VariableShading_GenerateVrsImage(cpuContext, cb, cpuInputs, context->config, cpuContext->vrsImage, cpuContext->vrsImagePitch, parallelFor);
+    }
+    else
+    {
+        generated = FFX_VariableShading_GenerateVrsImage(cpuContext, cb, cpuInputs, cpuContext->vrsImage, cpuContext->vrsImagePitch);
+    }
+    if (!generated)
+        return FFX_VARIABLESHADING_ERROR_DOES_NOT_FIT;
+
+    uint32_t firstTileX, firstTileY, tilesX, tilesY;
+    FFX_VariableShading_GetViewportTiles(&cb, firstTileX, firstTileY, tilesX, tilesY);
+    context->image.width = firstTileX + tilesX;
+    context->image.height = firstTileY + tilesY;
+    context->image.firstTileX = firstTileX;
+    context->image.firstTileY = firstTileY;
+
+    FFX_VariableShading_FrameStats& stats = context->stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.tileCount = tilesX * tilesY;
+    float shaded = 0.0f;
+    for (uint32_t y = firstTileY; y < firstTileY + tilesY; ++y)
+    {
+        const uint8_t* row = cpuContext->vrsImage + (size_t)y * cpuContext->vrsImagePitch;
+        for (uint32_t x = firstTileX; x < firstTileX + tilesX; ++x)
+        {
+            ++stats.rateClassTileCounts[FFX_VariableShading_GetRateClass(row[x])];
+            shaded += 1.0f / (float)((1u << FFX_VariableShading_GetRate1DX(row[x])) << FFX_VariableShading_GetRate1DY(row[x]));
+        }
+    }
+    stats.shadedFraction = stats.tileCount ? shaded / (float)stats.tileCount : 1.0f;
+    stats.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return FFX_VARIABLESHADING_OK;
+}
+
+// with workers the pool's std::function tasks come from the global heap, std::bad_alloc must not reach C callers
+FFX_VariableShading_Result FFX_VariableShading_SubmitInputs(FFX_VariableShading_Context* context, const FFX_VariableShading_FrameInputs* inputs)
+{
+    try
+    {
+        return FFX_VariableShading_Api_SubmitInputs(context, inputs);
+    }
+    catch (...)
+    {
+        return FFX_VARIABLESHADING_ERROR_OUT_OF_MEMORY;
+    }
+}
+
+FFX_VariableShading_Result FFX_VariableShading_GetRateImage(const FFX_VariableShading_Context* context, FFX_VariableShading_RateImage* image)
+{
+    if (!context || !image)
+        return FFX_VARIABLESHADING_ERROR_INVALID_ARGUMENT;
+
+    *image = context->image;
+    return FFX_VARIABLESHADING_OK;
+}
+
+FFX_VariableShading_Result FFX_VariableShading_GetFrameStats(const FFX_VariableShading_Context* context, FFX_VariableShading_FrameStats* stats)
+{
+    if (!context || !stats)
+        return FFX_VARIABLESHADING_ERROR_INVALID_ARGUMENT;
+
+    *stats = context->stats;
+    return FFX_VARIABLESHADING_OK;
+}
+
+void FFX_VariableShading_DestroyContext(FFX_VariableShading_Context* context)
+{
+    if (!context)
+        return;
+
+    FFX_VariableShading_DestroyCpuContext(&context->cpuContext);
+    FFX_VariableShading_Api_Free(context);
+}
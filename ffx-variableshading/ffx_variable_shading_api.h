@@ -0,0 +1,161 @@
+// FFX_VariableShading_Api.h
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//////////////////////////////////////////////////////////////////////////
+// VariableShading C API
+//
+// Interface of the ffx_variableshading (static) and ffx_variableshading_shared
+// libraries built by ffx-variableshading/CMakeLists.txt. It wraps the CPU
+// generator of ffx_variable_shading_cpu.h behind an opaque context, so
+// engines and tools link one binary instead of including the headers with
+// their own FFX_CPP setup and defines:
+//
+//   FFX_VariableShading_ContextDesc desc;
+//   FFX_VariableShading_GetDefaultContextDesc(&desc);
+//   desc.maxWidth = 3840;
+//   desc.maxHeight = 2160;
+//   desc.tileSize = 16;
+//   FFX_VariableShading_Context* context;
+//   FFX_VariableShading_CreateContext(&desc, &context);
+//   ...
+//   FFX_VariableShading_SubmitInputs(context, &frameInputs);
+//   FFX_VariableShading_GetRateImage(context, &rateImage);
+//   ...
+//   FFX_VariableShading_DestroyContext(context);
+//
+// Everything independent of the frame is set up by CreateContext: the
+// per worker scratch arenas and the VRS image for the maximum size, the
+// constants of the input mip level and the worker threads. SubmitInputs
+// generates the VRS image of one frame before it returns. With a
+// threadCount of 1 it does not allocate, with workers handing the tasks to
+// them allocates a few small records per frame from the global heap (not
+// from desc.allocator). Should that fail, SubmitInputs returns
+// FFX_VARIABLESHADING_ERROR_OUT_OF_MEMORY, no C++ exception crosses this
+// interface. With a luminanceTransform the context transforms the viewport
+// of each frame into a plane of its own first (see
+// ffx_variable_shading_cpu_luminance.h), for linear HDR luminance. A context may be used by one thread at a time, different
+// contexts are independent.
+//
+// The structs only grow at their end, desc.version tells the library
+// which revision the caller was compiled against.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(FFX_VARIABLESHADING_SHARED)
+#if defined(_WIN32)
+#if defined(FFX_VARIABLESHADING_BUILD)
+#define FFX_VARIABLESHADING_API __declspec(dllexport)
+#else
+#define FFX_VARIABLESHADING_API __declspec(dllimport)
+#endif
+#else
+#define FFX_VARIABLESHADING_API __attribute__((visibility("default")))
+#endif
+#else
+#define FFX_VARIABLESHADING_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FFX_VARIABLESHADING_API_VERSION 2
+
+typedef enum FFX_VariableShading_Result
+{
+    FFX_VARIABLESHADING_OK                      = 0,
+    FFX_VARIABLESHADING_ERROR_INVALID_ARGUMENT  = -1,   // NULL pointer, unsupported tile size or mip level, version mismatch
+    FFX_VARIABLESHADING_ERROR_OUT_OF_MEMORY     = -2,   // the allocator returned NULL, the workers could not be started or not be handed the frame's tasks
+    FFX_VARIABLESHADING_ERROR_DOES_NOT_FIT      = -3,   // the viewport exceeds the maximum size of the context
+} FFX_VariableShading_Result;
+
+// allocate returns memory aligned to alignment (a power of two) or NULL, used by CreateContext only
+typedef struct FFX_VariableShading_Allocator
+{
+    void*   (*allocate)(void* userData, size_t size, size_t alignment);
+    void    (*deallocate)(void* userData, void* memory);
+    void*   userData;
+} FFX_VariableShading_Allocator;
+
+typedef struct FFX_VariableShading_ContextDesc
+{
+    uint32_t                        version;                // FFX_VARIABLESHADING_API_VERSION
+    uint32_t                        maxWidth, maxHeight;    // largest surface in full resolution pixels
+    uint32_t                        tileSize;               // 8, 16 or 32
+    uint32_t                        inputMipLevel;          // level of the luminance planes, at most log2(tileSize / 8)
+    uint32_t                        additionalShadingRates; // 0: 1X1 to 2X2, otherwise up to 4X4
+    uint32_t                        neighbourhoodShape;     // 0: diamond, 1: square
+    uint32_t                        neighbourhoodRadius;    // 0 or 1 with a diamond: the 4 neighbours of the GPU version
+    uint32_t                        threadCount;            // 0: one per hardware thread, 1: generate on the calling thread
+    FFX_VariableShading_Allocator   allocator;              // allocate NULL: malloc
+    // version 2
+    uint32_t                        luminanceTransform;     // FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_* of ffx_variable_shading_luminance.h, 0: none
+    float                           luminanceNits;          // PQ: nits of a luminance of 1
+    float                           luminanceEpsilon;       // LOG2, WEBER: luminance below which differences fade out
+} FFX_VariableShading_ContextDesc;
+
+typedef struct FFX_VariableShading_FrameInputs
+{
+    const float*    luminance;          // plane of the input mip level, indexed in surface coordinates (not relative to the viewport),
+                                        // linear luminance with a luminanceTransform
+    uint32_t        luminancePitch;     // in floats
+    const float*    motionVectors;      // optional: 2 floats per full resolution pixel, in pixels
+    uint32_t        motionVectorPitch;  // in floats
+    uint32_t        viewportX, viewportY;           // in full resolution pixels
+    uint32_t        viewportWidth, viewportHeight;  // 0: maxWidth - viewportX, maxHeight - viewportY
+    float           varianceCutoff;     // for full resolution luminance, scaled to the mip level by the library
+    float           motionFactor;
+} FFX_VariableShading_FrameInputs;
+
+// One FFX_VARIABLESHADING_RATE_* value ((rateX << 2) | rateY) per tile, owned by the context and
+// valid until the next SubmitInputs. Only the tiles of the last viewport are written.
+typedef struct FFX_VariableShading_RateImage
+{
+    const uint8_t*  data;
+    uint32_t        width, height;      // in tiles, up to the right and bottom edge of the viewport
+    uint32_t        pitch;              // in bytes
+    uint32_t        tileSize;
+    uint32_t        firstTileX, firstTileY; // first tile of the viewport
+} FFX_VariableShading_RateImage;
+
+typedef struct FFX_VariableShading_FrameStats
+{
+    uint32_t        tileCount;              // tiles of the viewport
+    uint32_t        rateClassTileCounts[7]; // 1X1, 1X2, 2X1, 2X2, 2X4, 4X2, 4X4
+    float           shadedFraction;         // pixel shader invocations relative to full rate shading
+    float           milliseconds;           // CPU time of the last SubmitInputs
+} FFX_VariableShading_FrameStats;
+
+typedef struct FFX_VariableShading_Context FFX_VariableShading_Context;
+
+FFX_VARIABLESHADING_API void                        FFX_VariableShading_GetDefaultContextDesc(FFX_VariableShading_ContextDesc* desc);
+FFX_VARIABLESHADING_API FFX_VariableShading_Result  FFX_VariableShading_CreateContext(const FFX_VariableShading_ContextDesc* desc, FFX_VariableShading_Context** context);
+FFX_VARIABLESHADING_API FFX_VariableShading_Result  FFX_VariableShading_SubmitInputs(FFX_VariableShading_Context* context, const FFX_VariableShading_FrameInputs* inputs);
+FFX_VARIABLESHADING_API FFX_VariableShading_Result  FFX_VariableShading_GetRateImage(const FFX_VariableShading_Context* context, FFX_VariableShading_RateImage* image);
+FFX_VARIABLESHADING_API FFX_VariableShading_Result  FFX_VariableShading_GetFrameStats(const FFX_VariableShading_Context* context, FFX_VariableShading_FrameStats* stats);
+FFX_VARIABLESHADING_API void                        FFX_VariableShading_DestroyContext(FFX_VariableShading_Context* context);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,1691 @@
+// FFX_VariableShading_Cpu.h
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//////////////////////////////////////////////////////////////////////////
+// VariableShading CPU side helpers
+//
+// This header contains API independent C++ code that works on VRS images
+// once they are available in CPU memory (e.g. read back from the GPU).
+// A VRS image is one uint8_t per tile, holding one of the
+// FFX_VARIABLESHADING_RATE_* values.
+//
+// RateQuery Builds summed area tables over a VRS image and returns the
+// finest shading rate inside any rectangle in O(1). This allows
+// hardware only supporting per draw shading rates (D3D12 Tier 1)
+// to pick a rate for each draw from its projected bounding rectangle.
+//
+// ExecuteRateAware Reference implementation of software VRS for compute passes
+// (see ffx_variable_shading_software.h): evaluates one sample
+// per coarse pixel and broadcasts it to all covered pixels.
+//
+// TileLists Compacts the tiles of a VRS image into one list per rate class
+// plus indirect dispatch arguments, matching the GPU lists written
+// with FFX_VARIABLESHADING_TILELISTS (only the order within a
+// list differs: row major here, unordered on the GPU).
+//
+// QpOffsets Converts the per tile statistics written with
+// FFX_VARIABLESHADING_TILESTATS into per 16x16 macroblock QP
+// offsets for video encoders (x264/x265 quant_offsets, NVENC
+// delta QP maps), replacing the encoder's own AQ analysis.
+//
+// GenerateVrsImage CPU port of FFX_VariableShading_GenerateVrsImage, working on
+// float luminance planes of any mip level (see
+// FFX_VariableShading_SetInputMipLevel), in tasks of tile groups and bands
+// (FFX_VariableShading_CpuGeneratorConfig, tuned per machine by
+// ffx_variable_shading_cpu_autotune.h). With a reserved
+// FFX_VariableShading_CpuGeneratorScratch viewport changes do not allocate,
+// ffx_variable_shading_cpu_context.h keeps per worker arenas from a caller
+// provided allocator. Luminance planes are row linear or swizzled
+// in tile sized blocks (FFX_VariableShading_SwizzleLuminance), or bands
+// of rows (firstRow/rowCount), which ffx_variable_shading_cpu_stream.h
+// uses to generate from rows pushed top to bottom. Linear HDR luminance
+// is made perceptual first with ffx_variable_shading_cpu_luminance.h.
+// A FFX_VariableShading_RatePolicy sets a cutoff per rate class, skips
+// the neighbourhood step for a cheaper pass or maps the per tile (per
+// 4x4 block) variances to rates with a user functor.
+// CapShadingRates Derives the VRS image for passes limited to 2x2 from one
+// generated with additional shading rates, matching
+// FFX_VARIABLESHADING_CAPPEDIMAGE, without analyzing the frame again.
+// DilateShadingRates Widens fine rates to a square or diamond neighbourhood at a
+// cost independent of its radius, the CPU version of
+// ffx_variable_shading_dilation.h.
+// DownsampleShadingRates Derives the VRS image of another tile size or surface
+// size from a generated one, the CPU version of
+// ffx_variable_shading_downsample.h. Rows are combined with SSE2 or NEON
+// where available (define FFX_VARIABLESHADING_NO_SIMD for plain C++).
+// ffx_variable_shading_cpu_targets.h builds on it to convert VRS images
+// for Vulkan fragment shading rate and density maps and Metal rate maps.
+// Define FFX_VARIABLESHADING_PROFILE for per stage counters, see
+// ffx_variable_shading_cpu_profile.h, FFX_VARIABLESHADING_TRACE for
+// timeline events, see ffx_variable_shading_trace.h
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+#include <cmath>
+
+#if !defined(FFX_CPP)
+#define FFX_CPP
+#endif
+#include "ffx_variable_shading.h"
+#include "ffx_variable_shading_dilation.h"
+#include "ffx_variable_shading_downsample.h"
+
+#if !defined(FFX_VARIABLESHADING_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FFX_VARIABLESHADING_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define FFX_VARIABLESHADING_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(FFX_VARIABLESHADING_PROFILE) || defined(FFX_VARIABLESHADING_TRACE)
+#include "ffx_variable_shading_cpu_profile.h"
+#else
+#define FFX_VARIABLESHADING_PROFILE_BEGIN()
+#define FFX_VARIABLESHADING_PROFILE_STAGE(stage)
+#define FFX_VARIABLESHADING_PROFILE_ADD(counter, value)
+#endif
+
+#if defined(FFX_VARIABLESHADING_TRACE)
+#include "ffx_variable_shading_trace.h"
+#else
+#define FFX_VARIABLESHADING_TRACE_SCOPE(name, category)
+#define FFX_VARIABLESHADING_TRACE_SCOPE_ARGS(name, category, argNames, ...)
+#endif
+
+#ifndef FFX_VARIABLESHADING_MAKE_SHADING_RATE
+#define FFX_VARIABLESHADING_MAKE_SHADING_RATE(x,y) ((x << 2) | (y))
+#endif
+
+static const uint32_t FFX_VARIABLESHADING_RATE1D_1X = 0x0;
+static const uint32_t FFX_VARIABLESHADING_RATE1D_2X = 0x1;
+static const uint32_t FFX_VARIABLESHADING_RATE1D_4X = 0x2;
+
+static const uint32_t FFX_VARIABLESHADING_RATE_1X1 = FFX_VARIABLESHADING_MAKE_SHADING_RATE(FFX_VARIABLESHADING_RATE1D_1X, FFX_VARIABLESHADING_RATE1D_1X); // 0;
+static const uint32_t FFX_VARIABLESHADING_RATE_1X2 = FFX_VARIABLESHADING_MAKE_SHADING_RATE(FFX_VARIABLESHADING_RATE1D_1X, FFX_VARIABLESHADING_RATE1D_2X); // 0x1;
+static const uint32_t FFX_VARIABLESHADING_RATE_2X1 = FFX_VARIABLESHADING_MAKE_SHADING_RATE(FFX_VARIABLESHADING_RATE1D_2X, FFX_VARIABLESHADING_RATE1D_1X); // 0x4;
+static const uint32_t FFX_VARIABLESHADING_RATE_2X2 = FFX_VARIABLESHADING_MAKE_SHADING_RATE(FFX_VARIABLESHADING_RATE1D_2X, FFX_VARIABLESHADING_RATE1D_2X); // 0x5;
+static const uint32_t FFX_VARIABLESHADING_RATE_2X4 = FFX_VARIABLESHADING_MAKE_SHADING_RATE(FFX_VARIABLESHADING_RATE1D_2X, FFX_VARIABLESHADING_RATE1D_4X); // 0x6;
+static const uint32_t FFX_VARIABLESHADING_RATE_4X2 = FFX_VARIABLESHADING_MAKE_SHADING_RATE(FFX_VARIABLESHADING_RATE1D_4X, FFX_VARIABLESHADING_RATE1D_2X); // 0x9;
+static const uint32_t FFX_VARIABLESHADING_RATE_4X4 = FFX_VARIABLESHADING_MAKE_SHADING_RATE(FFX_VARIABLESHADING_RATE1D_4X, FFX_VARIABLESHADING_RATE1D_4X); // 0xa;
+
+inline uint32_t FFX_VariableShading_GetRate1DX(uint32_t rate) { return (rate >> 2) & 0x3; }
+inline uint32_t FFX_VariableShading_GetRate1DY(uint32_t rate) { return rate & 0x3; }
+
+// combine two shading rates so the result is never coarser than either input (finest rate wins per axis)
+inline uint32_t FFX_VariableShading_CombineRates(uint32_t a, uint32_t b)
+{
+    return FFX_VARIABLESHADING_MAKE_SHADING_RATE(
+        std::min(FFX_VariableShading_GetRate1DX(a), FFX_VariableShading_GetRate1DX(b)),
+        std::min(FFX_VariableShading_GetRate1DY(a), FFX_VariableShading_GetRate1DY(b)));
+}
+
+// tile lists are ordered 1X1, 1X2, 2X1, 2X2, 2X4, 4X2, 4X4
+static const uint32_t FFX_VARIABLESHADING_RATE_CLASS_COUNT = 7;
+
+inline uint32_t FFX_VariableShading_GetRateClass(uint32_t rate)
+{
+    static const uint8_t rateClass[16] = { 0, 1, 0, 0, 2, 3, 4, 0, 0, 5, 6, 0, 0, 0, 0, 0 };
+    return rateClass[rate & 0xf];
+}
+
+inline uint32_t FFX_VariableShading_GetRateFromClass(uint32_t rateClass)
+{
+    static const uint8_t rate[FFX_VARIABLESHADING_RATE_CLASS_COUNT] = { 0x0, 0x1, 0x4, 0x5, 0x6, 0x9, 0xa };
+    return rate[rateClass];
+}
+
+// limit a shading rate to maxRate1D per axis, e.g. FFX_VARIABLESHADING_RATE1D_2X if additional shading rates are not supported
+inline uint32_t FFX_VariableShading_ClampRate(uint32_t rate, uint32_t maxRate1D)
+{
+    return FFX_VARIABLESHADING_MAKE_SHADING_RATE(
+        std::min(FFX_VariableShading_GetRate1DX(rate), maxRate1D),
+        std::min(FFX_VariableShading_GetRate1DY(rate), maxRate1D));
+}
+
+// Limits every tile of a VRS image to maxRate1D per axis, capped may be vrsImage. With
+// FFX_VARIABLESHADING_RATE1D_2X this is the image FFX_VARIABLESHADING_CAPPEDIMAGE writes.
+inline void FFX_VariableShading_CapShadingRates(const uint8_t* vrsImage, uint32_t width, uint32_t height, uint32_t pitch, uint32_t maxRate1D, uint8_t* capped, uint32_t cappedPitch)
+{
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            capped[y * cappedPitch + x] = (uint8_t)FFX_VariableShading_ClampRate(vrsImage[y * pitch + x], maxRate1D);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------//
+// Per draw shading rates from a VRS image (Tier 1 emulation)                          //
+//--------------------------------------------------------------------------------------//
+// For every axis two summed area tables are kept: the number of tiles with 1X rate
+// and the number of tiles with a rate of at most 2X. A rectangle query then only
+// needs to check which counters are non-zero to find the finest rate per axis.
+// Since only 1x2, 2x1, 2x2, 2x4, 4x2 and 4x4 can be stored in a VRS image the
+// per axis result is always a valid shading rate.
+struct FFX_VariableShading_RateQuery
+{
+    uint32_t                width = 0;      // VRS image width in tiles
+    uint32_t                height = 0;     // VRS image height in tiles
+    uint32_t                tileSize = 0;   // tile size in pixels
+    std::vector<uint32_t>   sat[4];         // (width + 1) * (height + 1) entries each: X 1X, X <= 2X, Y 1X, Y <= 2X
+};
+
+// build the summed area tables, pitch is the row pitch of the VRS image in bytes
+// storage is only reallocated when the VRS image grows
+inline void FFX_VariableShading_BuildRateQuery(FFX_VariableShading_RateQuery* query, const uint8_t* vrsImage, uint32_t width, uint32_t height, uint32_t pitch, uint32_t tileSize)
+{
+    query->width = width;
+    query->height = height;
+    query->tileSize = tileSize;
+
+    const uint32_t satPitch = width + 1;
+    for (int i = 0; i < 4; ++i)
+    {
+        query->sat[i].resize(satPitch * (height + 1));
+        std::fill(query->sat[i].begin(), query->sat[i].begin() + satPitch, 0u);
+    }
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const uint8_t* row = vrsImage + y * pitch;
+        uint32_t rowSum[4] = {};
+
+        uint32_t* dst[4];
+        const uint32_t* above[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            dst[i] = &query->sat[i][(y + 1) * satPitch];
+            above[i] = &query->sat[i][y * satPitch];
+            dst[i][0] = 0;
+        }
+
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            uint32_t rateX = FFX_VariableShading_GetRate1DX(row[x]);
+            uint32_t rateY = FFX_VariableShading_GetRate1DY(row[x]);
+
+            rowSum[0] += (rateX == FFX_VARIABLESHADING_RATE1D_1X) ? 1 : 0;
+            rowSum[1] += (rateX <= FFX_VARIABLESHADING_RATE1D_2X) ? 1 : 0;
+            rowSum[2] += (rateY == FFX_VARIABLESHADING_RATE1D_1X) ? 1 : 0;
+            rowSum[3] += (rateY <= FFX_VARIABLESHADING_RATE1D_2X) ? 1 : 0;
+
+            for (int i = 0; i < 4; ++i)
+            {
+                dst[i][x + 1] = above[i][x + 1] + rowSum[i];
+            }
+        }
+    }
+}
+
+// return the finest shading rate of all tiles in [x0, x1) x [y0, y1), coordinates in tiles
+// an empty (or fully clipped) rectangle returns FFX_VARIABLESHADING_RATE_1X1
+inline uint32_t FFX_VariableShading_QueryRateTiles(const FFX_VariableShading_RateQuery* query, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+    x1 = std::min(x1, query->width);
+    y1 = std::min(y1, query->height);
+    if ((x0 >= x1) || (y0 >= y1))
+        return FFX_VARIABLESHADING_RATE_1X1;
+
+    const uint32_t satPitch = query->width + 1;
+    auto count = [&](int i)
+    {
+        const uint32_t* s = query->sat[i].data();
+        return s[y1 * satPitch + x1] - s[y0 * satPitch + x1] - s[y1 * satPitch + x0] + s[y0 * satPitch + x0];
+    };
+
+    uint32_t rateX = count(0) ? FFX_VARIABLESHADING_RATE1D_1X : (count(1) ? FFX_VARIABLESHADING_RATE1D_2X : FFX_VARIABLESHADING_RATE1D_4X);
+    uint32_t rateY = count(2) ? FFX_VARIABLESHADING_RATE1D_1X : (count(3) ? FFX_VARIABLESHADING_RATE1D_2X : FFX_VARIABLESHADING_RATE1D_4X);
+
+    return FFX_VARIABLESHADING_MAKE_SHADING_RATE(rateX, rateY);
+}
+
+// same as above, but the rectangle [left, right) x [top, bottom) is given in pixels
+// (e.g. the projected bounding rectangle of a draw); all touched tiles are considered
+inline uint32_t FFX_VariableShading_QueryRate(const FFX_VariableShading_RateQuery* query, int32_t left, int32_t top, int32_t right, int32_t bottom)
+{
+    if ((query->tileSize == 0) || (right <= 0) || (bottom <= 0))
+        return FFX_VARIABLESHADING_RATE_1X1;
+
+    uint32_t x0 = (uint32_t)std::max(left, 0) / query->tileSize;
+    uint32_t y0 = (uint32_t)std::max(top, 0) / query->tileSize;
+    uint32_t x1 = ((uint32_t)right + query->tileSize - 1) / query->tileSize;
+    uint32_t y1 = ((uint32_t)bottom + query->tileSize - 1) / query->tileSize;
+
+    return FFX_VariableShading_QueryRateTiles(query, x0, y0, x1, y1);
+}
+
+// Sort draws by shading rate (coarse to fine) to minimize the number of shading rate changes.
+// The sort is stable, so draws with the same rate keep their (e.g. front to back) order.
+// getRate is any callable returning the shading rate of an element.
+template <typename Iterator, typename GetRate>
+void FFX_VariableShading_SortByShadingRate(Iterator begin, Iterator end, GetRate getRate)
+{
+    std::stable_sort(begin, end, [&](const typename std::iterator_traits<Iterator>::value_type& a, const typename std::iterator_traits<Iterator>::value_type& b)
+    {
+        return getRate(a) > getRate(b);
+    });
+}
+
+//--------------------------------------------------------------------------------------//
+// Software VRS reference implementation                                                //
+//--------------------------------------------------------------------------------------//
+// evaluate(x, y) returns the value of the pass for one pixel,
+// write(x, y, value) stores it. Each coarse pixel is evaluated at its upper left pixel,
+// matching FFX_VariableShading_SoftwareVrs_Execute.
+// Returns the number of evaluations.
+template <typename Evaluate, typename Write>
+uint64_t FFX_VariableShading_ExecuteRateAware(const uint8_t* vrsImage, uint32_t vrsImagePitch, uint32_t tileSize, uint32_t width, uint32_t height, Evaluate evaluate, Write write)
+{
+    uint64_t evaluations = 0;
+
+    for (uint32_t tileY = 0; tileY * tileSize < height; ++tileY)
+    {
+        for (uint32_t tileX = 0; tileX * tileSize < width; ++tileX)
+        {
+            uint32_t rate = vrsImage[tileY * vrsImagePitch + tileX];
+            uint32_t coarseWidth = 1u << FFX_VariableShading_GetRate1DX(rate);
+            uint32_t coarseHeight = 1u << FFX_VariableShading_GetRate1DY(rate);
+
+            uint32_t x1 = std::min((tileX + 1) * tileSize, width);
+            uint32_t y1 = std::min((tileY + 1) * tileSize, height);
+
+            for (uint32_t y = tileY * tileSize; y < y1; y += coarseHeight)
+            {
+                for (uint32_t x = tileX * tileSize; x < x1; x += coarseWidth)
+                {
+                    auto value = evaluate(x, y);
+                    ++evaluations;
+
+                    for (uint32_t j = y; j < std::min(y + coarseHeight, y1); ++j)
+                    {
+                        for (uint32_t i = x; i < std::min(x + coarseWidth, x1); ++i)
+                        {
+                            write(i, j, value);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return evaluations;
+}
+
+struct FFX_VariableShading_RateAwareError
+{
+    double      maxError;
+    double      meanError;
+    uint64_t    evaluations;    // evaluations with the VRS image applied
+    uint64_t    pixels;         // evaluations at full rate
+};
+
+// Runs evaluate at full rate and rate aware and compares the results.
+// error(a, b) returns the (non-negative) difference between two values of the pass.
+template <typename Evaluate, typename Error>
+FFX_VariableShading_RateAwareError FFX_VariableShading_ValidateRateAware(const uint8_t* vrsImage, uint32_t vrsImagePitch, uint32_t tileSize, uint32_t width, uint32_t height, Evaluate evaluate, Error error)
+{
+    FFX_VariableShading_RateAwareError result = {};
+    double sum = 0.0;
+
+    result.evaluations = FFX_VariableShading_ExecuteRateAware(vrsImage, vrsImagePitch, tileSize, width, height, evaluate,
+        [&](uint32_t x, uint32_t y, const decltype(evaluate(0u, 0u))& value)
+        {
+            double e = (double)error(value, evaluate(x, y));
+            result.maxError = std::max(result.maxError, e);
+            sum += e;
+        });
+    result.pixels = (uint64_t)width * height;
+    result.meanError = result.pixels ? sum / (double)result.pixels : 0.0;
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------//
+// Per rate tile lists                                                                  //
+//--------------------------------------------------------------------------------------//
+// same layout as D3D12_DISPATCH_ARGUMENTS
+struct FFX_VariableShading_DispatchArguments
+{
+    uint32_t threadGroupCountX;
+    uint32_t threadGroupCountY;
+    uint32_t threadGroupCountZ;
+};
+
+struct FFX_VariableShading_TileLists
+{
+    FFX_VariableShading_DispatchArguments   arguments[FFX_VARIABLESHADING_RATE_CLASS_COUNT];   // one threadgroup per tile
+    uint32_t                                offset[FFX_VARIABLESHADING_RATE_CLASS_COUNT];      // first entry of each class in tiles
+    std::vector<uint32_t>                   tiles;          // packed tile coordinates, grouped by rate class
+    std::vector<uint32_t>                   rowOffsets;     // per tile row and class scatter offsets
+};
+
+inline uint32_t FFX_VariableShading_PackTile(uint32_t x, uint32_t y) { return x | (y << 16); }
+inline uint32_t FFX_VariableShading_UnpackTileX(uint32_t tile) { return tile & 0xffff; }
+inline uint32_t FFX_VariableShading_UnpackTileY(uint32_t tile) { return tile >> 16; }
+
+// Builds the tile lists with a parallel prefix scan: every tile row is counted and scattered
+// independently, only the scan over the per row counts is serial.
+// parallelFor(count, fn) has to call fn(i) for all i in [0, count), in any order and on any thread.
+template <typename ParallelFor>
+void FFX_VariableShading_BuildTileLists(FFX_VariableShading_TileLists* lists, const uint8_t* vrsImage, uint32_t width, uint32_t height, uint32_t pitch, ParallelFor parallelFor)
+{
+    const uint32_t classCount = FFX_VARIABLESHADING_RATE_CLASS_COUNT;
+    std::vector<uint32_t>& rowOffsets = lists->rowOffsets;
+    rowOffsets.resize((size_t)height * classCount);
+
+    // count the tiles of each class per row
+    parallelFor(height, [&](uint32_t y)
+    {
+        uint32_t* counts = &rowOffsets[(size_t)y * classCount];
+        std::fill(counts, counts + classCount, 0u);
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            ++counts[FFX_VariableShading_GetRateClass(vrsImage[y * pitch + x])];
+        }
+    });
+
+    // exclusive scan, class major so every list is contiguous
+    uint32_t sum = 0;
+    for (uint32_t c = 0; c < classCount; ++c)
+    {
+        lists->offset[c] = sum;
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            uint32_t count = rowOffsets[(size_t)y * classCount + c];
+            rowOffsets[(size_t)y * classCount + c] = sum;
+            sum += count;
+        }
+        lists->arguments[c].threadGroupCountX = sum - lists->offset[c];
+        lists->arguments[c].threadGroupCountY = 1;
+        lists->arguments[c].threadGroupCountZ = 1;
+    }
+    lists->tiles.resize(sum);
+
+    // scatter
+    parallelFor(height, [&](uint32_t y)
+    {
+        uint32_t cursor[FFX_VARIABLESHADING_RATE_CLASS_COUNT];
+        std::copy(&rowOffsets[(size_t)y * classCount], &rowOffsets[(size_t)y * classCount] + classCount, cursor);
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            lists->tiles[cursor[FFX_VariableShading_GetRateClass(vrsImage[y * pitch + x])]++] = FFX_VariableShading_PackTile(x, y);
+        }
+    });
+}
+
+inline void FFX_VariableShading_BuildTileLists(FFX_VariableShading_TileLists* lists, const uint8_t* vrsImage, uint32_t width, uint32_t height, uint32_t pitch)
+{
+    FFX_VariableShading_BuildTileLists(lists, vrsImage, width, height, pitch, [](uint32_t count, const std::function<void(uint32_t)>& fn)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+            fn(i);
+    });
+}
+
+//--------------------------------------------------------------------------------------//
+// Encoder QP offset maps                                                               //
+//--------------------------------------------------------------------------------------//
+// one element of the tile statistics plane (DXGI_FORMAT_R32G32B32A32_FLOAT)
+struct FFX_VariableShading_TileStats
+{
+    float maxVariance;      // max luminance range of the 2x2 quads in the tile
+    float minLuminance;
+    float maxLuminance;
+    float maxMotion;        // max motion vector length in pixels
+};
+
+struct FFX_VariableShading_QpOffsetParams
+{
+    float varianceStrength;     // QP offset per doubling of variance relative to the frame average (like x264 --aq-strength)
+    float motionStrength;       // QP offset per doubling of (1 + motion in pixels), fast motion masks artifacts
+    float varianceFloor;        // variance below this is treated as flat
+    float minOffset;
+    float maxOffset;
+};
+
+inline FFX_VariableShading_QpOffsetParams FFX_VariableShading_GetDefaultQpOffsetParams()
+{
+    FFX_VariableShading_QpOffsetParams params;
+    params.varianceStrength = 1.0f;
+    params.motionStrength = 1.0f;
+    params.varianceFloor = 1.0f / 1024.0f;
+    params.minOffset = -6.0f;
+    params.maxOffset = 6.0f;
+    return params;
+}
+
+static const uint32_t FFX_VARIABLESHADING_MACROBLOCK_SIZE = 16;
+
+inline void FFX_VariableShading_GetMacroblockCount(uint32_t width, uint32_t height, uint32_t& macroblocksX, uint32_t& macroblocksY)
+{
+    macroblocksX = (width + FFX_VARIABLESHADING_MACROBLOCK_SIZE - 1) / FFX_VARIABLESHADING_MACROBLOCK_SIZE;
+    macroblocksY = (height + FFX_VARIABLESHADING_MACROBLOCK_SIZE - 1) / FFX_VARIABLESHADING_MACROBLOCK_SIZE;
+}
+
+// Aggregates the tiles covered by macroblock (mx, my): max variance and min motion,
+// so neither texture nor motion masking is assumed for a partially textured or moving macroblock.
+inline FFX_VariableShading_TileStats FFX_VariableShading_GetMacroblockStats(const FFX_VariableShading_TileStats* stats, uint32_t statsPitch, uint32_t tileSize, uint32_t tilesX, uint32_t tilesY, uint32_t mx, uint32_t my)
+{
+    uint32_t x0 = mx * FFX_VARIABLESHADING_MACROBLOCK_SIZE / tileSize;
+    uint32_t y0 = my * FFX_VARIABLESHADING_MACROBLOCK_SIZE / tileSize;
+    uint32_t x1 = std::min(((mx + 1) * FFX_VARIABLESHADING_MACROBLOCK_SIZE + tileSize - 1) / tileSize, tilesX);
+    uint32_t y1 = std::min(((my + 1) * FFX_VARIABLESHADING_MACROBLOCK_SIZE + tileSize - 1) / tileSize, tilesY);
+
+    FFX_VariableShading_TileStats result = { 0.0f, INFINITY, 0.0f, INFINITY };
+    for (uint32_t y = y0; y < y1; ++y)
+    {
+        for (uint32_t x = x0; x < x1; ++x)
+        {
+            const FFX_VariableShading_TileStats& tile = stats[y * statsPitch + x];
+            result.maxVariance = std::max(result.maxVariance, tile.maxVariance);
+            result.minLuminance = std::min(result.minLuminance, tile.minLuminance);
+            result.maxLuminance = std::max(result.maxLuminance, tile.maxLuminance);
+            result.maxMotion = std::min(result.maxMotion, tile.maxMotion);
+        }
+    }
+    return result;
+}
+
+// Writes one QP offset per 16x16 macroblock of a width x height frame to qpOffsets (row major, no padding).
+// The variance term is relative to the frame average, so textured regions get a positive offset and
+// flat ones a negative offset, x264/x265 take the result directly as quant_offsets.
+inline void FFX_VariableShading_ComputeQpOffsets(const FFX_VariableShading_TileStats* stats, uint32_t statsPitch, uint32_t tileSize, uint32_t width, uint32_t height, const FFX_VariableShading_QpOffsetParams& params, float* qpOffsets)
+{
+    uint32_t macroblocksX, macroblocksY;
+    FFX_VariableShading_GetMacroblockCount(width, height, macroblocksX, macroblocksY);
+    const uint32_t tilesX = (width + tileSize - 1) / tileSize;
+    const uint32_t tilesY = (height + tileSize - 1) / tileSize;
+    const uint32_t macroblockCount = macroblocksX * macroblocksY;
+    if (macroblockCount == 0)
+        return;
+
+    // log2 variance per macroblock and its frame average
+    double sum = 0.0;
+    for (uint32_t my = 0; my < macroblocksY; ++my)
+    {
+        for (uint32_t mx = 0; mx < macroblocksX; ++mx)
+        {
+            FFX_VariableShading_TileStats macroblock = FFX_VariableShading_GetMacroblockStats(stats, statsPitch, tileSize, tilesX, tilesY, mx, my);
+            float logVariance = std::log2(std::max(macroblock.maxVariance, params.varianceFloor));
+            qpOffsets[my * macroblocksX + mx] = logVariance;
+            sum += logVariance;
+        }
+    }
+    const float average = (float)(sum / macroblockCount);
+
+    for (uint32_t my = 0; my < macroblocksY; ++my)
+    {
+        for (uint32_t mx = 0; mx < macroblocksX; ++mx)
+        {
+            FFX_VariableShading_TileStats macroblock = FFX_VariableShading_GetMacroblockStats(stats, statsPitch, tileSize, tilesX, tilesY, mx, my);
+            float& offset = qpOffsets[my * macroblocksX + mx];
+            offset = params.varianceStrength * (offset - average) + params.motionStrength * std::log2(1.0f + macroblock.maxMotion);
+            offset = std::min(std::max(offset, params.minOffset), params.maxOffset);
+        }
+    }
+}
+
+// rounds QP offsets to the signed 8 bit delta QP map NVENC expects (NV_ENC_QP_MAP_DELTA)
+inline void FFX_VariableShading_QuantizeQpOffsets(const float* qpOffsets, uint32_t count, int8_t* deltaQp)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        float value = std::min(std::max(qpOffsets[i], -128.0f), 127.0f);
+        deltaQp[i] = (int8_t)std::lround(value);
+    }
+}
+
+//--------------------------------------------------------------------------------------//
+// CPU VRS image generation                                                             //
+//--------------------------------------------------------------------------------------//
+// Follows the GPU algorithm (2x2 coarse pixel variance plus the min/max of the 4 neighbours
+// without additional shading rates, 4x4 blocks with them), with these differences:
+// - tiles are reduced spatially, independent of the threadgroup layout
+// - 4x4 block neighbours are centered and the vertical variance uses the vertical differences
+// - rates are combined per axis, the finest rate wins (FFX_VariableShading_CombineRates)
+// - the neighbourhood can be widened to any square or diamond (neighbourhoodShape/Radius)
+// - the luminance can be block swizzled (FFX_VariableShading_SwizzleLuminance), so the texels of a
+//   tile are a few contiguous cache lines instead of one row each
+
+// luminance plane layouts of FFX_VariableShading_CpuInputs
+static const uint32_t FFX_VARIABLESHADING_LUMINANCE_LAYOUT_LINEAR = 0;     // rows of luminancePitch floats
+static const uint32_t FFX_VARIABLESHADING_LUMINANCE_LAYOUT_SWIZZLED = 1;   // cb.tileSize x cb.tileSize blocks in row major order, Morton order inside a block
+
+// Variances of one tile (base rates) or one 4x4 block (additional shading rates) after the motion and
+// neighbourhood adjustments, the rates a path does not evaluate (2x4, 4x2 and 4x4 without additional
+// shading rates) are INFINITY, as in the shader
+struct FFX_VariableShading_RateStats
+{
+    float   var2x1, var1x2, var2x2;     // horizontal, vertical and 2x2 differences within 2x2 coarse pixels
+    float   var2x4, var4x2, var4x4;     // luminance ranges of the 2x4, 4x2 and 4x4 regions
+    bool    additionalShadingRates;
+};
+
+// maps the statistics to a FFX_VARIABLESHADING_RATE_* value, cutoffs holds one variance cutoff per rate class
+// (FFX_VariableShading_GetRateClass), the result is clamped to 2X2 without additional shading rates
+typedef std::function<uint32_t(const FFX_VariableShading_RateStats& stats, const float* cutoffs)> FFX_VariableShading_RateDecision;
+
+// How the generator turns variances into rates, see FFX_VariableShading_GetDefaultRatePolicy
+struct FFX_VariableShading_RatePolicy
+{
+    float                               cutoffScales[FFX_VARIABLESHADING_RATE_CLASS_COUNT]; // per rate class times cb.varianceCutoff, > 1 picks the rate more often
+    bool                                skipNeighbourhood;  // cheap mode: no widening by the neighbours' luminance range (base rates) or their rates (additional shading rates)
+    FFX_VariableShading_RateDecision    decide;             // optional, replaces the built in decision (FFX_VariableShading_DecideRate)
+};
+
+inline FFX_VariableShading_RatePolicy FFX_VariableShading_GetDefaultRatePolicy()
+{
+    FFX_VariableShading_RatePolicy policy;
+    std::fill(policy.cutoffScales, policy.cutoffScales + FFX_VARIABLESHADING_RATE_CLASS_COUNT, 1.0f);
+    policy.skipNeighbourhood = false;
+    return policy;
+}
+
+struct FFX_VariableShading_CpuInputs
+{
+    const float*    luminance;          // plane of the mip level the constants are set up for, covering at least the viewport (cb.viewportX + cb.width, cb.viewportY + cb.height)
+    uint32_t        luminancePitch;     // in floats
+    const float*    motionVectors;      // optional: 2 floats per pixel, in full resolution pixels
+    uint32_t        motionVectorPitch;  // in floats
+    uint32_t        motionVectorWidth, motionVectorHeight; // right and bottom edge of the viewport in full resolution pixels
+    uint32_t        mipLevel;           // level of luminance relative to the motion vectors
+    uint32_t        neighbourhoodShape; // FFX_VARIABLESHADING_NEIGHBOURHOOD_DIAMOND or _SQUARE
+    uint32_t        neighbourhoodRadius;// in coarse pixels (or 4x4 blocks), 0 or 1 with a diamond: the GPU's 4 neighbours
+    uint32_t        luminanceLayout;    // FFX_VARIABLESHADING_LUMINANCE_LAYOUT_*, swizzled: luminancePitch is FFX_VariableShading_GetSwizzledLuminancePitch
+    uint32_t        firstRow, rowCount; // optional band: the planes only hold the texel rows [firstRow, firstRow + rowCount) of the input level
+                                        // (the motion vectors the matching full resolution rows), reads are clamped to it. rowCount 0: whole planes
+    const FFX_VariableShading_RatePolicy* ratePolicy; // optional, NULL: cb.varianceCutoff for every rate with the built in decision
+};
+
+// cells (coarse samples or 4x4 blocks) around the tiles the neighbourhood step reads
+inline uint32_t FFX_VariableShading_GetNeighbourhoodBorder(const FFX_VariableShading_CpuInputs& inputs)
+{
+    return (inputs.ratePolicy && inputs.ratePolicy->skipNeighbourhood) ? 0 : std::max(inputs.neighbourhoodRadius, 1u);
+}
+
+// the variance cutoff of every rate class
+inline void FFX_VariableShading_GetRateCutoffs(const FFX_VariableShading_CB& cb, const FFX_VariableShading_CpuInputs& inputs, float* cutoffs)
+{
+    for (uint32_t rateClass = 0; rateClass < FFX_VARIABLESHADING_RATE_CLASS_COUNT; ++rateClass)
+        cutoffs[rateClass] = inputs.ratePolicy ? inputs.ratePolicy->cutoffScales[rateClass] * cb.varianceCutoff : cb.varianceCutoff;
+}
+
+// texel rows of the input level the planes hold within the viewport
+inline void FFX_VariableShading_GetInputRows(const FFX_VariableShading_CB& cb, const FFX_VariableShading_CpuInputs& inputs, int32_t& firstY, int32_t& lastY)
+{
+    firstY = (int32_t)std::max(cb.viewportY, inputs.firstRow);
+    lastY = (int32_t)(cb.viewportY + cb.height) - 1;
+    if (inputs.rowCount)
+        lastY = std::min(lastY, (int32_t)(inputs.firstRow + inputs.rowCount) - 1);
+}
+
+// bit i of v moves to bit 2 * i, for the up to 5 bits of a position inside a block
+inline uint32_t FFX_VariableShading_MortonSpread(uint32_t v)
+{
+    v &= 0xff;
+    v = (v | (v << 4)) & 0x0f0f;
+    v = (v | (v << 2)) & 0x3333;
+    v = (v | (v << 1)) & 0x5555;
+    return v;
+}
+
+inline uint32_t FFX_VariableShading_GetBlockShift(uint32_t blockSize)
+{
+    uint32_t shift = 0;
+    while ((2u << shift) <= blockSize)
+        ++shift;
+    return shift;
+}
+
+// floats between two rows of blocks
+inline uint32_t FFX_VariableShading_GetSwizzledLuminancePitch(uint32_t width, uint32_t blockSize)
+{
+    return FFX_VariableShading_DivideRoundingUp(width, blockSize) * blockSize * blockSize;
+}
+
+inline size_t FFX_VariableShading_GetSwizzledLuminanceSize(uint32_t width, uint32_t height, uint32_t blockSize)
+{
+    return (size_t)FFX_VariableShading_GetSwizzledLuminancePitch(width, blockSize) * FFX_VariableShading_DivideRoundingUp(height, blockSize);
+}
+
+// Texel addressing of the two layouts. x and y land in separate bits of the offset in both,
+// so offset(x, y) = ColumnOffset(x) + RowOffset(y), which lets whole grids be read through
+// one table of column offsets.
+struct FFX_VariableShading_LinearLuminancePlane
+{
+    const float*    luminance;
+    uint32_t        pitch;
+
+    uint32_t ColumnOffset(int32_t x) const { return (uint32_t)x; }
+    uint32_t RowOffset(int32_t y) const { return (uint32_t)y * pitch; }
+};
+
+struct FFX_VariableShading_SwizzledLuminancePlane
+{
+    const float*    luminance;
+    uint32_t        pitch;
+    uint32_t        blockShift;
+
+    uint32_t ColumnOffset(int32_t x) const { return (((uint32_t)x >> blockShift) << (2 * blockShift)) + FFX_VariableShading_MortonSpread((uint32_t)x & ((1u << blockShift) - 1)); }
+    uint32_t RowOffset(int32_t y) const { return ((uint32_t)y >> blockShift) * pitch + (FFX_VariableShading_MortonSpread((uint32_t)y & ((1u << blockShift) - 1)) << 1); }
+};
+
+// motion vector at pos (in texels of the input mip level), in texels of that level. Like
+// FFX_VariableShading_ReadViewportMotionVec2D of the GPU version the motion outside the viewport is 0.
+inline void FFX_VariableShading_ReadMotionVec2D(const FFX_VariableShading_CB& cb, const FFX_VariableShading_CpuInputs& inputs, int32_t x, int32_t y, float& mx, float& my)
+{
+    mx = my = 0.0f;
+    if (!inputs.motionVectors)
+        return;
+    if ((x < (int32_t)cb.viewportX) || (y < (int32_t)cb.viewportY) || (x >= (int32_t)(cb.viewportX + cb.width)) || (y >= (int32_t)(cb.viewportY + cb.height)))
+        return;
+
+    uint32_t fx = std::min((uint32_t)x << inputs.mipLevel, inputs.motionVectorWidth - 1);
+    uint32_t fy = std::min((uint32_t)y << inputs.mipLevel, inputs.motionVectorHeight - 1);
+    if (inputs.rowCount)
+    {
+        const uint32_t bandFirst = inputs.firstRow << inputs.mipLevel;
+        fy = std::min(std::max(fy, bandFirst), ((inputs.firstRow + inputs.rowCount) << inputs.mipLevel) - 1) - bandFirst;
+    }
+    const float* mv = &inputs.motionVectors[fy * inputs.motionVectorPitch + fx * 2];
+    const float scale = 1.0f / (float)(1u << inputs.mipLevel);
+    mx = mv[0] * scale;
+    my = mv[1] * scale;
+}
+
+// luminance of the previous frame at the position pos came from
+template <typename Plane>
+float FFX_VariableShading_GetLuminance(const FFX_VariableShading_CB& cb, const FFX_VariableShading_CpuInputs& inputs, const Plane& plane, int32_t x, int32_t y)
+{
+    float mx, my;
+    FFX_VariableShading_ReadMotionVec2D(cb, inputs, x, y, mx, my);
+    int32_t firstY, lastY;
+    FFX_VariableShading_GetInputRows(cb, inputs, firstY, lastY);
+    x = std::min(std::max(x - (int32_t)std::lround(mx), (int32_t)cb.viewportX), (int32_t)(cb.viewportX + cb.width) - 1);
+    y = std::min(std::max(y - (int32_t)std::lround(my), firstY), lastY);
+    return plane.luminance[plane.RowOffset(y - (int32_t)inputs.firstRow) + plane.ColumnOffset(x)];
+}
+
+inline float FFX_VariableShading_GetLuminance(const FFX_VariableShading_CB& cb, const FFX_VariableShading_CpuInputs& inputs, int32_t x, int32_t y)
+{
+    if (inputs.luminanceLayout == FFX_VARIABLESHADING_LUMINANCE_LAYOUT_SWIZZLED)
+    {
+        FFX_VariableShading_SwizzledLuminancePlane plane = { inputs.luminance, inputs.luminancePitch, FFX_VariableShading_GetBlockShift(cb.tileSize) };
+        return FFX_VariableShading_GetLuminance(cb, inputs, plane, x, y);
+    }
+    FFX_VariableShading_LinearLuminancePlane plane = { inputs.luminance, inputs.luminancePitch };
+    return FFX_VariableShading_GetLuminance(cb, inputs, plane, x, y);
+}
+
+inline float FFX_VariableShading_GetMotionLength(const FFX_VariableShading_CB& cb, const FFX_VariableShading_CpuInputs& inputs, int32_t x, int32_t y)
+{
+    float mx, my;
+    FFX_VariableShading_ReadMotionVec2D(cb, inputs, x, y, mx, my);
+    return std::sqrt(mx * mx + my * my);
+}
+
+// rate of one tile from its max horizontal, vertical and 2x2 variance and the cutoffs per rate class
+inline uint32_t FFX_VariableShading_DecideShadingRate(float varH, float varV, float var, const float* cutoffs)
+{
+    if (var < cutoffs[3])
+        return FFX_VARIABLESHADING_RATE_2X2;
+
+    // when both directions pass, the one further below its cutoff (with a single cutoff: the lower variance)
+    const float cutoff2x1 = cutoffs[2], cutoff1x2 = cutoffs[1];
+    const bool preferVertical = (cutoff2x1 == cutoff1x2) ? (varH > varV) : (varH - cutoff2x1 > varV - cutoff1x2);
+    if (preferVertical)
+        return FFX_VARIABLESHADING_MAKE_SHADING_RATE(FFX_VARIABLESHADING_RATE1D_1X, (varV > cutoff1x2) ? FFX_VARIABLESHADING_RATE1D_1X : FFX_VARIABLESHADING_RATE1D_2X);
+
+    return FFX_VARIABLESHADING_MAKE_SHADING_RATE((varH > cutoff2x1) ? FFX_VARIABLESHADING_RATE1D_1X : FFX_VARIABLESHADING_RATE1D_2X, FFX_VARIABLESHADING_RATE1D_1X);
+}
+
+inline uint32_t FFX_VariableShading_DecideShadingRate(float varH, float varV, float var, float varianceCutoff)
+{
+    const float cutoffs[FFX_VARIABLESHADING_RATE_CLASS_COUNT] = { varianceCutoff, varianceCutoff, varianceCutoff, varianceCutoff, varianceCutoff, varianceCutoff, varianceCutoff };
+    return FFX_VariableShading_DecideShadingRate(varH, varV, var, cutoffs);
+}
+
+// The built in decision of both paths: the coarsest rate whose variance is below its cutoff,
+// from 4X4 down to 1X2 with additional shading rates
+inline uint32_t FFX_VariableShading_DecideRate(const FFX_VariableShading_RateStats& stats, const float* cutoffs)
+{
+    if (!stats.additionalShadingRates)
+        return FFX_VariableShading_DecideShadingRate(stats.var2x1, stats.var1x2, stats.var2x2, cutoffs);
+
+    if (stats.var4x4 < cutoffs[6]) return FFX_VARIABLESHADING_RATE_4X4;
+    if (stats.var4x2 < cutoffs[5]) return FFX_VARIABLESHADING_RATE_4X2;
+    if (stats.var2x4 < cutoffs[4]) return FFX_VARIABLESHADING_RATE_2X4;
+    if (stats.var2x2 < cutoffs[3]) return FFX_VARIABLESHADING_RATE_2X2;
+    if (stats.var2x1 < cutoffs[2]) return FFX_VARIABLESHADING_RATE_2X1;
+    if (stats.var1x2 < cutoffs[1]) return FFX_VARIABLESHADING_RATE_1X2;
+    return FFX_VARIABLESHADING_RATE_1X1;
+}
+
+// the policy's decision, or the built in one
+inline uint32_t FFX_VariableShading_DecideRate(const FFX_VariableShading_RatePolicy* policy, const FFX_VariableShading_RateStats& stats, const float* cutoffs)
+{
+    if (!policy || !policy->decide)
+        return FFX_VariableShading_DecideRate(stats, cutoffs);
+
+    return FFX_VariableShading_ClampRate(policy->decide(stats, cutoffs), stats.additionalShadingRates ? FFX_VARIABLESHADING_RATE1D_4X : FFX_VARIABLESHADING_RATE1D_2X);
+}
+
+struct FFX_VariableShading_CoarseSample
+{
+    float varH, varV, var;
+    float minLuminance, maxLuminance;
+};
+
+// Stage 1 (sampling): motion adjusted luminance of the texels [x0, x0 + gridWidth) x [y0, y0 + gridHeight)
+// and the motion length (times cb.motionFactor) at the upper left texel of every cellSize x cellSize cell.
+// Without motion vectors the clamped column offsets are computed once (columnOffsets, gridWidth entries)
+// and every row is a gather from the few blocks (or one row) it covers.
+template <typename Plane>
+void FFX_VariableShading_SampleGrid(const FFX_VariableShading_CB& cb, const FFX_VariableShading_CpuInputs& inputs, const Plane& plane, int32_t x0, int32_t y0, int32_t gridWidth, int32_t gridHeight, int32_t cellSize, float* luminance, float* motion, uint32_t* columnOffsets)
+{
+    if (!inputs.motionVectors)
+    {
+        const int32_t lastX = (int32_t)(cb.viewportX + cb.width) - 1;
+        int32_t firstY, lastY;
+        FFX_VariableShading_GetInputRows(cb, inputs, firstY, lastY);
+        for (int32_t i = 0; i < gridWidth; ++i)
+        {
+            columnOffsets[i] = plane.ColumnOffset(std::min(std::max(x0 + i, (int32_t)cb.viewportX), lastX));
+        }
+        for (int32_t j = 0; j < gridHeight; ++j)
+        {
+            const float* row = plane.luminance + plane.RowOffset(std::min(std::max(y0 + j, firstY), lastY) - (int32_t)inputs.firstRow);
+            float* dst = &luminance[j * gridWidth];
+            for (int32_t i = 0; i < gridWidth; ++i)
+            {
+                dst[i] = row[columnOffsets[i]];
+            }
+        }
+    }
+    else
+    {
+        for (int32_t j = 0; j < gridHeight; ++j)
+        {
+            for (int32_t i = 0; i < gridWidth; ++i)
+            {
+                luminance[j * gridWidth + i] = FFX_VariableShading_GetLuminance(cb, inputs, plane, x0 + i, y0 + j);
+            }
+        }
+    }
+
+    const int32_t cellsX = gridWidth / cellSize;
+    for (int32_t j = 0; j < gridHeight / cellSize; ++j)
+    {
+        for (int32_t i = 0; i < cellsX; ++i)
+        {
+            motion[j * cellsX + i] = FFX_VariableShading_GetMotionLength(cb, inputs, x0 + i * cellSize, y0 + j * cellSize) * cb.motionFactor;
+        }
+    }
+}
+
+// picks the kernel of inputs.luminanceLayout once per grid
+inline void FFX_VariableShading_SampleGrid(const FFX_VariableShading_CB& cb, const FFX_VariableShading_CpuInputs& inputs, int32_t x0, int32_t y0, int32_t gridWidth, int32_t gridHeight, int32_t cellSize, float* luminance, float* motion, uint32_t* columnOffsets)
+{
+    if (inputs.luminanceLayout == FFX_VARIABLESHADING_LUMINANCE_LAYOUT_SWIZZLED)
+    {
+        FFX_VariableShading_SwizzledLuminancePlane plane = { inputs.luminance, inputs.luminancePitch, FFX_VariableShading_GetBlockShift(cb.tileSize) };
+        FFX_VariableShading_SampleGrid(cb, inputs, plane, x0, y0, gridWidth, gridHeight, cellSize, luminance, motion, columnOffsets);
+    }
+    else
+    {
+        FFX_VariableShading_LinearLuminancePlane plane = { inputs.luminance, inputs.luminancePitch };
+        FFX_VariableShading_SampleGrid(cb, inputs, plane, x0, y0, gridWidth, gridHeight, cellSize, luminance, motion, columnOffsets);
+    }
+}
+
+// Stage 2 (variance): 2x2 coarse pixel with its upper left texel at luminance[0], v is the scaled motion length
+inline FFX_VariableShading_CoarseSample FFX_VariableShading_ComputeCoarseSample(const float* luminance, int32_t pitch, float v)
+{
+    float a = luminance[0];
+    float b = luminance[1];
+    float c = luminance[pitch];
+    float d = luminance[pitch + 1];
+
+    FFX_VariableShading_CoarseSample sample;
+    sample.minLuminance = std::min(std::min(a, b), std::min(c, d));
+    sample.maxLuminance = std::max(std::max(a, b), std::max(c, d));
+
+    sample.varH = std::max(std::abs(a - b), std::abs(c - d)) - v;
+    sample.varV = std::max(std::abs(a - c), std::abs(b - d)) - v;
+    sample.var = sample.maxLuminance - sample.minLuminance - v;
+    sample.maxLuminance -= v;
+    return sample;
+}
+
+// Stage 2 (variance), additional shading rates: statistics of the 4x4 block with its upper left texel at luminance[0]
+inline FFX_VariableShading_RateStats FFX_VariableShading_ComputeBlockStats(const float* luminance, int32_t pitch, float v)
+{
+    float var2x1 = 0.0f, var1x2 = 0.0f, var2x2 = 0.0f;
+    float min4x2[2] = { INFINITY, INFINITY }, max4x2[2] = { -INFINITY, -INFINITY };
+    float min2x4[2] = { INFINITY, INFINITY }, max2x4[2] = { -INFINITY, -INFINITY };
+
+    for (int32_t j = 0; j < 2; ++j)
+    {
+        for (int32_t i = 0; i < 2; ++i)
+        {
+            const float* quad = &luminance[2 * j * pitch + 2 * i];
+            float a = quad[0];
+            float b = quad[1];
+            float c = quad[pitch];
+            float d = quad[pitch + 1];
+            float minLuminance = std::min(std::min(a, b), std::min(c, d));
+            float maxLuminance = std::max(std::max(a, b), std::max(c, d));
+
+            var2x1 = std::max(var2x1, std::max(std::abs(a - b), std::abs(c - d)) - v);
+            var1x2 = std::max(var1x2, std::max(std::abs(a - c), std::abs(b - d)) - v);
+            var2x2 = std::max(var2x2, maxLuminance - minLuminance - v);
+
+            min4x2[j] = std::min(min4x2[j], minLuminance);
+            max4x2[j] = std::max(max4x2[j], maxLuminance);
+            min2x4[i] = std::min(min2x4[i], minLuminance);
+            max2x4[i] = std::max(max2x4[i], maxLuminance);
+        }
+    }
+
+    FFX_VariableShading_RateStats stats;
+    stats.var2x1 = var2x1;
+    stats.var1x2 = var1x2;
+    stats.var2x2 = var2x2;
+    stats.var4x2 = std::max(max4x2[0] - min4x2[0], max4x2[1] - min4x2[1]) - v;
+    stats.var2x4 = std::max(max2x4[0] - min2x4[0], max2x4[1] - min2x4[1]) - v;
+    stats.var4x4 = std::max(max4x2[0], max4x2[1]) - std::min(min4x2[0], min4x2[1]) - v;
+    stats.additionalShadingRates = true;
+    return stats;
+}
+
+inline uint32_t FFX_VariableShading_ComputeBlockShadingRate(const float* luminance, int32_t pitch, float v, float cutoff)
+{
+    const float cutoffs[FFX_VARIABLESHADING_RATE_CLASS_COUNT] = { cutoff, cutoff, cutoff, cutoff, cutoff, cutoff, cutoff };
+    return FFX_VariableShading_DecideRate(FFX_VariableShading_ComputeBlockStats(luminance, pitch, v), cutoffs);
+}
+
+// first element of a line of a dilation pass, see FFX_VariableShading_Dilation_GetLineStart in ffx_variable_shading_dilation.h
+inline void FFX_VariableShading_GetDilationLineStart(const FFX_VariableShading_DilationPass& pass, uint32_t line, uint32_t width, uint32_t height, int32_t& x, int32_t& y)
+{
+    if (pass.directionY == 0)
+    {
+        x = 0;
+        y = (int32_t)line;
+    }
+    else if (pass.directionX == 0)
+    {
+        x = (int32_t)line;
+        y = 0;
+    }
+    else if (line < width)
+    {
+        x = (int32_t)line;
+        y = (pass.directionY > 0) ? 0 : (int32_t)height - 1;
+    }
+    else
+    {
+        int32_t k = (int32_t)(line - (width - 1));
+        x = 0;
+        y = (pass.directionY > 0) ? k : (int32_t)height - 1 - k;
+    }
+}
+
+// van Herk/Gil-Werman filter, in place: values[i] = combine of values[i - radius, i + radius],
+// outside [0, count) is identity. Three combines per element for any radius.
+// scratch holds 2 * (count + 2 * radius) elements.
+template <typename T, typename Combine>
+void FFX_VariableShading_DilateLine(T* values, uint32_t count, uint32_t radius, T identity, Combine combine, T* scratch)
+{
+    const uint32_t window = 2 * radius + 1;
+    const uint32_t padded = count + 2 * radius;
+    T* prefix = scratch;
+    T* suffix = scratch + padded;
+
+    for (uint32_t block = 0; block < padded; block += window)
+    {
+        const uint32_t blockEnd = std::min(block + window, padded);
+        T value = identity;
+        for (uint32_t i = block; i < blockEnd; ++i)
+        {
+            value = (i < radius || i >= radius + count) ? value : combine(value, values[i - radius]);
+            prefix[i] = value;
+        }
+        value = identity;
+        for (uint32_t i = blockEnd; i-- > block;)
+        {
+            value = (i < radius || i >= radius + count) ? value : combine(value, values[i - radius]);
+            suffix[i] = value;
+        }
+    }
+
+    // the window [i, i + 2 * radius] of the padded line spans at most two blocks
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        values[i] = combine(suffix[i], prefix[i + 2 * radius]);
+    }
+}
+
+// elements of scratch FFX_VariableShading_DilateUnpadded needs: the whole array for the 4 neighbour pass,
+// one line plus the prefix and suffix of its padded copy for the others
+inline size_t FFX_VariableShading_GetDilationScratchCount(uint32_t width, uint32_t height, uint32_t radius)
+{
+    const size_t maxLength = std::max(width, height);
+    return std::max((size_t)width * height, maxLength + 2 * (maxLength + 2 * radius));
+}
+
+// Runs the passes of ffx_variable_shading_dilation.h over the width x height array, with identity
+// outside of it. Only elements at least FFX_VariableShading_GetDilationPadding away from the edges get
+// their whole neighbourhood, see FFX_VariableShading_Dilate for the exact result everywhere.
+// combine has to be associative, commutative and idempotent (min, max, FFX_VariableShading_CombineRates).
+// scratch holds FFX_VariableShading_GetDilationScratchCount(width, height, radius) elements.
+template <typename T, typename Combine>
+void FFX_VariableShading_DilateUnpadded(T* values, uint32_t width, uint32_t height, uint32_t pitch, uint32_t shape, uint32_t radius, T identity, Combine combine, T* scratch)
+{
+    FFX_VariableShading_DilationPass passes[FFX_VARIABLESHADING_DILATION_MAX_PASSES];
+    const uint32_t passCount = FFX_VariableShading_GetDilationPasses(shape, radius, passes);
+    if (!passCount || !width || !height)
+        return;
+
+    const uint32_t maxLength = std::max(width, height);
+
+    for (uint32_t p = 0; p < passCount; ++p)
+    {
+        const FFX_VariableShading_DilationPass& pass = passes[p];
+        if (pass.directionX == 0 && pass.directionY == 0)
+        {
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                std::copy(&values[y * pitch], &values[y * pitch] + width, &scratch[(size_t)y * width]);
+            }
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                const T* row = &scratch[(size_t)y * width];
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    T value = row[x];
+                    if (x > 0) value = combine(value, row[x - 1]);
+                    if (x + 1 < width) value = combine(value, row[x + 1]);
+                    if (y > 0) value = combine(value, scratch[(size_t)(y - 1) * width + x]);
+                    if (y + 1 < height) value = combine(value, scratch[(size_t)(y + 1) * width + x]);
+                    values[y * pitch + x] = value;
+                }
+            }
+            continue;
+        }
+
+        T* line = scratch;
+        T* lineScratch = line + maxLength;
+        const uint32_t lineCount = FFX_VariableShading_Dilation_GetLineCount(pass, width, height);
+        for (uint32_t l = 0; l < lineCount; ++l)
+        {
+            int32_t x0, y0;
+            FFX_VariableShading_GetDilationLineStart(pass, l, width, height, x0, y0);
+
+            uint32_t count = 0;
+            for (int32_t x = x0, y = y0; x < (int32_t)width && y >= 0 && y < (int32_t)height; x += pass.directionX, y += pass.directionY)
+            {
+                line[count++] = values[y * pitch + x];
+            }
+
+            FFX_VariableShading_DilateLine(line, count, pass.radius, identity, combine, lineScratch);
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                values[(y0 + (int32_t)i * pass.directionY) * (int32_t)pitch + x0 + (int32_t)i * pass.directionX] = line[i];
+            }
+        }
+    }
+}
+
+template <typename T, typename Combine>
+void FFX_VariableShading_DilateUnpadded(T* values, uint32_t width, uint32_t height, uint32_t pitch, uint32_t shape, uint32_t radius, T identity, Combine combine, std::vector<T>& scratch)
+{
+    scratch.resize(FFX_VariableShading_GetDilationScratchCount(width, height, radius));
+    FFX_VariableShading_DilateUnpadded(values, width, height, pitch, shape, radius, identity, combine, scratch.data());
+}
+
+// Every element of the width x height array takes the combination of its square or diamond
+// neighbourhood (FFX_VARIABLESHADING_NEIGHBOURHOOD_*), elements outside the array are ignored
+template <typename T, typename Combine>
+void FFX_VariableShading_Dilate(T* values, uint32_t width, uint32_t height, uint32_t pitch, uint32_t shape, uint32_t radius, T identity, Combine combine)
+{
+    std::vector<T> scratch;
+    const uint32_t padding = FFX_VariableShading_GetDilationPadding(shape, radius);
+    if (!padding)
+    {
+        FFX_VariableShading_DilateUnpadded(values, width, height, pitch, shape, radius, identity, combine, scratch);
+        return;
+    }
+
+    const uint32_t paddedWidth = width + 2 * padding;
+    const uint32_t paddedHeight = height + 2 * padding;
+    std::vector<T> padded((size_t)paddedWidth * paddedHeight, identity);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        std::copy(&values[y * pitch], &values[y * pitch] + width, &padded[(size_t)(y + padding) * paddedWidth + padding]);
+    }
+
+    FFX_VariableShading_DilateUnpadded(padded.data(), paddedWidth, paddedHeight, paddedWidth, shape, radius, identity, combine, scratch);
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const T* row = &padded[(size_t)(y + padding) * paddedWidth + padding];
+        std::copy(row, row + width, &values[y * pitch]);
+    }
+}
+
+// CPU version of the ffx_variable_shading_dilation.h passes: every tile takes the finest rate (per axis)
+// within its neighbourhood.
+inline void FFX_VariableShading_DilateShadingRates(uint8_t* vrsImage, uint32_t width, uint32_t height, uint32_t pitch, uint32_t shape, uint32_t radius)
+{
+    FFX_VariableShading_Dilate<uint8_t>(vrsImage, width, height, pitch, shape, radius, (uint8_t)FFX_VARIABLESHADING_RATE_4X4,
+        [](uint8_t a, uint8_t b) { return (uint8_t)FFX_VariableShading_CombineRates(a, b); });
+}
+
+// rates[i] = FFX_VariableShading_CombineRates(rates[i], other[i]), 16 tiles per instruction with SIMD
+inline void FFX_VariableShading_CombineRateRows(uint8_t* rates, const uint8_t* other, uint32_t count)
+{
+    uint32_t i = 0;
+#if defined(FFX_VARIABLESHADING_SSE2)
+    const __m128i maskX = _mm_set1_epi8(0xc);
+    const __m128i maskY = _mm_set1_epi8(0x3);
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(rates + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(other + i));
+        __m128i x = _mm_min_epu8(_mm_and_si128(a, maskX), _mm_and_si128(b, maskX));
+        __m128i y = _mm_min_epu8(_mm_and_si128(a, maskY), _mm_and_si128(b, maskY));
+        _mm_storeu_si128((__m128i*)(rates + i), _mm_or_si128(x, y));
+    }
+#elif defined(FFX_VARIABLESHADING_NEON)
+    const uint8x16_t maskX = vdupq_n_u8(0xc);
+    const uint8x16_t maskY = vdupq_n_u8(0x3);
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8x16_t a = vld1q_u8(rates + i);
+        uint8x16_t b = vld1q_u8(other + i);
+        uint8x16_t x = vminq_u8(vandq_u8(a, maskX), vandq_u8(b, maskX));
+        uint8x16_t y = vminq_u8(vandq_u8(a, maskY), vandq_u8(b, maskY));
+        vst1q_u8(rates + i, vorrq_u8(x, y));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        rates[i] = (uint8_t)FFX_VariableShading_CombineRates(rates[i], other[i]);
+    }
+}
+
+// see FFX_VariableShading_Downsample_ShiftRate in ffx_variable_shading_downsample.h
+inline uint32_t FFX_VariableShading_ShiftDownsampledRate(uint32_t rate, const FFX_VariableShading_DownsampleCB& cb)
+{
+    int32_t x = std::min(std::max((int32_t)FFX_VariableShading_GetRate1DX(rate) + cb.rateShiftX, 0), (int32_t)cb.maxRate1D);
+    int32_t y = std::min(std::max((int32_t)FFX_VariableShading_GetRate1DY(rate) + cb.rateShiftY, 0), (int32_t)cb.maxRate1D);
+    return FFX_VARIABLESHADING_MAKE_SHADING_RATE((uint32_t)std::min(x, y + 1), (uint32_t)std::min(y, x + 1));
+}
+
+// CPU version of ffx_variable_shading_downsample.h: derives the cb.dstWidth x cb.dstHeight VRS image
+// from the cb.srcWidth x cb.srcHeight one (see FFX_VariableShading_SetupDownsample). The source rows of
+// every destination row are combined first, with SIMD, then the columns of every destination tile.
+inline void FFX_VariableShading_DownsampleShadingRates(const FFX_VariableShading_DownsampleCB& cb, const uint8_t* vrsImage, uint32_t pitch, uint8_t* downsampled, uint32_t downsampledPitch)
+{
+    std::vector<uint8_t> row(cb.srcWidth);
+    for (uint32_t y = 0; y < cb.dstHeight; ++y)
+    {
+        uint32_t firstY = (uint32_t)((uint64_t)y * cb.scaleNumY / cb.scaleDenY);
+        uint32_t endY = (uint32_t)std::min(((uint64_t)(y + 1) * cb.scaleNumY + cb.scaleDenY - 1) / cb.scaleDenY, (uint64_t)cb.srcHeight);
+
+        std::copy(&vrsImage[firstY * pitch], &vrsImage[firstY * pitch] + cb.srcWidth, row.begin());
+        for (uint32_t sy = firstY + 1; sy < endY; ++sy)
+        {
+            FFX_VariableShading_CombineRateRows(row.data(), &vrsImage[sy * pitch], cb.srcWidth);
+        }
+
+        for (uint32_t x = 0; x < cb.dstWidth; ++x)
+        {
+            uint32_t firstX = (uint32_t)((uint64_t)x * cb.scaleNumX / cb.scaleDenX);
+            uint32_t endX = (uint32_t)std::min(((uint64_t)(x + 1) * cb.scaleNumX + cb.scaleDenX - 1) / cb.scaleDenX, (uint64_t)cb.srcWidth);
+
+            uint32_t rate = FFX_VARIABLESHADING_RATE_4X4;
+            for (uint32_t sx = firstX; sx < endX; ++sx)
+            {
+                rate = FFX_VariableShading_CombineRates(rate, row[sx]);
+            }
+            downsampled[y * downsampledPitch + x] = (uint8_t)FFX_VariableShading_ShiftDownsampledRate(rate, cb);
+        }
+    }
+}
+
+static const size_t FFX_VARIABLESHADING_CACHE_LINE_SIZE = 64;
+
+inline size_t FFX_VariableShading_AlignToCacheLine(size_t size)
+{
+    return (size + FFX_VARIABLESHADING_CACHE_LINE_SIZE - 1) & ~(FFX_VARIABLESHADING_CACHE_LINE_SIZE - 1);
+}
+
+// Byte offsets of the generator's working memory for one thread generating tileCountX tiles per row,
+// every array starts on its own cache line. Arrays the configuration does not use are empty.
+struct FFX_VariableShading_CpuGeneratorScratchLayout
+{
+    size_t  luminance, motion, columnOffsets;
+    size_t  samples, adjusted, tileVariance, minNeighbourhood, maxNeighbourhood, dilation;  // base rates
+    size_t  blocks, combined, tileRates, rateDilation;                                      // additional shading rates
+    size_t  size;                                                                           // total in bytes
+};
+
+inline FFX_VariableShading_CpuGeneratorScratchLayout FFX_VariableShading_GetCpuGeneratorScratchLayout(const FFX_VariableShading_CB& cb, bool additionalShadingRates, const FFX_VariableShading_CpuInputs& inputs, uint32_t tileCountX)
+{
+    const uint32_t neighbourhoodRadius = std::max(inputs.neighbourhoodRadius, 1u);
+    const uint32_t border = FFX_VariableShading_GetNeighbourhoodBorder(inputs);
+    const bool dilate = (border != 0) && !((neighbourhoodRadius == 1) && (inputs.neighbourhoodShape == FFX_VARIABLESHADING_NEIGHBOURHOOD_DIAMOND));
+    const uint32_t cellSize = additionalShadingRates ? 4 : 2;
+    const size_t cellsPerTile = cb.tileSize / cellSize;
+    const uint32_t gridWidth = tileCountX * cb.tileSize + 2 * border * cellSize;
+    const uint32_t gridHeight = cb.tileSize + 2 * border * cellSize;
+    const size_t cells = (size_t)(gridWidth / cellSize) * (gridHeight / cellSize);
+    const size_t innerCells = (size_t)tileCountX * cellsPerTile * cellsPerTile;
+    const size_t dilation = dilate ? FFX_VariableShading_GetDilationScratchCount(gridWidth / cellSize, gridHeight / cellSize, neighbourhoodRadius) : 0;
+
+    FFX_VariableShading_CpuGeneratorScratchLayout layout = {};
+    size_t offset = 0;
+    auto place = [&offset](size_t& member, size_t bytes)
+    {
+        member = offset;
+        offset += FFX_VariableShading_AlignToCacheLine(bytes);
+    };
+
+    place(layout.luminance, (size_t)gridWidth * gridHeight * sizeof(float));
+    place(layout.motion, cells * sizeof(float));
+    place(layout.columnOffsets, gridWidth * sizeof(uint32_t));
+    if (!additionalShadingRates)
+    {
+        place(layout.samples, cells * sizeof(FFX_VariableShading_CoarseSample));
+        place(layout.adjusted, innerCells * 3 * sizeof(float));
+        place(layout.tileVariance, (size_t)tileCountX * 3 * sizeof(float));
+        place(layout.minNeighbourhood, dilate ? cells * sizeof(float) : 0);
+        place(layout.maxNeighbourhood, dilate ? cells * sizeof(float) : 0);
+        place(layout.dilation, dilation * sizeof(float));
+    }
+    else
+    {
+        place(layout.blocks, cells);
+        place(layout.combined, innerCells);
+        place(layout.tileRates, tileCountX);
+        place(layout.rateDilation, dilation);
+    }
+    layout.size = offset;
+    return layout;
+}
+
+// Owns the working memory of the generator for one thread at a time. Reserved for the widest range up front
+// (FFX_VariableShading_ReserveCpuGeneratorScratch), generating the same or a smaller range, e.g. after
+// a dynamic resolution change, reuses it without allocating. See ffx_variable_shading_cpu_context.h for
+// per worker scratch from a caller provided allocator.
+struct FFX_VariableShading_CpuGeneratorScratch
+{
+    std::vector<uint8_t>    memory;
+};
+
+// cache line aligned scratch of at least size bytes, only allocates when that exceeds what it held before
+inline void* FFX_VariableShading_GetCpuGeneratorScratchMemory(FFX_VariableShading_CpuGeneratorScratch& scratch, size_t size)
+{
+    if (scratch.memory.size() < size + FFX_VARIABLESHADING_CACHE_LINE_SIZE)
+        scratch.memory.resize(size + FFX_VARIABLESHADING_CACHE_LINE_SIZE);
+
+    uintptr_t address = (uintptr_t)scratch.memory.data();
+    return (void*)FFX_VariableShading_AlignToCacheLine(address);
+}
+
+// Scratch of the calling thread for the overloads that take none. It lives as long as the thread and only
+// grows to the widest range the thread generated, so after the first frames a pool's workers reuse it
+// without allocating. A task does not call back into the generator, so one per thread is enough.
+inline FFX_VariableShading_CpuGeneratorScratch& FFX_VariableShading_GetThreadCpuGeneratorScratch()
+{
+    static thread_local FFX_VariableShading_CpuGeneratorScratch scratch;
+    return scratch;
+}
+
+// Reserves scratch for generating whole tile rows of any viewport inside the surface cb describes
+// (cb.viewportX + cb.width by cb.viewportY + cb.height, set up for the maximum resolution)
+inline void FFX_VariableShading_ReserveCpuGeneratorScratch(FFX_VariableShading_CpuGeneratorScratch& scratch, const FFX_VariableShading_CB& cb, bool additionalShadingRates, const FFX_VariableShading_CpuInputs& inputs)
+{
+    const uint32_t tileCountX = FFX_VariableShading_DivideRoundingUp(cb.viewportX + cb.width, cb.tileSize);
+    FFX_VariableShading_GetCpuGeneratorScratchMemory(scratch, FFX_VariableShading_GetCpuGeneratorScratchLayout(cb, additionalShadingRates, inputs, tileCountX).size);
+}
+
+// Generates the tiles [firstTileX, firstTileX + tileCountX) x [firstTileRow, firstTileRow + tileRowCount)
+// of the viewport (see FFX_VariableShading_GetViewportTiles), the tiles are written at their place in the
+// VRS image. Tiles are independent, so disjoint ranges can run on different threads, each with its own scratch:
+// FFX_VariableShading_GetCpuGeneratorScratchLayout(cb, additionalShadingRates, inputs, tileCountX).size bytes,
+// cache line aligned. The generator itself never allocates.
+// Every row of the range runs the stages sampling, variance, neighbours, tile reduction and write,
+// each over the whole row of the range (see FFX_VARIABLESHADING_PROFILE in ffx_variable_shading_cpu_profile.h).
+inline void FFX_VariableShading_GenerateVrsImageTiles(const FFX_VariableShading_CB& cb, bool additionalShadingRates, const FFX_VariableShading_CpuInputs& inputs, uint32_t firstTileX, uint32_t tileCountX, uint32_t firstTileRow, uint32_t tileRowCount, uint8_t* vrsImage, uint32_t vrsImagePitch, void* scratch)
+{
+    FFX_VARIABLESHADING_PROFILE_BEGIN();
+
+    uint32_t viewportTileX, viewportTileY, viewportTilesX, viewportTilesY;
+    FFX_VariableShading_GetViewportTiles(&cb, viewportTileX, viewportTileY, viewportTilesX, viewportTilesY);
+    firstTileX += viewportTileX;
+    firstTileRow += viewportTileY;
+
+    const int32_t tileSize = (int32_t)cb.tileSize;
+    const uint32_t tilesX = tileCountX;
+    const int32_t x0 = (int32_t)firstTileX * tileSize;
+
+    // the 4 neighbours, or a wider neighbourhood dilated in O(1) per cell, or none when the policy skips it
+    const uint32_t neighbourhoodRadius = std::max(inputs.neighbourhoodRadius, 1u);
+    const bool skipNeighbourhood = (FFX_VariableShading_GetNeighbourhoodBorder(inputs) == 0);
+    const bool plusNeighbourhood = !skipNeighbourhood && (neighbourhoodRadius == 1) && (inputs.neighbourhoodShape == FFX_VARIABLESHADING_NEIGHBOURHOOD_DIAMOND);
+    const FFX_VariableShading_RatePolicy* policy = inputs.ratePolicy;
+    float cutoffs[FFX_VARIABLESHADING_RATE_CLASS_COUNT];
+    FFX_VariableShading_GetRateCutoffs(cb, inputs, cutoffs);
+
+    // texels of one tile row plus a border of neighbourhoodRadius cells (coarse samples or 4x4 blocks) on all sides
+    const int32_t cellSize = additionalShadingRates ? 4 : 2;
+    const int32_t cellsPerTile = tileSize / cellSize;
+    const int32_t border = (int32_t)FFX_VariableShading_GetNeighbourhoodBorder(inputs);
+    const int32_t gridWidth = (int32_t)tilesX * tileSize + 2 * border * cellSize;
+    const int32_t gridHeight = tileSize + 2 * border * cellSize;
+    const int32_t cellsX = gridWidth / cellSize;
+    const int32_t cellsY = gridHeight / cellSize;
+    const int32_t innerCellsX = (int32_t)tilesX * cellsPerTile;
+
+    const FFX_VariableShading_CpuGeneratorScratchLayout layout = FFX_VariableShading_GetCpuGeneratorScratchLayout(cb, additionalShadingRates, inputs, tilesX);
+    uint8_t* memory = (uint8_t*)scratch;
+    float* luminance = (float*)(memory + layout.luminance);
+    float* motion = (float*)(memory + layout.motion);
+    uint32_t* columnOffsets = (uint32_t*)(memory + layout.columnOffsets);
+
+    if (!additionalShadingRates)
+    {
+        FFX_VariableShading_CoarseSample* samples = (FFX_VariableShading_CoarseSample*)(memory + layout.samples);
+        float* adjusted = (float*)(memory + layout.adjusted);
+        float* tileVariance = (float*)(memory + layout.tileVariance);
+        float* minNeighbourhood = (float*)(memory + layout.minNeighbourhood);
+        float* maxNeighbourhood = (float*)(memory + layout.maxNeighbourhood);
+        float* dilationScratch = (float*)(memory + layout.dilation);
+
+        for (uint32_t tileY = firstTileRow; tileY < firstTileRow + tileRowCount; ++tileY)
+        {
+            FFX_VariableShading_SampleGrid(cb, inputs, x0 - border * cellSize, (int32_t)tileY * tileSize - border * cellSize, gridWidth, gridHeight, cellSize, luminance, motion, columnOffsets);
+            FFX_VARIABLESHADING_PROFILE_STAGE(FFX_VARIABLESHADING_PROFILE_STAGE_SAMPLING);
+            FFX_VARIABLESHADING_PROFILE_ADD(bytesRead, (uint64_t)gridWidth * gridHeight * (sizeof(float) + 2 * sizeof(float)) + (uint64_t)cellsX * cellsY * 2 * sizeof(float));
+
+            for (int32_t j = 0; j < cellsY; ++j)
+            {
+                for (int32_t i = 0; i < cellsX; ++i)
+                {
+                    samples[j * cellsX + i] = FFX_VariableShading_ComputeCoarseSample(&luminance[(j * cellSize) * gridWidth + i * cellSize], gridWidth, motion[j * cellsX + i]);
+                }
+            }
+            FFX_VARIABLESHADING_PROFILE_STAGE(FFX_VARIABLESHADING_PROFILE_STAGE_VARIANCE);
+
+            // variances widened by how far the neighbours' luminance range exceeds the sample's own
+            if (!plusNeighbourhood && !skipNeighbourhood)
+            {
+                // the border is at least the dilation padding, the sample itself is part of the dilated range, which leaves d unchanged
+                for (int32_t i = 0; i < cellsX * cellsY; ++i)
+                {
+                    minNeighbourhood[i] = samples[i].minLuminance;
+                    maxNeighbourhood[i] = samples[i].maxLuminance;
+                }
+                FFX_VariableShading_DilateUnpadded(minNeighbourhood, cellsX, cellsY, cellsX, inputs.neighbourhoodShape, neighbourhoodRadius, INFINITY,
+                    [](float a, float b) { return std::min(a, b); }, dilationScratch);
+                FFX_VariableShading_DilateUnpadded(maxNeighbourhood, cellsX, cellsY, cellsX, inputs.neighbourhoodShape, neighbourhoodRadius, -INFINITY,
+                    [](float a, float b) { return std::max(a, b); }, dilationScratch);
+            }
+
+            for (int32_t j = border; j < border + cellsPerTile; ++j)
+            {
+                for (int32_t i = border; i < border + innerCellsX; ++i)
+                {
+                    const FFX_VariableShading_CoarseSample& center = samples[j * cellsX + i];
+
+                    float minNeighbour = INFINITY, maxNeighbour = -INFINITY;
+                    if (skipNeighbourhood)
+                    {
+                        minNeighbour = center.minLuminance;
+                        maxNeighbour = center.maxLuminance;
+                    }
+                    else if (plusNeighbourhood)
+                    {
+                        const FFX_VariableShading_CoarseSample* neighbours[4] = {
+                            &samples[(j - 1) * cellsX + i], &samples[j * cellsX + i - 1],
+                            &samples[(j + 1) * cellsX + i], &samples[j * cellsX + i + 1] };
+
+                        for (const FFX_VariableShading_CoarseSample* n : neighbours)
+                        {
+                            minNeighbour = std::min(minNeighbour, n->minLuminance);
+                            maxNeighbour = std::max(maxNeighbour, n->maxLuminance);
+                        }
+                    }
+                    else
+                    {
+                        minNeighbour = minNeighbourhood[j * cellsX + i];
+                        maxNeighbour = maxNeighbourhood[j * cellsX + i];
+                    }
+                    float d = std::max(0.0f, center.minLuminance - minNeighbour) + std::max(0.0f, maxNeighbour - center.maxLuminance);
+
+                    float* out = &adjusted[((j - border) * innerCellsX + (i - border)) * 3];
+                    out[0] = center.varH + d;
+                    out[1] = center.varV + d;
+                    out[2] = center.var + d;
+                }
+            }
+            FFX_VARIABLESHADING_PROFILE_STAGE(FFX_VARIABLESHADING_PROFILE_STAGE_NEIGHBOURS);
+
+            for (uint32_t tileX = 0; tileX < tilesX; ++tileX)
+            {
+                float varH = 0.0f, varV = 0.0f, var = 0.0f;
+                for (int32_t j = 0; j < cellsPerTile; ++j)
+                {
+                    const float* row = &adjusted[(j * innerCellsX + (int32_t)tileX * cellsPerTile) * 3];
+                    for (int32_t i = 0; i < cellsPerTile; ++i)
+                    {
+                        varH = std::max(varH, row[i * 3 + 0]);
+                        varV = std::max(varV, row[i * 3 + 1]);
+                        var = std::max(var, row[i * 3 + 2]);
+                    }
+                }
+                tileVariance[tileX * 3 + 0] = varH;
+                tileVariance[tileX * 3 + 1] = varV;
+                tileVariance[tileX * 3 + 2] = var;
+            }
+            FFX_VARIABLESHADING_PROFILE_STAGE(FFX_VARIABLESHADING_PROFILE_STAGE_TILE_REDUCTION);
+
+            for (uint32_t tileX = 0; tileX < tilesX; ++tileX)
+            {
+                uint32_t rate;
+                if (policy && policy->decide)
+                {
+                    FFX_VariableShading_RateStats stats;
+                    stats.var2x1 = tileVariance[tileX * 3 + 0];
+                    stats.var1x2 = tileVariance[tileX * 3 + 1];
+                    stats.var2x2 = tileVariance[tileX * 3 + 2];
+                    stats.var2x4 = stats.var4x2 = stats.var4x4 = INFINITY;
+                    stats.additionalShadingRates = false;
+                    rate = FFX_VariableShading_DecideRate(policy, stats, cutoffs);
+                }
+                else
+                {
+                    rate = FFX_VariableShading_DecideShadingRate(tileVariance[tileX * 3 + 0], tileVariance[tileX * 3 + 1], tileVariance[tileX * 3 + 2], cutoffs);
+                }
+                vrsImage[tileY * vrsImagePitch + firstTileX + tileX] = (uint8_t)rate;
+            }
+            FFX_VARIABLESHADING_PROFILE_STAGE(FFX_VARIABLESHADING_PROFILE_STAGE_WRITE);
+            FFX_VARIABLESHADING_PROFILE_ADD(tiles, tilesX);
+            FFX_VARIABLESHADING_PROFILE_ADD(tileRows, 1);
+        }
+    }
+    else
+    {
+        uint8_t* blocks = memory + layout.blocks;
+        uint8_t* combined = memory + layout.combined;
+        uint8_t* tileRates = memory + layout.tileRates;
+        uint8_t* dilationScratch = memory + layout.rateDilation;
+
+        for (uint32_t tileY = firstTileRow; tileY < firstTileRow + tileRowCount; ++tileY)
+        {
+            FFX_VariableShading_SampleGrid(cb, inputs, x0 - border * cellSize, (int32_t)tileY * tileSize - border * cellSize, gridWidth, gridHeight, cellSize, luminance, motion, columnOffsets);
+            FFX_VARIABLESHADING_PROFILE_STAGE(FFX_VARIABLESHADING_PROFILE_STAGE_SAMPLING);
+            FFX_VARIABLESHADING_PROFILE_ADD(bytesRead, (uint64_t)gridWidth * gridHeight * (sizeof(float) + 2 * sizeof(float)) + (uint64_t)cellsX * cellsY * 2 * sizeof(float));
+
+            for (int32_t j = 0; j < cellsY; ++j)
+            {
+                for (int32_t i = 0; i < cellsX; ++i)
+                {
+                    const FFX_VariableShading_RateStats stats = FFX_VariableShading_ComputeBlockStats(&luminance[(j * cellSize) * gridWidth + i * cellSize], gridWidth, motion[j * cellsX + i]);
+                    blocks[j * cellsX + i] = (uint8_t)FFX_VariableShading_DecideRate(policy, stats, cutoffs);
+                }
+            }
+            FFX_VARIABLESHADING_PROFILE_STAGE(FFX_VARIABLESHADING_PROFILE_STAGE_VARIANCE);
+
+            // every block takes the finest rate of itself and its neighbours
+            if (skipNeighbourhood)
+            {
+                std::copy(blocks, blocks + cellsX * cellsY, combined);
+            }
+            else if (plusNeighbourhood)
+            {
+                for (int32_t j = 1; j <= cellsPerTile; ++j)
+                {
+                    for (int32_t i = 1; i <= innerCellsX; ++i)
+                    {
+                        uint32_t rate = blocks[j * cellsX + i];
+                        rate = FFX_VariableShading_CombineRates(rate, blocks[(j - 1) * cellsX + i]);
+                        rate = FFX_VariableShading_CombineRates(rate, blocks[(j + 1) * cellsX + i]);
+                        rate = FFX_VariableShading_CombineRates(rate, blocks[j * cellsX + i - 1]);
+                        rate = FFX_VariableShading_CombineRates(rate, blocks[j * cellsX + i + 1]);
+                        combined[(j - 1) * innerCellsX + (i - 1)] = (uint8_t)rate;
+                    }
+                }
+            }
+            else
+            {
+                FFX_VariableShading_DilateUnpadded<uint8_t>(blocks, cellsX, cellsY, cellsX, inputs.neighbourhoodShape, neighbourhoodRadius, (uint8_t)FFX_VARIABLESHADING_RATE_4X4,
+                    [](uint8_t a, uint8_t b) { return (uint8_t)FFX_VariableShading_CombineRates(a, b); }, dilationScratch);
+                for (int32_t j = 0; j < cellsPerTile; ++j)
+                {
+                    std::copy(&blocks[(j + border) * cellsX + border], &blocks[(j + border) * cellsX + border] + innerCellsX, &combined[j * innerCellsX]);
+                }
+            }
+            FFX_VARIABLESHADING_PROFILE_STAGE(FFX_VARIABLESHADING_PROFILE_STAGE_NEIGHBOURS);
+
+            for (uint32_t tileX = 0; tileX < tilesX; ++tileX)
+            {
+                uint32_t rate = FFX_VARIABLESHADING_RATE_4X4;
+                for (int32_t j = 0; j < cellsPerTile; ++j)
+                {
+                    const uint8_t* row = &combined[j * innerCellsX + (int32_t)tileX * cellsPerTile];
+                    for (int32_t i = 0; i < cellsPerTile; ++i)
+                    {
+                        rate = FFX_VariableShading_CombineRates(rate, row[i]);
+                    }
+                }
+                tileRates[tileX] = (uint8_t)rate;
+            }
+            FFX_VARIABLESHADING_PROFILE_STAGE(FFX_VARIABLESHADING_PROFILE_STAGE_TILE_REDUCTION);
+
+            std::copy(tileRates, tileRates + tilesX, &vrsImage[tileY * vrsImagePitch + firstTileX]);
+            FFX_VARIABLESHADING_PROFILE_STAGE(FFX_VARIABLESHADING_PROFILE_STAGE_WRITE);
+            FFX_VARIABLESHADING_PROFILE_ADD(tiles, tilesX);
+            FFX_VARIABLESHADING_PROFILE_ADD(tileRows, 1);
+        }
+    }
+}
+
+inline void FFX_VariableShading_GenerateVrsImageTiles(const FFX_VariableShading_CB& cb, bool additionalShadingRates, const FFX_VariableShading_CpuInputs& inputs, uint32_t firstTileX, uint32_t tileCountX, uint32_t firstTileRow, uint32_t tileRowCount, uint8_t* vrsImage, uint32_t vrsImagePitch, FFX_VariableShading_CpuGeneratorScratch& scratch)
+{
+    void* memory = FFX_VariableShading_GetCpuGeneratorScratchMemory(scratch, FFX_VariableShading_GetCpuGeneratorScratchLayout(cb, additionalShadingRates, inputs, tileCountX).size);
+    FFX_VariableShading_GenerateVrsImageTiles(cb, additionalShadingRates, inputs, firstTileX, tileCountX, firstTileRow, tileRowCount, vrsImage, vrsImagePitch, memory);
+}
+
+inline void FFX_VariableShading_GenerateVrsImageTiles(const FFX_VariableShading_CB& cb, bool additionalShadingRates, const FFX_VariableShading_CpuInputs& inputs, uint32_t firstTileX, uint32_t tileCountX, uint32_t firstTileRow, uint32_t tileRowCount, uint8_t* vrsImage, uint32_t vrsImagePitch)
+{
+    FFX_VariableShading_GenerateVrsImageTiles(cb, additionalShadingRates, inputs, firstTileX, tileCountX, firstTileRow, tileRowCount, vrsImage, vrsImagePitch, FFX_VariableShading_GetThreadCpuGeneratorScratch());
+}
+
+// Generates tile rows [firstTileRow, firstTileRow + tileRowCount) of the viewport.
+inline void FFX_VariableShading_GenerateVrsImageRows(const FFX_VariableShading_CB& cb, bool additionalShadingRates, const FFX_VariableShading_CpuInputs& inputs, uint32_t firstTileRow, uint32_t tileRowCount, uint8_t* vrsImage, uint32_t vrsImagePitch, FFX_VariableShading_CpuGeneratorScratch& scratch)
+{
+    uint32_t firstTileX, firstTileY, tilesX, tilesY;
+    FFX_VariableShading_GetViewportTiles(&cb, firstTileX, firstTileY, tilesX, tilesY);
+    FFX_VariableShading_GenerateVrsImageTiles(cb, additionalShadingRates, inputs, 0, tilesX, firstTileRow, tileRowCount, vrsImage, vrsImagePitch, scratch);
+}
+
+inline void FFX_VariableShading_GenerateVrsImageRows(const FFX_VariableShading_CB& cb, bool additionalShadingRates, const FFX_VariableShading_CpuInputs& inputs, uint32_t firstTileRow, uint32_t tileRowCount, uint8_t* vrsImage, uint32_t vrsImagePitch)
+{
+    FFX_VariableShading_GenerateVrsImageRows(cb, additionalShadingRates, inputs, firstTileRow, tileRowCount, vrsImage, vrsImagePitch, FFX_VariableShading_GetThreadCpuGeneratorScratch());
+}
+
+// How the parallel generator splits the VRS image into tasks, see ffx_variable_shading_cpu_autotune.h
+// for picking the fastest one on the running machine.
+struct FFX_VariableShading_CpuGeneratorConfig
+{
+    uint32_t    tileGroupWidth;     // tiles per task horizontally, 0: whole tile rows
+    uint32_t    bandHeight;         // tile rows per task
+    uint32_t    threadCount;        // workers the parallelFor should use, not used by the generator itself
+};
+
+inline FFX_VariableShading_CpuGeneratorConfig FFX_VariableShading_GetDefaultCpuGeneratorConfig()
+{
+    FFX_VariableShading_CpuGeneratorConfig config;
+    config.tileGroupWidth = 0;
+    config.bandHeight = 1;
+    config.threadCount = 0;
+    return config;
+}
+
+// Number of independent tasks config splits the viewport's tiles into
+inline uint32_t FFX_VariableShading_GetGeneratorTaskCount(const FFX_VariableShading_CB& cb, const FFX_VariableShading_CpuGeneratorConfig& config)
+{
+    uint32_t firstTileX, firstTileY, tilesX, tilesY;
+    FFX_VariableShading_GetViewportTiles(&cb, firstTileX, firstTileY, tilesX, tilesY);
+    const uint32_t groupWidth = (config.tileGroupWidth && config.tileGroupWidth < tilesX) ? config.tileGroupWidth : tilesX;
+    const uint32_t bandHeight = std::max(config.bandHeight, 1u);
+    return FFX_VariableShading_DivideRoundingUp(tilesX, groupWidth) * FFX_VariableShading_DivideRoundingUp(tilesY, bandHeight);
+}
+
+// the viewport tiles of task [0, FFX_VariableShading_GetGeneratorTaskCount), for FFX_VariableShading_GenerateVrsImageTiles
+inline void FFX_VariableShading_GetGeneratorTaskTiles(const FFX_VariableShading_CB& cb, const FFX_VariableShading_CpuGeneratorConfig& config, uint32_t task,
+    uint32_t& firstTileX, uint32_t& tileCountX, uint32_t& firstTileRow, uint32_t& tileRowCount)
+{
+    uint32_t viewportTileX, viewportTileY, tilesX, tilesY;
+    FFX_VariableShading_GetViewportTiles(&cb, viewportTileX, viewportTileY, tilesX, tilesY);
+    const uint32_t groupWidth = (config.tileGroupWidth && config.tileGroupWidth < tilesX) ? config.tileGroupWidth : tilesX;
+    const uint32_t bandHeight = std::max(config.bandHeight, 1u);
+    const uint32_t groupsX = FFX_VariableShading_DivideRoundingUp(tilesX, groupWidth);
+
+    firstTileX = (task % groupsX) * groupWidth;
+    firstTileRow = (task / groupsX) * bandHeight;
+    tileCountX = std::min(groupWidth, tilesX - firstTileX);
+    tileRowCount = std::min(bandHeight, tilesY - firstTileRow);
+}
+
+// Generates task [0, FFX_VariableShading_GetGeneratorTaskCount) of the split, tasks can run in any order and on any thread
+// (concurrent tasks need their own scratch)
+inline void FFX_VariableShading_GenerateVrsImageTask(const FFX_VariableShading_CB& cb, bool additionalShadingRates, const FFX_VariableShading_CpuInputs& inputs, const FFX_VariableShading_CpuGeneratorConfig& config, uint32_t task, uint8_t* vrsImage, uint32_t vrsImagePitch, void* scratch)
+{
+    uint32_t firstTileX, tileCountX, firstTileRow, tileRowCount;
+    FFX_VariableShading_GetGeneratorTaskTiles(cb, config, task, firstTileX, tileCountX, firstTileRow, tileRowCount);
+    FFX_VARIABLESHADING_TRACE_SCOPE_ARGS("Generator task", "VRS generation", FFX_VARIABLESHADING_TRACE_TILE_ARGS, firstTileX, tileCountX, firstTileRow, tileRowCount);
+    FFX_VariableShading_GenerateVrsImageTiles(cb, additionalShadingRates, inputs, firstTileX, tileCountX, firstTileRow, tileRowCount, vrsImage, vrsImagePitch, scratch);
+}
+
+inline void FFX_VariableShading_GenerateVrsImageTask(const FFX_VariableShading_CB& cb, bool additionalShadingRates, const FFX_VariableShading_CpuInputs& inputs, const FFX_VariableShading_CpuGeneratorConfig& config, uint32_t task, uint8_t* vrsImage, uint32_t vrsImagePitch, FFX_VariableShading_CpuGeneratorScratch& scratch)
+{
+    uint32_t firstTileX, tileCountX, firstTileRow, tileRowCount;
+    FFX_VariableShading_GetGeneratorTaskTiles(cb, config, task, firstTileX, tileCountX, firstTileRow, tileRowCount);
+    FFX_VARIABLESHADING_TRACE_SCOPE_ARGS("Generator task", "VRS generation", FFX_VARIABLESHADING_TRACE_TILE_ARGS, firstTileX, tileCountX, firstTileRow, tileRowCount);
+    FFX_VariableShading_GenerateVrsImageTiles(cb, additionalShadingRates, inputs, firstTileX, tileCountX, firstTileRow, tileRowCount, vrsImage, vrsImagePitch, scratch);
+}
+
+inline void FFX_VariableShading_GenerateVrsImageTask(const FFX_VariableShading_CB& cb, bool additionalShadingRates, const FFX_VariableShading_CpuInputs& inputs, const FFX_VariableShading_CpuGeneratorConfig& config, uint32_t task, uint8_t* vrsImage, uint32_t vrsImagePitch)
+{
+    FFX_VariableShading_GenerateVrsImageTask(cb, additionalShadingRates, inputs, config, task, vrsImage, vrsImagePitch, FFX_VariableShading_GetThreadCpuGeneratorScratch());
+}
+
+// parallelFor(count, fn) has to call fn(i) for all i in [0, count), in any order and on any thread.
+// Engines with their own job system can schedule the tasks themselves, see ffx_variable_shading_cpu_jobs.h.
+// Every task uses the scratch of the thread it runs on (FFX_VariableShading_GetThreadCpuGeneratorScratch).
+template <typename ParallelFor>
+void FFX_VariableShading_GenerateVrsImage(const FFX_VariableShading_CB& cb, bool additionalShadingRates, const FFX_VariableShading_CpuInputs& inputs, const FFX_VariableShading_CpuGeneratorConfig& config, uint8_t* vrsImage, uint32_t vrsImagePitch, ParallelFor parallelFor)
+{
+    parallelFor(FFX_VariableShading_GetGeneratorTaskCount(cb, config), [&](uint32_t task)
+    {
+        FFX_VariableShading_GenerateVrsImageTask(cb, additionalShadingRates, inputs, config, task, vrsImage, vrsImagePitch);
+    });
+}
+
+template <typename ParallelFor>
+void FFX_VariableShading_GenerateVrsImage(const FFX_VariableShading_CB& cb, bool additionalShadingRates, const FFX_VariableShading_CpuInputs& inputs, uint8_t* vrsImage, uint32_t vrsImagePitch, ParallelFor parallelFor)
+{
+    FFX_VariableShading_GenerateVrsImage(cb, additionalShadingRates, inputs, FFX_VariableShading_GetDefaultCpuGeneratorConfig(), vrsImage, vrsImagePitch, parallelFor);
+}
+
+// single threaded, scratch reserved with FFX_VariableShading_ReserveCpuGeneratorScratch keeps viewport changes free of allocations
+inline void FFX_VariableShading_GenerateVrsImage(const FFX_VariableShading_CB& cb, bool additionalShadingRates, const FFX_VariableShading_CpuInputs& inputs, uint8_t* vrsImage, uint32_t vrsImagePitch, FFX_VariableShading_CpuGeneratorScratch& scratch)
+{
+    uint32_t firstTileX, firstTileY, tilesX, tilesY;
+    FFX_VariableShading_GetViewportTiles(&cb, firstTileX, firstTileY, tilesX, tilesY);
+    FFX_VariableShading_GenerateVrsImageTiles(cb, additionalShadingRates, inputs, 0, tilesX, 0, tilesY, vrsImage, vrsImagePitch, scratch);
+}
+
+inline void FFX_VariableShading_GenerateVrsImage(const FFX_VariableShading_CB& cb, bool additionalShadingRates, const FFX_VariableShading_CpuInputs& inputs, uint8_t* vrsImage, uint32_t vrsImagePitch)
+{
+    FFX_VariableShading_GenerateVrsImage(cb, additionalShadingRates, inputs, vrsImage, vrsImagePitch, FFX_VariableShading_GetThreadCpuGeneratorScratch());
+}
+
+// 2x2 box filter, the equivalent of one level of the DownSamplePS mip chain.
+// dst is ((width + 1) / 2) x ((height + 1) / 2), odd edges are clamped.
+inline void FFX_VariableShading_DownsampleLuminance(const float* src, uint32_t width, uint32_t height, uint32_t srcPitch, float* dst, uint32_t dstPitch)
+{
+    const uint32_t dstWidth = (width + 1) / 2;
+    const uint32_t dstHeight = (height + 1) / 2;
+
+    for (uint32_t y = 0; y < dstHeight; ++y)
+    {
+        const float* row0 = &src[(2 * y) * srcPitch];
+        const float* row1 = &src[std::min(2 * y + 1, height - 1) * srcPitch];
+        for (uint32_t x = 0; x < dstWidth; ++x)
+        {
+            uint32_t x0 = 2 * x;
+            uint32_t x1 = std::min(2 * x + 1, width - 1);
+            dst[y * dstPitch + x] = 0.25f * (row0[x0] + row0[x1] + row1[x0] + row1[x1]);
+        }
+    }
+}
+
+// Converts a linear luminance plane to FFX_VARIABLESHADING_LUMINANCE_LAYOUT_SWIZZLED with blocks of
+// blockSize (cb.tileSize after FFX_VariableShading_SetInputMipLevel), dst holds
+// FFX_VariableShading_GetSwizzledLuminanceSize floats. Blocks are written in order, each one contiguous,
+// the parts of edge blocks outside the plane repeat the edge texels.
+inline void FFX_VariableShading_SwizzleLuminance(const float* src, uint32_t width, uint32_t height, uint32_t srcPitch, uint32_t blockSize, float* dst)
+{
+    const uint32_t blockShift = FFX_VariableShading_GetBlockShift(blockSize);
+    const uint32_t blocksX = FFX_VariableShading_DivideRoundingUp(width, blockSize);
+    const uint32_t blocksY = FFX_VariableShading_DivideRoundingUp(height, blockSize);
+    for (uint32_t by = 0; by < blocksY; ++by)
+    {
+        for (uint32_t bx = 0; bx < blocksX; ++bx)
+        {
+            float* block = dst + ((size_t)by * blocksX + bx) * blockSize * blockSize;
+            for (uint32_t j = 0; j < blockSize; ++j)
+            {
+                const float* row = &src[(size_t)std::min((by << blockShift) + j, height - 1) * srcPitch];
+                const uint32_t rowBits = FFX_VariableShading_MortonSpread(j) << 1;
+                for (uint32_t i = 0; i < blockSize; ++i)
+                {
+                    block[rowBits | FFX_VariableShading_MortonSpread(i)] = row[std::min((bx << blockShift) + i, width - 1)];
+                }
+            }
+        }
+    }
+}
\ No newline at end of file
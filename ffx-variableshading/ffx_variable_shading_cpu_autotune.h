@@ -0,0 +1,405 @@
+// FFX_VariableShading_Cpu_Autotune.h
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//////////////////////////////////////////////////////////////////////////
+// VariableShading CPU generator autotuning
+//
+// The fastest FFX_VariableShading_CpuGeneratorConfig (thread count, tile
+// group width, band height) depends on core count and cache sizes. A short
+// calibration on synthetic inputs at the configured resolution picks it:
+//
+//   FFX_VariableShading_AutotuneResult tuned = FFX_VariableShading_GetCpuGeneratorConfig(
+//       "VrsAutotune.txt", cb, additionalShadingRates, mipLevel, FFX_VariableShading_GetDefaultAutotuneOptions());
+//   FFX_VariableShading_CpuThreadPool pool(tuned.config.threadCount);
+//   ...
+//   FFX_VariableShading_GenerateVrsImage(cb, additionalShadingRates, inputs, tuned.config, vrsImage, pitch,
+//       FFX_VariableShading_ThreadPoolParallelFor{ &pool });
+//
+// The result is stored in a small text file keyed by CPU model, hardware
+// thread count, resolution, tile size, mip level and rate set, so only the
+// first launch on a machine (or at a new resolution) pays for calibration.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ffx_variable_shading_cpu_jobs.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+static const uint32_t FFX_VARIABLESHADING_AUTOTUNE_CACHE_VERSION = 1;
+
+//--------------------------------------------------------------------------------------//
+// Calibration inputs                                                                   //
+//--------------------------------------------------------------------------------------//
+// Luminance with flat, smooth and noisy regions and a swirling motion field of a few pixels,
+// so every rate decision branch is taken. luminance is width x height, motionVectors is
+// (width << mipLevel) x (height << mipLevel) x 2, both without padding.
+inline void FFX_VariableShading_MakeCalibrationInputs(uint32_t width, uint32_t height, uint32_t mipLevel, std::vector<float>& luminance, std::vector<float>& motionVectors)
+{
+    uint32_t state = 0x9e3779b9u;
+    auto random = [&state]()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (float)(state & 0xffffff) / (float)0x1000000;
+    };
+
+    luminance.resize((size_t)width * height);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            const uint32_t region = ((x / 64) + (y / 64)) % 3;
+            float value = 0.5f;
+            if (region == 1)
+                value = 0.25f + 0.5f * (float)x / (float)width;
+            else if (region == 2)
+                value = random();
+            luminance[(size_t)y * width + x] = value;
+        }
+    }
+
+    const uint32_t mvWidth = width << mipLevel;
+    const uint32_t mvHeight = height << mipLevel;
+    motionVectors.resize((size_t)mvWidth * mvHeight * 2);
+    for (uint32_t y = 0; y < mvHeight; ++y)
+    {
+        for (uint32_t x = 0; x < mvWidth; ++x)
+        {
+            const float dx = (float)x / (float)mvWidth - 0.5f;
+            const float dy = (float)y / (float)mvHeight - 0.5f;
+            motionVectors[((size_t)y * mvWidth + x) * 2 + 0] = -dy * 8.0f;
+            motionVectors[((size_t)y * mvWidth + x) * 2 + 1] = dx * 8.0f;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------//
+// Autotuning                                                                           //
+//--------------------------------------------------------------------------------------//
+struct FFX_VariableShading_AutotuneOptions
+{
+    uint32_t    maxThreadCount;     // 0: std::thread::hardware_concurrency
+    uint32_t    repetitions;        // timed runs per candidate, the median counts
+    double      timeBudgetMs;       // no further refinement pass starts after this
+};
+
+inline FFX_VariableShading_AutotuneOptions FFX_VariableShading_GetDefaultAutotuneOptions()
+{
+    FFX_VariableShading_AutotuneOptions options;
+    options.maxThreadCount = 0;
+    options.repetitions = 5;
+    options.timeBudgetMs = 1000.0;
+    return options;
+}
+
+struct FFX_VariableShading_AutotuneResult
+{
+    FFX_VariableShading_CpuGeneratorConfig  config;
+    double                                  milliseconds;   // median generation time of config
+    uint32_t                                candidates;     // configurations timed, 0 if read from the cache
+};
+
+// CPUID brand string where available, e.g. "AMD Ryzen 9 3950X 16-Core Processor"
+inline std::string FFX_VariableShading_GetCpuModelName()
+{
+    char brand[49] = {};
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int regs[4];
+    __cpuid(regs, 0x80000000);
+    if ((uint32_t)regs[0] >= 0x80000004)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            __cpuid(regs, 0x80000002 + i);
+            memcpy(&brand[i * 16], regs, 16);
+        }
+    }
+#elif defined(__x86_64__) || defined(__i386__)
+    unsigned int regs[4];
+    if (__get_cpuid_max(0x80000000, nullptr) >= 0x80000004)
+    {
+        for (unsigned int i = 0; i < 3; ++i)
+        {
+            __get_cpuid(0x80000002 + i, &regs[0], &regs[1], &regs[2], &regs[3]);
+            memcpy(&brand[i * 16], regs, 16);
+        }
+    }
+#endif
+
+    // trimmed, without the characters of the cache file syntax
+    std::string name;
+    for (const char* c = brand; *c; ++c)
+    {
+        const char ch = (*c == '=' || *c == '\n' || *c == '\r') ? ' ' : *c;
+        if (ch != ' ' || (!name.empty() && name.back() != ' '))
+            name += ch;
+    }
+    while (!name.empty() && name.back() == ' ')
+        name.pop_back();
+    return name.empty() ? "unknown" : name;
+}
+
+inline std::string FFX_VariableShading_GetAutotuneCacheKey(const FFX_VariableShading_CB& cb, bool additionalShadingRates, uint32_t mipLevel)
+{
+    char settings[128];
+    snprintf(settings, sizeof(settings), "|threads %u|%ux%u|tile %u|mip %u|%s", std::thread::hardware_concurrency(), cb.width, cb.height, cb.tileSize, mipLevel,
+        additionalShadingRates ? "additional rates" : "base rates");
+    return FFX_VariableShading_GetCpuModelName() + settings;
+}
+
+// Times the generator on synthetic inputs for cb (width and height of the input mip level) and
+// returns the fastest configuration found. Coordinate descent, one parameter at a time: thread
+// count, band height, tile group width and the thread count again for the final shape. All
+// candidates run on one pool of the largest thread count and on the arenas of one
+// FFX_VariableShading_CpuContext, so neither thread start up nor scratch allocation is timed.
+// The thread count is capped at FFX_VARIABLESHADING_CPU_CONTEXT_MAX_WORKERS.
+inline FFX_VariableShading_AutotuneResult FFX_VariableShading_AutotuneCpuGenerator(const FFX_VariableShading_CB& cb, bool additionalShadingRates, uint32_t mipLevel, const FFX_VariableShading_AutotuneOptions& options)
+{
+    FFX_VARIABLESHADING_TRACE_SCOPE("Autotune", "VRS generation");
+
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point startTime = Clock::now();
+    auto elapsedMs = [&]() { return std::chrono::duration<double, std::milli>(Clock::now() - startTime).count(); };
+
+    // the synthetic inputs only cover the viewport, its cost does not depend on the offset
+    FFX_VariableShading_CB calibration = cb;
+    calibration.viewportX = calibration.viewportY = 0;
+
+    std::vector<float> luminance, motionVectors;
+    FFX_VariableShading_MakeCalibrationInputs(cb.width, cb.height, mipLevel, luminance, motionVectors);
+
+    FFX_VariableShading_CpuInputs inputs = {};
+    inputs.luminance = luminance.data();
+    inputs.luminancePitch = cb.width;
+    inputs.motionVectors = motionVectors.data();
+    inputs.motionVectorWidth = cb.width << mipLevel;
+    inputs.motionVectorHeight = cb.height << mipLevel;
+    inputs.motionVectorPitch = inputs.motionVectorWidth * 2;
+    inputs.mipLevel = mipLevel;
+
+    const uint32_t tilesX = FFX_VariableShading_DivideRoundingUp(cb.width, cb.tileSize);
+    const uint32_t tilesY = FFX_VariableShading_DivideRoundingUp(cb.height, cb.tileSize);
+    std::vector<uint8_t> vrsImage((size_t)tilesX * tilesY);
+
+    const uint32_t maxThreadCount = std::min(std::max(1u, options.maxThreadCount ? options.maxThreadCount : std::thread::hardware_concurrency()), FFX_VARIABLESHADING_CPU_CONTEXT_MAX_WORKERS);
+    const uint32_t repetitions = std::max(1u, options.repetitions);
+
+    FFX_VariableShading_AutotuneResult result;
+    result.config = FFX_VariableShading_GetDefaultCpuGeneratorConfig();
+    result.config.threadCount = 1;
+    result.milliseconds = INFINITY;
+    result.candidates = 0;
+
+    FFX_VariableShading_CpuThreadPool pool(maxThreadCount);
+
+    FFX_VariableShading_CpuContextDesc desc = {};
+    desc.cb = calibration;
+    desc.additionalShadingRates = additionalShadingRates;
+    desc.neighbourhoodShape = inputs.neighbourhoodShape;
+    desc.neighbourhoodRadius = inputs.neighbourhoodRadius;
+    desc.workerCount = maxThreadCount;
+    FFX_VariableShading_CpuContext context;
+    const bool haveContext = FFX_VariableShading_CreateCpuContext(&context, desc, FFX_VariableShading_GetDefaultCpuAllocator());
+
+    // without a context (out of memory) the workers use their thread's scratch
+    auto generate = [&](const FFX_VariableShading_CpuGeneratorConfig& config)
+    {
+        auto parallelFor = [&](uint32_t count, const std::function<void(uint32_t)>& fn) { pool.ParallelFor(count, fn, config.threadCount); };
+        if (haveContext)
+            FFX_VariableShading_GenerateVrsImage(&context, calibration, inputs, config, vrsImage.data(), tilesX, parallelFor);
+        else
+            FFX_VariableShading_GenerateVrsImage(calibration, additionalShadingRates, inputs, config, vrsImage.data(), tilesX, parallelFor);
+    };
+
+    auto measure = [&](const FFX_VariableShading_CpuGeneratorConfig& config)
+    {
+        // the first run warms up caches and wakes the workers
+        generate(config);
+
+        std::vector<double> times(repetitions);
+        for (uint32_t i = 0; i < repetitions; ++i)
+        {
+            const Clock::time_point t0 = Clock::now();
+            generate(config);
+            times[i] = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        }
+        std::nth_element(times.begin(), times.begin() + repetitions / 2, times.end());
+
+        ++result.candidates;
+        if (times[repetitions / 2] < result.milliseconds)
+        {
+            result.milliseconds = times[repetitions / 2];
+            result.config = config;
+        }
+    };
+
+    // 1, 2, 4, ... and maxThreadCount
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+        threadCounts.push_back(threadCount);
+    threadCounts.push_back(maxThreadCount);
+
+    const uint32_t bandHeights[] = { 1, 2, 4, 8 };
+    const uint32_t tileGroupWidths[] = { 0, 64, 32, 16 };
+
+    for (uint32_t threadCount : threadCounts)
+    {
+        FFX_VariableShading_CpuGeneratorConfig config = FFX_VariableShading_GetDefaultCpuGeneratorConfig();
+        config.threadCount = threadCount;
+        measure(config);
+    }
+
+    if (elapsedMs() < options.timeBudgetMs)
+    {
+        const FFX_VariableShading_CpuGeneratorConfig best = result.config;
+        for (uint32_t bandHeight : bandHeights)
+        {
+            FFX_VariableShading_CpuGeneratorConfig config = best;
+            config.bandHeight = bandHeight;
+            if (bandHeight != best.bandHeight && bandHeight <= tilesY)
+                measure(config);
+        }
+    }
+
+    if (elapsedMs() < options.timeBudgetMs)
+    {
+        const FFX_VariableShading_CpuGeneratorConfig best = result.config;
+        for (uint32_t tileGroupWidth : tileGroupWidths)
+        {
+            FFX_VariableShading_CpuGeneratorConfig config = best;
+            config.tileGroupWidth = tileGroupWidth;
+            if (tileGroupWidth != best.tileGroupWidth && tileGroupWidth < tilesX)
+                measure(config);
+        }
+    }
+
+    // smaller tasks can shift the best thread count, e.g. when there are fewer bands than threads
+    if (elapsedMs() < options.timeBudgetMs && (result.config.bandHeight != 1 || result.config.tileGroupWidth != 0))
+    {
+        const FFX_VariableShading_CpuGeneratorConfig best = result.config;
+        for (uint32_t threadCount : threadCounts)
+        {
+            FFX_VariableShading_CpuGeneratorConfig config = best;
+            config.threadCount = threadCount;
+            if (threadCount != best.threadCount)
+                measure(config);
+        }
+    }
+
+    FFX_VariableShading_DestroyCpuContext(&context);
+    return result;
+}
+
+//--------------------------------------------------------------------------------------//
+// Cache                                                                                //
+//--------------------------------------------------------------------------------------//
+// One line per key: <key>=<tile group width> <band height> <thread count> <milliseconds>
+
+inline bool FFX_VariableShading_LoadAutotuneCache(const char* fileName, const std::string& key, FFX_VariableShading_AutotuneResult* pResult)
+{
+    FILE* f = fopen(fileName, "r");
+    if (!f)
+        return false;
+
+    char line[512];
+    bool found = false;
+    uint32_t version = 0;
+    if (fgets(line, sizeof(line), f) && sscanf(line, "# FidelityFX Variable Shading autotune cache %u", &version) == 1 && version == FFX_VARIABLESHADING_AUTOTUNE_CACHE_VERSION)
+    {
+        while (!found && fgets(line, sizeof(line), f))
+        {
+            char* separator = strrchr(line, '=');
+            if (!separator || std::string(line, separator) != key)
+                continue;
+
+            FFX_VariableShading_AutotuneResult result;
+            if (sscanf(separator + 1, "%u %u %u %lf", &result.config.tileGroupWidth, &result.config.bandHeight, &result.config.threadCount, &result.milliseconds) == 4 &&
+                result.config.bandHeight > 0 && result.config.threadCount > 0)
+            {
+                result.candidates = 0;
+                *pResult = result;
+                found = true;
+            }
+        }
+    }
+
+    fclose(f);
+    return found;
+}
+
+// replaces the entry of key, other entries are kept
+inline bool FFX_VariableShading_SaveAutotuneCache(const char* fileName, const std::string& key, const FFX_VariableShading_AutotuneResult& result)
+{
+    std::vector<std::string> lines;
+    if (FILE* f = fopen(fileName, "r"))
+    {
+        char line[512];
+        uint32_t version = 0;
+        if (fgets(line, sizeof(line), f) && sscanf(line, "# FidelityFX Variable Shading autotune cache %u", &version) == 1 && version == FFX_VARIABLESHADING_AUTOTUNE_CACHE_VERSION)
+        {
+            while (fgets(line, sizeof(line), f))
+            {
+                const char* separator = strrchr(line, '=');
+                if (separator && std::string((const char*)line, separator) != key)
+                    lines.push_back(line);
+            }
+        }
+        fclose(f);
+    }
+
+    FILE* f = fopen(fileName, "w");
+    if (!f)
+        return false;
+
+    fprintf(f, "# FidelityFX Variable Shading autotune cache %u\n", FFX_VARIABLESHADING_AUTOTUNE_CACHE_VERSION);
+    for (const std::string& line : lines)
+        fputs(line.c_str(), f);
+    fprintf(f, "%s=%u %u %u %.4f\n", key.c_str(), result.config.tileGroupWidth, result.config.bandHeight, result.config.threadCount, result.milliseconds);
+    return fclose(f) == 0;
+}
+
+// The cached configuration for this machine and resolution, calibrating and caching it on a miss.
+// cacheFileName can be null to always calibrate.
+inline FFX_VariableShading_AutotuneResult FFX_VariableShading_GetCpuGeneratorConfig(const char* cacheFileName, const FFX_VariableShading_CB& cb, bool additionalShadingRates, uint32_t mipLevel, const FFX_VariableShading_AutotuneOptions& options)
+{
+    const std::string key = FFX_VariableShading_GetAutotuneCacheKey(cb, additionalShadingRates, mipLevel);
+
+    FFX_VariableShading_AutotuneResult result;
+    if (cacheFileName && FFX_VariableShading_LoadAutotuneCache(cacheFileName, key, &result))
+        return result;
+
+    result = FFX_VariableShading_AutotuneCpuGenerator(cb, additionalShadingRates, mipLevel, options);
+    if (cacheFileName)
+        FFX_VariableShading_SaveAutotuneCache(cacheFileName, key, result);
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,290 @@
+// FFX_VariableShading_Cpu_Batch.h
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//////////////////////////////////////////////////////////////////////////
+// VariableShading CPU batch processing
+//
+// Throughput mode for captured sequences, next to the latency oriented
+// per frame scheduling of FFX_VariableShading_GenerateVrsImage
+// (FFX_VariableShading_CpuGeneratorConfig): every worker takes whole frames
+// through decode and generate, so a 720p frame of a few thousand tiles does
+// not have to be split across all cores. Results are consumed in frame
+// order.
+//
+// - In flight memory is bounded: every worker owns framesPerWorker frame
+//   slots and only takes a new frame once one of them has been consumed.
+// - Slots are created by their worker, and with pinToNumaNodes workers are
+//   spread round robin over the NUMA nodes and pinned to the CPUs of their
+//   node, so first touch keeps the frame data node local.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#endif
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+//--------------------------------------------------------------------------------------//
+// NUMA                                                                                 //
+//--------------------------------------------------------------------------------------//
+#if defined(__linux__)
+// CPUs of a node from /sys/devices/system/node/node<node>/cpulist ("0-7,16-23")
+inline bool FFX_VariableShading_GetNumaNodeCpus(uint32_t node, cpu_set_t* cpus)
+{
+    char fileName[64];
+    snprintf(fileName, sizeof(fileName), "/sys/devices/system/node/node%u/cpulist", node);
+    FILE* f = fopen(fileName, "r");
+    if (!f)
+        return false;
+
+    CPU_ZERO(cpus);
+    bool any = false;
+    unsigned first, last;
+    int separator;
+    while (fscanf(f, "%u", &first) == 1)
+    {
+        last = first;
+        separator = fgetc(f);
+        if (separator == '-')
+        {
+            if (fscanf(f, "%u", &last) != 1)
+                break;
+            separator = fgetc(f);
+        }
+        for (unsigned cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+        {
+            CPU_SET(cpu, cpus);
+            any = true;
+        }
+        if (separator != ',')
+            break;
+    }
+
+    fclose(f);
+    return any;
+}
+#endif
+
+inline uint32_t FFX_VariableShading_GetNumaNodeCount()
+{
+#if defined(_WIN32)
+    ULONG highestNode = 0;
+    return GetNumaHighestNodeNumber(&highestNode) ? (uint32_t)highestNode + 1 : 1;
+#elif defined(__linux__)
+    uint32_t count = 0;
+    cpu_set_t cpus;
+    while (FFX_VariableShading_GetNumaNodeCpus(count, &cpus))
+        ++count;
+    return std::max(count, 1u);
+#else
+    return 1;
+#endif
+}
+
+// Restricts the calling thread to the CPUs of a NUMA node, returns false if that is not possible
+inline bool FFX_VariableShading_PinThreadToNumaNode(uint32_t node)
+{
+#if defined(_WIN32)
+    GROUP_AFFINITY affinity = {};
+    if (!GetNumaNodeProcessorMaskEx((USHORT)node, &affinity) || !affinity.Mask)
+        return false;
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#elif defined(__linux__)
+    cpu_set_t cpus;
+    if (!FFX_VariableShading_GetNumaNodeCpus(node, &cpus))
+        return false;
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+#else
+    (void)node;
+    return false;
+#endif
+}
+
+// Restores the CPUs the constructing thread was allowed to run on when it goes out of scope
+struct FFX_VariableShading_ThreadAffinityScope
+{
+#if defined(_WIN32)
+    GROUP_AFFINITY  affinity = {};
+    bool            saved = GetThreadGroupAffinity(GetCurrentThread(), &affinity) != 0;
+    ~FFX_VariableShading_ThreadAffinityScope()
+    {
+        if (saved)
+            SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr);
+    }
+#elif defined(__linux__)
+    cpu_set_t       cpus;
+    bool            saved = pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+    ~FFX_VariableShading_ThreadAffinityScope()
+    {
+        if (saved)
+            pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+#endif
+};
+
+//--------------------------------------------------------------------------------------//
+// Batch executor                                                                       //
+//--------------------------------------------------------------------------------------//
+struct FFX_VariableShading_BatchOptions
+{
+    uint32_t    threadCount;        // 0: std::thread::hardware_concurrency
+    uint32_t    framesPerWorker;    // frame slots per worker, at most threadCount * framesPerWorker frames in flight
+    bool        pinToNumaNodes;     // spread the workers over the NUMA nodes, ignored on single node hosts
+};
+
+inline FFX_VariableShading_BatchOptions FFX_VariableShading_GetDefaultBatchOptions()
+{
+    FFX_VariableShading_BatchOptions options;
+    options.threadCount = 0;
+    options.framesPerWorker = 2;
+    options.pinToNumaNodes = true;
+    return options;
+}
+
+// Runs frames [0, frameCount) through
+//   decode(frameIndex, Frame&)    on a worker, loads or produces the frame's inputs
+//   generate(frameIndex, Frame&)  on the same worker, e.g. FFX_VariableShading_GenerateVrsImage
+//   consume(frameIndex, Frame&)   in frame order, never concurrently, e.g. scoring or encoding
+// Frame has to be default constructible. Slots are reused, so decode should reuse the
+// allocations of the previous frame in the slot instead of assuming an empty Frame.
+template <typename Frame, typename Decode, typename Generate, typename Consume>
+void FFX_VariableShading_ProcessFrames(uint32_t frameCount, const FFX_VariableShading_BatchOptions& options, Decode decode, Generate generate, Consume consume)
+{
+    if (frameCount == 0)
+        return;
+
+    const uint32_t threadCount = std::min(frameCount, std::max(1u, options.threadCount ? options.threadCount : std::thread::hardware_concurrency()));
+    const uint32_t framesPerWorker = std::max(options.framesPerWorker, 1u);
+    const uint32_t numaNodeCount = options.pinToNumaNodes ? FFX_VariableShading_GetNumaNodeCount() : 1;
+
+    struct Slot
+    {
+        std::unique_ptr<Frame>  frame;
+        uint32_t                frameIndex;
+        bool                    busy;       // claimed and not yet consumed
+        bool                    ready;      // generated
+    };
+
+    struct Worker
+    {
+        std::vector<Slot>       slots;
+        uint32_t                nextSlot = 0;
+    };
+
+    std::vector<Worker> workers(threadCount);
+    std::vector<Slot*> frameSlots(frameCount, nullptr);
+
+    std::mutex mutex;
+    std::condition_variable slotFreed;
+    uint32_t nextFrame = 0;
+    uint32_t nextConsumed = 0;
+    bool consuming = false;
+
+    // Consumes ready frames in order. Only one thread consumes at a time, a thread that finds
+    // another one consuming leaves its frame to it.
+    auto drain = [&](std::unique_lock<std::mutex>& lock)
+    {
+        if (consuming)
+            return;
+        consuming = true;
+        while (nextConsumed < frameCount && frameSlots[nextConsumed] && frameSlots[nextConsumed]->ready)
+        {
+            Slot* slot = frameSlots[nextConsumed];
+            lock.unlock();
+            consume(slot->frameIndex, *slot->frame);
+            lock.lock();
+            slot->busy = false;
+            slot->ready = false;
+            frameSlots[nextConsumed++] = nullptr;
+            slotFreed.notify_all();
+        }
+        consuming = false;
+    };
+
+    auto workerMain = [&](uint32_t workerIndex)
+    {
+        if (numaNodeCount > 1)
+            FFX_VariableShading_PinThreadToNumaNode(workerIndex % numaNodeCount);
+
+        Worker& worker = workers[workerIndex];
+        worker.slots.resize(framesPerWorker);
+        for (Slot& slot : worker.slots)
+        {
+            slot.frame.reset(new Frame());
+            slot.busy = false;
+            slot.ready = false;
+        }
+
+        for (;;)
+        {
+            // a frame is only claimed once there is a slot for it, so the oldest claimed frame
+            // can always finish and the consumer never waits on a worker that waits on it
+            Slot* slot = &worker.slots[worker.nextSlot];
+            uint32_t frameIndex;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                slotFreed.wait(lock, [&]() { return !slot->busy || nextFrame >= frameCount; });
+                if (nextFrame >= frameCount)
+                    break;
+                frameIndex = nextFrame++;
+                slot->frameIndex = frameIndex;
+                slot->busy = true;
+                frameSlots[frameIndex] = slot;
+            }
+            worker.nextSlot = (worker.nextSlot + 1) % framesPerWorker;
+
+            decode(frameIndex, *slot->frame);
+            generate(frameIndex, *slot->frame);
+
+            std::unique_lock<std::mutex> lock(mutex);
+            slot->ready = true;
+            drain(lock);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < threadCount; ++i)
+        threads.emplace_back(workerMain, i);
+    {
+        // the calling thread is worker 0, it leaves with the affinity it came with
+        FFX_VariableShading_ThreadAffinityScope callerAffinity;
+        workerMain(0);
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+}
\ No newline at end of file
@@ -0,0 +1,254 @@
+// FFX_VariableShading_Cpu_Context.h
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//////////////////////////////////////////////////////////////////////////
+// VariableShading CPU generation context
+//
+// Owns all memory the CPU generator needs, allocated once at creation from
+// a caller provided allocator, so generating frames never touches the heap:
+//   - one scratch arena per worker (the CPU equivalent of the LDS arrays of
+//     the GPU threadgroups), sized for whole tile rows at the maximum
+//     resolution. Arenas start on a cache line and are padded to one, so
+//     workers never share a line.
+//   - optionally the VRS image of the maximum resolution
+//
+//   FFX_VariableShading_CpuContextDesc desc = {};
+//   desc.cb = cb;                              // maximum resolution, after FFX_VariableShading_SetInputMipLevel
+//   desc.additionalShadingRates = true;
+//   desc.workerCount = pool.ThreadCount();
+//   desc.allocateVrsImage = true;
+//   FFX_VariableShading_CpuContext context;
+//   FFX_VariableShading_CreateCpuContext(&context, desc, allocator);
+//   ...
+//   FFX_VariableShading_GenerateVrsImage(&context, frameCb, inputs, config,
+//       context.vrsImage, context.vrsImagePitch, parallelFor);
+//   ...
+//   FFX_VariableShading_DestroyCpuContext(&context);
+//
+// A task takes a free arena when it starts and returns it when done, so the
+// parallelFor or job system only has to run at most workerCount tasks at a
+// time, it does not need to tell the generator which worker it is on.
+// tests/test_cpu_context.cpp checks that generating frames neither calls the
+// allocator nor the global operator new. The parallelFor is not part of the
+// guarantee, a job system may allocate to queue its tasks.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ffx_variable_shading_cpu.h"
+
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+
+static const uint32_t FFX_VARIABLESHADING_CPU_CONTEXT_MAX_WORKERS = 64;
+
+// allocate returns memory aligned to alignment (a power of two) or NULL
+struct FFX_VariableShading_CpuAllocator
+{
+    void*   (*allocate)(void* userData, size_t size, size_t alignment);
+    void    (*deallocate)(void* userData, void* memory);
+    void*   userData;
+};
+
+// malloc based, the pointer malloc returned is kept in front of the aligned block
+inline void* FFX_VariableShading_DefaultCpuAllocate(void* userData, size_t size, size_t alignment)
+{
+    (void)userData;
+    void* memory = malloc(size + alignment + sizeof(void*));
+    if (!memory)
+        return NULL;
+
+    uintptr_t aligned = ((uintptr_t)memory + sizeof(void*) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    ((void**)aligned)[-1] = memory;
+    return (void*)aligned;
+}
+
+inline void FFX_VariableShading_DefaultCpuDeallocate(void* userData, void* memory)
+{
+    (void)userData;
+    if (memory)
+        free(((void**)memory)[-1]);
+}
+
+inline FFX_VariableShading_CpuAllocator FFX_VariableShading_GetDefaultCpuAllocator()
+{
+    FFX_VariableShading_CpuAllocator allocator;
+    allocator.allocate = FFX_VariableShading_DefaultCpuAllocate;
+    allocator.deallocate = FFX_VariableShading_DefaultCpuDeallocate;
+    allocator.userData = NULL;
+    return allocator;
+}
+
+struct FFX_VariableShading_CpuContextDesc
+{
+    FFX_VariableShading_CB  cb;                     // largest surface generated with the context (viewportX/Y + width/height), its tile size and mip level
+    bool                    additionalShadingRates;
+    uint32_t                neighbourhoodShape;     // largest neighbourhood of FFX_VariableShading_CpuInputs used with the context
+    uint32_t                neighbourhoodRadius;
+    uint32_t                workerCount;            // tasks running at the same time, at most FFX_VARIABLESHADING_CPU_CONTEXT_MAX_WORKERS
+    bool                    allocateVrsImage;       // also allocate the VRS image of cb
+};
+
+struct FFX_VariableShading_CpuContext
+{
+    FFX_VariableShading_CpuAllocator    allocator;
+    FFX_VariableShading_CpuContextDesc  desc;
+    size_t                              arenaSize;      // per worker, a multiple of FFX_VARIABLESHADING_CACHE_LINE_SIZE
+    uint8_t*                            arenas;         // desc.workerCount * arenaSize bytes
+    std::atomic<uint64_t>               freeArenas;     // one bit per arena
+    uint8_t*                            vrsImage;       // with desc.allocateVrsImage, otherwise NULL
+    uint32_t                            vrsImagePitch;  // 0 without desc.allocateVrsImage
+    uint32_t                            vrsImageHeight;
+};
+
+inline void* FFX_VariableShading_CpuContextAllocate(FFX_VariableShading_CpuContext* context, size_t size)
+{
+    return context->allocator.allocate(context->allocator.userData, size, FFX_VARIABLESHADING_CACHE_LINE_SIZE);
+}
+
+// only returns the memory that was allocated, the allocator never sees NULL
+inline void FFX_VariableShading_DestroyCpuContext(FFX_VariableShading_CpuContext* context)
+{
+    if (context->arenas)
+        context->allocator.deallocate(context->allocator.userData, context->arenas);
+    if (context->vrsImage)
+        context->allocator.deallocate(context->allocator.userData, context->vrsImage);
+    context->arenas = NULL;
+    context->vrsImage = NULL;
+    context->vrsImagePitch = 0;
+    context->vrsImageHeight = 0;
+}
+
+// returns false if an allocation failed, the context then holds no memory
+inline bool FFX_VariableShading_CreateCpuContext(FFX_VariableShading_CpuContext* context, const FFX_VariableShading_CpuContextDesc& desc, const FFX_VariableShading_CpuAllocator& allocator)
+{
+    context->allocator = allocator;
+    context->desc = desc;
+    context->desc.workerCount = std::min(std::max(desc.workerCount, 1u), FFX_VARIABLESHADING_CPU_CONTEXT_MAX_WORKERS);
+    context->arenas = NULL;
+    context->vrsImage = NULL;
+    context->vrsImagePitch = 0;
+    context->vrsImageHeight = 0;
+
+    uint32_t firstTileX, firstTileY, tilesX, tilesY;
+    FFX_VariableShading_GetViewportTiles(&desc.cb, firstTileX, firstTileY, tilesX, tilesY);
+    const uint32_t imageWidth = firstTileX + tilesX;
+    const uint32_t imageHeight = firstTileY + tilesY;
+
+    FFX_VariableShading_CpuInputs inputs = {};
+    inputs.neighbourhoodShape = desc.neighbourhoodShape;
+    inputs.neighbourhoodRadius = desc.neighbourhoodRadius;
+    context->arenaSize = FFX_VariableShading_GetCpuGeneratorScratchLayout(desc.cb, desc.additionalShadingRates, inputs, imageWidth).size;
+
+    const uint32_t workerCount = context->desc.workerCount;
+    context->freeArenas.store((workerCount == 64) ? ~0ull : ((1ull << workerCount) - 1), std::memory_order_relaxed);
+
+    context->arenas = (uint8_t*)FFX_VariableShading_CpuContextAllocate(context, context->arenaSize * workerCount);
+    if (desc.allocateVrsImage)
+    {
+        context->vrsImagePitch = (uint32_t)FFX_VariableShading_AlignToCacheLine(imageWidth);
+        context->vrsImageHeight = imageHeight;
+        context->vrsImage = (uint8_t*)FFX_VariableShading_CpuContextAllocate(context, (size_t)context->vrsImagePitch * imageHeight);
+    }
+
+    if (!context->arenas || (desc.allocateVrsImage && !context->vrsImage))
+    {
+        FFX_VariableShading_DestroyCpuContext(context);
+        return false;
+    }
+    return true;
+}
+
+// cb has to lie inside the surface of the context, with its tile size, and inputs must not use a wider neighbourhood
+inline bool FFX_VariableShading_CpuContextFits(const FFX_VariableShading_CpuContext* context, const FFX_VariableShading_CB& cb, const FFX_VariableShading_CpuInputs& inputs)
+{
+    if ((cb.tileSize != context->desc.cb.tileSize) ||
+        (cb.viewportX + cb.width > context->desc.cb.viewportX + context->desc.cb.width) ||
+        (cb.viewportY + cb.height > context->desc.cb.viewportY + context->desc.cb.height))
+        return false;
+
+    uint32_t firstTileX, firstTileY, tilesX, tilesY;
+    FFX_VariableShading_GetViewportTiles(&cb, firstTileX, firstTileY, tilesX, tilesY);
+    return FFX_VariableShading_GetCpuGeneratorScratchLayout(cb, context->desc.additionalShadingRates, inputs, tilesX).size <= context->arenaSize;
+}
+
+// takes a free arena, waits if all desc.workerCount are in use
+inline uint32_t FFX_VariableShading_AcquireCpuContextArena(FFX_VariableShading_CpuContext* context)
+{
+    for (;;)
+    {
+        uint64_t available = context->freeArenas.load(std::memory_order_relaxed);
+        while (available)
+        {
+            const uint64_t bit = available & (~available + 1);
+            if (context->freeArenas.compare_exchange_weak(available, available & ~bit, std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                uint32_t index = 0;
+                while (!((bit >> index) & 1))
+                    ++index;
+                return index;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+inline void FFX_VariableShading_ReleaseCpuContextArena(FFX_VariableShading_CpuContext* context, uint32_t arena)
+{
+    context->freeArenas.fetch_or(1ull << arena, std::memory_order_release);
+}
+
+// FFX_VariableShading_GenerateVrsImageTask on an arena of the context
+inline void FFX_VariableShading_GenerateVrsImageTask(FFX_VariableShading_CpuContext* context, const FFX_VariableShading_CB& cb, const FFX_VariableShading_CpuInputs& inputs, const FFX_VariableShading_CpuGeneratorConfig& config, uint32_t task, uint8_t* vrsImage, uint32_t vrsImagePitch)
+{
+    const uint32_t arena = FFX_VariableShading_AcquireCpuContextArena(context);
+    FFX_VariableShading_GenerateVrsImageTask(cb, context->desc.additionalShadingRates, inputs, config, task, vrsImage, vrsImagePitch, context->arenas + arena * context->arenaSize);
+    FFX_VariableShading_ReleaseCpuContextArena(context, arena);
+}
+
+// FFX_VariableShading_GenerateVrsImage with the scratch of the context, returns false without generating
+// anything if cb or inputs do not fit the context (FFX_VariableShading_CpuContextFits)
+template <typename ParallelFor>
+bool FFX_VariableShading_GenerateVrsImage(FFX_VariableShading_CpuContext* context, const FFX_VariableShading_CB& cb, const FFX_VariableShading_CpuInputs& inputs, const FFX_VariableShading_CpuGeneratorConfig& config, uint8_t* vrsImage, uint32_t vrsImagePitch, ParallelFor parallelFor)
+{
+    if (!FFX_VariableShading_CpuContextFits(context, cb, inputs))
+        return false;
+
+    parallelFor(FFX_VariableShading_GetGeneratorTaskCount(cb, config), [&](uint32_t task)
+    {
+        FFX_VariableShading_GenerateVrsImageTask(context, cb, inputs, config, task, vrsImage, vrsImagePitch);
+    });
+    return true;
+}
+
+// single threaded on the first arena
+inline bool FFX_VariableShading_GenerateVrsImage(FFX_VariableShading_CpuContext* context, const FFX_VariableShading_CB& cb, const FFX_VariableShading_CpuInputs& inputs, uint8_t* vrsImage, uint32_t vrsImagePitch)
+{
+    if (!FFX_VariableShading_CpuContextFits(context, cb, inputs))
+        return false;
+
+    uint32_t firstTileX, firstTileY, tilesX, tilesY;
+    FFX_VariableShading_GetViewportTiles(&cb, firstTileX, firstTileY, tilesX, tilesY);
+    const uint32_t arena = FFX_VariableShading_AcquireCpuContextArena(context);
+    FFX_VariableShading_GenerateVrsImageTiles(cb, context->desc.additionalShadingRates, inputs, 0, tilesX, 0, tilesY, vrsImage, vrsImagePitch, context->arenas + arena * context->arenaSize);
+    FFX_VariableShading_ReleaseCpuContextArena(context, arena);
+    return true;
+}
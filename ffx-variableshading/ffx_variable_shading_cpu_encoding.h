@@ -0,0 +1,403 @@
+// FFX_VariableShading_Cpu_Encoding.h
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//////////////////////////////////////////////////////////////////////////
+// VariableShading compact VRS image encodings
+//
+// A VRS image stores one byte per tile but holds only the 7 valid rates,
+// usually in large uniform regions. For captures, for passing rate images
+// between processes and for uploads there are three smaller forms, all
+// with random access to single rows:
+//
+// Nibbles      4 bits per tile, the rate itself, the even tile in the low
+//              nibble. Rows of FFX_VariableShading_GetNibbleRowSize bytes.
+//              Lossless for any 4 bit value, packed and unpacked with
+//              SSE2/NEON, 32 tiles per iteration.
+// RateClasses  3 bits per tile, the rate class (FFX_VariableShading_GetRateClass),
+//              8 tiles in 3 bytes, tile i in bits 3 * i of the little endian
+//              24 bit group. Rows of FFX_VariableShading_GetRateClassRowSize
+//              bytes. Only the 7 valid rates can be stored.
+// RunLength    Variable length rows of runs, one token byte per run: the
+//              rate class in bits 0..2, the run length - 1 in bits 3..7.
+//              A field of 31 is followed by the rest of the length - 32 as
+//              a LEB128 varint, so a uniform row of a 4K image takes 3 bytes.
+//              The encoded image starts with a header of width, height and
+//              height + 1 row offsets (uint32_t, native byte order), row y
+//              decodes from its offset alone.
+//
+// The rate to class mapping is arithmetic (class = y + 2 * x, x = (class + 1) / 3),
+// so the SIMD paths need no table lookups.
+// Define FFX_VARIABLESHADING_NO_SIMD for plain C++.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ffx_variable_shading_cpu.h"
+
+#include <string.h>
+
+//--------------------------------------------------------------------------------------//
+// 4 bit                                                                                //
+//--------------------------------------------------------------------------------------//
+inline uint32_t FFX_VariableShading_GetNibbleRowSize(uint32_t width)
+{
+    return (width + 1) / 2;
+}
+
+inline void FFX_VariableShading_PackNibbleRow(const uint8_t* rates, uint32_t width, uint8_t* packed)
+{
+    uint32_t i = 0;
+#if defined(FFX_VARIABLESHADING_SSE2)
+    const __m128i maskLow = _mm_set1_epi16(0x000f);
+    for (; i + 32 <= width; i += 32)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(rates + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(rates + i + 16));
+        // per 16 bit lane: even | (odd << 4), then pack the lanes to bytes
+        a = _mm_or_si128(_mm_and_si128(a, maskLow), _mm_and_si128(_mm_srli_epi16(a, 4), _mm_set1_epi16(0x00f0)));
+        b = _mm_or_si128(_mm_and_si128(b, maskLow), _mm_and_si128(_mm_srli_epi16(b, 4), _mm_set1_epi16(0x00f0)));
+        _mm_storeu_si128((__m128i*)(packed + i / 2), _mm_packus_epi16(a, b));
+    }
+#elif defined(FFX_VARIABLESHADING_NEON)
+    const uint8x16_t maskLow = vdupq_n_u8(0xf);
+    for (; i + 32 <= width; i += 32)
+    {
+        uint8x16x2_t tiles = vld2q_u8(rates + i);
+        vst1q_u8(packed + i / 2, vsliq_n_u8(vandq_u8(tiles.val[0], maskLow), tiles.val[1], 4));
+    }
+#endif
+    for (; i + 1 < width; i += 2)
+    {
+        packed[i / 2] = (uint8_t)((rates[i] & 0xf) | (rates[i + 1] << 4));
+    }
+    if (i < width)
+        packed[i / 2] = (uint8_t)(rates[i] & 0xf);
+}
+
+inline void FFX_VariableShading_UnpackNibbleRow(const uint8_t* packed, uint32_t width, uint8_t* rates)
+{
+    uint32_t i = 0;
+#if defined(FFX_VARIABLESHADING_SSE2)
+    const __m128i maskLow = _mm_set1_epi8(0xf);
+    for (; i + 32 <= width; i += 32)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(packed + i / 2));
+        __m128i even = _mm_and_si128(bytes, maskLow);
+        __m128i odd = _mm_and_si128(_mm_srli_epi16(bytes, 4), maskLow);
+        _mm_storeu_si128((__m128i*)(rates + i), _mm_unpacklo_epi8(even, odd));
+        _mm_storeu_si128((__m128i*)(rates + i + 16), _mm_unpackhi_epi8(even, odd));
+    }
+#elif defined(FFX_VARIABLESHADING_NEON)
+    const uint8x16_t maskLow = vdupq_n_u8(0xf);
+    for (; i + 32 <= width; i += 32)
+    {
+        uint8x16_t bytes = vld1q_u8(packed + i / 2);
+        uint8x16x2_t tiles;
+        tiles.val[0] = vandq_u8(bytes, maskLow);
+        tiles.val[1] = vshrq_n_u8(bytes, 4);
+        vst2q_u8(rates + i, tiles);
+    }
+#endif
+    for (; i + 1 < width; i += 2)
+    {
+        rates[i] = packed[i / 2] & 0xf;
+        rates[i + 1] = packed[i / 2] >> 4;
+    }
+    if (i < width)
+        rates[i] = packed[i / 2] & 0xf;
+}
+
+// packed holds height rows of FFX_VariableShading_GetNibbleRowSize(width) bytes
+inline void FFX_VariableShading_PackNibbles(const uint8_t* vrsImage, uint32_t width, uint32_t height, uint32_t pitch, uint8_t* packed)
+{
+    const uint32_t rowSize = FFX_VariableShading_GetNibbleRowSize(width);
+    for (uint32_t y = 0; y < height; ++y)
+        FFX_VariableShading_PackNibbleRow(vrsImage + (size_t)y * pitch, width, packed + (size_t)y * rowSize);
+}
+
+inline void FFX_VariableShading_UnpackNibbles(const uint8_t* packed, uint32_t width, uint32_t height, uint8_t* vrsImage, uint32_t pitch)
+{
+    const uint32_t rowSize = FFX_VariableShading_GetNibbleRowSize(width);
+    for (uint32_t y = 0; y < height; ++y)
+        FFX_VariableShading_UnpackNibbleRow(packed + (size_t)y * rowSize, width, vrsImage + (size_t)y * pitch);
+}
+
+//--------------------------------------------------------------------------------------//
+// 3 bit                                                                                //
+//--------------------------------------------------------------------------------------//
+inline uint32_t FFX_VariableShading_GetRateClassRowSize(uint32_t width)
+{
+    return (width + 7) / 8 * 3;
+}
+
+// same as FFX_VariableShading_GetRateClass for the valid rates
+inline uint32_t FFX_VariableShading_GetRateClassArithmetic(uint32_t rate)
+{
+    return (rate & 0x3) + ((rate >> 1) & 0x6);
+}
+
+inline uint32_t FFX_VariableShading_GetRateFromClassArithmetic(uint32_t rateClass)
+{
+    const uint32_t x = (rateClass + 1) / 3;
+    return FFX_VARIABLESHADING_MAKE_SHADING_RATE(x, rateClass - 2 * x);
+}
+
+inline void FFX_VariableShading_PackRateClassRow(const uint8_t* rates, uint32_t width, uint8_t* packed)
+{
+    uint32_t i = 0;
+#if defined(FFX_VARIABLESHADING_SSE2)
+    for (; i + 16 <= width; i += 16)
+    {
+        __m128i r = _mm_loadu_si128((const __m128i*)(rates + i));
+        __m128i c = _mm_add_epi8(_mm_and_si128(r, _mm_set1_epi8(0x3)), _mm_and_si128(_mm_srli_epi16(r, 1), _mm_set1_epi8(0x6)));
+        // merge neighbours in ever wider lanes: 2 x 3 bits per 16, 4 x 3 per 32, 8 x 3 per 64
+        c = _mm_or_si128(_mm_and_si128(c, _mm_set1_epi16(0x00ff)), _mm_slli_epi16(_mm_srli_epi16(c, 8), 3));
+        c = _mm_or_si128(_mm_and_si128(c, _mm_set1_epi32(0x0000ffff)), _mm_slli_epi32(_mm_srli_epi32(c, 16), 6));
+        c = _mm_or_si128(_mm_and_si128(c, _mm_set_epi32(0, -1, 0, -1)), _mm_slli_epi64(_mm_srli_epi64(c, 32), 12));
+        const uint32_t group0 = (uint32_t)_mm_cvtsi128_si32(c);
+        const uint32_t group1 = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(c, 8));
+        uint8_t* out = packed + i / 8 * 3;
+        out[0] = (uint8_t)group0; out[1] = (uint8_t)(group0 >> 8); out[2] = (uint8_t)(group0 >> 16);
+        out[3] = (uint8_t)group1; out[4] = (uint8_t)(group1 >> 8); out[5] = (uint8_t)(group1 >> 16);
+    }
+#elif defined(FFX_VARIABLESHADING_NEON)
+    for (; i + 16 <= width; i += 16)
+    {
+        uint8x16_t r = vld1q_u8(rates + i);
+        uint8x16_t c = vaddq_u8(vandq_u8(r, vdupq_n_u8(0x3)), vandq_u8(vshrq_n_u8(r, 1), vdupq_n_u8(0x6)));
+        uint16x8_t c16 = vreinterpretq_u16_u8(c);
+        c16 = vorrq_u16(vandq_u16(c16, vdupq_n_u16(0x00ff)), vshlq_n_u16(vshrq_n_u16(c16, 8), 3));
+        uint32x4_t c32 = vreinterpretq_u32_u16(c16);
+        c32 = vorrq_u32(vandq_u32(c32, vdupq_n_u32(0x0000ffff)), vshlq_n_u32(vshrq_n_u32(c32, 16), 6));
+        uint64x2_t c64 = vreinterpretq_u64_u32(c32);
+        c64 = vorrq_u64(vandq_u64(c64, vdupq_n_u64(0xffffffffull)), vshlq_n_u64(vshrq_n_u64(c64, 32), 12));
+        const uint32_t group0 = (uint32_t)vgetq_lane_u64(c64, 0);
+        const uint32_t group1 = (uint32_t)vgetq_lane_u64(c64, 1);
+        uint8_t* out = packed + i / 8 * 3;
+        out[0] = (uint8_t)group0; out[1] = (uint8_t)(group0 >> 8); out[2] = (uint8_t)(group0 >> 16);
+        out[3] = (uint8_t)group1; out[4] = (uint8_t)(group1 >> 8); out[5] = (uint8_t)(group1 >> 16);
+    }
+#endif
+    for (; i < width; i += 8)
+    {
+        uint32_t group = 0;
+        for (uint32_t j = 0; (j < 8) && (i + j < width); ++j)
+            group |= FFX_VariableShading_GetRateClassArithmetic(rates[i + j]) << (3 * j);
+        uint8_t* out = packed + i / 8 * 3;
+        out[0] = (uint8_t)group; out[1] = (uint8_t)(group >> 8); out[2] = (uint8_t)(group >> 16);
+    }
+}
+
+inline void FFX_VariableShading_UnpackRateClassRow(const uint8_t* packed, uint32_t width, uint8_t* rates)
+{
+    uint32_t i = 0;
+#if defined(FFX_VARIABLESHADING_SSE2)
+    for (; i + 16 <= width; i += 16)
+    {
+        const uint8_t* in = packed + i / 8 * 3;
+        const int32_t group0 = in[0] | (in[1] << 8) | (in[2] << 16);
+        const int32_t group1 = in[3] | (in[4] << 8) | (in[5] << 16);
+        // the packing steps reversed: 8 x 3 bits per 64 bit lane down to one class per byte
+        __m128i c = _mm_set_epi32(0, group1, 0, group0);
+        c = _mm_or_si128(_mm_and_si128(c, _mm_set_epi32(0, 0xfff, 0, 0xfff)), _mm_slli_epi64(_mm_srli_epi64(c, 12), 32));
+        c = _mm_or_si128(_mm_and_si128(c, _mm_set1_epi32(0x3f)), _mm_slli_epi32(_mm_srli_epi32(c, 6), 16));
+        c = _mm_or_si128(_mm_and_si128(c, _mm_set1_epi16(0x7)), _mm_slli_epi16(_mm_srli_epi16(c, 3), 8));
+        // x = (c > 1) + (c > 4), y = c - 2 * x, the compares return -1
+        __m128i x = _mm_sub_epi8(_mm_setzero_si128(), _mm_add_epi8(_mm_cmpgt_epi8(c, _mm_set1_epi8(1)), _mm_cmpgt_epi8(c, _mm_set1_epi8(4))));
+        __m128i x2 = _mm_add_epi8(x, x);
+        _mm_storeu_si128((__m128i*)(rates + i), _mm_add_epi8(_mm_sub_epi8(c, x2), _mm_add_epi8(x2, x2)));
+    }
+#elif defined(FFX_VARIABLESHADING_NEON)
+    for (; i + 16 <= width; i += 16)
+    {
+        const uint8_t* in = packed + i / 8 * 3;
+        const uint64_t group0 = in[0] | (in[1] << 8) | (in[2] << 16);
+        const uint64_t group1 = in[3] | (in[4] << 8) | (in[5] << 16);
+        uint64x2_t c64 = vcombine_u64(vcreate_u64(group0), vcreate_u64(group1));
+        c64 = vorrq_u64(vandq_u64(c64, vdupq_n_u64(0xfff)), vshlq_n_u64(vshrq_n_u64(c64, 12), 32));
+        uint32x4_t c32 = vreinterpretq_u32_u64(c64);
+        c32 = vorrq_u32(vandq_u32(c32, vdupq_n_u32(0x3f)), vshlq_n_u32(vshrq_n_u32(c32, 6), 16));
+        uint16x8_t c16 = vreinterpretq_u16_u32(c32);
+        c16 = vorrq_u16(vandq_u16(c16, vdupq_n_u16(0x7)), vshlq_n_u16(vshrq_n_u16(c16, 3), 8));
+        uint8x16_t c = vreinterpretq_u8_u16(c16);
+        uint8x16_t x = vsubq_u8(vdupq_n_u8(0), vaddq_u8(vcgtq_u8(c, vdupq_n_u8(1)), vcgtq_u8(c, vdupq_n_u8(4))));
+        uint8x16_t x2 = vaddq_u8(x, x);
+        vst1q_u8(rates + i, vaddq_u8(vsubq_u8(c, x2), vaddq_u8(x2, x2)));
+    }
+#endif
+    for (; i < width; i += 8)
+    {
+        const uint8_t* in = packed + i / 8 * 3;
+        const uint32_t group = in[0] | (in[1] << 8) | (in[2] << 16);
+        for (uint32_t j = 0; (j < 8) && (i + j < width); ++j)
+            rates[i + j] = (uint8_t)FFX_VariableShading_GetRateFromClassArithmetic((group >> (3 * j)) & 0x7);
+    }
+}
+
+// packed holds height rows of FFX_VariableShading_GetRateClassRowSize(width) bytes
+inline void FFX_VariableShading_PackRateClasses(const uint8_t* vrsImage, uint32_t width, uint32_t height, uint32_t pitch, uint8_t* packed)
+{
+    const uint32_t rowSize = FFX_VariableShading_GetRateClassRowSize(width);
+    for (uint32_t y = 0; y < height; ++y)
+        FFX_VariableShading_PackRateClassRow(vrsImage + (size_t)y * pitch, width, packed + (size_t)y * rowSize);
+}
+
+inline void FFX_VariableShading_UnpackRateClasses(const uint8_t* packed, uint32_t width, uint32_t height, uint8_t* vrsImage, uint32_t pitch)
+{
+    const uint32_t rowSize = FFX_VariableShading_GetRateClassRowSize(width);
+    for (uint32_t y = 0; y < height; ++y)
+        FFX_VariableShading_UnpackRateClassRow(packed + (size_t)y * rowSize, width, vrsImage + (size_t)y * pitch);
+}
+
+//--------------------------------------------------------------------------------------//
+// Row run length                                                                       //
+//--------------------------------------------------------------------------------------//
+static const uint32_t FFX_VARIABLESHADING_RUN_LENGTH_TOKEN_MAX = 32;   // shorter runs take one byte
+
+// header and row offsets in uint32_t
+inline size_t FFX_VariableShading_GetRunLengthHeaderSize(uint32_t height)
+{
+    return (2 + (size_t)height + 1) * sizeof(uint32_t);
+}
+
+// upper bound of the encoded size, a run never takes more bytes than tiles
+inline size_t FFX_VariableShading_GetRunLengthMaxSize(uint32_t width, uint32_t height)
+{
+    return FFX_VariableShading_GetRunLengthHeaderSize(height) + (size_t)width * height;
+}
+
+// end of the run starting at x, 16 tiles per compare with SIMD
+inline uint32_t FFX_VariableShading_FindRunEnd(const uint8_t* row, uint32_t x, uint32_t width)
+{
+    const uint8_t rate = row[x++];
+#if defined(FFX_VARIABLESHADING_SSE2)
+    const __m128i r = _mm_set1_epi8((char)rate);
+    while ((x + 16 <= width) && (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(row + x)), r)) == 0xffff))
+        x += 16;
+#elif defined(FFX_VARIABLESHADING_NEON)
+    const uint8x16_t r = vdupq_n_u8(rate);
+    while (x + 16 <= width)
+    {
+        uint64x2_t equal = vreinterpretq_u64_u8(vceqq_u8(vld1q_u8(row + x), r));
+        if ((vgetq_lane_u64(equal, 0) & vgetq_lane_u64(equal, 1)) != ~0ull)
+            break;
+        x += 16;
+    }
+#endif
+    while ((x < width) && (row[x] == rate))
+        ++x;
+    return x;
+}
+
+// returns the bytes written to encoded, at most width
+inline uint32_t FFX_VariableShading_EncodeRunLengthRow(const uint8_t* rates, uint32_t width, uint8_t* encoded)
+{
+    uint32_t size = 0;
+    for (uint32_t x = 0; x < width;)
+    {
+        const uint32_t end = FFX_VariableShading_FindRunEnd(rates, x, width);
+        const uint32_t rateClass = FFX_VariableShading_GetRateClassArithmetic(rates[x]);
+        uint32_t length = end - x;
+        if (length < FFX_VARIABLESHADING_RUN_LENGTH_TOKEN_MAX)
+        {
+            encoded[size++] = (uint8_t)(rateClass | ((length - 1) << 3));
+        }
+        else
+        {
+            encoded[size++] = (uint8_t)(rateClass | ((FFX_VARIABLESHADING_RUN_LENGTH_TOKEN_MAX - 1) << 3));
+            length -= FFX_VARIABLESHADING_RUN_LENGTH_TOKEN_MAX;
+            do
+            {
+                encoded[size++] = (uint8_t)((length & 0x7f) | ((length > 0x7f) ? 0x80 : 0));
+                length >>= 7;
+            } while (length);
+        }
+        x = end;
+    }
+    return size;
+}
+
+// decodes the runs of one row, at most width tiles
+inline void FFX_VariableShading_DecodeRunLengthRow(const uint8_t* encoded, uint32_t size, uint8_t* rates, uint32_t width)
+{
+    uint32_t x = 0;
+    for (uint32_t i = 0; (i < size) && (x < width);)
+    {
+        const uint8_t token = encoded[i++];
+        uint32_t length = (token >> 3) + 1;
+        if (length == FFX_VARIABLESHADING_RUN_LENGTH_TOKEN_MAX)
+        {
+            uint32_t extra = 0;
+            for (uint32_t shift = 0; i < size; shift += 7)
+            {
+                const uint8_t byte = encoded[i++];
+                extra |= (uint32_t)(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    break;
+            }
+            length += extra;
+        }
+        length = std::min(length, width - x);
+        memset(rates + x, (int)FFX_VariableShading_GetRateFromClassArithmetic(token & 0x7), length);
+        x += length;
+    }
+}
+
+// writes header, row offsets and runs, encoded needs FFX_VariableShading_GetRunLengthMaxSize bytes,
+// returns the encoded size
+inline size_t FFX_VariableShading_EncodeRunLength(const uint8_t* vrsImage, uint32_t width, uint32_t height, uint32_t pitch, uint8_t* encoded)
+{
+    const size_t headerSize = FFX_VariableShading_GetRunLengthHeaderSize(height);
+    uint32_t* header = (uint32_t*)encoded;
+    header[0] = width;
+    header[1] = height;
+    uint32_t* rowOffsets = header + 2;
+
+    uint32_t offset = 0;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        rowOffsets[y] = offset;
+        offset += FFX_VariableShading_EncodeRunLengthRow(vrsImage + (size_t)y * pitch, width, encoded + headerSize + offset);
+    }
+    rowOffsets[height] = offset;
+    return headerSize + offset;
+}
+
+inline void FFX_VariableShading_GetRunLengthSize(const uint8_t* encoded, uint32_t& width, uint32_t& height)
+{
+    width = ((const uint32_t*)encoded)[0];
+    height = ((const uint32_t*)encoded)[1];
+}
+
+// random access: decodes row y alone
+inline void FFX_VariableShading_DecodeRunLengthRow(const uint8_t* encoded, uint32_t y, uint8_t* rates)
+{
+    const uint32_t* header = (const uint32_t*)encoded;
+    const uint32_t* rowOffsets = header + 2;
+    const uint8_t* runs = encoded + FFX_VariableShading_GetRunLengthHeaderSize(header[1]);
+    FFX_VariableShading_DecodeRunLengthRow(runs + rowOffsets[y], rowOffsets[y + 1] - rowOffsets[y], rates, header[0]);
+}
+
+inline void FFX_VariableShading_DecodeRunLength(const uint8_t* encoded, uint8_t* vrsImage, uint32_t pitch)
+{
+    const uint32_t height = ((const uint32_t*)encoded)[1];
+    for (uint32_t y = 0; y < height; ++y)
+        FFX_VariableShading_DecodeRunLengthRow(encoded, y, vrsImage + (size_t)y * pitch);
+}
@@ -0,0 +1,303 @@
+// FFX_VariableShading_Cpu_Jobs.h
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//////////////////////////////////////////////////////////////////////////
+// VariableShading CPU generator jobs
+//
+// The CPU generator never creates threads itself. Besides the blocking
+// parallelFor interface of FFX_VariableShading_GenerateVrsImage it can hand
+// out its work as independent jobs, so it interleaves with the other jobs of
+// an engine's scheduler instead of competing with them for cores:
+//
+//   FFX_VariableShading_PrepareGenerateJobs(&jobs, cb, additionalShadingRates, inputs, config,
+//       vrsImage, pitch, []() { /* VRS image ready */ });
+//   for (uint32_t i = 0; i < jobs.jobCount; ++i)
+//       engine.Schedule([&jobs, i]() { FFX_VariableShading_RunGenerateJob(&jobs, i); });
+//
+// Adapters are provided for FFX_VariableShading_CpuThreadPool (plain
+// std::thread workers) and, with FFX_VARIABLESHADING_TBB defined, for
+// oneTBB task groups and parallel_for.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ffx_variable_shading_cpu.h"
+#include "ffx_variable_shading_cpu_context.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(FFX_VARIABLESHADING_TBB)
+#include <tbb/parallel_for.h>
+#include <tbb/task_group.h>
+#endif
+
+//--------------------------------------------------------------------------------------//
+// Generation jobs                                                                      //
+//--------------------------------------------------------------------------------------//
+struct FFX_VariableShading_GenerateJobs
+{
+    FFX_VariableShading_CB                  cb;
+    bool                                    additionalShadingRates;
+    FFX_VariableShading_CpuInputs           inputs;
+    FFX_VariableShading_CpuGeneratorConfig  config;
+    uint8_t*                                vrsImage;
+    uint32_t                                vrsImagePitch;
+    uint32_t                                jobCount;
+    std::atomic<uint32_t>                   remainingJobs;
+    std::function<void()>                   onComplete;     // optional, runs on the thread that finishes the last job
+    FFX_VariableShading_CpuContext*         context;        // optional, jobs take their scratch from its arenas instead of the scratch of the thread they run on
+};
+
+// The inputs and vrsImage have to stay valid until the last job has run. A jobs object can
+// be prepared again once all jobs of the previous generation have run.
+inline void FFX_VariableShading_PrepareGenerateJobs(FFX_VariableShading_GenerateJobs* jobs, const FFX_VariableShading_CB& cb, bool additionalShadingRates, const FFX_VariableShading_CpuInputs& inputs,
+    const FFX_VariableShading_CpuGeneratorConfig& config, uint8_t* vrsImage, uint32_t vrsImagePitch, std::function<void()> onComplete)
+{
+    jobs->cb = cb;
+    jobs->additionalShadingRates = additionalShadingRates;
+    jobs->inputs = inputs;
+    jobs->config = config;
+    jobs->vrsImage = vrsImage;
+    jobs->vrsImagePitch = vrsImagePitch;
+    jobs->jobCount = FFX_VariableShading_GetGeneratorTaskCount(cb, config);
+    jobs->remainingJobs.store(jobs->jobCount, std::memory_order_relaxed);
+    jobs->onComplete = std::move(onComplete);
+    jobs->context = NULL;
+}
+
+// The jobs use the arenas of context, cb and inputs have to fit it (FFX_VariableShading_CpuContextFits)
+// and the scheduler must not run more than its workerCount jobs at a time.
+inline void FFX_VariableShading_PrepareGenerateJobs(FFX_VariableShading_GenerateJobs* jobs, FFX_VariableShading_CpuContext* context, const FFX_VariableShading_CB& cb, const FFX_VariableShading_CpuInputs& inputs,
+    const FFX_VariableShading_CpuGeneratorConfig& config, uint8_t* vrsImage, uint32_t vrsImagePitch, std::function<void()> onComplete)
+{
+    FFX_VariableShading_PrepareGenerateJobs(jobs, cb, context->desc.additionalShadingRates, inputs, config, vrsImage, vrsImagePitch, std::move(onComplete));
+    jobs->context = context;
+}
+
+// Runs job jobIndex, in any order and on any thread, every job exactly once
+inline void FFX_VariableShading_RunGenerateJob(FFX_VariableShading_GenerateJobs* jobs, uint32_t jobIndex)
+{
+    FFX_VARIABLESHADING_TRACE_SCOPE_ARGS("Generate job", "VRS generation", FFX_VARIABLESHADING_TRACE_INDEX_ARGS, jobIndex);
+    if (jobs->context)
+        FFX_VariableShading_GenerateVrsImageTask(jobs->context, jobs->cb, jobs->inputs, jobs->config, jobIndex, jobs->vrsImage, jobs->vrsImagePitch);
+    else
+        FFX_VariableShading_GenerateVrsImageTask(jobs->cb, jobs->additionalShadingRates, jobs->inputs, jobs->config, jobIndex, jobs->vrsImage, jobs->vrsImagePitch);
+
+    // acq_rel: the last job sees the tiles of all others before the completion runs
+    if (jobs->remainingJobs.fetch_sub(1, std::memory_order_acq_rel) == 1 && jobs->onComplete)
+        jobs->onComplete();
+}
+
+inline bool FFX_VariableShading_GenerateJobsDone(const FFX_VariableShading_GenerateJobs* jobs)
+{
+    return jobs->remainingJobs.load(std::memory_order_acquire) == 0;
+}
+
+//--------------------------------------------------------------------------------------//
+// std::thread pool                                                                     //
+//--------------------------------------------------------------------------------------//
+// Persistent workers with a FIFO task queue. ParallelFor blocks, but the calling thread
+// works on the loop too, so it can be called from inside a task. A pool of threadCount
+// runs threadCount - 1 workers.
+class FFX_VariableShading_CpuThreadPool
+{
+public:
+    explicit FFX_VariableShading_CpuThreadPool(uint32_t threadCount)
+    {
+        for (uint32_t i = 1; i < threadCount; ++i)
+            m_workers.emplace_back([this]() { WorkerLoop(); });
+    }
+
+    // runs the tasks that are already queued
+    ~FFX_VariableShading_CpuThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_exit = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& worker : m_workers)
+            worker.join();
+    }
+
+    FFX_VariableShading_CpuThreadPool(const FFX_VariableShading_CpuThreadPool&) = delete;
+    FFX_VariableShading_CpuThreadPool& operator=(const FFX_VariableShading_CpuThreadPool&) = delete;
+
+    uint32_t ThreadCount() const { return (uint32_t)m_workers.size() + 1; }
+
+    // without workers the task runs right away on the calling thread
+    void Submit(std::function<void()> task)
+    {
+        if (m_workers.empty())
+        {
+            task();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+        m_wake.notify_one();
+    }
+
+    // calls fn(i) for all i in [0, count) and returns when all calls are done, on at most
+    // threadCount threads including the calling one (0: all threads of the pool)
+    void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& fn, uint32_t threadCount = 0)
+    {
+        if (m_workers.empty() || count < 2 || threadCount == 1)
+        {
+            for (uint32_t i = 0; i < count; ++i)
+                fn(i);
+            return;
+        }
+
+        // helpers that start after the loop is done must not touch fn, so they hold the state
+        struct Loop
+        {
+            const std::function<void(uint32_t)>*    fn;
+            uint32_t                                count;
+            std::atomic<uint32_t>                   next;
+            std::atomic<uint32_t>                   done;
+            std::mutex                              mutex;
+            std::condition_variable                 finished;
+
+            void Run(bool helper)
+            {
+                uint32_t completed = 0;
+                for (uint32_t i = next.fetch_add(1, std::memory_order_relaxed); i < count; i = next.fetch_add(1, std::memory_order_relaxed))
+                {
+                    FFX_VARIABLESHADING_TRACE_SCOPE_ARGS("Parallel for", "Thread pool", FFX_VARIABLESHADING_TRACE_INDEX_ARGS, i);
+                    (*fn)(i);
+                    ++completed;
+                }
+#if defined(FFX_VARIABLESHADING_PROFILE)
+                if (helper && completed)
+                    FFX_VariableShading_ProfileAddSteals(completed);
+#else
+                (void)helper;
+#endif
+                if (completed && done.fetch_add(completed, std::memory_order_acq_rel) + completed == count)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    finished.notify_all();
+                }
+            }
+        };
+
+        std::shared_ptr<Loop> loop = std::make_shared<Loop>();
+        loop->fn = &fn;
+        loop->count = count;
+        loop->next.store(0, std::memory_order_relaxed);
+        loop->done.store(0, std::memory_order_relaxed);
+
+        uint32_t helpers = std::min(count - 1, (uint32_t)m_workers.size());
+        if (threadCount)
+            helpers = std::min(helpers, threadCount - 1);
+
+        // fn has to outlive every queued helper, so a helper that cannot be queued
+        // leaves its share to the others instead of throwing past them
+        try
+        {
+            for (uint32_t i = 0; i < helpers; ++i)
+                Submit([loop]() { loop->Run(true); });
+        }
+        catch (...)
+        {
+        }
+
+        loop->Run(false);
+
+        std::unique_lock<std::mutex> lock(loop->mutex);
+        loop->finished.wait(lock, [&]() { return loop->done.load(std::memory_order_acquire) == count; });
+    }
+
+private:
+    void WorkerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this]() { return m_exit || !m_tasks.empty(); });
+                if (m_tasks.empty())
+                    return;
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            FFX_VARIABLESHADING_TRACE_SCOPE("Pool task", "Thread pool");
+            task();
+        }
+    }
+
+    std::vector<std::thread>                    m_workers;
+    std::mutex                                  m_mutex;
+    std::condition_variable                     m_wake;
+    std::deque<std::function<void()>>           m_tasks;
+    bool                                        m_exit = false;
+};
+
+// parallelFor for FFX_VariableShading_GenerateVrsImage
+struct FFX_VariableShading_ThreadPoolParallelFor
+{
+    FFX_VariableShading_CpuThreadPool*  pool;
+
+    void operator()(uint32_t count, const std::function<void(uint32_t)>& fn) const { pool->ParallelFor(count, fn); }
+};
+
+inline void FFX_VariableShading_SubmitGenerateJobs(FFX_VariableShading_GenerateJobs* jobs, FFX_VariableShading_CpuThreadPool& pool)
+{
+    for (uint32_t i = 0; i < jobs->jobCount; ++i)
+        pool.Submit([jobs, i]() { FFX_VariableShading_RunGenerateJob(jobs, i); });
+}
+
+//--------------------------------------------------------------------------------------//
+// oneTBB                                                                               //
+//--------------------------------------------------------------------------------------//
+#if defined(FFX_VARIABLESHADING_TBB)
+// parallelFor for FFX_VariableShading_GenerateVrsImage, one TBB task per generator task
+struct FFX_VariableShading_TbbParallelFor
+{
+    template <typename Fn>
+    void operator()(uint32_t count, const Fn& fn) const
+    {
+        tbb::parallel_for(tbb::blocked_range<uint32_t>(0, count, 1), [&](const tbb::blocked_range<uint32_t>& range)
+        {
+            for (uint32_t i = range.begin(); i != range.end(); ++i)
+                fn(i);
+        });
+    }
+};
+
+// the jobs run in group, group.wait() or the completion callback tell when the image is ready
+inline void FFX_VariableShading_SubmitGenerateJobs(FFX_VariableShading_GenerateJobs* jobs, tbb::task_group& group)
+{
+    for (uint32_t i = 0; i < jobs->jobCount; ++i)
+        group.run([jobs, i]() { FFX_VariableShading_RunGenerateJob(jobs, i); });
+}
+#endif
\ No newline at end of file
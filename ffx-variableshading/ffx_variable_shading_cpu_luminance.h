@@ -0,0 +1,196 @@
+// FFX_VariableShading_Cpu_Luminance.h
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//////////////////////////////////////////////////////////////////////////
+// VariableShading CPU luminance transforms
+//
+// Applies the transforms of ffx_variable_shading_luminance.h to linear
+// luminance planes before FFX_VariableShading_GenerateVrsImage:
+//
+//   std::vector<float> table(FFX_VariableShading_GetLuminanceTableCount(desc));
+//   FFX_VariableShading_LuminanceTransform transform;
+//   FFX_VariableShading_InitLuminanceTransform(&transform, desc, table.data());
+//   FFX_VariableShading_TransformLuminance(transform, linear, pitch, width, height, transformed, pitch);
+//
+// The curves are not evaluated per texel: a table holds them at the floats
+// whose low 16 bits are 0 (128 entries per octave up to the half float
+// maximum of 65504) and texels interpolate linearly between the two
+// entries around them, indexed by the high 16 bits of the float. The
+// error stays below 1e-4 of the curve for the shipped transforms. Index
+// and interpolation use SSE2 or NEON where available, the table reads are
+// scalar. WEBER divides by the mean of the 3x3 texels around each texel,
+// clamped to the plane, and cannot transform in place.
+//
+// FFX_VariableShading_TransformLuminanceRows works on a band of rows, so
+// bands can be transformed in parallel (or as they arrive, see
+// ffx_variable_shading_cpu_stream.h). The planes stay row linear, swizzle
+// the transformed plane with FFX_VariableShading_SwizzleLuminance.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ffx_variable_shading_cpu.h"
+#include "ffx_variable_shading_luminance.h"
+
+#include <string.h>
+
+// entries up to the one after 65504 (0x477fe000)
+static const uint32_t FFX_VARIABLESHADING_LUMINANCE_TABLE_COUNT = (0x477fe000u >> 16) + 2;
+static const float FFX_VARIABLESHADING_LUMINANCE_TABLE_MAX = 65504.0f;
+
+struct FFX_VariableShading_LuminanceTransform
+{
+    FFX_VariableShading_LuminanceTransformDesc  desc;
+    const float*                                table;  // NULL for NONE and WEBER
+};
+
+inline bool FFX_VariableShading_LuminanceTransformUsesTable(uint32_t transform)
+{
+    return (transform == FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_SRGB) ||
+        (transform == FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_LOG2) ||
+        (transform == FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_PQ);
+}
+
+inline const char* FFX_VariableShading_GetLuminanceTransformName(uint32_t transform)
+{
+    static const char* names[FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_COUNT] = { "none", "srgb", "log2", "pq", "weber" };
+    return (transform < FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_COUNT) ? names[transform] : "unknown";
+}
+
+// floats of the table FFX_VariableShading_InitLuminanceTransform fills
+inline size_t FFX_VariableShading_GetLuminanceTableCount(const FFX_VariableShading_LuminanceTransformDesc& desc)
+{
+    return FFX_VariableShading_LuminanceTransformUsesTable(desc.transform) ? FFX_VARIABLESHADING_LUMINANCE_TABLE_COUNT : 0;
+}
+
+inline void FFX_VariableShading_InitLuminanceTransform(FFX_VariableShading_LuminanceTransform* transform, const FFX_VariableShading_LuminanceTransformDesc& desc, float* table)
+{
+    transform->desc = desc;
+    transform->table = NULL;
+    if (!FFX_VariableShading_LuminanceTransformUsesTable(desc.transform))
+        return;
+
+    for (uint32_t i = 0; i < FFX_VARIABLESHADING_LUMINANCE_TABLE_COUNT; ++i)
+    {
+        const uint32_t bits = i << 16;
+        float x;
+        memcpy(&x, &bits, sizeof(x));
+        table[i] = FFX_VariableShading_ApplyLuminanceCurve(desc, x);
+    }
+    transform->table = table;
+}
+
+// the curve of transform at x through the table
+inline float FFX_VariableShading_LookupLuminanceCurve(const FFX_VariableShading_LuminanceTransform& transform, float x)
+{
+    x = (x > 0.0f) ? std::min(x, FFX_VARIABLESHADING_LUMINANCE_TABLE_MAX) : 0.0f;
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    const float* entry = &transform.table[bits >> 16];
+    return entry[0] + (entry[1] - entry[0]) * (float)(bits & 0xffff) * (1.0f / 65536.0f);
+}
+
+inline void FFX_VariableShading_LookupLuminanceRow(const FFX_VariableShading_LuminanceTransform& transform, const float* src, float* dst, uint32_t count)
+{
+    uint32_t x = 0;
+#if defined(FFX_VARIABLESHADING_SSE2)
+    const float* table = transform.table;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 maxValue = _mm_set1_ps(FFX_VARIABLESHADING_LUMINANCE_TABLE_MAX);
+    const __m128i fracMask = _mm_set1_epi32(0xffff);
+    const __m128 fracScale = _mm_set1_ps(1.0f / 65536.0f);
+    for (; x + 4 <= count; x += 4)
+    {
+        // max returns its second operand for NaN, which maps NaN to 0
+        const __m128i bits = _mm_castps_si128(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + x), zero), maxValue));
+        alignas(16) uint32_t index[4];
+        _mm_store_si128((__m128i*)index, _mm_srli_epi32(bits, 16));
+        const __m128 t0 = _mm_setr_ps(table[index[0]], table[index[1]], table[index[2]], table[index[3]]);
+        const __m128 t1 = _mm_setr_ps(table[index[0] + 1], table[index[1] + 1], table[index[2] + 1], table[index[3] + 1]);
+        const __m128 frac = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(bits, fracMask)), fracScale);
+        _mm_storeu_ps(dst + x, _mm_add_ps(t0, _mm_mul_ps(_mm_sub_ps(t1, t0), frac)));
+    }
+#elif defined(FFX_VARIABLESHADING_NEON)
+    const float* table = transform.table;
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t maxValue = vdupq_n_f32(FFX_VARIABLESHADING_LUMINANCE_TABLE_MAX);
+    const uint32x4_t fracMask = vdupq_n_u32(0xffff);
+    for (; x + 4 <= count; x += 4)
+    {
+        // select instead of max, NEON's max propagates NaN
+        const float32x4_t v = vld1q_f32(src + x);
+        const uint32x4_t bits = vreinterpretq_u32_f32(vminq_f32(vbslq_f32(vcgtq_f32(v, zero), v, zero), maxValue));
+        uint32_t index[4];
+        vst1q_u32(index, vshrq_n_u32(bits, 16));
+        const float t0Values[4] = { table[index[0]], table[index[1]], table[index[2]], table[index[3]] };
+        const float t1Values[4] = { table[index[0] + 1], table[index[1] + 1], table[index[2] + 1], table[index[3] + 1] };
+        const float32x4_t t0 = vld1q_f32(t0Values);
+        const float32x4_t t1 = vld1q_f32(t1Values);
+        const float32x4_t frac = vmulq_n_f32(vcvtq_f32_u32(vandq_u32(bits, fracMask)), 1.0f / 65536.0f);
+        vst1q_f32(dst + x, vmlaq_f32(t0, vsubq_f32(t1, t0), frac));
+    }
+#endif
+    for (; x < count; ++x)
+        dst[x] = FFX_VariableShading_LookupLuminanceCurve(transform, src[x]);
+}
+
+// row y of the plane divided by the 3x3 means around its texels, rows above and below clamped to the plane
+inline void FFX_VariableShading_WeberContrastRow(const float* src, uint32_t srcPitch, uint32_t width, uint32_t height, uint32_t y, float epsilon, float* dst)
+{
+    const float* above = src + (size_t)(y ? y - 1 : y) * srcPitch;
+    const float* row = src + (size_t)y * srcPitch;
+    const float* below = src + (size_t)std::min(y + 1, height - 1) * srcPitch;
+
+    // column sums clamped to the plane, negative and NaN texels count as 0
+    auto texel = [](float v) { return (v > 0.0f) ? v : 0.0f; };
+    auto column = [&](uint32_t x) { return texel(above[x]) + texel(row[x]) + texel(below[x]); };
+
+    float left = column(0);
+    float center = left;
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        const float right = (x + 1 < width) ? column(x + 1) : center;
+        dst[x] = texel(row[x]) / ((left + center + right) * (1.0f / 9.0f) + epsilon);
+        left = center;
+        center = right;
+    }
+}
+
+// rows [firstRow, firstRow + rowCount) of a width x height plane, WEBER reads the rows around them
+inline void FFX_VariableShading_TransformLuminanceRows(const FFX_VariableShading_LuminanceTransform& transform, const float* src, uint32_t srcPitch, uint32_t width, uint32_t height,
+    uint32_t firstRow, uint32_t rowCount, float* dst, uint32_t dstPitch)
+{
+    for (uint32_t y = firstRow; y < firstRow + rowCount; ++y)
+    {
+        const float* srcRow = src + (size_t)y * srcPitch;
+        float* dstRow = dst + (size_t)y * dstPitch;
+        if (transform.table)
+            FFX_VariableShading_LookupLuminanceRow(transform, srcRow, dstRow, width);
+        else if (transform.desc.transform == FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_WEBER)
+            FFX_VariableShading_WeberContrastRow(src, srcPitch, width, height, y, transform.desc.epsilon, dstRow);
+        else if (srcRow != dstRow)
+            memcpy(dstRow, srcRow, width * sizeof(float));
+    }
+}
+
+inline void FFX_VariableShading_TransformLuminance(const FFX_VariableShading_LuminanceTransform& transform, const float* src, uint32_t srcPitch, uint32_t width, uint32_t height, float* dst, uint32_t dstPitch)
+{
+    FFX_VariableShading_TransformLuminanceRows(transform, src, srcPitch, width, height, 0, height, dst, dstPitch);
+}
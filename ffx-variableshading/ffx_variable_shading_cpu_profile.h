@@ -0,0 +1,395 @@
+// FFX_VariableShading_Cpu_Profile.h
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//////////////////////////////////////////////////////////////////////////
+// VariableShading CPU generator instrumentation
+//
+// Opt in: define FFX_VARIABLESHADING_PROFILE before including
+// ffx_variable_shading_cpu.h. Without it the instrumentation macros in the
+// generator expand to nothing. FFX_VARIABLESHADING_TRACE additionally
+// records every stage as a timeline event (ffx_variable_shading_trace.h).
+//
+// Every call of FFX_VariableShading_GenerateVrsImageTiles accumulates on the
+// stack and publishes into a per thread slot when it returns:
+// - timestamp ticks (rdtsc where available) per stage: sampling, variance,
+//   neighbours, tile reduction, write
+// - tiles, tile rows and bytes read from the inputs
+// - steals: tasks of a FFX_VariableShading_CpuThreadPool::ParallelFor run by
+//   a worker instead of the calling thread, other schedulers report theirs
+//   via FFX_VariableShading_ProfileAddSteals
+// - on Linux, if enabled with FFX_VariableShading_SetHardwareCountersEnabled
+//   and permitted (perf_event_paranoid), CPU cycles, instructions, cache
+//   references and cache misses from perf_event_open, user space only.
+//
+// The query functions can be called from any thread at any time (e.g. by
+// an engine profiler once per frame); counters are monotonic until reset.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const uint32_t FFX_VARIABLESHADING_PROFILE_STAGE_SAMPLING = 0;
+static const uint32_t FFX_VARIABLESHADING_PROFILE_STAGE_VARIANCE = 1;
+static const uint32_t FFX_VARIABLESHADING_PROFILE_STAGE_NEIGHBOURS = 2;
+static const uint32_t FFX_VARIABLESHADING_PROFILE_STAGE_TILE_REDUCTION = 3;
+static const uint32_t FFX_VARIABLESHADING_PROFILE_STAGE_WRITE = 4;
+static const uint32_t FFX_VARIABLESHADING_PROFILE_STAGE_COUNT = 5;
+
+// A thread holds its slot until it exits, then the next new thread takes it over and adds to its counters.
+// Threads running at the same time beyond this share the last slot.
+static const uint32_t FFX_VARIABLESHADING_PROFILE_MAX_THREADS = 64;
+
+struct FFX_VariableShading_ProfileCounters
+{
+    uint64_t    stageTicks[FFX_VARIABLESHADING_PROFILE_STAGE_COUNT];   // see FFX_VariableShading_GetTimestampFrequency
+    uint64_t    tiles;
+    uint64_t    tileRows;
+    uint64_t    bytesRead;          // luminance and motion vector reads, before any caching
+    uint64_t    steals;             // tasks taken over from the thread that started the parallel loop
+
+    // hardware counters, 0 if not available
+    uint64_t    cpuCycles;
+    uint64_t    instructions;
+    uint64_t    cacheReferences;
+    uint64_t    cacheMisses;
+};
+
+static const uint32_t FFX_VARIABLESHADING_PROFILE_COUNTER_COUNT = sizeof(FFX_VariableShading_ProfileCounters) / sizeof(uint64_t);
+static_assert(sizeof(FFX_VariableShading_ProfileCounters) == FFX_VARIABLESHADING_PROFILE_COUNTER_COUNT * sizeof(uint64_t), "profile counters have to be uint64_t only");
+
+inline const char* FFX_VariableShading_GetProfileStageName(uint32_t stage)
+{
+    static const char* names[FFX_VARIABLESHADING_PROFILE_STAGE_COUNT] = { "Sampling", "Variance", "Neighbours", "Tile reduction", "Write" };
+    return (stage < FFX_VARIABLESHADING_PROFILE_STAGE_COUNT) ? names[stage] : "";
+}
+
+inline uint64_t FFX_VariableShading_ReadTimestamp()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// timestamp ticks per second, measured once on first use (takes ~20ms)
+inline double FFX_VariableShading_GetTimestampFrequency()
+{
+    static const double frequency = []()
+    {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        auto start = std::chrono::steady_clock::now();
+        uint64_t startTicks = FFX_VariableShading_ReadTimestamp();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t endTicks = FFX_VariableShading_ReadTimestamp();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return (double)(endTicks - startTicks) / seconds;
+#else
+        return 1e9;
+#endif
+    }();
+    return frequency;
+}
+
+//--------------------------------------------------------------------------------------//
+// Per thread slots                                                                     //
+//--------------------------------------------------------------------------------------//
+struct FFX_VariableShading_ProfileRegistry
+{
+    std::atomic<uint64_t>   slots[FFX_VARIABLESHADING_PROFILE_MAX_THREADS][FFX_VARIABLESHADING_PROFILE_COUNTER_COUNT];
+    std::atomic<uint64_t>   usedSlots;      // one bit per slot held by a running thread
+    std::atomic<uint32_t>   slotCount;      // the highest slot ever held + 1
+    std::atomic<bool>       hardwareCountersEnabled;
+    std::atomic<bool>       hardwareCountersAvailable;
+};
+
+inline FFX_VariableShading_ProfileRegistry& FFX_VariableShading_GetProfileRegistry()
+{
+    static FFX_VariableShading_ProfileRegistry registry = {};
+    return registry;
+}
+
+static_assert(FFX_VARIABLESHADING_PROFILE_MAX_THREADS <= 64, "one bit per slot in FFX_VariableShading_ProfileRegistry::usedSlots");
+
+static const uint32_t FFX_VARIABLESHADING_PROFILE_HARDWARE_COUNTER_COUNT = 4;
+
+// slot and perf_event file descriptors of the calling thread
+class FFX_VariableShading_ProfileThread
+{
+public:
+    FFX_VariableShading_ProfileThread()
+    {
+        FFX_VariableShading_ProfileRegistry& registry = FFX_VariableShading_GetProfileRegistry();
+        m_slot = FFX_VARIABLESHADING_PROFILE_MAX_THREADS - 1;
+        m_ownsSlot = false;
+        uint64_t used = registry.usedSlots.load(std::memory_order_relaxed);
+        while (used != ~0ull)
+        {
+            uint32_t slot = 0;
+            while (used & (1ull << slot))
+                ++slot;
+            if (registry.usedSlots.compare_exchange_weak(used, used | (1ull << slot), std::memory_order_relaxed))
+            {
+                m_slot = slot;
+                m_ownsSlot = true;
+                break;
+            }
+        }
+
+        uint32_t count = registry.slotCount.load(std::memory_order_relaxed);
+        while (count <= m_slot && !registry.slotCount.compare_exchange_weak(count, m_slot + 1, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    // the counters stay in the slot, totals do not drop when a thread exits
+    ~FFX_VariableShading_ProfileThread()
+    {
+        if (m_ownsSlot)
+            FFX_VariableShading_GetProfileRegistry().usedSlots.fetch_and(~(1ull << m_slot), std::memory_order_relaxed);
+#if defined(__linux__)
+        for (int fd : m_fds)
+        {
+            if (fd >= 0)
+                close(fd);
+        }
+#endif
+    }
+
+    uint32_t Slot() const { return m_slot; }
+
+    // reads the hardware counters in the order of FFX_VariableShading_ProfileCounters::cpuCycles..cacheMisses,
+    // returns false if they are disabled or not available
+    bool ReadHardwareCounters(uint64_t values[FFX_VARIABLESHADING_PROFILE_HARDWARE_COUNTER_COUNT])
+    {
+#if defined(__linux__)
+        if (!FFX_VariableShading_GetProfileRegistry().hardwareCountersEnabled.load(std::memory_order_relaxed))
+            return false;
+
+        if (!m_opened)
+            Open();
+        if (m_fds[0] < 0)
+            return false;
+
+        struct
+        {
+            uint64_t count;
+            uint64_t values[FFX_VARIABLESHADING_PROFILE_HARDWARE_COUNTER_COUNT];
+        } group = {};
+        if (read(m_fds[0], &group, sizeof(group)) < (ssize_t)sizeof(uint64_t))
+            return false;
+
+        for (uint32_t i = 0; i < FFX_VARIABLESHADING_PROFILE_HARDWARE_COUNTER_COUNT; ++i)
+            values[i] = (m_groupIndex[i] >= 0 && (uint64_t)m_groupIndex[i] < group.count) ? group.values[m_groupIndex[i]] : 0;
+        return true;
+#else
+        (void)values;
+        return false;
+#endif
+    }
+
+private:
+#if defined(__linux__)
+    void Open()
+    {
+        static const uint64_t configs[FFX_VARIABLESHADING_PROFILE_HARDWARE_COUNTER_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES };
+
+        m_opened = true;
+        int groupSize = 0;
+        for (uint32_t i = 0; i < FFX_VARIABLESHADING_PROFILE_HARDWARE_COUNTER_COUNT; ++i)
+        {
+            perf_event_attr attr = {};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.disabled = (i == 0) ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+
+            // the first counter is the group leader, the others are optional (not every PMU has them)
+            m_fds[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, (i == 0) ? -1 : m_fds[0], 0);
+            m_groupIndex[i] = (m_fds[i] >= 0) ? groupSize++ : -1;
+            if (m_fds[0] < 0)
+                return;
+        }
+
+        ioctl(m_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        FFX_VariableShading_GetProfileRegistry().hardwareCountersAvailable = true;
+    }
+
+    int         m_fds[FFX_VARIABLESHADING_PROFILE_HARDWARE_COUNTER_COUNT] = { -1, -1, -1, -1 };
+    int         m_groupIndex[FFX_VARIABLESHADING_PROFILE_HARDWARE_COUNTER_COUNT] = { -1, -1, -1, -1 };
+    bool        m_opened = false;
+#endif
+    uint32_t    m_slot;
+    bool        m_ownsSlot;
+};
+
+inline FFX_VariableShading_ProfileThread& FFX_VariableShading_GetProfileThread()
+{
+    static thread_local FFX_VariableShading_ProfileThread thread;
+    return thread;
+}
+
+inline void FFX_VariableShading_PublishProfileCounters(const FFX_VariableShading_ProfileCounters& counters)
+{
+    const uint64_t* values = reinterpret_cast<const uint64_t*>(&counters);
+    std::atomic<uint64_t>* slot = FFX_VariableShading_GetProfileRegistry().slots[FFX_VariableShading_GetProfileThread().Slot()];
+    for (uint32_t i = 0; i < FFX_VARIABLESHADING_PROFILE_COUNTER_COUNT; ++i)
+    {
+        if (values[i])
+            slot[i].fetch_add(values[i], std::memory_order_relaxed);
+    }
+}
+
+#if defined(FFX_VARIABLESHADING_TRACE)
+// ffx_variable_shading_trace.h
+inline void FFX_VariableShading_TraceComplete(const char* name, const char* category, uint64_t start, uint64_t end);
+#endif
+
+// Instrumentation of one generator call, see FFX_VARIABLESHADING_PROFILE_BEGIN
+class FFX_VariableShading_ProfileScope
+{
+public:
+    FFX_VariableShading_ProfileScope()
+    {
+        m_hardwareCounters = FFX_VariableShading_GetProfileThread().ReadHardwareCounters(m_hardwareStart);
+        m_timestamp = FFX_VariableShading_ReadTimestamp();
+    }
+
+    ~FFX_VariableShading_ProfileScope()
+    {
+        uint64_t hardwareEnd[FFX_VARIABLESHADING_PROFILE_HARDWARE_COUNTER_COUNT];
+        if (m_hardwareCounters && FFX_VariableShading_GetProfileThread().ReadHardwareCounters(hardwareEnd))
+        {
+            counters.cpuCycles += hardwareEnd[0] - m_hardwareStart[0];
+            counters.instructions += hardwareEnd[1] - m_hardwareStart[1];
+            counters.cacheReferences += hardwareEnd[2] - m_hardwareStart[2];
+            counters.cacheMisses += hardwareEnd[3] - m_hardwareStart[3];
+        }
+        FFX_VariableShading_PublishProfileCounters(counters);
+    }
+
+    // charges the time since the previous stage (or the start of the scope) to stage
+    void Stage(uint32_t stage)
+    {
+        uint64_t timestamp = FFX_VariableShading_ReadTimestamp();
+        counters.stageTicks[stage] += timestamp - m_timestamp;
+#if defined(FFX_VARIABLESHADING_TRACE)
+        FFX_VariableShading_TraceComplete(FFX_VariableShading_GetProfileStageName(stage), "VRS generation", m_timestamp, timestamp);
+#endif
+        m_timestamp = timestamp;
+    }
+
+    FFX_VariableShading_ProfileCounters counters = {};
+
+private:
+    uint64_t    m_timestamp;
+    uint64_t    m_hardwareStart[FFX_VARIABLESHADING_PROFILE_HARDWARE_COUNTER_COUNT] = {};
+    bool        m_hardwareCounters;
+};
+
+#define FFX_VARIABLESHADING_PROFILE_BEGIN() FFX_VariableShading_ProfileScope ffxProfileScope
+#define FFX_VARIABLESHADING_PROFILE_STAGE(stage) ffxProfileScope.Stage(stage)
+#define FFX_VARIABLESHADING_PROFILE_ADD(counter, value) ffxProfileScope.counters.counter += (value)
+
+//--------------------------------------------------------------------------------------//
+// Query API                                                                            //
+//--------------------------------------------------------------------------------------//
+inline void FFX_VariableShading_SetHardwareCountersEnabled(bool enabled)
+{
+    FFX_VariableShading_GetProfileRegistry().hardwareCountersEnabled = enabled;
+}
+
+// true once a thread managed to open the hardware counters
+inline bool FFX_VariableShading_HardwareCountersAvailable()
+{
+    return FFX_VariableShading_GetProfileRegistry().hardwareCountersAvailable;
+}
+
+// for schedulers driving the generator's parallelFor: count of tasks the calling thread took from another queue,
+// FFX_VariableShading_CpuThreadPool reports its own
+inline void FFX_VariableShading_ProfileAddSteals(uint64_t count)
+{
+    FFX_VariableShading_ProfileCounters counters = {};
+    counters.steals = count;
+    FFX_VariableShading_PublishProfileCounters(counters);
+}
+
+// number of slots threads have recorded counters in so far, see FFX_VARIABLESHADING_PROFILE_MAX_THREADS
+inline uint32_t FFX_VariableShading_GetProfileThreadCount()
+{
+    uint32_t count = FFX_VariableShading_GetProfileRegistry().slotCount;
+    return (count < FFX_VARIABLESHADING_PROFILE_MAX_THREADS) ? count : FFX_VARIABLESHADING_PROFILE_MAX_THREADS;
+}
+
+inline void FFX_VariableShading_GetProfileCounters(uint32_t thread, FFX_VariableShading_ProfileCounters* counters)
+{
+    uint64_t* values = reinterpret_cast<uint64_t*>(counters);
+    const std::atomic<uint64_t>* slot = FFX_VariableShading_GetProfileRegistry().slots[thread];
+    for (uint32_t i = 0; i < FFX_VARIABLESHADING_PROFILE_COUNTER_COUNT; ++i)
+        values[i] = slot[i].load(std::memory_order_relaxed);
+}
+
+// sum over all threads
+inline void FFX_VariableShading_GetProfileTotals(FFX_VariableShading_ProfileCounters* totals)
+{
+    *totals = {};
+    uint64_t* values = reinterpret_cast<uint64_t*>(totals);
+    for (uint32_t thread = 0; thread < FFX_VariableShading_GetProfileThreadCount(); ++thread)
+    {
+        FFX_VariableShading_ProfileCounters counters;
+        FFX_VariableShading_GetProfileCounters(thread, &counters);
+        const uint64_t* threadValues = reinterpret_cast<const uint64_t*>(&counters);
+        for (uint32_t i = 0; i < FFX_VARIABLESHADING_PROFILE_COUNTER_COUNT; ++i)
+            values[i] += threadValues[i];
+    }
+}
+
+// threads keep their slots, only the values are cleared
+inline void FFX_VariableShading_ResetProfileCounters()
+{
+    FFX_VariableShading_ProfileRegistry& registry = FFX_VariableShading_GetProfileRegistry();
+    for (uint32_t thread = 0; thread < FFX_VARIABLESHADING_PROFILE_MAX_THREADS; ++thread)
+    {
+        for (uint32_t i = 0; i < FFX_VARIABLESHADING_PROFILE_COUNTER_COUNT; ++i)
+            registry.slots[thread][i].store(0, std::memory_order_relaxed);
+    }
+}
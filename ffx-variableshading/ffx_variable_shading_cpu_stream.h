@@ -0,0 +1,215 @@
+// FFX_VariableShading_Cpu_Stream.h
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//////////////////////////////////////////////////////////////////////////
+// VariableShading CPU streaming generation
+//
+// Generates the VRS image of a surface from rows pushed top to bottom,
+// without ever holding the whole luminance and motion vector planes, for
+// very large offline images and line by line producers:
+//
+//   FFX_VariableShading_CpuStreamDesc desc = {};
+//   desc.cb = cb;                              // after FFX_VariableShading_SetInputMipLevel, no viewport offset
+//   desc.motionVectorWidth = width;            // full resolution, 0 without motion vectors
+//   desc.motionVectorHeight = height;
+//   desc.maxMotionRows = 8;
+//   FFX_VariableShading_CpuStream stream;
+//   FFX_VariableShading_BeginCpuStream(&stream, desc);
+//   while (producing)
+//       FFX_VariableShading_PushCpuStreamRows(&stream, rows, pitch, motionRows, motionPitch, rowCount,
+//           [&](uint32_t tileRow, const uint8_t* rates) { ... });
+//
+// A tile row is generated as soon as the rows it reads have arrived: the
+// tile's rows, the border of the neighbourhood cells above and below and
+// maxMotionRows for the reprojection. The stream keeps a window of just
+// these rows (about 3 tile rows with the default neighbourhood), so memory
+// is O(width * tileSize) instead of O(width * height). Reprojections
+// further than maxMotionRows are clamped to the window, otherwise the
+// result matches FFX_VariableShading_GenerateVrsImage.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ffx_variable_shading_cpu.h"
+
+#include <string.h>
+
+struct FFX_VariableShading_CpuStreamDesc
+{
+    FFX_VariableShading_CB  cb;                     // whole surface at the input level, viewportX/Y 0
+    bool                    additionalShadingRates;
+    uint32_t                mipLevel;               // level of the pushed luminance rows relative to the motion vectors
+    uint32_t                neighbourhoodShape;     // see FFX_VariableShading_CpuInputs
+    uint32_t                neighbourhoodRadius;
+    uint32_t                motionVectorWidth;      // full resolution surface, 0 without motion vectors
+    uint32_t                motionVectorHeight;
+    uint32_t                maxMotionRows;          // vertical reprojection in texels of the input level the window keeps rows for
+    const FFX_VariableShading_RatePolicy* ratePolicy; // optional, see FFX_VariableShading_CpuInputs
+};
+
+struct FFX_VariableShading_CpuStream
+{
+    FFX_VariableShading_CpuStreamDesc       desc;
+    FFX_VariableShading_CpuInputs           inputs;         // the window as a band of the planes
+    uint32_t                                reach;          // rows above and below a tile row it reads
+    uint32_t                                windowCapacity; // in rows of the input level
+    uint32_t                                rowsReceived;
+    uint32_t                                nextTileRow;
+    uint32_t                                tileCountX, tileCountY;
+    std::vector<float>                      luminance;      // windowCapacity rows of cb.width
+    std::vector<float>                      motionVectors;  // the matching full resolution rows of 2 * motionVectorWidth
+    std::vector<uint8_t>                    rates;          // the tile row being finished
+    FFX_VariableShading_CpuGeneratorScratch scratch;
+};
+
+inline void FFX_VariableShading_BeginCpuStream(FFX_VariableShading_CpuStream* stream, const FFX_VariableShading_CpuStreamDesc& desc)
+{
+    stream->desc = desc;
+    stream->desc.cb.viewportX = stream->desc.cb.viewportY = 0;
+    const FFX_VariableShading_CB& cb = stream->desc.cb;
+
+    const uint32_t cellSize = desc.additionalShadingRates ? 4 : 2;
+    stream->reach = std::max(desc.neighbourhoodRadius, 1u) * cellSize + desc.maxMotionRows;
+    stream->windowCapacity = cb.tileSize + 2 * stream->reach;
+    stream->rowsReceived = 0;
+    stream->nextTileRow = 0;
+    stream->tileCountX = FFX_VariableShading_DivideRoundingUp(cb.width, cb.tileSize);
+    stream->tileCountY = FFX_VariableShading_DivideRoundingUp(cb.height, cb.tileSize);
+
+    FFX_VariableShading_CpuInputs& inputs = stream->inputs;
+    inputs = FFX_VariableShading_CpuInputs();
+    inputs.luminancePitch = cb.width;
+    inputs.motionVectorPitch = 2 * desc.motionVectorWidth;
+    inputs.motionVectorWidth = desc.motionVectorWidth;
+    inputs.motionVectorHeight = desc.motionVectorHeight;
+    inputs.mipLevel = desc.mipLevel;
+    inputs.neighbourhoodShape = desc.neighbourhoodShape;
+    inputs.neighbourhoodRadius = desc.neighbourhoodRadius;
+    inputs.ratePolicy = desc.ratePolicy;
+
+    stream->luminance.resize((size_t)stream->windowCapacity * cb.width);
+    stream->motionVectors.resize(desc.motionVectorWidth ? ((size_t)stream->windowCapacity << desc.mipLevel) * inputs.motionVectorPitch : 0);
+    stream->rates.resize(stream->tileCountX);
+    FFX_VariableShading_ReserveCpuGeneratorScratch(stream->scratch, cb, desc.additionalShadingRates, inputs);
+
+    inputs.luminance = stream->luminance.data();
+    inputs.motionVectors = desc.motionVectorWidth ? stream->motionVectors.data() : NULL;
+    inputs.firstRow = 0;
+    inputs.rowCount = 0;
+}
+
+// first and end row (input level) tile row tileRow reads
+inline void FFX_VariableShading_GetCpuStreamRows(const FFX_VariableShading_CpuStream* stream, uint32_t tileRow, uint32_t& firstRow, uint32_t& endRow)
+{
+    const uint32_t tileSize = stream->desc.cb.tileSize;
+    firstRow = (tileRow * tileSize > stream->reach) ? tileRow * tileSize - stream->reach : 0;
+    endRow = std::min((tileRow + 1) * tileSize + stream->reach, stream->desc.cb.height);
+}
+
+// full resolution motion vector rows of the input level rows [firstRow, endRow)
+inline void FFX_VariableShading_GetCpuStreamMotionRows(const FFX_VariableShading_CpuStream* stream, uint32_t firstRow, uint32_t endRow, uint32_t& firstMotionRow, uint32_t& endMotionRow)
+{
+    firstMotionRow = std::min(firstRow << stream->desc.mipLevel, stream->desc.motionVectorHeight);
+    endMotionRow = std::min(endRow << stream->desc.mipLevel, stream->desc.motionVectorHeight);
+}
+
+// drops the rows before firstRow from the window
+inline void FFX_VariableShading_SlideCpuStreamWindow(FFX_VariableShading_CpuStream* stream, uint32_t firstRow)
+{
+    FFX_VariableShading_CpuInputs& inputs = stream->inputs;
+    if (firstRow <= inputs.firstRow)
+        return;
+
+    const uint32_t shift = std::min(firstRow - inputs.firstRow, inputs.rowCount);
+    const size_t width = stream->desc.cb.width;
+    memmove(stream->luminance.data(), stream->luminance.data() + shift * width, (inputs.rowCount - shift) * width * sizeof(float));
+    if (inputs.motionVectors)
+    {
+        uint32_t firstMotionRow, endMotionRow, newFirstMotionRow, unused;
+        FFX_VariableShading_GetCpuStreamMotionRows(stream, inputs.firstRow, inputs.firstRow + inputs.rowCount, firstMotionRow, endMotionRow);
+        FFX_VariableShading_GetCpuStreamMotionRows(stream, inputs.firstRow + shift, inputs.firstRow + inputs.rowCount, newFirstMotionRow, unused);
+        const size_t pitch = inputs.motionVectorPitch;
+        memmove(stream->motionVectors.data(), stream->motionVectors.data() + (newFirstMotionRow - firstMotionRow) * pitch, (endMotionRow - newFirstMotionRow) * pitch * sizeof(float));
+    }
+    inputs.firstRow += shift;
+    inputs.rowCount -= shift;
+}
+
+// Appends rowCount luminance rows of the input level (luminancePitch floats apart) below the ones pushed
+// before, with the matching full resolution motion vector rows (NULL without motion vectors). Calls
+// onTileRow(tileRow, rates) for every tile row that can be finished, rates holds its tileCountX rates
+// and is only valid during the call. Once all cb.height rows are pushed every tile row is done.
+template <typename OnTileRow>
+void FFX_VariableShading_PushCpuStreamRows(FFX_VariableShading_CpuStream* stream, const float* luminance, uint32_t luminancePitch, const float* motionVectors, uint32_t motionVectorPitch, uint32_t rowCount, OnTileRow onTileRow)
+{
+    const FFX_VariableShading_CB& cb = stream->desc.cb;
+    FFX_VariableShading_CpuInputs& inputs = stream->inputs;
+    rowCount = std::min(rowCount, cb.height - stream->rowsReceived);
+
+    while (rowCount || (stream->nextTileRow < stream->tileCountY && stream->rowsReceived == cb.height))
+    {
+        // append what fits, the window always has room for the rows the next tile row is missing
+        const uint32_t count = std::min(rowCount, stream->windowCapacity - inputs.rowCount);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            memcpy(&stream->luminance[(size_t)(inputs.rowCount + i) * cb.width], &luminance[(size_t)i * luminancePitch], cb.width * sizeof(float));
+        }
+        if (inputs.motionVectors)
+        {
+            uint32_t firstMotionRow, endMotionRow, windowMotionRow, unused;
+            FFX_VariableShading_GetCpuStreamMotionRows(stream, stream->rowsReceived, stream->rowsReceived + count, firstMotionRow, endMotionRow);
+            FFX_VariableShading_GetCpuStreamMotionRows(stream, inputs.firstRow, stream->rowsReceived, windowMotionRow, unused);
+            for (uint32_t row = firstMotionRow; row < endMotionRow; ++row)
+            {
+                memcpy(&stream->motionVectors[(size_t)(row - windowMotionRow) * inputs.motionVectorPitch], &motionVectors[(size_t)(row - firstMotionRow) * motionVectorPitch], inputs.motionVectorPitch * sizeof(float));
+            }
+            motionVectors += (size_t)(endMotionRow - firstMotionRow) * motionVectorPitch;
+        }
+        luminance += (size_t)count * luminancePitch;
+        inputs.rowCount += count;
+        stream->rowsReceived += count;
+        rowCount -= count;
+
+        // finish the tile rows whose rows are all there
+        while (stream->nextTileRow < stream->tileCountY)
+        {
+            uint32_t firstRow, endRow;
+            FFX_VariableShading_GetCpuStreamRows(stream, stream->nextTileRow, firstRow, endRow);
+            if (stream->rowsReceived < endRow)
+                break;
+
+            // pitch 0: the generator writes row nextTileRow to rates
+            FFX_VariableShading_GenerateVrsImageTiles(cb, stream->desc.additionalShadingRates, inputs, 0, stream->tileCountX, stream->nextTileRow, 1, stream->rates.data(), 0, stream->scratch);
+            onTileRow(stream->nextTileRow, (const uint8_t*)stream->rates.data());
+            ++stream->nextTileRow;
+
+            if (stream->nextTileRow < stream->tileCountY)
+            {
+                FFX_VariableShading_GetCpuStreamRows(stream, stream->nextTileRow, firstRow, endRow);
+                FFX_VariableShading_SlideCpuStreamWindow(stream, firstRow);
+            }
+        }
+    }
+}
+
+inline bool FFX_VariableShading_CpuStreamDone(const FFX_VariableShading_CpuStream* stream)
+{
+    return stream->nextTileRow == stream->tileCountY;
+}
@@ -0,0 +1,336 @@
+// FFX_VariableShading_Cpu_Synthetic.h
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//////////////////////////////////////////////////////////////////////////
+// VariableShading synthetic generator inputs
+//
+// Deterministic luminance and motion vector sequences for benchmarks and
+// regression tests without captured media or a GPU. The background is a
+// world of square regions, each one of four kinds picked with the relative
+// areas of the desc:
+//   flat       constant luminance, coarse shading everywhere
+//   texture    per texel noise at textureScale, the worst case for the variance
+//   edges      hard edged stripes of random orientation
+//   sky        a smooth vertical gradient
+// seen through a camera that pans and rotates around the surface center,
+// plus objectCount textured discs moving on their own, and per frame noise.
+// Motion vectors follow the sequence convention: screen space motion in
+// pixels, current minus previous position, so frame f is reprojected into
+// frame f - 1 exactly.
+//
+// Every pixel is a few hashes and multiplies, independent of all others,
+// so bands of rows can be generated in parallel (FFX_VariableShading_GenerateSyntheticRows).
+// On one thread a frame costs about as much as its VRS image, the
+// properties of a region are computed once per run of pixels inside it.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+
+static const uint32_t FFX_VARIABLESHADING_SYNTHETIC_TYPICAL = 0;      // mostly flat and sky, some texture, slow pan
+static const uint32_t FFX_VARIABLESHADING_SYNTHETIC_WORST_CASE = 1;   // texture and edges everywhere, rotation, many objects, little to save
+static const uint32_t FFX_VARIABLESHADING_SYNTHETIC_FLAT = 2;         // flat regions and sky, static camera
+static const uint32_t FFX_VARIABLESHADING_SYNTHETIC_PRESET_COUNT = 3;
+
+struct FFX_VariableShading_SyntheticContentDesc
+{
+    uint32_t    width, height;
+    uint32_t    seed;
+    float       flat, texture, edges, sky;  // relative area of the region kinds, any scale
+    float       regionSize;                 // in pixels
+    float       textureScale;               // texel size of the texture regions in pixels
+    float       stripeWidth;                // of the edge regions in pixels
+    float       noise;                      // amplitude of the per frame noise
+    float       panX, panY;                 // camera pan in pixels per frame
+    float       rotation;                   // camera rotation in radians per frame
+    uint32_t    objectCount;
+    float       objectRadius;               // in pixels
+    float       objectSpeed;                // largest object speed in pixels per frame
+};
+
+inline const char* FFX_VariableShading_GetSyntheticPresetName(uint32_t preset)
+{
+    static const char* names[FFX_VARIABLESHADING_SYNTHETIC_PRESET_COUNT] = { "typical", "worst", "flat" };
+    return (preset < FFX_VARIABLESHADING_SYNTHETIC_PRESET_COUNT) ? names[preset] : "";
+}
+
+inline FFX_VariableShading_SyntheticContentDesc FFX_VariableShading_GetSyntheticPreset(uint32_t preset, uint32_t width, uint32_t height)
+{
+    FFX_VariableShading_SyntheticContentDesc desc = {};
+    desc.width = width;
+    desc.height = height;
+    desc.seed = 1;
+    desc.regionSize = 96.0f;
+    desc.textureScale = 1.0f;
+    desc.stripeWidth = 6.0f;
+    desc.objectRadius = 48.0f;
+    switch (preset)
+    {
+    case FFX_VARIABLESHADING_SYNTHETIC_WORST_CASE:
+        desc.texture = 0.6f;
+        desc.edges = 0.4f;
+        desc.noise = 0.05f;
+        desc.panX = 3.0f;
+        desc.panY = -2.0f;
+        desc.rotation = 0.002f;
+        desc.objectCount = 32;
+        desc.objectSpeed = 8.0f;
+        break;
+    case FFX_VARIABLESHADING_SYNTHETIC_FLAT:
+        desc.flat = 0.7f;
+        desc.sky = 0.3f;
+        break;
+    default:
+        desc.flat = 0.45f;
+        desc.sky = 0.25f;
+        desc.texture = 0.2f;
+        desc.edges = 0.1f;
+        desc.noise = 0.005f;
+        desc.panX = 2.0f;
+        desc.objectCount = 4;
+        desc.objectSpeed = 6.0f;
+        break;
+    }
+    return desc;
+}
+
+inline uint32_t FFX_VariableShading_SyntheticHash(uint32_t x, uint32_t y, uint32_t z)
+{
+    uint32_t h = x * 0x8da6b343u ^ y * 0xd8163841u ^ z * 0xcb1ab31fu;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+inline float FFX_VariableShading_SyntheticHash01(uint32_t x, uint32_t y, uint32_t z)
+{
+    return (float)(FFX_VariableShading_SyntheticHash(x, y, z) >> 8) * (1.0f / 16777216.0f);
+}
+
+// floor without a libm call on targets before SSE4.1
+inline int32_t FFX_VariableShading_SyntheticFloor(float value)
+{
+    const int32_t i = (int32_t)value;
+    return i - (value < (float)i);
+}
+
+static const uint32_t FFX_VARIABLESHADING_SYNTHETIC_REGION_FLAT = 0;
+static const uint32_t FFX_VARIABLESHADING_SYNTHETIC_REGION_TEXTURE = 1;
+static const uint32_t FFX_VARIABLESHADING_SYNTHETIC_REGION_EDGES = 2;
+static const uint32_t FFX_VARIABLESHADING_SYNTHETIC_REGION_SKY = 3;
+
+// everything of a region that does not depend on the position inside it
+struct FFX_VariableShading_SyntheticRegion
+{
+    int32_t     cellX, cellY;
+    uint32_t    kind;           // FFX_VARIABLESHADING_SYNTHETIC_REGION_*
+    float       base;
+    float       stripeX, stripeY;   // stripe normal over the stripe width
+};
+
+inline FFX_VariableShading_SyntheticRegion FFX_VariableShading_GetSyntheticRegion(const FFX_VariableShading_SyntheticContentDesc& desc, int32_t cellX, int32_t cellY)
+{
+    const uint32_t cx = (uint32_t)cellX, cy = (uint32_t)cellY;
+    const float total = desc.flat + desc.texture + desc.edges + desc.sky;
+    const float pick = FFX_VariableShading_SyntheticHash01(cx, cy, desc.seed) * total;
+
+    FFX_VariableShading_SyntheticRegion region;
+    region.cellX = cellX;
+    region.cellY = cellY;
+    region.base = 0.2f + 0.6f * FFX_VariableShading_SyntheticHash01(cx, cy, desc.seed + 1);
+    region.stripeX = region.stripeY = 0.0f;
+    if (total <= 0.0f || pick < desc.flat)
+        region.kind = FFX_VARIABLESHADING_SYNTHETIC_REGION_FLAT;
+    else if (pick < desc.flat + desc.texture)
+        region.kind = FFX_VARIABLESHADING_SYNTHETIC_REGION_TEXTURE;
+    else if (pick < desc.flat + desc.texture + desc.edges)
+    {
+        const float angle = 6.2831853f * FFX_VariableShading_SyntheticHash01(cx, cy, desc.seed + 3);
+        region.kind = FFX_VARIABLESHADING_SYNTHETIC_REGION_EDGES;
+        region.stripeX = std::cos(angle) / desc.stripeWidth;
+        region.stripeY = std::sin(angle) / desc.stripeWidth;
+    }
+    else
+        region.kind = FFX_VARIABLESHADING_SYNTHETIC_REGION_SKY;
+    return region;
+}
+
+// background luminance at a world position inside region
+inline float FFX_VariableShading_GetSyntheticBackground(const FFX_VariableShading_SyntheticContentDesc& desc, const FFX_VariableShading_SyntheticRegion& region, float wx, float wy)
+{
+    switch (region.kind)
+    {
+    case FFX_VARIABLESHADING_SYNTHETIC_REGION_TEXTURE:
+    {
+        const float scale = 1.0f / desc.textureScale;
+        const uint32_t tx = (uint32_t)FFX_VariableShading_SyntheticFloor(wx * scale);
+        const uint32_t ty = (uint32_t)FFX_VariableShading_SyntheticFloor(wy * scale);
+        return region.base + 0.4f * (FFX_VariableShading_SyntheticHash01(tx, ty, desc.seed + 2) - 0.5f);
+    }
+    case FFX_VARIABLESHADING_SYNTHETIC_REGION_EDGES:
+        return (FFX_VariableShading_SyntheticFloor(wx * region.stripeX + wy * region.stripeY) & 1) ? region.base + 0.3f : region.base - 0.15f;
+    case FFX_VARIABLESHADING_SYNTHETIC_REGION_SKY:
+    {
+        // a gradient continuing over up to 4 vertically adjacent sky regions
+        const float t = wy / (4.0f * desc.regionSize);
+        return 0.35f + 0.5f * (t - (float)FFX_VariableShading_SyntheticFloor(t));
+    }
+    default:
+        return region.base;
+    }
+}
+
+inline float FFX_VariableShading_GetSyntheticBackground(const FFX_VariableShading_SyntheticContentDesc& desc, float wx, float wy)
+{
+    const float scale = 1.0f / desc.regionSize;
+    const FFX_VariableShading_SyntheticRegion region = FFX_VariableShading_GetSyntheticRegion(desc,
+        FFX_VariableShading_SyntheticFloor(wx * scale), FFX_VariableShading_SyntheticFloor(wy * scale));
+    return FFX_VariableShading_GetSyntheticBackground(desc, region, wx, wy);
+}
+
+struct FFX_VariableShading_SyntheticObject
+{
+    float   x, y;           // center in the frame
+    float   vx, vy;         // motion in pixels per frame
+    float   radius;
+    uint32_t id;
+};
+
+// object i in frame, moving on a torus of the surface size so it never leaves it for long
+inline FFX_VariableShading_SyntheticObject FFX_VariableShading_GetSyntheticObject(const FFX_VariableShading_SyntheticContentDesc& desc, uint32_t i, uint32_t frame)
+{
+    FFX_VariableShading_SyntheticObject object;
+    object.id = i;
+    object.radius = desc.objectRadius * (0.5f + FFX_VariableShading_SyntheticHash01(i, 0, desc.seed + 4));
+    object.vx = desc.objectSpeed * (2.0f * FFX_VariableShading_SyntheticHash01(i, 1, desc.seed + 4) - 1.0f);
+    object.vy = desc.objectSpeed * (2.0f * FFX_VariableShading_SyntheticHash01(i, 2, desc.seed + 4) - 1.0f);
+    const float spanX = (float)desc.width + 2.0f * object.radius;
+    const float spanY = (float)desc.height + 2.0f * object.radius;
+    const float x = FFX_VariableShading_SyntheticHash01(i, 3, desc.seed + 4) * spanX + object.vx * (float)frame;
+    const float y = FFX_VariableShading_SyntheticHash01(i, 4, desc.seed + 4) * spanY + object.vy * (float)frame;
+    object.x = x - spanX * std::floor(x / spanX) - object.radius;
+    object.y = y - spanY * std::floor(y / spanY) - object.radius;
+    return object;
+}
+
+// Rows [firstRow, firstRow + rowCount) of frame: luminance (luminancePitch floats per row) and motion
+// vectors (2 floats per pixel, motionVectorPitch floats per row, may be NULL)
+inline void FFX_VariableShading_GenerateSyntheticRows(const FFX_VariableShading_SyntheticContentDesc& desc, uint32_t frame, uint32_t firstRow, uint32_t rowCount,
+    float* luminance, uint32_t luminancePitch, float* motionVectors, uint32_t motionVectorPitch)
+{
+    const float cx = 0.5f * (float)desc.width;
+    const float cy = 0.5f * (float)desc.height;
+    const float angle = desc.rotation * (float)frame;
+    const float cosA = std::cos(angle), sinA = std::sin(angle);
+    const float cosP = std::cos(angle - desc.rotation), sinP = std::sin(angle - desc.rotation);
+    const float panX = desc.panX * (float)frame, panY = desc.panY * (float)frame;
+
+    const uint32_t maxObjects = 64;
+    FFX_VariableShading_SyntheticObject objects[maxObjects];
+    uint32_t objectCount = 0;
+    for (uint32_t i = 0; i < std::min(desc.objectCount, maxObjects); ++i)
+    {
+        FFX_VariableShading_SyntheticObject object = FFX_VariableShading_GetSyntheticObject(desc, i, frame);
+        if (object.y + object.radius >= (float)firstRow && object.y - object.radius < (float)(firstRow + rowCount))
+            objects[objectCount++] = object;
+    }
+
+    const float regionScale = 1.0f / desc.regionSize;
+    const float objectTextureScale = 0.5f / desc.textureScale;
+    FFX_VariableShading_SyntheticRegion region = FFX_VariableShading_GetSyntheticRegion(desc, 0, 0);
+
+    for (uint32_t y = firstRow; y < firstRow + rowCount; ++y)
+    {
+        float* lumRow = luminance + (size_t)(y - firstRow) * luminancePitch;
+        float* mvRow = motionVectors ? motionVectors + (size_t)(y - firstRow) * motionVectorPitch : NULL;
+        const float py = (float)y + 0.5f - cy;
+
+        uint32_t rowObjects[maxObjects];
+        uint32_t rowObjectCount = 0;
+        for (uint32_t i = 0; i < objectCount; ++i)
+        {
+            if (std::fabs((float)y + 0.5f - objects[i].y) < objects[i].radius)
+                rowObjects[rowObjectCount++] = i;
+        }
+
+        for (uint32_t x = 0; x < desc.width; ++x)
+        {
+            const float px = (float)x + 0.5f - cx;
+            float value, mx, my;
+
+            uint32_t hit = objectCount;
+            for (uint32_t j = 0; j < rowObjectCount; ++j)
+            {
+                const uint32_t i = rowObjects[j];
+                const float dx = (float)x + 0.5f - objects[i].x;
+                const float dy = (float)y + 0.5f - objects[i].y;
+                if (dx * dx + dy * dy < objects[i].radius * objects[i].radius)
+                    hit = i;
+            }
+
+            if (hit < objectCount)
+            {
+                // textured in object space, so the texture moves with the object
+                const FFX_VariableShading_SyntheticObject& object = objects[hit];
+                const uint32_t tx = (uint32_t)FFX_VariableShading_SyntheticFloor(((float)x - object.x) * objectTextureScale);
+                const uint32_t ty = (uint32_t)FFX_VariableShading_SyntheticFloor(((float)y - object.y) * objectTextureScale);
+                value = 0.3f + 0.5f * FFX_VariableShading_SyntheticHash01(tx, ty, desc.seed + 5 + object.id);
+                mx = object.vx;
+                my = object.vy;
+            }
+            else
+            {
+                // screen to world in this frame, world back to screen in the previous one
+                const float wx = cosA * px - sinA * py + cx + panX;
+                const float wy = sinA * px + cosA * py + cy + panY;
+                const int32_t cellX = FFX_VariableShading_SyntheticFloor(wx * regionScale);
+                const int32_t cellY = FFX_VariableShading_SyntheticFloor(wy * regionScale);
+                if (cellX != region.cellX || cellY != region.cellY)
+                    region = FFX_VariableShading_GetSyntheticRegion(desc, cellX, cellY);
+                value = FFX_VariableShading_GetSyntheticBackground(desc, region, wx, wy);
+                const float qx = wx - cx - (panX - desc.panX);
+                const float qy = wy - cy - (panY - desc.panY);
+                mx = px - (cosP * qx + sinP * qy);
+                my = py - (-sinP * qx + cosP * qy);
+            }
+
+            if (desc.noise > 0.0f)
+                value += desc.noise * (FFX_VariableShading_SyntheticHash01(x, y, desc.seed + 6 + frame) - 0.5f);
+
+            lumRow[x] = std::min(std::max(value, 0.0f), 1.0f);
+            if (mvRow)
+            {
+                mvRow[2 * x + 0] = mx;
+                mvRow[2 * x + 1] = my;
+            }
+        }
+    }
+}
+
+inline void FFX_VariableShading_GenerateSyntheticFrame(const FFX_VariableShading_SyntheticContentDesc& desc, uint32_t frame, float* luminance, uint32_t luminancePitch, float* motionVectors, uint32_t motionVectorPitch)
+{
+    FFX_VariableShading_GenerateSyntheticRows(desc, frame, 0, desc.height, luminance, luminancePitch, motionVectors, motionVectorPitch);
+}
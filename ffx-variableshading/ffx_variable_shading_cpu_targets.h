@@ -0,0 +1,229 @@
+// FFX_VariableShading_Cpu_Targets.h
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//////////////////////////////////////////////////////////////////////////
+// VariableShading rate targets of other APIs
+//
+// Converts a VRS image (square tiles of tileSize pixels, one
+// FFX_VARIABLESHADING_RATE_* per tile, e.g. from the CPU generator in
+// ffx_variable_shading_cpu.h) into the rate inputs of other APIs, so one
+// analysis serves every backend. All conversions are conservative: every
+// pixel is shaded at least as densely (per axis) as the VRS image asks for.
+//
+// FsrAttachment  VK_KHR_fragment_shading_rate attachment. Its texels hold
+//                (log2(width) << 2) | log2(height), the encoding of the
+//                FFX_VARIABLESHADING_RATE_* values, but cover texelWidth x
+//                texelHeight pixels (any power of two the device reports in
+//                min/maxFragmentShadingRateAttachmentTexelSize, not
+//                necessarily square). Rates the device does not list in
+//                vkGetPhysicalDeviceFragmentShadingRatesKHR are replaced by
+//                the largest listed one that is not coarser on either axis.
+// DensityMap     VK_EXT_fragment_density_map attachment, R8G8_UNORM: the
+//                density 1 / fragment size of x in R and of y in G, rounded
+//                up, for texels of texelWidth x texelHeight pixels.
+// SeparableRates Metal rasterization rate maps (MTLRasterizationRateLayerDescriptor)
+//                only take one rate per column zone and one per row zone,
+//                a zone at (x, y) is shaded with horizontal[x] x vertical[y].
+//                The column zone gets the finest x rate of all tiles it
+//                covers, in any row, the row zone the finest y rate of all
+//                tiles it covers, in any column. Written as the sample
+//                quality of the zone (1, 0.5 or 0.25).
+//
+// All targets cover the whole surface (width x height pixels), the texel
+// (zone) of a target takes the finest rate of all tiles it overlaps.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ffx_variable_shading_cpu.h"
+
+#include <cstdlib>
+
+//--------------------------------------------------------------------------------------//
+// VK_KHR_fragment_shading_rate attachment                                              //
+//--------------------------------------------------------------------------------------//
+
+// supportedRates: bit r set for each FFX_VARIABLESHADING_RATE_* r the device supports (1X1 always is)
+static const uint32_t FFX_VARIABLESHADING_SUPPORTED_RATES_ALL = (1u << FFX_VARIABLESHADING_RATE_1X1) | (1u << FFX_VARIABLESHADING_RATE_1X2) |
+    (1u << FFX_VARIABLESHADING_RATE_2X1) | (1u << FFX_VARIABLESHADING_RATE_2X2) | (1u << FFX_VARIABLESHADING_RATE_2X4) |
+    (1u << FFX_VARIABLESHADING_RATE_4X2) | (1u << FFX_VARIABLESHADING_RATE_4X4);
+
+// bit of a fragment size (1, 2 or 4 per axis) in supportedRates, e.g. of VkPhysicalDeviceFragmentShadingRateKHR::fragmentSize.
+// 1x4 and 4x1, which no VRS image holds, are valid bits, too.
+inline uint32_t FFX_VariableShading_GetFragmentSizeRateBit(uint32_t width, uint32_t height)
+{
+    auto rate1D = [](uint32_t size) { return (size >= 4) ? FFX_VARIABLESHADING_RATE1D_4X : ((size >= 2) ? FFX_VARIABLESHADING_RATE1D_2X : FFX_VARIABLESHADING_RATE1D_1X); };
+    return 1u << FFX_VARIABLESHADING_MAKE_SHADING_RATE(rate1D(width), rate1D(height));
+}
+
+// the coarsest rate in supportedRates that is not coarser than rate on either axis, the squarer one of equally coarse ones
+inline uint32_t FFX_VariableShading_GetSupportedRate(uint32_t rate, uint32_t supportedRates)
+{
+    const int32_t rateX = (int32_t)FFX_VariableShading_GetRate1DX(rate);
+    const int32_t rateY = (int32_t)FFX_VariableShading_GetRate1DY(rate);
+    int32_t bestX = 0, bestY = 0;
+    for (int32_t x = 0; x <= rateX; ++x)
+    {
+        for (int32_t y = 0; y <= rateY; ++y)
+        {
+            if (!(supportedRates & (1u << FFX_VARIABLESHADING_MAKE_SHADING_RATE(x, y))))
+                continue;
+            if ((x + y > bestX + bestY) || ((x + y == bestX + bestY) && (std::abs(x - y) < std::abs(bestX - bestY))))
+            {
+                bestX = x;
+                bestY = y;
+            }
+        }
+    }
+    return FFX_VARIABLESHADING_MAKE_SHADING_RATE((uint32_t)bestX, (uint32_t)bestY);
+}
+
+// Maps the tiles of a VRS image to the texels of another grid over the same surface: texel x covers the tiles
+// [x * texelWidth / tileSize, ceil((x + 1) * texelWidth / tileSize)), y alike (see FFX_VariableShading_DownsampleCB).
+inline void FFX_VariableShading_SetupTargetResample(FFX_VariableShading_DownsampleCB* cb, uint32_t width, uint32_t height, uint32_t tileSize,
+    uint32_t texelWidth, uint32_t texelHeight, uint32_t maxRate1D)
+{
+    const uint32_t gcdX = FFX_VariableShading_Downsample_Gcd(texelWidth, tileSize);
+    const uint32_t gcdY = FFX_VariableShading_Downsample_Gcd(texelHeight, tileSize);
+    cb->srcWidth = FFX_VariableShading_DivideRoundingUp(width, tileSize);
+    cb->srcHeight = FFX_VariableShading_DivideRoundingUp(height, tileSize);
+    cb->dstWidth = FFX_VariableShading_DivideRoundingUp(width, texelWidth);
+    cb->dstHeight = FFX_VariableShading_DivideRoundingUp(height, texelHeight);
+    cb->scaleNumX = texelWidth / gcdX;
+    cb->scaleNumY = texelHeight / gcdY;
+    cb->scaleDenX = tileSize / gcdX;
+    cb->scaleDenY = tileSize / gcdY;
+    cb->rateShiftX = cb->rateShiftY = 0;
+    cb->maxRate1D = maxRate1D;
+}
+
+// size of the attachment in texels
+inline void FFX_VariableShading_GetFsrAttachmentSize(uint32_t width, uint32_t height, uint32_t texelWidth, uint32_t texelHeight, uint32_t& attachmentWidth, uint32_t& attachmentHeight)
+{
+    attachmentWidth = FFX_VariableShading_DivideRoundingUp(width, texelWidth);
+    attachmentHeight = FFX_VariableShading_DivideRoundingUp(height, texelHeight);
+}
+
+// VK_KHR_fragment_shading_rate attachment (VK_FORMAT_R8_UINT) of the width x height surface the VRS image was generated for
+inline void FFX_VariableShading_ConvertToFsrAttachment(const uint8_t* vrsImage, uint32_t vrsImagePitch, uint32_t width, uint32_t height, uint32_t tileSize,
+    uint32_t texelWidth, uint32_t texelHeight, uint32_t supportedRates, uint8_t* attachment, uint32_t attachmentPitch)
+{
+    FFX_VariableShading_DownsampleCB cb;
+    FFX_VariableShading_SetupTargetResample(&cb, width, height, tileSize, texelWidth, texelHeight, FFX_VARIABLESHADING_RATE1D_4X);
+    FFX_VariableShading_DownsampleShadingRates(cb, vrsImage, vrsImagePitch, attachment, attachmentPitch);
+
+    if ((supportedRates & FFX_VARIABLESHADING_SUPPORTED_RATES_ALL) == FFX_VARIABLESHADING_SUPPORTED_RATES_ALL)
+        return;
+
+    uint8_t remap[FFX_VARIABLESHADING_RATE_4X4 + 1];
+    for (uint32_t rate = 0; rate <= FFX_VARIABLESHADING_RATE_4X4; ++rate)
+        remap[rate] = (uint8_t)FFX_VariableShading_GetSupportedRate(rate, supportedRates);
+    for (uint32_t y = 0; y < cb.dstHeight; ++y)
+    {
+        uint8_t* row = &attachment[y * attachmentPitch];
+        for (uint32_t x = 0; x < cb.dstWidth; ++x)
+            row[x] = remap[row[x]];
+    }
+}
+
+//--------------------------------------------------------------------------------------//
+// VK_EXT_fragment_density_map                                                          //
+//--------------------------------------------------------------------------------------//
+
+// UNORM density of a 1D rate: 255 / fragment size rounded up (255, 128, 64)
+inline uint8_t FFX_VariableShading_GetRate1DDensity(uint32_t rate1D)
+{
+    const uint32_t size = 1u << rate1D;
+    return (uint8_t)((255 + size - 1) / size);
+}
+
+// VK_EXT_fragment_density_map attachment (VK_FORMAT_R8G8_UNORM, 2 bytes per texel, pitch in bytes)
+inline void FFX_VariableShading_ConvertToDensityMap(const uint8_t* vrsImage, uint32_t vrsImagePitch, uint32_t width, uint32_t height, uint32_t tileSize,
+    uint32_t texelWidth, uint32_t texelHeight, uint8_t* densityMap, uint32_t densityMapPitch)
+{
+    FFX_VariableShading_DownsampleCB cb;
+    FFX_VariableShading_SetupTargetResample(&cb, width, height, tileSize, texelWidth, texelHeight, FFX_VARIABLESHADING_RATE1D_4X);
+    std::vector<uint8_t> rates((size_t)cb.dstWidth * cb.dstHeight);
+    FFX_VariableShading_DownsampleShadingRates(cb, vrsImage, vrsImagePitch, rates.data(), cb.dstWidth);
+
+    for (uint32_t y = 0; y < cb.dstHeight; ++y)
+    {
+        uint8_t* row = &densityMap[y * densityMapPitch];
+        for (uint32_t x = 0; x < cb.dstWidth; ++x)
+        {
+            const uint32_t rate = rates[y * cb.dstWidth + x];
+            row[2 * x + 0] = FFX_VariableShading_GetRate1DDensity(FFX_VariableShading_GetRate1DX(rate));
+            row[2 * x + 1] = FFX_VariableShading_GetRate1DDensity(FFX_VariableShading_GetRate1DY(rate));
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------//
+// Separable rates (Metal rasterization rate maps)                                      //
+//--------------------------------------------------------------------------------------//
+
+// sample quality of a 1D rate: 1, 0.5 or 0.25
+inline float FFX_VariableShading_GetRate1DQuality(uint32_t rate1D)
+{
+    return 1.0f / (float)(1u << rate1D);
+}
+
+// finest 1D rates of zoneCountX column zones and zoneCountY row zones of equal size over the surface, as
+// MTLRasterizationRateLayerDescriptor horizontal and vertical sample arrays
+inline void FFX_VariableShading_ComputeSeparableRates(const uint8_t* vrsImage, uint32_t vrsImagePitch, uint32_t width, uint32_t height, uint32_t tileSize,
+    uint32_t zoneCountX, uint32_t zoneCountY, float* horizontal, float* vertical)
+{
+    const uint32_t tilesX = FFX_VariableShading_DivideRoundingUp(width, tileSize);
+    const uint32_t tilesY = FFX_VariableShading_DivideRoundingUp(height, tileSize);
+
+    // finest x rate of every tile column and finest y rate of every tile row
+    std::vector<uint8_t> columnRates(tilesX, (uint8_t)FFX_VARIABLESHADING_RATE_4X4);
+    std::vector<uint8_t> rowRates1D(tilesY);
+    for (uint32_t y = 0; y < tilesY; ++y)
+    {
+        const uint8_t* row = &vrsImage[y * vrsImagePitch];
+        FFX_VariableShading_CombineRateRows(columnRates.data(), row, tilesX);
+
+        uint32_t rate1D = FFX_VARIABLESHADING_RATE1D_4X;
+        for (uint32_t x = 0; x < tilesX; ++x)
+            rate1D = std::min(rate1D, FFX_VariableShading_GetRate1DY(row[x]));
+        rowRates1D[y] = (uint8_t)rate1D;
+    }
+    std::vector<uint8_t> columnRates1D(tilesX);
+    for (uint32_t x = 0; x < tilesX; ++x)
+        columnRates1D[x] = (uint8_t)FFX_VariableShading_GetRate1DX(columnRates[x]);
+
+    // zone i covers the pixels [i * size / zoneCount, (i + 1) * size / zoneCount), at least one
+    auto reduceZones = [tileSize](uint32_t size, uint32_t zoneCount, const std::vector<uint8_t>& tileRates1D, float* quality)
+    {
+        for (uint32_t zone = 0; zone < zoneCount; ++zone)
+        {
+            const uint32_t firstPixel = std::min((uint32_t)((uint64_t)zone * size / zoneCount), size - 1);
+            const uint32_t endPixel = std::max((uint32_t)((uint64_t)(zone + 1) * size / zoneCount), firstPixel + 1);
+
+            uint32_t rate1D = FFX_VARIABLESHADING_RATE1D_4X;
+            for (uint32_t tile = firstPixel / tileSize; tile < FFX_VariableShading_DivideRoundingUp(endPixel, tileSize); ++tile)
+                rate1D = std::min(rate1D, (uint32_t)tileRates1D[tile]);
+            quality[zone] = FFX_VariableShading_GetRate1DQuality(rate1D);
+        }
+    };
+    reduceZones(width, zoneCountX, columnRates1D, horizontal);
+    reduceZones(height, zoneCountY, rowRates1D, vertical);
+}
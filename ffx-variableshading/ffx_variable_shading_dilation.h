@@ -0,0 +1,244 @@
+// FFX_VariableShading_Dilation.h
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//////////////////////////////////////////////////////////////////////////
+// VRS image dilation:
+//
+// The generator protects against burn in with the 4 neighbours of every
+// coarse pixel (or 4x4 block). Fast moving content may need a wider margin,
+// which this pass applies to the finished VRS image: every tile takes the
+// finest rate (per axis) within a square or diamond of configurable radius.
+//
+// The neighbourhood is split into line passes, each running a van Herk/Gil-Werman
+// filter: the line is cut into blocks of 2 * radius + 1 tiles, prefix and suffix
+// combinations within every block make any window the combination of one suffix
+// and one prefix. The cost per tile is the same for every radius.
+//   square:   horizontal and vertical line of the radius
+//   diamond:  two diagonal lines of half the radius followed by one or two
+//             plus shaped passes (4 neighbours), radius 1 is the plus alone
+//
+// Every pass reads the previous pass' output, so passes ping pong between two
+// images. They run over the VRS image padded by
+// FFX_VariableShading_GetDilationPadding tiles on all sides, all coordinates
+// passed to the callbacks and the width and height are those of the padded
+// domain: the first pass reads the VRS image at tile - padding (outside of it
+// the 4X4 identity), the last one only writes the tiles of the VRS image back.
+// FFX_VariableShading_GetDilationPasses returns the passes,
+// FFX_VariableShading_Dilation_GetDispatchInfo their dispatch size.
+//
+// The CPU generator applies the same decomposition to the coarse pixel
+// statistics (FFX_VariableShading_CpuInputs::neighbourhoodRadius), and
+// FFX_VariableShading_DilateShadingRates in ffx_variable_shading_cpu.h is the
+// CPU version of this pass.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#if defined(FFX_CPP)
+#if !defined(FFX_VARIABLESHADING_DILATION_CPP_DEFINED)
+#define FFX_VARIABLESHADING_DILATION_CPP_DEFINED
+
+static const uint32_t FFX_VARIABLESHADING_NEIGHBOURHOOD_DIAMOND = 0;
+static const uint32_t FFX_VARIABLESHADING_NEIGHBOURHOOD_SQUARE = 1;
+
+static const uint32_t FFX_VARIABLESHADING_DILATION_MAX_PASSES = 4;
+
+// the GPU line pass keeps 64 tiles plus the radius on both sides in LDS,
+// longer lines are clamped: squares up to 32, diamonds up to 66
+static const uint32_t FFX_VARIABLESHADING_DILATION_MAX_LINE_RADIUS = 32;
+static const uint32_t FFX_VARIABLESHADING_DILATION_MAX_PADDING = FFX_VARIABLESHADING_DILATION_MAX_LINE_RADIUS + 2;
+
+// direction (1, 0), (0, 1), (1, 1) or (1, -1) for a line of radius tiles to both sides,
+// direction (0, 0) for the plus shaped pass
+struct FFX_VariableShading_DilationPass
+{
+    int32_t     directionX;
+    int32_t     directionY;
+    uint32_t    radius;
+};
+
+static inline uint32_t FFX_VariableShading_GetDilationPasses(uint32_t shape, uint32_t radius, FFX_VariableShading_DilationPass passes[FFX_VARIABLESHADING_DILATION_MAX_PASSES])
+{
+    uint32_t count = 0;
+    if (radius == 0)
+        return count;
+
+    if (shape == FFX_VARIABLESHADING_NEIGHBOURHOOD_SQUARE)
+    {
+        passes[count++] = { 1, 0, radius };
+        passes[count++] = { 0, 1, radius };
+        return count;
+    }
+
+    // the diagonals of radius a cover every other tile of the diamond of radius 2 * a,
+    // one plus shaped pass fills the gaps and grows it to 2 * a + 1
+    uint32_t diagonalRadius = (radius - 1) / 2;
+    if (diagonalRadius)
+    {
+        passes[count++] = { 1, 1, diagonalRadius };
+        passes[count++] = { 1, -1, diagonalRadius };
+    }
+    passes[count++] = { 0, 0, 1 };
+    if (!(radius & 1))
+    {
+        passes[count++] = { 0, 0, 1 };
+    }
+    return count;
+}
+
+// Tiles the passes have to run beyond every edge of the VRS image: a tile on the edge can reach
+// a tile further along the edge through the diagonals only via a tile outside of the image.
+static inline uint32_t FFX_VariableShading_GetDilationPadding(uint32_t shape, uint32_t radius)
+{
+    if (shape == FFX_VARIABLESHADING_NEIGHBOURHOOD_SQUARE || radius < 3)
+        return 0;
+    return (radius - 1) / 2 + ((radius & 1) ? 1 : 2);
+}
+
+// number of lines of a pass over the width x height padded domain
+static inline uint32_t FFX_VariableShading_Dilation_GetLineCount(const FFX_VariableShading_DilationPass& pass, uint32_t width, uint32_t height)
+{
+    if (pass.directionY == 0)
+        return height;
+    if (pass.directionX == 0)
+        return width;
+    return width + height - 1;
+}
+
+// line passes run [numthreads(64, 1, 1)] threadgroups, the plus shaped pass [numthreads(8, 8, 1)]
+static inline void FFX_VariableShading_Dilation_GetDispatchInfo(const FFX_VariableShading_DilationPass& pass, const uint32_t width, const uint32_t height, uint32_t& numThreadGroupsX, uint32_t& numThreadGroupsY)
+{
+    if (pass.directionX == 0 && pass.directionY == 0)
+    {
+        numThreadGroupsX = (width + 7) / 8;
+        numThreadGroupsY = (height + 7) / 8;
+        return;
+    }
+
+    uint32_t lineLength = (pass.directionY == 0) ? width : (pass.directionX == 0) ? height : (width < height ? width : height);
+    numThreadGroupsX = (lineLength + 63) / 64;
+    numThreadGroupsY = FFX_VariableShading_Dilation_GetLineCount(pass, width, height);
+}
+
+#endif // FFX_VARIABLESHADING_DILATION_CPP_DEFINED
+#elif defined(FFX_HLSL)
+
+// Forward declaration of functions that need to be implemented by shader code using this technique
+uint    FFX_VariableShading_ReadDilationInput(int2 tile);
+void    FFX_VariableShading_WriteDilationOutput(int2 tile, uint shadingRate);
+
+static const uint FFX_VariableShading_Dilation_ThreadCount = 64;
+static const int FFX_VariableShading_Dilation_MaxLineRadius = 32;
+static const uint FFX_VariableShading_Dilation_LdsSize = FFX_VariableShading_Dilation_ThreadCount + 2 * FFX_VariableShading_Dilation_MaxLineRadius;
+
+// 4X4, coarsest on both axes, leaves every rate unchanged
+static const uint FFX_VariableShading_Dilation_Identity = 0xa;
+
+groupshared uint FFX_VariableShading_LdsDilationLine[FFX_VariableShading_Dilation_LdsSize];
+groupshared uint FFX_VariableShading_LdsDilationPrefix[FFX_VariableShading_Dilation_LdsSize];
+groupshared uint FFX_VariableShading_LdsDilationSuffix[FFX_VariableShading_Dilation_LdsSize];
+
+// finest rate per axis, rates are encoded as (x << 2) | y
+uint FFX_VariableShading_Dilation_CombineRates(uint a, uint b)
+{
+    return min(a & 0xc, b & 0xc) | min(a & 0x3, b & 0x3);
+}
+
+uint FFX_VariableShading_Dilation_Read(int2 tile, int2 resolution)
+{
+    if ((tile.x < 0) || (tile.y < 0) || (tile.x >= resolution.x) || (tile.y >= resolution.y))
+        return FFX_VariableShading_Dilation_Identity;
+    return FFX_VariableShading_ReadDilationInput(tile);
+}
+
+// first tile of a line, lines start on the top or left edge (bottom or left edge for (1, -1))
+int2 FFX_VariableShading_Dilation_GetLineStart(int line, int2 resolution, int2 direction)
+{
+    if (direction.y == 0)
+        return int2(0, line);
+    if (direction.x == 0)
+        return int2(line, 0);
+    if (line < resolution.x)
+        return int2(line, (direction.y > 0) ? 0 : resolution.y - 1);
+    line -= resolution.x - 1;
+    return int2(0, (direction.y > 0) ? line : resolution.y - 1 - line);
+}
+
+//--------------------------------------------------------------------------------------//
+// Line pass: call from a [numthreads(64, 1, 1)] compute shader                         //
+//--------------------------------------------------------------------------------------//
+void FFX_VariableShading_Dilation_Line(uint3 Gid, uint Gidx, int2 resolution, int2 direction, uint radius)
+{
+    int r = min((int)radius, FFX_VariableShading_Dilation_MaxLineRadius);
+    int window = 2 * r + 1;
+    int segmentLength = (int)FFX_VariableShading_Dilation_ThreadCount + 2 * r;
+
+    // the group's 64 tiles of the line plus r tiles on both sides
+    int2 start = FFX_VariableShading_Dilation_GetLineStart((int)Gid.y, resolution, direction);
+    int first = (int)(Gid.x * FFX_VariableShading_Dilation_ThreadCount) - r;
+    for (int i = (int)Gidx; i < segmentLength; i += FFX_VariableShading_Dilation_ThreadCount)
+    {
+        FFX_VariableShading_LdsDilationLine[i] = FFX_VariableShading_Dilation_Read(start + (first + i) * direction, resolution);
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // prefix and suffix combinations within blocks of window tiles, one thread per block
+    for (int block = (int)Gidx * window; block < segmentLength; block += FFX_VariableShading_Dilation_ThreadCount * window)
+    {
+        int blockEnd = min(block + window, segmentLength);
+        uint prefix = FFX_VariableShading_Dilation_Identity;
+        for (int i = block; i < blockEnd; ++i)
+        {
+            prefix = FFX_VariableShading_Dilation_CombineRates(prefix, FFX_VariableShading_LdsDilationLine[i]);
+            FFX_VariableShading_LdsDilationPrefix[i] = prefix;
+        }
+        uint suffix = FFX_VariableShading_Dilation_Identity;
+        for (int i = blockEnd - 1; i >= block; --i)
+        {
+            suffix = FFX_VariableShading_Dilation_CombineRates(suffix, FFX_VariableShading_LdsDilationLine[i]);
+            FFX_VariableShading_LdsDilationSuffix[i] = suffix;
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // the window [Gidx, Gidx + 2r] of the segment spans at most two blocks
+    int2 tile = start + (first + r + (int)Gidx) * direction;
+    if ((tile.x >= 0) && (tile.y >= 0) && (tile.x < resolution.x) && (tile.y < resolution.y))
+    {
+        uint rate = FFX_VariableShading_Dilation_CombineRates(FFX_VariableShading_LdsDilationSuffix[Gidx], FFX_VariableShading_LdsDilationPrefix[Gidx + 2 * r]);
+        FFX_VariableShading_WriteDilationOutput(tile, rate);
+    }
+}
+
+//--------------------------------------------------------------------------------------//
+// Plus shaped pass: call from a [numthreads(8, 8, 1)] compute shader                   //
+//--------------------------------------------------------------------------------------//
+void FFX_VariableShading_Dilation_Plus(uint3 DTid, int2 resolution)
+{
+    int2 tile = DTid.xy;
+    if ((tile.x >= resolution.x) || (tile.y >= resolution.y))
+        return;
+
+    uint rate = FFX_VariableShading_Dilation_Read(tile, resolution);
+    rate = FFX_VariableShading_Dilation_CombineRates(rate, FFX_VariableShading_Dilation_Read(tile + int2(-1, 0), resolution));
+    rate = FFX_VariableShading_Dilation_CombineRates(rate, FFX_VariableShading_Dilation_Read(tile + int2(1, 0), resolution));
+    rate = FFX_VariableShading_Dilation_CombineRates(rate, FFX_VariableShading_Dilation_Read(tile + int2(0, -1), resolution));
+    rate = FFX_VariableShading_Dilation_CombineRates(rate, FFX_VariableShading_Dilation_Read(tile + int2(0, 1), resolution));
+    FFX_VariableShading_WriteDilationOutput(tile, rate);
+}
+#endif // FFX_CPP|FFX_HLSL
@@ -0,0 +1,164 @@
+// FFX_VariableShading_Downsample.h
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//////////////////////////////////////////////////////////////////////////
+// VRS image derivation:
+//
+// Derives the VRS image of another tile size and/or another surface size
+// (e.g. half resolution particles) from a generated one, instead of running
+// the generator again. The derivation is conservative:
+//   - every destination tile takes the finest rate (per axis) of all source
+//     tiles its pixels cover
+//   - the rates keep the shading density of the source: on a surface of half
+//     the width a 2X rate becomes 1X, as one destination pixel already covers
+//     two source pixels. Scales that are no power of two round to the finer
+//     rate, rates are clamped to maxRate1D and to the valid combinations.
+//
+// FFX_VariableShading_SetupDownsample fills the constants for a pair of
+// surface and tile sizes, FFX_VariableShading_Downsample_GetDispatchInfo the
+// dispatch size of the [numthreads(8, 8, 1)] pass running
+// FFX_VariableShading_Downsample, one thread per destination tile.
+// FFX_VariableShading_DownsampleShadingRates in ffx_variable_shading_cpu.h is
+// the CPU version.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#if defined(FFX_CPP)
+#if !defined(FFX_VARIABLESHADING_DOWNSAMPLE_CPP_DEFINED)
+#define FFX_VARIABLESHADING_DOWNSAMPLE_CPP_DEFINED
+
+// Destination tile (x, y) covers the source tiles
+// [x * scaleNumX / scaleDenX, ((x + 1) * scaleNumX + scaleDenX - 1) / scaleDenX) (clamped to srcWidth), y alike.
+// The layout matches the cbuffer of the sample's VRSDownsampleCS.hlsl.
+struct FFX_VariableShading_DownsampleCB
+{
+    uint32_t    srcWidth;       // source VRS image in tiles
+    uint32_t    srcHeight;
+    uint32_t    dstWidth;       // destination VRS image in tiles
+    uint32_t    dstHeight;
+    uint32_t    scaleNumX;
+    uint32_t    scaleNumY;
+    uint32_t    scaleDenX;
+    uint32_t    scaleDenY;
+    int32_t     rateShiftX;     // added to the 1D rate of the axis
+    int32_t     rateShiftY;
+    uint32_t    maxRate1D;      // FFX_VARIABLESHADING_RATE1D_4X with additional shading rates, _2X without
+};
+
+static inline uint32_t FFX_VariableShading_Downsample_Gcd(uint32_t a, uint32_t b)
+{
+    while (b)
+    {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// negative: ceil(log2(src / dst)) finer for a smaller destination surface,
+// positive: floor(log2(dst / src)) coarser for a larger one, both limited to the 2 steps between 1X and 4X
+static inline int32_t FFX_VariableShading_Downsample_GetRateShift(uint32_t srcResolution, uint32_t dstResolution)
+{
+    int32_t shift = 0;
+    if (dstResolution < srcResolution)
+    {
+        while ((shift > -2) && ((dstResolution << -shift) < srcResolution))
+            --shift;
+    }
+    else
+    {
+        while ((shift < 2) && ((srcResolution << (shift + 1)) <= dstResolution))
+            ++shift;
+    }
+    return shift;
+}
+
+static inline void FFX_VariableShading_SetupDownsample(FFX_VariableShading_DownsampleCB* cb,
+    const uint32_t srcResolutionX, const uint32_t srcResolutionY, const uint32_t srcTileSize,
+    const uint32_t dstResolutionX, const uint32_t dstResolutionY, const uint32_t dstTileSize, const uint32_t maxRate1D)
+{
+    cb->srcWidth = (srcResolutionX + srcTileSize - 1) / srcTileSize;
+    cb->srcHeight = (srcResolutionY + srcTileSize - 1) / srcTileSize;
+    cb->dstWidth = (dstResolutionX + dstTileSize - 1) / dstTileSize;
+    cb->dstHeight = (dstResolutionY + dstTileSize - 1) / dstTileSize;
+
+    // source tiles per destination tile: (dstTileSize * srcResolution) / (dstResolution * srcTileSize)
+    uint32_t gcdX = FFX_VariableShading_Downsample_Gcd(dstTileSize * srcResolutionX, dstResolutionX * srcTileSize);
+    uint32_t gcdY = FFX_VariableShading_Downsample_Gcd(dstTileSize * srcResolutionY, dstResolutionY * srcTileSize);
+    cb->scaleNumX = dstTileSize * srcResolutionX / gcdX;
+    cb->scaleNumY = dstTileSize * srcResolutionY / gcdY;
+    cb->scaleDenX = dstResolutionX * srcTileSize / gcdX;
+    cb->scaleDenY = dstResolutionY * srcTileSize / gcdY;
+
+    cb->rateShiftX = FFX_VariableShading_Downsample_GetRateShift(srcResolutionX, dstResolutionX);
+    cb->rateShiftY = FFX_VariableShading_Downsample_GetRateShift(srcResolutionY, dstResolutionY);
+    cb->maxRate1D = maxRate1D;
+}
+
+static inline void FFX_VariableShading_Downsample_GetDispatchInfo(const FFX_VariableShading_DownsampleCB* cb, uint32_t& numThreadGroupsX, uint32_t& numThreadGroupsY)
+{
+    numThreadGroupsX = (cb->dstWidth + 7) / 8;
+    numThreadGroupsY = (cb->dstHeight + 7) / 8;
+}
+
+#endif // FFX_VARIABLESHADING_DOWNSAMPLE_CPP_DEFINED
+#elif defined(FFX_HLSL)
+
+// Forward declaration of functions that need to be implemented by shader code using this technique
+uint    FFX_VariableShading_ReadDownsampleInput(int2 tile);
+void    FFX_VariableShading_WriteDownsampleOutput(int2 tile, uint shadingRate);
+
+// applies the rate shift of a surface scale to a rate combined from the source tiles
+uint FFX_VariableShading_Downsample_ShiftRate(uint rate, int2 rateShift, uint maxRate1D)
+{
+    int2 rate1D = clamp(int2(rate >> 2, rate & 0x3) + rateShift, 0, (int)maxRate1D);
+
+    // axes shifted differently may end up two steps apart (1X4), take the finer valid rate
+    rate1D = min(rate1D, rate1D.yx + 1);
+    return (uint(rate1D.x) << 2) | uint(rate1D.y);
+}
+
+//--------------------------------------------------------------------------------------//
+// Main function: call from a [numthreads(8, 8, 1)] compute shader                      //
+//--------------------------------------------------------------------------------------//
+void FFX_VariableShading_Downsample(uint3 DTid, uint2 srcSize, uint2 dstSize, uint2 scaleNum, uint2 scaleDen, int2 rateShift, uint maxRate1D)
+{
+    if ((DTid.x >= dstSize.x) || (DTid.y >= dstSize.y))
+        return;
+
+    uint2 first = DTid.xy * scaleNum / scaleDen;
+    uint2 end = min(((DTid.xy + 1) * scaleNum + scaleDen - 1) / scaleDen, srcSize);
+
+    // finest rate per axis, starting from 4X4
+    uint rateX = 0x8;
+    uint rateY = 0x2;
+    for (uint y = first.y; y < end.y; ++y)
+    {
+        for (uint x = first.x; x < end.x; ++x)
+        {
+            uint rate = FFX_VariableShading_ReadDownsampleInput(int2(x, y));
+            rateX = min(rateX, rate & 0xc);
+            rateY = min(rateY, rate & 0x3);
+        }
+    }
+
+    FFX_VariableShading_WriteDownsampleOutput(DTid.xy, FFX_VariableShading_Downsample_ShiftRate(rateX | rateY, rateShift, maxRate1D));
+}
+#endif // FFX_CPP|FFX_HLSL
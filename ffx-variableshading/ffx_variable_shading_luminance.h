@@ -0,0 +1,164 @@
+// FFX_VariableShading_Luminance.h
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//////////////////////////////////////////////////////////////////////////
+// Perceptual luminance transforms:
+//
+// The variance cutoff is a luminance difference, so it only means the same
+// thing for every frame when the luminance is perceptually uniform. A gamma
+// encoded SDR back buffer roughly is, linear HDR values are not: the same
+// cutoff shades dark regions at full rate and lets bright ones go coarse.
+// Transforming linear luminance before the variance restores one meaning:
+//   NONE   the luminance as read (the behaviour without a transform)
+//   SRGB   the sRGB encoding, linear HDR frames behave like SDR ones
+//   LOG2   log2(1 + L / epsilon) / log2(1 + 1 / epsilon), 0 and 1 stay in place
+//   PQ     SMPTE ST 2084 of L * nits (nits of a luminance of 1, 80 for scRGB)
+//   WEBER  L / (mean of the 3x3 texels around L + epsilon), differences are
+//          Weber contrasts, independent of the local brightness
+// The curves map a luminance of 1 to about 1 (PQ: about 0.5 at 80 nits), so the
+// cutoffs stay in the range of the untransformed SDR luminance. WEBER needs
+// the neighbourhood and is applied by the caller with
+// FFX_VariableShading_WeberContrast.
+//
+// FFX_VariableShading_ApplyLuminanceCurve is the reference on both sides.
+// ffx_variable_shading_cpu_luminance.h applies the transforms to luminance
+// planes for the CPU generator, through a 16 bit indexed lookup table.
+// In HLSL, define FFX_VARIABLESHADING_LUMINANCE_TRANSFORM (and optionally
+// FFX_VARIABLESHADING_LUMINANCE_NITS, FFX_VARIABLESHADING_LUMINANCE_EPSILON)
+// and return FFX_VariableShading_TransformLuminance of the linear luminance
+// from FFX_VariableShading_ReadLuminance.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#if defined(FFX_CPP)
+#if !defined(FFX_VARIABLESHADING_LUMINANCE_CPP_DEFINED)
+#define FFX_VARIABLESHADING_LUMINANCE_CPP_DEFINED
+
+#include <stdint.h>
+#include <cmath>
+
+static const uint32_t FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_NONE = 0;
+static const uint32_t FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_SRGB = 1;
+static const uint32_t FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_LOG2 = 2;
+static const uint32_t FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_PQ = 3;
+static const uint32_t FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_WEBER = 4;
+static const uint32_t FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_COUNT = 5;
+
+struct FFX_VariableShading_LuminanceTransformDesc
+{
+    uint32_t    transform;  // FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_*
+    float       nits;       // PQ: nits of a luminance of 1
+    float       epsilon;    // LOG2, WEBER: luminance below which differences fade out
+};
+
+static inline FFX_VariableShading_LuminanceTransformDesc FFX_VariableShading_GetDefaultLuminanceTransformDesc(uint32_t transform)
+{
+    FFX_VariableShading_LuminanceTransformDesc desc;
+    desc.transform = transform;
+    desc.nits = 80.0f;
+    desc.epsilon = 1.0f / 64.0f;
+    return desc;
+}
+
+static inline float FFX_VariableShading_LinearToSrgb(float x)
+{
+    return (x <= 0.0031308f) ? 12.92f * x : 1.055f * std::pow(x, 1.0f / 2.4f) - 0.055f;
+}
+
+static inline float FFX_VariableShading_SrgbToLinear(float x)
+{
+    return (x <= 0.04045f) ? x / 12.92f : std::pow((x + 0.055f) / 1.055f, 2.4f);
+}
+
+// point transform of linear luminance, WEBER returns x (see FFX_VariableShading_WeberContrast)
+static inline float FFX_VariableShading_ApplyLuminanceCurve(const FFX_VariableShading_LuminanceTransformDesc& desc, float x)
+{
+    x = (x > 0.0f) ? x : 0.0f;
+    switch (desc.transform)
+    {
+    case FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_SRGB:
+        return FFX_VariableShading_LinearToSrgb(x);
+    case FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_LOG2:
+        return std::log2(1.0f + x / desc.epsilon) / std::log2(1.0f + 1.0f / desc.epsilon);
+    case FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_PQ:
+    {
+        const float y = std::pow(std::fmin(x * desc.nits / 10000.0f, 1.0f), 0.1593017578125f);
+        return std::pow((0.8359375f + 18.8515625f * y) / (1.0f + 18.6875f * y), 78.84375f);
+    }
+    default:
+        return x;
+    }
+}
+
+static inline float FFX_VariableShading_WeberContrast(float x, float localMean, float epsilon)
+{
+    return x / (localMean + epsilon);
+}
+
+#endif // FFX_VARIABLESHADING_LUMINANCE_CPP_DEFINED
+#elif defined(FFX_HLSL)
+
+#define FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_NONE 0
+#define FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_SRGB 1
+#define FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_LOG2 2
+#define FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_PQ 3
+#define FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_WEBER 4
+
+#ifndef FFX_VARIABLESHADING_LUMINANCE_TRANSFORM
+#define FFX_VARIABLESHADING_LUMINANCE_TRANSFORM FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_NONE
+#endif
+#ifndef FFX_VARIABLESHADING_LUMINANCE_NITS
+#define FFX_VARIABLESHADING_LUMINANCE_NITS 80.0
+#endif
+#ifndef FFX_VARIABLESHADING_LUMINANCE_EPSILON
+#define FFX_VARIABLESHADING_LUMINANCE_EPSILON (1.0 / 64.0)
+#endif
+
+float FFX_VariableShading_LinearToSrgb(float x)
+{
+    return (x <= 0.0031308) ? 12.92 * x : 1.055 * pow(x, 1.0 / 2.4) - 0.055;
+}
+
+float FFX_VariableShading_SrgbToLinear(float x)
+{
+    return (x <= 0.04045) ? x / 12.92 : pow((x + 0.055) / 1.055, 2.4);
+}
+
+// the FFX_VARIABLESHADING_LUMINANCE_TRANSFORM curve of linear luminance, WEBER returns x
+float FFX_VariableShading_TransformLuminance(float x)
+{
+    x = max(x, 0.0);
+#if FFX_VARIABLESHADING_LUMINANCE_TRANSFORM == FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_SRGB
+    return FFX_VariableShading_LinearToSrgb(x);
+#elif FFX_VARIABLESHADING_LUMINANCE_TRANSFORM == FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_LOG2
+    return log2(1.0 + x / FFX_VARIABLESHADING_LUMINANCE_EPSILON) / log2(1.0 + 1.0 / FFX_VARIABLESHADING_LUMINANCE_EPSILON);
+#elif FFX_VARIABLESHADING_LUMINANCE_TRANSFORM == FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_PQ
+    float y = pow(min(x * FFX_VARIABLESHADING_LUMINANCE_NITS / 10000.0, 1.0), 0.1593017578125);
+    return pow((0.8359375 + 18.8515625 * y) / (1.0 + 18.6875 * y), 78.84375);
+#else
+    return x;
+#endif
+}
+
+// localMean: the mean of the 3x3 texels around x
+float FFX_VariableShading_WeberContrast(float x, float localMean)
+{
+    return x / (localMean + FFX_VARIABLESHADING_LUMINANCE_EPSILON);
+}
+#endif // FFX_CPP|FFX_HLSL
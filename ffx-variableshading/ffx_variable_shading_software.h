@@ -0,0 +1,122 @@
+// FFX_VariableShading_Software.h
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//////////////////////////////////////////////////////////////////////////
+// Software VRS for compute passes:
+//
+// Hardware VRS only applies to pixel shaders. Compute (post processing) passes
+// can use the VRS image with this header: every thread processes a 4x4 pixel
+// block, reads the shading rate of the tile the block belongs to, evaluates one
+// sample per coarse pixel (at its upper left pixel) and writes the result to all
+// pixels covered by the coarse pixel.
+// Since tiles are a multiple of 4 pixels, a block never straddles two tiles.
+//
+// With tile lists (FFX_VARIABLESHADING_TILELISTS) the pass can instead be
+// dispatched indirectly once per rate class, one threadgroup per tile: the
+// shading rate is then uniform across the dispatch and no thread reads the
+// VRS image.
+//
+// A CPU reference implementation is FFX_VariableShading_ExecuteRateAware in
+// ffx_variable_shading_cpu.h
+//
+//////////////////////////////////////////////////////////////////////////
+
+#if defined(FFX_CPP)
+static inline void FFX_VariableShading_SoftwareVrs_GetDispatchInfo(const uint32_t width, const uint32_t height, uint32_t& numThreadGroupsX, uint32_t& numThreadGroupsY)
+{
+    // each thread computes 4x4 pixels, an 8x8 threadgroup computes 32x32 pixels
+    numThreadGroupsX = (width + 31) / 32;
+    numThreadGroupsY = (height + 31) / 32;
+}
+#elif defined(FFX_HLSL)
+
+// Forward declaration of functions that need to be implemented by shader code using this technique
+uint    FFX_VariableShading_ReadShadingRate(int2 tile);
+float4  FFX_VariableShading_EvaluatePixel(int2 pos);
+void    FFX_VariableShading_WritePixel(int2 pos, float4 value);
+
+static const uint FFX_VariableShading_SoftwareVrs_ThreadCount1D = 8;
+static const int FFX_VariableShading_SoftwareVrs_BlockSize1D = 4;
+
+void FFX_VariableShading_SoftwareVrs_ExecuteBlock(int2 blockOffset, int2 resolution, uint shadingRate)
+{
+    // rates are encoded as log2 of the coarse pixel size per axis
+    int2 coarseSize = int2(1 << ((shadingRate >> 2) & 3), 1 << (shadingRate & 3));
+
+    for (int y = 0; y < FFX_VariableShading_SoftwareVrs_BlockSize1D; y += coarseSize.y)
+    {
+        for (int x = 0; x < FFX_VariableShading_SoftwareVrs_BlockSize1D; x += coarseSize.x)
+        {
+            int2 coarseOffset = blockOffset + int2(x, y);
+            if ((coarseOffset.x >= resolution.x) || (coarseOffset.y >= resolution.y))
+                continue;
+
+            // one evaluation per coarse pixel, broadcast to all covered pixels
+            float4 value = FFX_VariableShading_EvaluatePixel(coarseOffset);
+
+            for (int j = 0; j < coarseSize.y; ++j)
+            {
+                for (int i = 0; i < coarseSize.x; ++i)
+                {
+                    int2 pos = coarseOffset + int2(i, j);
+                    if ((pos.x < resolution.x) && (pos.y < resolution.y))
+                    {
+                        FFX_VariableShading_WritePixel(pos, value);
+                    }
+                }
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------//
+// Main function: call from a [numthreads(8, 8, 1)] compute shader                      //
+//--------------------------------------------------------------------------------------//
+void FFX_VariableShading_SoftwareVrs_Execute(uint3 DTid, int2 resolution, uint tileSize)
+{
+    int2 blockOffset = DTid.xy * FFX_VariableShading_SoftwareVrs_BlockSize1D;
+    if ((blockOffset.x >= resolution.x) || (blockOffset.y >= resolution.y))
+        return;
+
+    uint shadingRate = FFX_VariableShading_ReadShadingRate(blockOffset / (int)tileSize);
+    FFX_VariableShading_SoftwareVrs_ExecuteBlock(blockOffset, resolution, shadingRate);
+}
+
+//--------------------------------------------------------------------------------------//
+// Tile list variant: call from a [numthreads(8, 8, 1)] compute shader dispatched with  //
+// one threadgroup per entry of the tile list of shadingRate                            //
+//--------------------------------------------------------------------------------------//
+void FFX_VariableShading_SoftwareVrs_ExecuteTile(int2 tile, uint3 Gtid, int2 resolution, uint tileSize, uint shadingRate)
+{
+    // tiles smaller than 32x32 pixels leave some threads idle
+    int blocksPerTile1D = (int)tileSize / FFX_VariableShading_SoftwareVrs_BlockSize1D;
+
+    for (int y = Gtid.y; y < blocksPerTile1D; y += FFX_VariableShading_SoftwareVrs_ThreadCount1D)
+    {
+        for (int x = Gtid.x; x < blocksPerTile1D; x += FFX_VariableShading_SoftwareVrs_ThreadCount1D)
+        {
+            int2 blockOffset = tile * (int)tileSize + int2(x, y) * FFX_VariableShading_SoftwareVrs_BlockSize1D;
+            if ((blockOffset.x < resolution.x) && (blockOffset.y < resolution.y))
+            {
+                FFX_VariableShading_SoftwareVrs_ExecuteBlock(blockOffset, resolution, shadingRate);
+            }
+        }
+    }
+}
+#endif // FFX_CPP|FFX_HLSL
@@ -0,0 +1,537 @@
+// FFX_VariableShading_Trace.h
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//////////////////////////////////////////////////////////////////////////
+// VariableShading timeline tracing
+//
+// Records complete events (name, category, start and end timestamp) into a
+// lock-free single producer / single consumer ring per thread and streams
+// them from a background thread to a Chrome trace JSON file (chrome://tracing,
+// ui.perfetto.dev) or a Perfetto protobuf trace.
+//
+// - FFX_VARIABLESHADING_TRACE_SCOPE(name, category) records the enclosing
+//   scope on the calling thread, e.g. scheduler tasks.
+//   FFX_VARIABLESHADING_TRACE_SCOPE_ARGS(name, category, argNames, values...)
+//   adds up to FFX_VARIABLESHADING_TRACE_MAX_ARGS named integers, e.g. the
+//   tiles of every generator task and the tasks of every
+//   FFX_VariableShading_CpuThreadPool worker, so the trace shows how they
+//   overlap with the frame.
+// - FFX_VariableShading_TraceComplete records an event with explicit
+//   timestamps (FFX_VariableShading_ReadTimestamp ticks), optionally on a
+//   named virtual track (FFX_VariableShading_TraceRegisterTrack), e.g. GPU
+//   passes converted to the CPU timebase.
+// - Defining FFX_VARIABLESHADING_TRACE before including
+//   ffx_variable_shading_cpu.h records every stage of the CPU generator
+//   (it implies FFX_VARIABLESHADING_PROFILE).
+//
+// Names and categories are stored as pointers: use string literals or
+// FFX_VariableShading_TraceInternString. Nothing is recorded while no
+// FFX_VariableShading_TraceWriter is running; a full ring drops events
+// (see FFX_VariableShading_TraceWriter::DroppedEvents) instead of blocking.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ffx_variable_shading_cpu_profile.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <condition_variable>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+static const uint32_t FFX_VARIABLESHADING_TRACE_RING_SIZE = 1 << 14;    // events per thread, power of 2
+static const uint32_t FFX_VARIABLESHADING_TRACE_FORMAT_CHROME_JSON = 0;
+static const uint32_t FFX_VARIABLESHADING_TRACE_FORMAT_PERFETTO = 1;
+static const uint32_t FFX_VARIABLESHADING_TRACE_MAX_ARGS = 4;
+
+// argument names of FFX_VARIABLESHADING_TRACE_SCOPE_ARGS
+static const char* const FFX_VARIABLESHADING_TRACE_TILE_ARGS[] = { "firstTileX", "tileCountX", "firstTileRow", "tileRowCount" };
+static const char* const FFX_VARIABLESHADING_TRACE_INDEX_ARGS[] = { "index" };
+
+struct FFX_VariableShading_TraceEvent
+{
+    uint64_t            start, end;     // FFX_VariableShading_ReadTimestamp ticks
+    const char*         name;
+    const char*         category;
+    uint32_t            track;          // 0: the recording thread, otherwise a FFX_VariableShading_TraceRegisterTrack id
+    uint32_t            argCount;
+    const char* const*  argNames;       // argCount names, stored as pointers like name
+    uint32_t            args[FFX_VARIABLESHADING_TRACE_MAX_ARGS];
+};
+
+class FFX_VariableShading_TraceRing
+{
+public:
+    // producer: the owning thread only
+    bool Push(const FFX_VariableShading_TraceEvent& event)
+    {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) >= FFX_VARIABLESHADING_TRACE_RING_SIZE)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_events[head & (FFX_VARIABLESHADING_TRACE_RING_SIZE - 1)] = event;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer: the writer thread only
+    template <typename Fn>
+    void Drain(Fn fn)
+    {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        const uint32_t head = m_head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail)
+            fn(m_events[tail & (FFX_VARIABLESHADING_TRACE_RING_SIZE - 1)]);
+        m_tail.store(tail, std::memory_order_release);
+    }
+
+    uint64_t Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    uint32_t    id = 0;             // 1 based thread index
+    std::string name;               // guarded by the registry mutex
+
+private:
+    FFX_VariableShading_TraceEvent  m_events[FFX_VARIABLESHADING_TRACE_RING_SIZE];
+    std::atomic<uint32_t>           m_head{ 0 };
+    std::atomic<uint32_t>           m_tail{ 0 };
+    std::atomic<uint64_t>           m_dropped{ 0 };
+};
+
+struct FFX_VariableShading_TraceRegistry
+{
+    std::mutex                                              mutex;
+    std::vector<std::unique_ptr<FFX_VariableShading_TraceRing>> rings;     // rings outlive their threads
+    std::vector<std::string>                                tracks;         // virtual track names, id = index + 1
+    std::unordered_set<std::string>                         strings;
+    std::atomic<bool>                                       recording{ false };
+};
+
+inline FFX_VariableShading_TraceRegistry& FFX_VariableShading_GetTraceRegistry()
+{
+    static FFX_VariableShading_TraceRegistry registry;
+    return registry;
+}
+
+inline FFX_VariableShading_TraceRing* FFX_VariableShading_GetTraceRing()
+{
+    static thread_local FFX_VariableShading_TraceRing* ring = []()
+    {
+        FFX_VariableShading_TraceRegistry& registry = FFX_VariableShading_GetTraceRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.rings.emplace_back(new FFX_VariableShading_TraceRing());
+        FFX_VariableShading_TraceRing* newRing = registry.rings.back().get();
+        newRing->id = (uint32_t)registry.rings.size();
+        newRing->name = "Thread " + std::to_string(newRing->id);
+        return newRing;
+    }();
+    return ring;
+}
+
+inline void FFX_VariableShading_SetTraceThreadName(const char* name)
+{
+    FFX_VariableShading_TraceRing* ring = FFX_VariableShading_GetTraceRing();
+    std::lock_guard<std::mutex> lock(FFX_VariableShading_GetTraceRegistry().mutex);
+    ring->name = name;
+}
+
+inline uint32_t FFX_VariableShading_TraceRegisterTrack(const char* name)
+{
+    FFX_VariableShading_TraceRegistry& registry = FFX_VariableShading_GetTraceRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (size_t i = 0; i < registry.tracks.size(); ++i)
+    {
+        if (registry.tracks[i] == name)
+            return (uint32_t)i + 1;
+    }
+    registry.tracks.push_back(name);
+    return (uint32_t)registry.tracks.size();
+}
+
+// stable copy of a string for event names that are not literals
+inline const char* FFX_VariableShading_TraceInternString(const std::string& s)
+{
+    FFX_VariableShading_TraceRegistry& registry = FFX_VariableShading_GetTraceRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    return registry.strings.insert(s).first->c_str();
+}
+
+inline bool FFX_VariableShading_TraceRecording()
+{
+    return FFX_VariableShading_GetTraceRegistry().recording.load(std::memory_order_relaxed);
+}
+
+inline void FFX_VariableShading_TraceComplete(const char* name, const char* category, uint64_t start, uint64_t end, uint32_t track,
+    const char* const* argNames, uint32_t argCount, const uint32_t* args)
+{
+    if (!FFX_VariableShading_TraceRecording())
+        return;
+
+    FFX_VariableShading_TraceEvent event;
+    event.start = start;
+    event.end = end;
+    event.name = name;
+    event.category = category;
+    event.track = track;
+    event.argCount = std::min(argCount, FFX_VARIABLESHADING_TRACE_MAX_ARGS);
+    event.argNames = argNames;
+    for (uint32_t i = 0; i < event.argCount; ++i)
+        event.args[i] = args[i];
+    FFX_VariableShading_GetTraceRing()->Push(event);
+}
+
+inline void FFX_VariableShading_TraceComplete(const char* name, const char* category, uint64_t start, uint64_t end, uint32_t track)
+{
+    FFX_VariableShading_TraceComplete(name, category, start, end, track, NULL, 0, NULL);
+}
+
+inline void FFX_VariableShading_TraceComplete(const char* name, const char* category, uint64_t start, uint64_t end)
+{
+    FFX_VariableShading_TraceComplete(name, category, start, end, 0);
+}
+
+class FFX_VariableShading_TraceScope
+{
+public:
+    FFX_VariableShading_TraceScope(const char* name, const char* category) : m_name(name), m_category(category)
+    {
+        m_start = FFX_VariableShading_TraceRecording() ? FFX_VariableShading_ReadTimestamp() : 0;
+    }
+
+    // argNames has one name per value, at most FFX_VARIABLESHADING_TRACE_MAX_ARGS are kept
+    FFX_VariableShading_TraceScope(const char* name, const char* category, const char* const* argNames, std::initializer_list<uint32_t> args)
+        : FFX_VariableShading_TraceScope(name, category)
+    {
+        m_argNames = argNames;
+        for (uint32_t arg : args)
+        {
+            if (m_argCount < FFX_VARIABLESHADING_TRACE_MAX_ARGS)
+                m_args[m_argCount++] = arg;
+        }
+    }
+
+    ~FFX_VariableShading_TraceScope()
+    {
+        if (m_start)
+            FFX_VariableShading_TraceComplete(m_name, m_category, m_start, FFX_VariableShading_ReadTimestamp(), 0, m_argNames, m_argCount, m_args);
+    }
+
+private:
+    const char*         m_name;
+    const char*         m_category;
+    uint64_t            m_start;
+    const char* const*  m_argNames = NULL;
+    uint32_t            m_argCount = 0;
+    uint32_t            m_args[FFX_VARIABLESHADING_TRACE_MAX_ARGS];
+};
+
+#define FFX_VARIABLESHADING_TRACE_CONCAT_(a, b) a##b
+#define FFX_VARIABLESHADING_TRACE_CONCAT(a, b) FFX_VARIABLESHADING_TRACE_CONCAT_(a, b)
+#define FFX_VARIABLESHADING_TRACE_SCOPE(name, category) FFX_VariableShading_TraceScope FFX_VARIABLESHADING_TRACE_CONCAT(ffxTraceScope, __LINE__)(name, category)
+#define FFX_VARIABLESHADING_TRACE_SCOPE_ARGS(name, category, argNames, ...) \
+    FFX_VariableShading_TraceScope FFX_VARIABLESHADING_TRACE_CONCAT(ffxTraceScope, __LINE__)(name, category, argNames, { __VA_ARGS__ })
+
+//--------------------------------------------------------------------------------------//
+// Writer                                                                               //
+//--------------------------------------------------------------------------------------//
+class FFX_VariableShading_TraceWriter
+{
+public:
+    ~FFX_VariableShading_TraceWriter() { Stop(); }
+
+    // starts recording, events are flushed every flushIntervalMs. Only one writer can run at a time.
+    bool Start(const char* fileName, uint32_t format, uint32_t flushIntervalMs = 100)
+    {
+        FFX_VariableShading_TraceRegistry& registry = FFX_VariableShading_GetTraceRegistry();
+        if (m_file || registry.recording)
+            return false;
+
+        m_file = fopen(fileName, "wb");
+        if (!m_file)
+            return false;
+
+        m_format = format;
+        m_firstEvent = true;
+        m_stop = false;
+        m_namedThreads.clear();
+        m_namedTracks.clear();
+        m_baseTicks = FFX_VariableShading_ReadTimestamp();
+        m_ticksPerMicrosecond = FFX_VariableShading_GetTimestampFrequency() / 1e6;
+        m_droppedAtStart = CountDropped();
+
+        // discard whatever was left from a previous recording
+        Drain(false);
+
+        if (m_format == FFX_VARIABLESHADING_TRACE_FORMAT_CHROME_JSON)
+            fputs("{\"traceEvents\":[\n", m_file);
+
+        registry.recording = true;
+        m_thread = std::thread([this, flushIntervalMs]()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (!m_stop)
+            {
+                m_wake.wait_for(lock, std::chrono::milliseconds(flushIntervalMs));
+                Drain(true);
+            }
+        });
+        return true;
+    }
+
+    void Stop()
+    {
+        if (!m_file)
+            return;
+
+        FFX_VariableShading_GetTraceRegistry().recording = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+
+        // events pushed after the last flush
+        Drain(true);
+
+        if (m_format == FFX_VARIABLESHADING_TRACE_FORMAT_CHROME_JSON)
+            fputs("\n],\"displayTimeUnit\":\"ms\"}\n", m_file);
+        fclose(m_file);
+        m_file = nullptr;
+    }
+
+    bool Running() const { return m_file != nullptr; }
+
+    // events lost to full rings since Start
+    uint64_t DroppedEvents() const { return CountDropped() - m_droppedAtStart; }
+
+private:
+    static uint64_t CountDropped()
+    {
+        FFX_VariableShading_TraceRegistry& registry = FFX_VariableShading_GetTraceRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        uint64_t dropped = 0;
+        for (const auto& ring : registry.rings)
+            dropped += ring->Dropped();
+        return dropped;
+    }
+
+    void Drain(bool write)
+    {
+        FFX_VariableShading_TraceRegistry& registry = FFX_VariableShading_GetTraceRegistry();
+
+        // snapshot the rings and names, new threads are picked up by the next flush
+        std::vector<FFX_VariableShading_TraceRing*> rings;
+        std::vector<std::string> ringNames, trackNames;
+        {
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            for (const auto& ring : registry.rings)
+            {
+                rings.push_back(ring.get());
+                ringNames.push_back(ring->name);
+            }
+            trackNames = registry.tracks;
+        }
+
+        for (size_t r = 0; r < rings.size(); ++r)
+        {
+            rings[r]->Drain([&](const FFX_VariableShading_TraceEvent& event)
+            {
+                if (!write || event.start < m_baseTicks)
+                    return;
+
+                uint64_t trackId;
+                if (event.track)
+                {
+                    trackId = TrackIdBase + event.track;
+                    NameTrack(m_namedTracks, trackId, (event.track <= trackNames.size()) ? trackNames[event.track - 1] : "Track", false);
+                }
+                else
+                {
+                    trackId = rings[r]->id;
+                    NameTrack(m_namedThreads, trackId, ringNames[r], true);
+                }
+                WriteEvent(event, trackId);
+            });
+        }
+
+        if (write)
+            fflush(m_file);
+    }
+
+    void NameTrack(std::vector<uint64_t>& named, uint64_t trackId, const std::string& name, bool thread)
+    {
+        for (uint64_t id : named)
+        {
+            if (id == trackId)
+                return;
+        }
+        named.push_back(trackId);
+
+        if (m_format == FFX_VARIABLESHADING_TRACE_FORMAT_CHROME_JSON)
+        {
+            fprintf(m_file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%llu,\"args\":{\"name\":\"%s\"}}",
+                m_firstEvent ? "" : ",\n", (unsigned long long)trackId, EscapeJson(name).c_str());
+            m_firstEvent = false;
+        }
+        else
+        {
+            // TrackDescriptor { uuid = 1, name = 2, thread = 4 { pid = 1, tid = 2, thread_name = 5 } }
+            std::string descriptor;
+            WriteVarintField(descriptor, 1, trackId);
+            if (thread)
+            {
+                std::string threadDescriptor;
+                WriteVarintField(threadDescriptor, 1, 1);
+                WriteVarintField(threadDescriptor, 2, trackId);
+                WriteBytesField(threadDescriptor, 5, name);
+                WriteBytesField(descriptor, 4, threadDescriptor);
+            }
+            else
+            {
+                WriteBytesField(descriptor, 2, name);
+            }
+
+            std::string packet;
+            WriteBytesField(packet, 60, descriptor);
+            WritePacket(packet);
+        }
+    }
+
+    void WriteEvent(const FFX_VariableShading_TraceEvent& event, uint64_t trackId)
+    {
+        const double start = (double)(event.start - m_baseTicks) / m_ticksPerMicrosecond;
+        const double duration = (double)(event.end - event.start) / m_ticksPerMicrosecond;
+
+        if (m_format == FFX_VARIABLESHADING_TRACE_FORMAT_CHROME_JSON)
+        {
+            fprintf(m_file, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%llu",
+                m_firstEvent ? "" : ",\n", EscapeJson(event.name).c_str(), EscapeJson(event.category).c_str(), start, duration, (unsigned long long)trackId);
+            for (uint32_t i = 0; i < event.argCount; ++i)
+                fprintf(m_file, "%s\"%s\":%u", i ? "," : ",\"args\":{", EscapeJson(event.argNames[i]).c_str(), event.args[i]);
+            fputs(event.argCount ? "}}" : "}", m_file);
+            m_firstEvent = false;
+        }
+        else
+        {
+            // TrackEvent { debug_annotations = 4, type = 9, track_uuid = 11, categories = 22, name = 23 }, SLICE_BEGIN = 1, SLICE_END = 2
+            for (uint32_t type = 1; type <= 2; ++type)
+            {
+                std::string trackEvent;
+                WriteVarintField(trackEvent, 9, type);
+                WriteVarintField(trackEvent, 11, trackId);
+                if (type == 1)
+                {
+                    WriteBytesField(trackEvent, 22, event.category);
+                    WriteBytesField(trackEvent, 23, event.name);
+
+                    // DebugAnnotation { uint_value = 3, name = 10 }
+                    for (uint32_t i = 0; i < event.argCount; ++i)
+                    {
+                        std::string annotation;
+                        WriteVarintField(annotation, 3, event.args[i]);
+                        WriteBytesField(annotation, 10, event.argNames[i]);
+                        WriteBytesField(trackEvent, 4, annotation);
+                    }
+                }
+
+                // TracePacket { timestamp = 8, trusted_packet_sequence_id = 10, track_event = 11 }, timestamps in ns
+                std::string packet;
+                WriteVarintField(packet, 8, (uint64_t)(((type == 1) ? start : start + duration) * 1000.0));
+                WriteBytesField(packet, 11, trackEvent);
+                WritePacket(packet);
+            }
+        }
+    }
+
+    void WritePacket(std::string& packet)
+    {
+        WriteVarintField(packet, 10, 1);
+        if (m_firstEvent)
+        {
+            // sequence_flags = 13: SEQ_INCREMENTAL_STATE_CLEARED
+            WriteVarintField(packet, 13, 1);
+            m_firstEvent = false;
+        }
+
+        // Trace { repeated TracePacket packet = 1 }
+        std::string field;
+        WriteBytesField(field, 1, packet);
+        fwrite(field.data(), 1, field.size(), m_file);
+    }
+
+    static void WriteVarint(std::string& out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back((char)((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back((char)value);
+    }
+
+    static void WriteVarintField(std::string& out, uint32_t field, uint64_t value)
+    {
+        WriteVarint(out, (uint64_t)field << 3);
+        WriteVarint(out, value);
+    }
+
+    static void WriteBytesField(std::string& out, uint32_t field, const std::string& value)
+    {
+        WriteVarint(out, ((uint64_t)field << 3) | 2);
+        WriteVarint(out, value.size());
+        out += value;
+    }
+
+    static std::string EscapeJson(const std::string& s)
+    {
+        std::string escaped;
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+                escaped.push_back('\\');
+            if ((unsigned char)c >= 0x20)
+                escaped.push_back(c);
+        }
+        return escaped;
+    }
+
+    static const uint64_t   TrackIdBase = 1 << 20;
+
+    FILE*                   m_file = nullptr;
+    uint32_t                m_format = FFX_VARIABLESHADING_TRACE_FORMAT_CHROME_JSON;
+    bool                    m_firstEvent = true;
+    uint64_t                m_baseTicks = 0;
+    double                  m_ticksPerMicrosecond = 1.0;
+    uint64_t                m_droppedAtStart = 0;
+    std::vector<uint64_t>   m_namedThreads;
+    std::vector<uint64_t>   m_namedTracks;
+
+    std::thread             m_thread;
+    std::mutex              m_mutex;
+    std::condition_variable m_wake;
+    bool                    m_stop = false;
+};
@@ -0,0 +1,230 @@
+// test_cpu_context.cpp
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Generating frames with a FFX_VariableShading_CpuContext must neither call its allocator
+// nor the global operator new, and the context must only return what it allocated. The overloads
+// without a context reuse the scratch of the calling thread once it has seen the widest viewport.
+
+#include "ffx_variable_shading_cpu_context.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <new>
+
+static std::atomic<uint64_t> g_newCount(0);
+
+// The whole replaceable set (C++14 has no aligned forms), so every new is counted
+// and every delete returns memory from the matching malloc. The free stays out of line:
+// inlined into a caller GCC's -Wmismatched-new-delete pairs it with the new expression.
+#if defined(__GNUC__)
+#define FFX_TEST_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define FFX_TEST_NOINLINE __declspec(noinline)
+#else
+#define FFX_TEST_NOINLINE
+#endif
+
+static void* CountedNew(size_t size)
+{
+    ++g_newCount;
+    return malloc(size ? size : 1);
+}
+
+static FFX_TEST_NOINLINE void CountedDelete(void* memory)
+{
+    free(memory);
+}
+
+void* operator new(size_t size)
+{
+    if (void* memory = CountedNew(size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    if (void* memory = CountedNew(size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return CountedNew(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return CountedNew(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    CountedDelete(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    CountedDelete(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    CountedDelete(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+    CountedDelete(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+    CountedDelete(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+    CountedDelete(memory);
+}
+
+struct AllocatorCounts
+{
+    uint32_t    allocations;
+    uint32_t    deallocations;
+    uint32_t    nullDeallocations;
+};
+
+static void* CountingAllocate(void* userData, size_t size, size_t alignment)
+{
+    ++((AllocatorCounts*)userData)->allocations;
+    return FFX_VariableShading_DefaultCpuAllocate(NULL, size, alignment);
+}
+
+static void CountingDeallocate(void* userData, void* memory)
+{
+    AllocatorCounts* counts = (AllocatorCounts*)userData;
+    ++counts->deallocations;
+    counts->nullDeallocations += memory ? 0 : 1;
+    FFX_VariableShading_DefaultCpuDeallocate(NULL, memory);
+}
+
+static int g_failures = 0;
+
+static void Check(bool condition, const char* what)
+{
+    if (!condition)
+    {
+        printf("FAILED: %s\n", what);
+        ++g_failures;
+    }
+}
+
+int main()
+{
+    const uint32_t width = 640, height = 360;
+    std::vector<float> luminance((size_t)width * height);
+    std::vector<float> motionVectors((size_t)width * height * 2);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            luminance[y * width + x] = (float)((x * 7 + y * 13) % 97) / 97.0f * (((x / 40 + y / 40) % 2) ? 1.0f : 0.02f);
+            motionVectors[(y * width + x) * 2 + 0] = (float)(x % 5) - 2.0f;
+            motionVectors[(y * width + x) * 2 + 1] = (float)(y % 3) - 1.0f;
+        }
+    }
+
+    for (uint32_t additionalShadingRates = 0; additionalShadingRates < 2; ++additionalShadingRates)
+    {
+        for (uint32_t allocateVrsImage = 0; allocateVrsImage < 2; ++allocateVrsImage)
+        {
+            AllocatorCounts counts = {};
+            FFX_VariableShading_CpuAllocator allocator = { CountingAllocate, CountingDeallocate, &counts };
+
+            FFX_VariableShading_CpuContextDesc desc = {};
+            desc.cb = { width, height, 8, 0.05f, 0.1f, 0, 0 };
+            desc.additionalShadingRates = additionalShadingRates != 0;
+            desc.neighbourhoodShape = FFX_VARIABLESHADING_NEIGHBOURHOOD_SQUARE;
+            desc.neighbourhoodRadius = 2;
+            desc.workerCount = 4;
+            desc.allocateVrsImage = allocateVrsImage != 0;
+
+            FFX_VariableShading_CpuContext context;
+            Check(FFX_VariableShading_CreateCpuContext(&context, desc, allocator), "context creation");
+            Check(allocateVrsImage || ((context.vrsImagePitch == 0) && (context.vrsImageHeight == 0)), "no VRS image size without allocateVrsImage");
+            const uint32_t creationAllocations = counts.allocations;
+
+            uint32_t firstTileX, firstTileY, tilesX, tilesY;
+            FFX_VariableShading_GetViewportTiles(&desc.cb, firstTileX, firstTileY, tilesX, tilesY);
+            std::vector<uint8_t> callerImage((size_t)tilesX * tilesY);
+            uint8_t* vrsImage = allocateVrsImage ? context.vrsImage : callerImage.data();
+            const uint32_t vrsImagePitch = allocateVrsImage ? context.vrsImagePitch : tilesX;
+
+            FFX_VariableShading_CpuInputs inputs = {};
+            inputs.luminance = luminance.data();
+            inputs.luminancePitch = width;
+            inputs.motionVectors = motionVectors.data();
+            inputs.motionVectorPitch = width * 2;
+            inputs.motionVectorWidth = width;
+            inputs.motionVectorHeight = height;
+            inputs.neighbourhoodShape = desc.neighbourhoodShape;
+            inputs.neighbourhoodRadius = desc.neighbourhoodRadius;
+
+            // tasks in reverse order on the calling thread, the parallelFor itself does not allocate
+            auto serialFor = [](uint32_t count, const auto& task)
+            {
+                for (uint32_t i = count; i-- > 0;)
+                    task(i);
+            };
+            const FFX_VariableShading_CpuGeneratorConfig config = { 3, 2, 0 };
+
+            const uint64_t newCount = g_newCount.load();
+            for (uint32_t frame = 0; frame < 8; ++frame)
+            {
+                FFX_VariableShading_CB cb = desc.cb;
+                cb.width = width - frame * 16;       // viewport changes must not allocate either
+                cb.height = height - frame * 8;
+                Check(FFX_VariableShading_GenerateVrsImage(&context, cb, inputs, vrsImage, vrsImagePitch), "single threaded generation fits");
+                Check(FFX_VariableShading_GenerateVrsImage(&context, cb, inputs, config, vrsImage, vrsImagePitch, serialFor), "task generation fits");
+            }
+            Check(g_newCount.load() == newCount, "no operator new while generating");
+            Check(counts.allocations == creationAllocations, "no allocator calls while generating");
+
+            FFX_VariableShading_GenerateVrsImage(desc.cb, desc.additionalShadingRates, inputs, config, vrsImage, vrsImagePitch, serialFor);
+            const uint64_t threadScratchNewCount = g_newCount.load();
+            for (uint32_t frame = 0; frame < 8; ++frame)
+            {
+                FFX_VariableShading_CB cb = desc.cb;
+                cb.width = width - frame * 16;
+                cb.height = height - frame * 8;
+                FFX_VariableShading_GenerateVrsImage(cb, desc.additionalShadingRates, inputs, config, vrsImage, vrsImagePitch, serialFor);
+            }
+            Check(g_newCount.load() == threadScratchNewCount, "no operator new generating on the thread's scratch");
+
+            FFX_VariableShading_DestroyCpuContext(&context);
+            Check(counts.deallocations == creationAllocations, "every allocation returned once");
+            Check(counts.nullDeallocations == 0, "no NULL deallocations");
+        }
+    }
+
+    printf("%s\n", g_failures ? "test_cpu_context FAILED" : "test_cpu_context passed");
+    return g_failures ? 1 : 0;
+}
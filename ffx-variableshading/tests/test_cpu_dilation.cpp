@@ -0,0 +1,175 @@
+// test_cpu_dilation.cpp
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// The van Herk/Gil-Werman dilation of ffx_variable_shading_cpu.h against brute force filters:
+// the line filter against a max over the window, the square and diamond passes against a max over
+// |dx|, |dy| <= radius and |dx| + |dy| <= radius, and FFX_VariableShading_DilateShadingRates against
+// the finest rate per axis in the neighbourhood. Radii run from 0 past the array size, on arrays
+// down to a single element, with a pitch wider than the array that has to stay untouched.
+
+#include "ffx_variable_shading_cpu.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static int g_failures = 0;
+
+static void Check(bool condition, const char* what, uint32_t shape, uint32_t radius)
+{
+    if (!condition)
+    {
+        printf("FAILED: %s (%s, radius %u)\n", what, shape == FFX_VARIABLESHADING_NEIGHBOURHOOD_SQUARE ? "square" : "diamond", radius);
+        ++g_failures;
+    }
+}
+
+static const uint32_t GUARD = 0xcdcdcdcdu;
+
+static uint32_t g_state = 0x1b873593u;
+
+static uint32_t Random()
+{
+    g_state ^= g_state << 13;
+    g_state ^= g_state >> 17;
+    g_state ^= g_state << 5;
+    return g_state;
+}
+
+static bool InNeighbourhood(int32_t dx, int32_t dy, uint32_t shape, uint32_t radius)
+{
+    const uint32_t ax = (uint32_t)std::abs(dx), ay = (uint32_t)std::abs(dy);
+    return (shape == FFX_VARIABLESHADING_NEIGHBOURHOOD_SQUARE) ? (ax <= radius && ay <= radius) : (ax + ay <= radius);
+}
+
+static void TestLine(uint32_t count, uint32_t radius)
+{
+    std::vector<uint32_t> values(count), scratch(2 * (count + 2 * radius));
+    for (uint32_t& value : values)
+        value = Random() % 1000;
+
+    std::vector<uint32_t> expected(count, 0);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        for (uint32_t j = (i > radius) ? i - radius : 0; j < std::min(i + radius + 1, count); ++j)
+            expected[i] = std::max(expected[i], values[j]);
+    }
+
+    FFX_VariableShading_DilateLine(values.data(), count, radius, 0u, [](uint32_t a, uint32_t b) { return std::max(a, b); }, scratch.data());
+    Check(values == expected, "line against the max over the window", FFX_VARIABLESHADING_NEIGHBOURHOOD_SQUARE, radius);
+}
+
+static void TestMax(uint32_t width, uint32_t height, uint32_t shape, uint32_t radius)
+{
+    const uint32_t pitch = width + 3;
+    std::vector<uint32_t> values((size_t)pitch * height, GUARD);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+            values[(size_t)y * pitch + x] = Random() % 1000;
+    }
+
+    std::vector<uint32_t> expected = values;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            uint32_t value = 0;
+            for (uint32_t sy = 0; sy < height; ++sy)
+            {
+                for (uint32_t sx = 0; sx < width; ++sx)
+                {
+                    if (InNeighbourhood((int32_t)sx - (int32_t)x, (int32_t)sy - (int32_t)y, shape, radius))
+                        value = std::max(value, values[(size_t)sy * pitch + sx]);
+                }
+            }
+            expected[(size_t)y * pitch + x] = value;
+        }
+    }
+
+    FFX_VariableShading_Dilate(values.data(), width, height, pitch, shape, radius, 0u, [](uint32_t a, uint32_t b) { return std::max(a, b); });
+    Check(values == expected, "max filter against brute force", shape, radius);
+}
+
+static void TestShadingRates(uint32_t width, uint32_t height, uint32_t shape, uint32_t radius)
+{
+    const uint32_t pitch = width + 5;
+    std::vector<uint8_t> image((size_t)pitch * height, (uint8_t)GUARD);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            // mostly coarse, so the few fine rates spread
+            const uint32_t rateClass = (Random() % 8) ? FFX_VARIABLESHADING_RATE_CLASS_COUNT - 1 - Random() % 3 : Random() % FFX_VARIABLESHADING_RATE_CLASS_COUNT;
+            image[(size_t)y * pitch + x] = (uint8_t)FFX_VariableShading_GetRateFromClass(rateClass);
+        }
+    }
+
+    std::vector<uint8_t> expected = image;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            uint32_t rateX = 2, rateY = 2;
+            for (uint32_t sy = 0; sy < height; ++sy)
+            {
+                for (uint32_t sx = 0; sx < width; ++sx)
+                {
+                    if (!InNeighbourhood((int32_t)sx - (int32_t)x, (int32_t)sy - (int32_t)y, shape, radius))
+                        continue;
+                    const uint32_t rate = image[(size_t)sy * pitch + sx];
+                    rateX = std::min(rateX, rate >> 2);
+                    rateY = std::min(rateY, rate & 3);
+                }
+            }
+            expected[(size_t)y * pitch + x] = (uint8_t)FFX_VARIABLESHADING_MAKE_SHADING_RATE(rateX, rateY);
+        }
+    }
+
+    FFX_VariableShading_DilateShadingRates(image.data(), width, height, pitch, shape, radius);
+    Check(image == expected, "finest rate per axis in the neighbourhood", shape, radius);
+}
+
+int main()
+{
+    for (uint32_t radius = 0; radius <= 12; ++radius)
+    {
+        const uint32_t counts[] = { 1, 2, 3, 7, 25, 26, 27, 64, 101 };
+        for (uint32_t count : counts)
+            TestLine(count, radius);
+    }
+
+    // single elements, single rows and columns, and radii reaching past the whole array
+    const uint32_t sizes[][2] = { { 1, 1 }, { 1, 9 }, { 13, 1 }, { 2, 3 }, { 17, 11 }, { 31, 24 }, { 40, 37 } };
+    const uint32_t radii[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 15, 16, 40 };
+    for (uint32_t shape = FFX_VARIABLESHADING_NEIGHBOURHOOD_DIAMOND; shape <= FFX_VARIABLESHADING_NEIGHBOURHOOD_SQUARE; ++shape)
+    {
+        for (uint32_t radius : radii)
+        {
+            for (const auto& size : sizes)
+            {
+                TestMax(size[0], size[1], shape, radius);
+                TestShadingRates(size[0], size[1], shape, radius);
+            }
+        }
+    }
+
+    printf("%s\n", g_failures ? "test_cpu_dilation FAILED" : "test_cpu_dilation passed");
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,232 @@
+// test_cpu_downsample.cpp
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// The conservative VRS image derivation (FFX_VariableShading_DownsampleShadingRates) against a brute
+// force version working on pixels: every destination tile takes the finest rate per axis of the
+// source tiles its pixel span covers on the source surface, shifted by the rounded log2 of the
+// surface scale and limited to maxRate1D and the valid combinations. Tile sizes 8 to 32, same,
+// half, quarter, larger and odd surface scales, and hand computed images.
+
+#include "ffx_variable_shading_cpu.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static int g_failures = 0;
+
+static void Check(bool condition, const char* what)
+{
+    if (!condition)
+    {
+        printf("FAILED: %s\n", what);
+        ++g_failures;
+    }
+}
+
+static const uint8_t GUARD = 0xcd;
+
+static uint32_t g_state = 0x85ebca6bu;
+
+static uint32_t Random()
+{
+    g_state ^= g_state << 13;
+    g_state ^= g_state >> 17;
+    g_state ^= g_state << 5;
+    return g_state;
+}
+
+// finer for a smaller destination surface, coarser for a larger one, at most the 2 steps between 1X and 4X
+static int32_t GetRateShift(uint32_t srcResolution, uint32_t dstResolution)
+{
+    const double scale = (double)dstResolution / (double)srcResolution;
+    const int32_t shift = (scale < 1.0) ? -(int32_t)ceil(log2(1.0 / scale) - 1e-9) : (int32_t)floor(log2(scale) + 1e-9);
+    return std::min(std::max(shift, -2), 2);
+}
+
+static std::vector<uint8_t> Downsample(const std::vector<uint8_t>& src, uint32_t srcPitch,
+    uint32_t srcResolutionX, uint32_t srcResolutionY, uint32_t srcTileSize,
+    uint32_t dstResolutionX, uint32_t dstResolutionY, uint32_t dstTileSize, uint32_t maxRate1D)
+{
+    const uint32_t srcWidth = FFX_VariableShading_DivideRoundingUp(srcResolutionX, srcTileSize), srcHeight = FFX_VariableShading_DivideRoundingUp(srcResolutionY, srcTileSize);
+    const uint32_t dstWidth = FFX_VariableShading_DivideRoundingUp(dstResolutionX, dstTileSize), dstHeight = FFX_VariableShading_DivideRoundingUp(dstResolutionY, dstTileSize);
+    const int32_t shiftX = GetRateShift(srcResolutionX, dstResolutionX), shiftY = GetRateShift(srcResolutionY, dstResolutionY);
+
+    std::vector<uint8_t> dst((size_t)dstWidth * dstHeight);
+    for (uint32_t y = 0; y < dstHeight; ++y)
+    {
+        for (uint32_t x = 0; x < dstWidth; ++x)
+        {
+            // destination pixels [x * dstTileSize, (x + 1) * dstTileSize) in source pixels, times dstResolution
+            const uint64_t firstX = (uint64_t)x * dstTileSize * srcResolutionX, endX = (uint64_t)(x + 1) * dstTileSize * srcResolutionX;
+            const uint64_t firstY = (uint64_t)y * dstTileSize * srcResolutionY, endY = (uint64_t)(y + 1) * dstTileSize * srcResolutionY;
+
+            // every source tile near the span, whether it is covered is decided pixel by pixel below
+            const uint32_t nearX = (uint32_t)(firstX / ((uint64_t)srcTileSize * dstResolutionX)), nearY = (uint32_t)(firstY / ((uint64_t)srcTileSize * dstResolutionY));
+            const uint32_t farX = (uint32_t)std::min(endX / ((uint64_t)srcTileSize * dstResolutionX) + 2, (uint64_t)srcWidth);
+            const uint32_t farY = (uint32_t)std::min(endY / ((uint64_t)srcTileSize * dstResolutionY) + 2, (uint64_t)srcHeight);
+
+            int32_t rateX = 2, rateY = 2;
+            for (uint32_t sy = nearY > 0 ? nearY - 1 : 0; sy < farY; ++sy)
+            {
+                for (uint32_t sx = nearX > 0 ? nearX - 1 : 0; sx < farX; ++sx)
+                {
+                    // source tile pixels [sx * srcTileSize, (sx + 1) * srcTileSize) overlap the span
+                    const bool coveredX = ((uint64_t)sx * srcTileSize * dstResolutionX < endX) && ((uint64_t)(sx + 1) * srcTileSize * dstResolutionX > firstX);
+                    const bool coveredY = ((uint64_t)sy * srcTileSize * dstResolutionY < endY) && ((uint64_t)(sy + 1) * srcTileSize * dstResolutionY > firstY);
+                    if (!coveredX || !coveredY)
+                        continue;
+                    const uint32_t rate = src[(size_t)sy * srcPitch + sx];
+                    rateX = std::min(rateX, (int32_t)(rate >> 2));
+                    rateY = std::min(rateY, (int32_t)(rate & 3));
+                }
+            }
+
+            rateX = std::min(std::max(rateX + shiftX, 0), (int32_t)maxRate1D);
+            rateY = std::min(std::max(rateY + shiftY, 0), (int32_t)maxRate1D);
+            dst[(size_t)y * dstWidth + x] = (uint8_t)FFX_VARIABLESHADING_MAKE_SHADING_RATE((uint32_t)std::min(rateX, rateY + 1), (uint32_t)std::min(rateY, rateX + 1));
+        }
+    }
+    return dst;
+}
+
+static void TestBruteForce(uint32_t srcResolutionX, uint32_t srcResolutionY, uint32_t srcTileSize,
+    uint32_t dstResolutionX, uint32_t dstResolutionY, uint32_t dstTileSize, uint32_t maxRate1D)
+{
+    FFX_VariableShading_DownsampleCB cb;
+    FFX_VariableShading_SetupDownsample(&cb, srcResolutionX, srcResolutionY, srcTileSize, dstResolutionX, dstResolutionY, dstTileSize, maxRate1D);
+
+    // mostly coarse, so the fine rates decide
+    const uint32_t srcPitch = cb.srcWidth + 7;
+    std::vector<uint8_t> src((size_t)srcPitch * cb.srcHeight, GUARD);
+    for (uint32_t y = 0; y < cb.srcHeight; ++y)
+    {
+        for (uint32_t x = 0; x < cb.srcWidth; ++x)
+        {
+            const uint32_t rateClass = (Random() % 4) ? FFX_VARIABLESHADING_RATE_CLASS_COUNT - 1 - Random() % 3 : Random() % FFX_VARIABLESHADING_RATE_CLASS_COUNT;
+            src[(size_t)y * srcPitch + x] = (uint8_t)std::min(FFX_VariableShading_GetRateFromClass(rateClass), (uint32_t)FFX_VARIABLESHADING_MAKE_SHADING_RATE(maxRate1D, maxRate1D));
+        }
+    }
+
+    const std::vector<uint8_t> expected = Downsample(src, srcPitch, srcResolutionX, srcResolutionY, srcTileSize, dstResolutionX, dstResolutionY, dstTileSize, maxRate1D);
+    std::vector<uint8_t> dst((size_t)cb.dstWidth * cb.dstHeight, GUARD);
+    FFX_VariableShading_DownsampleShadingRates(cb, src.data(), srcPitch, dst.data(), cb.dstWidth);
+
+    char what[160];
+    snprintf(what, sizeof(what), "%ux%u tile %u to %ux%u tile %u, max rate %u against brute force",
+        srcResolutionX, srcResolutionY, srcTileSize, dstResolutionX, dstResolutionY, dstTileSize, maxRate1D);
+    Check(dst == expected, what);
+}
+
+#define RATE(x, y) FFX_VARIABLESHADING_RATE_##x##X##y
+
+// 64x64 pixels of 16x16 tiles
+static const uint8_t g_source[4 * 4] =
+{
+    RATE(4, 4), RATE(4, 4), RATE(2, 4), RATE(4, 4),
+    RATE(4, 4), RATE(4, 2), RATE(4, 4), RATE(4, 4),
+    RATE(1, 1), RATE(4, 4), RATE(2, 2), RATE(4, 4),
+    RATE(4, 4), RATE(4, 4), RATE(4, 4), RATE(1, 2),
+};
+
+static void TestTables()
+{
+    // 32x32 tiles of the same surface: finest rate per axis of each 2x2 tile block
+    const uint8_t tiles32[2 * 2] =
+    {
+        RATE(4, 2), RATE(2, 4),
+        RATE(1, 1), RATE(1, 2),
+    };
+    FFX_VariableShading_DownsampleCB cb;
+    FFX_VariableShading_SetupDownsample(&cb, 64, 64, 16, 64, 64, 32, FFX_VARIABLESHADING_RATE1D_4X);
+    std::vector<uint8_t> dst(4, GUARD);
+    FFX_VariableShading_DownsampleShadingRates(cb, g_source, 4, dst.data(), 2);
+    Check(memcmp(dst.data(), tiles32, sizeof(tiles32)) == 0, "32x32 tiles of the same surface");
+
+    // half resolution with 16x16 tiles: every destination tile covers 2x2 source tiles and one step finer
+    const uint8_t half[2 * 2] =
+    {
+        RATE(2, 1), RATE(1, 2),
+        RATE(1, 1), RATE(1, 1),
+    };
+    FFX_VariableShading_SetupDownsample(&cb, 64, 64, 16, 32, 32, 16, FFX_VARIABLESHADING_RATE1D_4X);
+    std::fill(dst.begin(), dst.end(), GUARD);
+    FFX_VariableShading_DownsampleShadingRates(cb, g_source, 4, dst.data(), 2);
+    Check(memcmp(dst.data(), half, sizeof(half)) == 0, "half resolution");
+
+    // twice the resolution with 8x8 tiles: every destination tile within one source tile and one step coarser,
+    // clamped to 4X, and to 2X without additional shading rates
+    const uint8_t doubled[4 * 4] =
+    {
+        RATE(4, 4), RATE(4, 4), RATE(4, 4), RATE(4, 4),
+        RATE(4, 4), RATE(4, 4), RATE(4, 4), RATE(4, 4),
+        RATE(2, 2), RATE(4, 4), RATE(4, 4), RATE(4, 4),
+        RATE(4, 4), RATE(4, 4), RATE(4, 4), RATE(2, 4),
+    };
+    for (uint32_t maxRate1D = FFX_VARIABLESHADING_RATE1D_2X; maxRate1D <= FFX_VARIABLESHADING_RATE1D_4X; ++maxRate1D)
+    {
+        FFX_VariableShading_SetupDownsample(&cb, 64, 64, 16, 128, 128, 8, maxRate1D);
+        dst.assign((size_t)cb.dstWidth * cb.dstHeight, GUARD);
+        FFX_VariableShading_DownsampleShadingRates(cb, g_source, 4, dst.data(), cb.dstWidth);
+        bool equal = (cb.dstWidth == 16) && (cb.dstHeight == 16);
+        for (uint32_t y = 0; equal && y < 16; ++y)
+        {
+            for (uint32_t x = 0; x < 16; ++x)
+                equal &= dst[(size_t)y * 16 + x] == ((maxRate1D == FFX_VARIABLESHADING_RATE1D_4X) ? doubled[(y / 4) * 4 + x / 4] : RATE(2, 2));
+        }
+        Check(equal, (maxRate1D == FFX_VARIABLESHADING_RATE1D_4X) ? "twice the resolution with 8x8 tiles" : "twice the resolution, clamped to 2X");
+    }
+}
+
+int main()
+{
+    TestTables();
+
+    struct Surface { uint32_t width, height; };
+    const Surface sources[] = { { 1920, 1080 }, { 1001, 777 }, { 64, 48 } };
+    for (const Surface& src : sources)
+    {
+        // same size, half, quarter, eighth, two thirds, odd and larger surfaces
+        const Surface destinations[] =
+        {
+            { src.width, src.height },
+            { (src.width + 1) / 2, (src.height + 1) / 2 },
+            { (src.width + 3) / 4, (src.height + 3) / 4 },
+            { (src.width + 7) / 8, (src.height + 7) / 8 },
+            { src.width * 2 / 3, src.height * 2 / 3 },
+            { src.width - 13, src.height / 2 + 5 },
+            { src.width * 2, src.height * 3 / 2 },
+        };
+        for (const Surface& dst : destinations)
+        {
+            for (uint32_t srcTileSize = 8; srcTileSize <= 32; srcTileSize *= 2)
+            {
+                for (uint32_t dstTileSize = 8; dstTileSize <= 32; dstTileSize *= 2)
+                {
+                    TestBruteForce(src.width, src.height, srcTileSize, dst.width, dst.height, dstTileSize, FFX_VARIABLESHADING_RATE1D_4X);
+                    TestBruteForce(src.width, src.height, srcTileSize, dst.width, dst.height, dstTileSize, FFX_VARIABLESHADING_RATE1D_2X);
+                }
+            }
+        }
+    }
+
+    printf("%s\n", g_failures ? "test_cpu_downsample FAILED" : "test_cpu_downsample passed");
+    return g_failures ? 1 : 0;
+}
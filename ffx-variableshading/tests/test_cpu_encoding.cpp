@@ -0,0 +1,252 @@
+// test_cpu_encoding.cpp
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Round trips of the three encodings of ffx_variable_shading_cpu_encoding.h: widths around the
+// SIMD block sizes, with odd tails, runs on both sides of the one byte token limit and run
+// lengths whose LEB128 rest takes two and three bytes. The packed forms are also checked against
+// their documented bit layout, and no function may write past the rows it was given.
+
+#include "ffx_variable_shading_cpu_encoding.h"
+
+#include <stdio.h>
+#include <vector>
+
+static int g_failures = 0;
+
+static void Check(bool condition, const char* what, uint32_t width)
+{
+    if (!condition)
+    {
+        printf("FAILED: %s (width %u)\n", what, width);
+        ++g_failures;
+    }
+}
+
+static const uint8_t GUARD = 0xcd;
+static const uint32_t GUARD_SIZE = 64;
+
+static uint32_t g_state = 0x12345678u;
+
+static uint32_t Random()
+{
+    g_state ^= g_state << 13;
+    g_state ^= g_state >> 17;
+    g_state ^= g_state << 5;
+    return g_state;
+}
+
+static uint8_t RandomRate()
+{
+    return (uint8_t)FFX_VariableShading_GetRateFromClassArithmetic(Random() % FFX_VARIABLESHADING_RATE_CLASS_COUNT);
+}
+
+static bool GuardIntact(const std::vector<uint8_t>& buffer, size_t start)
+{
+    for (size_t i = start; i < buffer.size(); ++i)
+    {
+        if (buffer[i] != GUARD)
+            return false;
+    }
+    return true;
+}
+
+// bytes the LEB128 rest of a run of length takes, 0 for a one byte token
+static uint32_t GetRunExtraBytes(uint32_t length)
+{
+    if (length < FFX_VARIABLESHADING_RUN_LENGTH_TOKEN_MAX)
+        return 0;
+    uint32_t bytes = 1;
+    for (uint32_t rest = length - FFX_VARIABLESHADING_RUN_LENGTH_TOKEN_MAX; rest > 0x7f; rest >>= 7)
+        ++bytes;
+    return bytes;
+}
+
+static void TestRateClasses()
+{
+    for (uint32_t rateClass = 0; rateClass < FFX_VARIABLESHADING_RATE_CLASS_COUNT; ++rateClass)
+    {
+        const uint32_t rate = FFX_VariableShading_GetRateFromClassArithmetic(rateClass);
+        Check(FFX_VariableShading_GetRateClass(rate) == rateClass, "arithmetic class to rate", rateClass);
+        Check(FFX_VariableShading_GetRateClassArithmetic(rate) == rateClass, "arithmetic rate to class", rateClass);
+    }
+}
+
+static void TestNibbles(uint32_t width)
+{
+    const uint32_t height = 3, pitch = width + 5;
+    const uint32_t rowSize = FFX_VariableShading_GetNibbleRowSize(width);
+    std::vector<uint8_t> image((size_t)pitch * height);
+    for (uint8_t& tile : image)
+        tile = (uint8_t)(Random() & 0xf);   // lossless for any 4 bit value, not only rates
+
+    std::vector<uint8_t> packed((size_t)rowSize * height + GUARD_SIZE, GUARD);
+    FFX_VariableShading_PackNibbles(image.data(), width, height, pitch, packed.data());
+    Check(GuardIntact(packed, (size_t)rowSize * height), "nibble packing stays inside its rows", width);
+
+    bool layout = true;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            const uint8_t byte = packed[(size_t)y * rowSize + x / 2];
+            layout &= (uint32_t)((x & 1) ? (byte >> 4) : (byte & 0xf)) == image[(size_t)y * pitch + x];
+        }
+    }
+    Check(layout, "even tile in the low nibble", width);
+
+    std::vector<uint8_t> decoded((size_t)pitch * height, GUARD);
+    FFX_VariableShading_UnpackNibbles(packed.data(), width, height, decoded.data(), pitch);
+    bool equal = true, padding = true;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < pitch; ++x)
+        {
+            const size_t i = (size_t)y * pitch + x;
+            if (x < width)
+                equal &= decoded[i] == image[i];
+            else
+                padding &= decoded[i] == GUARD;
+        }
+    }
+    Check(equal, "nibble round trip", width);
+    Check(padding, "nibble unpacking leaves the pitch padding alone", width);
+}
+
+static void TestPackedRateClasses(uint32_t width)
+{
+    const uint32_t height = 3, pitch = width + 3;
+    const uint32_t rowSize = FFX_VariableShading_GetRateClassRowSize(width);
+    std::vector<uint8_t> image((size_t)pitch * height);
+    for (uint8_t& tile : image)
+        tile = RandomRate();
+
+    std::vector<uint8_t> packed((size_t)rowSize * height + GUARD_SIZE, GUARD);
+    FFX_VariableShading_PackRateClasses(image.data(), width, height, pitch, packed.data());
+    Check(GuardIntact(packed, (size_t)rowSize * height), "rate class packing stays inside its rows", width);
+
+    bool layout = true;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            const uint8_t* group = &packed[(size_t)y * rowSize + x / 8 * 3];
+            const uint32_t bits = group[0] | (group[1] << 8) | (group[2] << 16);
+            layout &= ((bits >> (3 * (x % 8))) & 0x7) == FFX_VariableShading_GetRateClass(image[(size_t)y * pitch + x]);
+        }
+    }
+    Check(layout, "tile i in bits 3 * i of its group", width);
+
+    std::vector<uint8_t> decoded((size_t)pitch * height, GUARD);
+    FFX_VariableShading_UnpackRateClasses(packed.data(), width, height, decoded.data(), pitch);
+    bool equal = true, padding = true;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < pitch; ++x)
+        {
+            const size_t i = (size_t)y * pitch + x;
+            if (x < width)
+                equal &= decoded[i] == image[i];
+            else
+                padding &= decoded[i] == GUARD;
+        }
+    }
+    Check(equal, "rate class round trip", width);
+    Check(padding, "rate class unpacking leaves the pitch padding alone", width);
+}
+
+// rows made of the given run lengths, cycling through them until the row is full
+static void TestRunLength(uint32_t width, const std::vector<uint32_t>& runLengths)
+{
+    const uint32_t height = 4, pitch = width + 7;
+    std::vector<uint8_t> image((size_t)pitch * height, GUARD);
+    size_t expectedRuns = 0;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        uint8_t previous = 0xff;
+        for (uint32_t x = 0, run = y; x < width; ++run)
+        {
+            uint8_t rate;
+            do
+            {
+                rate = RandomRate();
+            } while (rate == previous);     // neighbouring runs must not merge
+            previous = rate;
+
+            const uint32_t length = std::min(runLengths[run % runLengths.size()], width - x);
+            memset(&image[(size_t)y * pitch + x], rate, length);
+            expectedRuns += 1 + GetRunExtraBytes(length);
+            x += length;
+        }
+    }
+
+    const size_t maxSize = FFX_VariableShading_GetRunLengthMaxSize(width, height);
+    std::vector<uint8_t> encoded(maxSize + GUARD_SIZE, GUARD);
+    const size_t size = FFX_VariableShading_EncodeRunLength(image.data(), width, height, pitch, encoded.data());
+    Check(size <= maxSize, "run length size within the bound", width);
+    Check(size == FFX_VariableShading_GetRunLengthHeaderSize(height) + expectedRuns, "one token per run plus its LEB128 rest", width);
+    Check(GuardIntact(encoded, size), "run length encoding stays inside its size", width);
+
+    uint32_t decodedWidth, decodedHeight;
+    FFX_VariableShading_GetRunLengthSize(encoded.data(), decodedWidth, decodedHeight);
+    Check((decodedWidth == width) && (decodedHeight == height), "run length header", width);
+
+    std::vector<uint8_t> decoded((size_t)pitch * height, GUARD);
+    FFX_VariableShading_DecodeRunLength(encoded.data(), decoded.data(), pitch);
+    Check(decoded == image, "run length round trip", width);
+
+    // random access, bottom up
+    bool rows = true;
+    std::vector<uint8_t> row(width + GUARD_SIZE, GUARD);
+    for (uint32_t y = height; y-- > 0;)
+    {
+        FFX_VariableShading_DecodeRunLengthRow(encoded.data(), y, row.data());
+        rows &= memcmp(row.data(), &image[(size_t)y * pitch], width) == 0;
+        rows &= GuardIntact(row, width);
+    }
+    Check(rows, "run length rows decode alone", width);
+}
+
+int main()
+{
+    TestRateClasses();
+
+    // around the 16 and 32 tile SIMD blocks, odd tails included
+    const uint32_t widths[] = { 1, 2, 3, 7, 8, 9, 15, 16, 17, 31, 32, 33, 47, 63, 64, 65, 97, 120, 240, 241 };
+    for (uint32_t width : widths)
+    {
+        TestNibbles(width);
+        TestPackedRateClasses(width);
+        TestRunLength(width, { 1, 2, 5 });
+    }
+
+    // single byte tokens up to 31 tiles, 32 and up with a LEB128 rest: 1 byte up to 159,
+    // 2 bytes from 160 (rest 128), 3 bytes from 16416 (rest 16384)
+    TestRunLength(40, { 31, 1 });
+    TestRunLength(100, { 32, 33, 1 });
+    TestRunLength(700, { 159, 160, 161, 3 });
+    TestRunLength(20000, { 16415, 1, 16416, 7 });
+    TestRunLength(40000, { 40000 });
+    TestRunLength(240, { 240 });    // a uniform row of a 4K image at 16x16 tiles
+
+    std::vector<uint8_t> uniform(240, FFX_VARIABLESHADING_RATE_2X2), encoded(240);
+    Check(FFX_VariableShading_EncodeRunLengthRow(uniform.data(), 240, encoded.data()) == 3, "uniform 4K row in 3 bytes", 240);
+
+    printf("%s\n", g_failures ? "test_cpu_encoding FAILED" : "test_cpu_encoding passed");
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,168 @@
+// test_cpu_layout.cpp
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// The block swizzled luminance layout has to give the same VRS image as the linear one, byte for
+// byte: every tile size and input mip level, planes with partial edge blocks, viewports at odd
+// offsets, both neighbourhood shapes, with and without motion and additional shading rates. The
+// swizzled addressing is also checked texel by texel against FFX_VariableShading_SwizzleLuminance.
+
+#include "ffx_variable_shading_cpu.h"
+
+#include <stdio.h>
+#include <vector>
+
+static int g_failures = 0;
+
+static void Check(bool condition, const char* what, uint32_t width, uint32_t height, uint32_t tileSize)
+{
+    if (!condition)
+    {
+        printf("FAILED: %s (%ux%u, tile size %u)\n", what, width, height, tileSize);
+        ++g_failures;
+    }
+}
+
+static const uint8_t GUARD = 0xcd;
+
+static uint32_t g_state = 0x9e3779b9u;
+
+static uint32_t Random()
+{
+    g_state ^= g_state << 13;
+    g_state ^= g_state >> 17;
+    g_state ^= g_state << 5;
+    return g_state;
+}
+
+// mostly flat with some edges, so every rate shows up
+static std::vector<float> MakeLuminance(uint32_t width, uint32_t height)
+{
+    std::vector<float> luminance((size_t)width * height);
+    for (float& texel : luminance)
+        texel = (float)(Random() % 1000) / 1000.0f * ((Random() % 4) ? 0.02f : 1.0f);
+    return luminance;
+}
+
+static void TestAddressing(const std::vector<float>& luminance, uint32_t width, uint32_t height, uint32_t blockSize)
+{
+    std::vector<float> swizzled(FFX_VariableShading_GetSwizzledLuminanceSize(width, height, blockSize));
+    FFX_VariableShading_SwizzleLuminance(luminance.data(), width, height, width, blockSize, swizzled.data());
+
+    // the padding of the edge blocks repeats the edge texels
+    const uint32_t paddedWidth = FFX_VariableShading_DivideRoundingUp(width, blockSize) * blockSize;
+    const uint32_t paddedHeight = FFX_VariableShading_DivideRoundingUp(height, blockSize) * blockSize;
+    const FFX_VariableShading_SwizzledLuminancePlane plane = { swizzled.data(), FFX_VariableShading_GetSwizzledLuminancePitch(width, blockSize), FFX_VariableShading_GetBlockShift(blockSize) };
+    bool equal = true;
+    for (uint32_t y = 0; y < paddedHeight; ++y)
+    {
+        for (uint32_t x = 0; x < paddedWidth; ++x)
+        {
+            const float texel = luminance[(size_t)std::min(y, height - 1) * width + std::min(x, width - 1)];
+            equal &= plane.luminance[plane.ColumnOffset((int32_t)x) + plane.RowOffset((int32_t)y)] == texel;
+        }
+    }
+    Check(equal, "swizzled texel addressing", width, height, blockSize);
+}
+
+static void TestGenerator(const std::vector<float>& level0, uint32_t width, uint32_t height, const std::vector<float>& motionVectors, uint32_t tileSize)
+{
+    for (uint32_t mipLevel = 0; mipLevel <= FFX_VariableShading_GetMaxInputMipLevel(tileSize); ++mipLevel)
+    {
+        uint32_t levelWidth = width, levelHeight = height;
+        std::vector<float> level = level0;
+        for (uint32_t i = 0; i < mipLevel; ++i)
+        {
+            const uint32_t nextWidth = FFX_VariableShading_DivideRoundingUp(levelWidth, 2), nextHeight = FFX_VariableShading_DivideRoundingUp(levelHeight, 2);
+            std::vector<float> next((size_t)nextWidth * nextHeight);
+            FFX_VariableShading_DownsampleLuminance(level.data(), levelWidth, levelHeight, levelWidth, next.data(), nextWidth);
+            level.swap(next);
+            levelWidth = nextWidth;
+            levelHeight = nextHeight;
+        }
+
+        for (uint32_t variant = 0; variant < 16; ++variant)
+        {
+            FFX_VariableShading_CB cb = {};
+            cb.viewportX = (variant & 3) ? Random() % (width / 2 + 1) : 0;
+            cb.viewportY = (variant & 3) ? Random() % (height / 2 + 1) : 0;
+            cb.width = 1 + Random() % (width - cb.viewportX);
+            cb.height = 1 + Random() % (height - cb.viewportY);
+            cb.tileSize = tileSize;
+            cb.varianceCutoff = 0.05f;
+            cb.motionFactor = 0.1f;
+            const uint32_t motionVectorWidth = cb.viewportX + cb.width, motionVectorHeight = cb.viewportY + cb.height;
+            FFX_VariableShading_SetInputMipLevel(&cb, mipLevel);
+
+            FFX_VariableShading_CpuInputs linear = {};
+            linear.luminance = level.data();
+            linear.luminancePitch = levelWidth;
+            linear.mipLevel = mipLevel;
+            linear.neighbourhoodShape = (variant & 4) ? FFX_VARIABLESHADING_NEIGHBOURHOOD_SQUARE : FFX_VARIABLESHADING_NEIGHBOURHOOD_DIAMOND;
+            linear.neighbourhoodRadius = variant % 3;
+            if (variant & 8)
+            {
+                linear.motionVectors = motionVectors.data();
+                linear.motionVectorPitch = width * 2;
+                linear.motionVectorWidth = motionVectorWidth;
+                linear.motionVectorHeight = motionVectorHeight;
+            }
+
+            std::vector<float> swizzled(FFX_VariableShading_GetSwizzledLuminanceSize(levelWidth, levelHeight, cb.tileSize));
+            FFX_VariableShading_SwizzleLuminance(level.data(), levelWidth, levelHeight, levelWidth, cb.tileSize, swizzled.data());
+            FFX_VariableShading_CpuInputs blocks = linear;
+            blocks.luminance = swizzled.data();
+            blocks.luminancePitch = FFX_VariableShading_GetSwizzledLuminancePitch(levelWidth, cb.tileSize);
+            blocks.luminanceLayout = FFX_VARIABLESHADING_LUMINANCE_LAYOUT_SWIZZLED;
+
+            // a pitch wider than the image, so the padding is compared too
+            const uint32_t tilesX = FFX_VariableShading_DivideRoundingUp(width, tileSize) + 3;
+            const uint32_t tilesY = FFX_VariableShading_DivideRoundingUp(height, tileSize);
+            for (uint32_t additionalShadingRates = 0; additionalShadingRates < 2; ++additionalShadingRates)
+            {
+                std::vector<uint8_t> expected((size_t)tilesX * tilesY, GUARD), image((size_t)tilesX * tilesY, GUARD);
+                FFX_VariableShading_GenerateVrsImage(cb, additionalShadingRates != 0, linear, expected.data(), tilesX);
+                FFX_VariableShading_GenerateVrsImage(cb, additionalShadingRates != 0, blocks, image.data(), tilesX);
+                Check(image == expected, additionalShadingRates ? "swizzled image, additional shading rates" : "swizzled image", width, height, tileSize);
+            }
+        }
+    }
+}
+
+int main()
+{
+    // block aligned, partial edge blocks of every tile size and planes smaller than one block
+    const uint32_t sizes[][2] = { { 64, 64 }, { 96, 32 }, { 301, 203 }, { 127, 65 }, { 33, 17 }, { 9, 31 }, { 5, 3 } };
+    for (const auto& size : sizes)
+    {
+        const uint32_t width = size[0], height = size[1];
+        const std::vector<float> luminance = MakeLuminance(width, height);
+        std::vector<float> motionVectors((size_t)width * height * 2);
+        for (float& motion : motionVectors)
+            motion = (float)((int32_t)(Random() % 9) - 4);
+
+        for (uint32_t tileSize = 8; tileSize <= 32; tileSize *= 2)
+        {
+            TestAddressing(luminance, width, height, tileSize);
+            TestGenerator(luminance, width, height, motionVectors, tileSize);
+        }
+    }
+
+    printf("%s\n", g_failures ? "test_cpu_layout FAILED" : "test_cpu_layout passed");
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,181 @@
+// test_cpu_stream.cpp
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Streaming generation (ffx_variable_shading_cpu_stream.h) has to give the whole image result of
+// FFX_VariableShading_GenerateVrsImage while its window only keeps tileSize plus twice the reach
+// rows, reach = max(radius, 1) * cellSize + maxMotionRows. Rows are pushed one at a time, in random
+// chunks and all at once, with the dilated neighbourhoods and vertical motion up to maxMotionRows.
+
+#include "ffx_variable_shading_cpu_stream.h"
+
+#include <stdio.h>
+#include <vector>
+
+static int g_failures = 0;
+
+static void Check(bool condition, const char* what, uint32_t tileSize, uint32_t mipLevel)
+{
+    if (!condition)
+    {
+        printf("FAILED: %s (tile size %u, mip level %u)\n", what, tileSize, mipLevel);
+        ++g_failures;
+    }
+}
+
+static uint32_t g_state = 0x2545f491u;
+
+static uint32_t Random()
+{
+    g_state ^= g_state << 13;
+    g_state ^= g_state >> 17;
+    g_state ^= g_state << 5;
+    return g_state;
+}
+
+static const uint32_t WIDTH = 203, HEIGHT = 251;
+
+// vertical motion up to maxMotion full resolution pixels, horizontal up to 4
+static std::vector<float> MakeMotionVectors(int32_t maxMotion)
+{
+    std::vector<float> motionVectors((size_t)WIDTH * HEIGHT * 2);
+    for (size_t i = 0; i < motionVectors.size(); i += 2)
+    {
+        motionVectors[i] = (float)((int32_t)(Random() % 9) - 4);
+        motionVectors[i + 1] = (float)((int32_t)(Random() % (2 * maxMotion + 1)) - maxMotion);
+    }
+    return motionVectors;
+}
+
+// chunkSize 0: random chunks
+static void TestStream(const FFX_VariableShading_CB& cb, const FFX_VariableShading_CpuInputs& inputs, bool additionalShadingRates, uint32_t maxMotionRows, uint32_t chunkSize, uint32_t tileSize)
+{
+    const uint32_t tilesX = FFX_VariableShading_DivideRoundingUp(cb.width, cb.tileSize);
+    const uint32_t tilesY = FFX_VariableShading_DivideRoundingUp(cb.height, cb.tileSize);
+    std::vector<uint8_t> expected((size_t)tilesX * tilesY), image((size_t)tilesX * tilesY, 0xcd);
+    FFX_VariableShading_GenerateVrsImage(cb, additionalShadingRates, inputs, expected.data(), tilesX);
+
+    FFX_VariableShading_CpuStreamDesc desc = {};
+    desc.cb = cb;
+    desc.additionalShadingRates = additionalShadingRates;
+    desc.mipLevel = inputs.mipLevel;
+    desc.neighbourhoodShape = inputs.neighbourhoodShape;
+    desc.neighbourhoodRadius = inputs.neighbourhoodRadius;
+    if (inputs.motionVectors)
+    {
+        desc.motionVectorWidth = inputs.motionVectorWidth;
+        desc.motionVectorHeight = inputs.motionVectorHeight;
+        desc.maxMotionRows = maxMotionRows;
+    }
+    FFX_VariableShading_CpuStream stream;
+    FFX_VariableShading_BeginCpuStream(&stream, desc);
+
+    const uint32_t cellSize = additionalShadingRates ? 4 : 2;
+    const uint32_t reach = std::max(inputs.neighbourhoodRadius, 1u) * cellSize + desc.maxMotionRows;
+    const size_t windowSize = (size_t)(cb.tileSize + 2 * reach) * cb.width;
+
+    bool ordered = true, bounded = true;
+    uint32_t nextTileRow = 0;
+    for (uint32_t row = 0; row < cb.height;)
+    {
+        const uint32_t count = std::min(cb.height - row, chunkSize ? chunkSize : 1 + Random() % 40);
+        const float* motionVectors = inputs.motionVectors ? inputs.motionVectors + (size_t)std::min(row << inputs.mipLevel, inputs.motionVectorHeight) * inputs.motionVectorPitch : NULL;
+        FFX_VariableShading_PushCpuStreamRows(&stream, &inputs.luminance[(size_t)row * inputs.luminancePitch], inputs.luminancePitch, motionVectors, inputs.motionVectorPitch, count,
+            [&](uint32_t tileRow, const uint8_t* rates)
+            {
+                ordered &= tileRow == nextTileRow++;
+                memcpy(&image[(size_t)tileRow * tilesX], rates, tilesX);
+            });
+        bounded &= (stream.luminance.size() <= windowSize) && (stream.inputs.rowCount <= stream.windowCapacity);
+        row += count;
+    }
+
+    Check(FFX_VariableShading_CpuStreamDone(&stream), "every tile row done", tileSize, inputs.mipLevel);
+    Check(ordered, "tile rows in order", tileSize, inputs.mipLevel);
+    Check(bounded, "window of tileSize + 2 * reach rows", tileSize, inputs.mipLevel);
+    Check(image == expected, "stream matches the whole image", tileSize, inputs.mipLevel);
+}
+
+int main()
+{
+    std::vector<float> luminance((size_t)WIDTH * HEIGHT);
+    for (float& texel : luminance)
+        texel = (float)(Random() % 1000) / 1000.0f * ((Random() % 4) ? 0.02f : 1.0f);
+
+    // large vertical motion reaches several tile rows up and down
+    const int32_t maxMotions[] = { 0, 4, 48 };
+    for (int32_t maxMotion : maxMotions)
+    {
+        const std::vector<float> motionVectors = MakeMotionVectors(maxMotion);
+        for (uint32_t tileSize = 8; tileSize <= 32; tileSize *= 2)
+        {
+            for (uint32_t mipLevel = 0; mipLevel <= FFX_VariableShading_GetMaxInputMipLevel(tileSize); ++mipLevel)
+            {
+                std::vector<float> level = luminance;
+                uint32_t levelWidth = WIDTH, levelHeight = HEIGHT;
+                for (uint32_t i = 0; i < mipLevel; ++i)
+                {
+                    const uint32_t nextWidth = FFX_VariableShading_DivideRoundingUp(levelWidth, 2), nextHeight = FFX_VariableShading_DivideRoundingUp(levelHeight, 2);
+                    std::vector<float> next((size_t)nextWidth * nextHeight);
+                    FFX_VariableShading_DownsampleLuminance(level.data(), levelWidth, levelHeight, levelWidth, next.data(), nextWidth);
+                    level.swap(next);
+                    levelWidth = nextWidth;
+                    levelHeight = nextHeight;
+                }
+
+                FFX_VariableShading_CB cb = {};
+                cb.width = WIDTH;
+                cb.height = HEIGHT;
+                cb.tileSize = tileSize;
+                cb.varianceCutoff = 0.05f;
+                cb.motionFactor = 0.1f;
+                FFX_VariableShading_SetInputMipLevel(&cb, mipLevel);
+
+                // the diamond of the GPU, and dilated diamonds and squares
+                for (uint32_t neighbourhood = 0; neighbourhood < 4; ++neighbourhood)
+                {
+                    FFX_VariableShading_CpuInputs inputs = {};
+                    inputs.luminance = level.data();
+                    inputs.luminancePitch = levelWidth;
+                    inputs.mipLevel = mipLevel;
+                    inputs.neighbourhoodShape = (neighbourhood & 1) ? FFX_VARIABLESHADING_NEIGHBOURHOOD_SQUARE : FFX_VARIABLESHADING_NEIGHBOURHOOD_DIAMOND;
+                    inputs.neighbourhoodRadius = neighbourhood ? 1 + neighbourhood / 2 * 2 : 1;
+                    if (maxMotion)
+                    {
+                        inputs.motionVectors = motionVectors.data();
+                        inputs.motionVectorPitch = WIDTH * 2;
+                        inputs.motionVectorWidth = WIDTH;
+                        inputs.motionVectorHeight = HEIGHT;
+                    }
+
+                    // in texels of the level, one more for the rounding of the reprojection
+                    const uint32_t maxMotionRows = ((uint32_t)maxMotion >> mipLevel) + 1;
+                    for (uint32_t additionalShadingRates = 0; additionalShadingRates < 2; ++additionalShadingRates)
+                    {
+                        const uint32_t chunkSizes[] = { 1, 0, levelHeight };
+                        for (uint32_t chunkSize : chunkSizes)
+                            TestStream(cb, inputs, additionalShadingRates != 0, maxMotionRows, chunkSize, tileSize);
+                    }
+                }
+            }
+        }
+    }
+
+    printf("%s\n", g_failures ? "test_cpu_stream FAILED" : "test_cpu_stream passed");
+    return g_failures ? 1 : 0;
+}
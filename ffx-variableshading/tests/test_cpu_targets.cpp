@@ -0,0 +1,162 @@
+// test_cpu_targets.cpp
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Every conversion of ffx_variable_shading_cpu_targets.h against tables computed by hand from one
+// 3x3 tile VRS image of a 48x40 surface (a partial last tile row): the fragment shading rate
+// attachment with non square texels, with all rates and with a device that lacks some, the
+// fragment density map and the separable rates of a Metal rasterization rate map. Texels smaller
+// than the tiles repeat them, and the padding of every pitch stays untouched.
+
+#include "ffx_variable_shading_cpu_targets.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static int g_failures = 0;
+
+static void Check(bool condition, const char* what)
+{
+    if (!condition)
+    {
+        printf("FAILED: %s\n", what);
+        ++g_failures;
+    }
+}
+
+static const uint8_t GUARD = 0xcd;
+
+#define RATE(x, y) FFX_VARIABLESHADING_RATE_##x##X##y
+
+static const uint32_t WIDTH = 48, HEIGHT = 40, TILE_SIZE = 16;
+
+// 3x3 tiles, pitch 5
+static const uint8_t g_vrsImage[3 * 5] =
+{
+    RATE(4, 4), RATE(2, 4), RATE(4, 4), GUARD, GUARD,
+    RATE(4, 2), RATE(4, 4), RATE(1, 2), GUARD, GUARD,
+    RATE(2, 4), RATE(4, 4), RATE(4, 4), GUARD, GUARD,
+};
+
+// rows of width bytes, pitch apart, with the padding untouched
+static bool RowsEqual(const std::vector<uint8_t>& target, uint32_t pitch, const uint8_t* expected, uint32_t width, uint32_t height)
+{
+    bool equal = true;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        equal &= memcmp(&target[(size_t)y * pitch], &expected[(size_t)y * width], width) == 0;
+        for (uint32_t x = width; x < pitch; ++x)
+            equal &= target[(size_t)y * pitch + x] == GUARD;
+    }
+    return equal;
+}
+
+static void TestFsrAttachment()
+{
+    // 32x16 texels: 2 texels per row, the first one over tile columns 0 and 1, the second over column 2
+    uint32_t attachmentWidth, attachmentHeight;
+    FFX_VariableShading_GetFsrAttachmentSize(WIDTH, HEIGHT, 32, 16, attachmentWidth, attachmentHeight);
+    Check((attachmentWidth == 2) && (attachmentHeight == 3), "attachment size of 32x16 texels");
+
+    const uint8_t all[3 * 2] =
+    {
+        RATE(2, 4), RATE(4, 4),
+        RATE(4, 2), RATE(1, 2),
+        RATE(2, 4), RATE(4, 4),
+    };
+    std::vector<uint8_t> attachment(3 * 4, GUARD);
+    FFX_VariableShading_ConvertToFsrAttachment(g_vrsImage, 5, WIDTH, HEIGHT, TILE_SIZE, 32, 16, FFX_VARIABLESHADING_SUPPORTED_RATES_ALL, attachment.data(), 4);
+    Check(RowsEqual(attachment, 4, all, 2, 3), "attachment with every rate supported");
+
+    // a device with 1x1, 2x1, 2x2 and 4x2: 2X4 falls back to 2X2, 4X4 to 4X2 and 1X2 to 1X1
+    const uint32_t supportedRates = FFX_VariableShading_GetFragmentSizeRateBit(1, 1) | FFX_VariableShading_GetFragmentSizeRateBit(2, 1) |
+        FFX_VariableShading_GetFragmentSizeRateBit(2, 2) | FFX_VariableShading_GetFragmentSizeRateBit(4, 2);
+    const uint8_t limited[3 * 2] =
+    {
+        RATE(2, 2), RATE(4, 2),
+        RATE(4, 2), RATE(1, 1),
+        RATE(2, 2), RATE(4, 2),
+    };
+    std::fill(attachment.begin(), attachment.end(), GUARD);
+    FFX_VariableShading_ConvertToFsrAttachment(g_vrsImage, 5, WIDTH, HEIGHT, TILE_SIZE, 32, 16, supportedRates, attachment.data(), 4);
+    Check(RowsEqual(attachment, 4, limited, 2, 3), "attachment of a device without every rate");
+
+    // of equally coarse supported rates the squarer one
+    const uint32_t squareOrNot = FFX_VariableShading_GetFragmentSizeRateBit(1, 4) | FFX_VariableShading_GetFragmentSizeRateBit(2, 2);
+    Check(FFX_VariableShading_GetSupportedRate(RATE(4, 4), squareOrNot) == RATE(2, 2), "2x2 over 1x4");
+    Check(FFX_VariableShading_GetSupportedRate(RATE(2, 4), squareOrNot) == RATE(2, 2), "2x4 falls back to 2x2");
+
+    // 8x8 texels repeat every tile 2x2 times, the last tile row is half covered
+    const uint32_t pitch = 7;
+    attachment.assign((size_t)pitch * 5, GUARD);
+    FFX_VariableShading_ConvertToFsrAttachment(g_vrsImage, 5, WIDTH, HEIGHT, TILE_SIZE, 8, 8, FFX_VARIABLESHADING_SUPPORTED_RATES_ALL, attachment.data(), pitch);
+    uint8_t repeated[5 * 6];
+    for (uint32_t y = 0; y < 5; ++y)
+    {
+        for (uint32_t x = 0; x < 6; ++x)
+            repeated[y * 6 + x] = g_vrsImage[(y / 2) * 5 + x / 2];
+    }
+    Check(RowsEqual(attachment, pitch, repeated, 6, 5), "8x8 texels repeat the tiles");
+}
+
+static void TestDensityMap()
+{
+    // 16x32 texels: 3 texels per row, the first row over tile rows 0 and 1, the second over row 2.
+    // R and G hold 255 / fragment size rounded up: 255, 128 or 64.
+    const uint8_t expected[2 * 6] =
+    {
+        64, 128,    128, 64,    255, 128,
+        128, 64,    64, 64,     64, 64,
+    };
+    std::vector<uint8_t> densityMap(2 * 8, GUARD);
+    FFX_VariableShading_ConvertToDensityMap(g_vrsImage, 5, WIDTH, HEIGHT, TILE_SIZE, 16, 32, densityMap.data(), 8);
+    Check(RowsEqual(densityMap, 8, expected, 6, 2), "density map of 16x32 texels");
+}
+
+static void TestSeparableRates()
+{
+    // finest x rate per tile column: 2X, 2X, 1X, finest y rate per tile row: 4X, 2X, 4X.
+    // 2 column zones of 24 pixels over tile columns 0-1 and 1-2, 5 row zones of 8 pixels.
+    const float expectedHorizontal[2] = { 0.5f, 1.0f };
+    const float expectedVertical[5] = { 0.25f, 0.25f, 0.5f, 0.5f, 0.25f };
+    float horizontal[3], vertical[6];
+    std::fill(horizontal, horizontal + 3, -1.0f);
+    std::fill(vertical, vertical + 6, -1.0f);
+    FFX_VariableShading_ComputeSeparableRates(g_vrsImage, 5, WIDTH, HEIGHT, TILE_SIZE, 2, 5, horizontal, vertical);
+    Check(memcmp(horizontal, expectedHorizontal, sizeof(expectedHorizontal)) == 0 && horizontal[2] == -1.0f, "horizontal zones");
+    Check(memcmp(vertical, expectedVertical, sizeof(expectedVertical)) == 0 && vertical[5] == -1.0f, "vertical zones");
+
+    // more zones than pixels: every zone at least one pixel
+    float fine[64], fineVertical[64];
+    FFX_VariableShading_ComputeSeparableRates(g_vrsImage, 5, WIDTH, HEIGHT, TILE_SIZE, 64, 64, fine, fineVertical);
+    bool covered = true;
+    for (uint32_t zone = 0; zone < 64; ++zone)
+        covered &= fine[zone] == ((zone * WIDTH / 64 < 32) ? 0.5f : 1.0f);
+    Check(covered, "zones narrower than a pixel");
+}
+
+int main()
+{
+    TestFsrAttachment();
+    TestDensityMap();
+    TestSeparableRates();
+
+    printf("%s\n", g_failures ? "test_cpu_targets FAILED" : "test_cpu_targets passed");
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,453 @@
+// AMD FidelityFX Variable Shading Sample code
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Timing of the CPU VRS image generator on the synthetic content of
+// ffx_variable_shading_cpu_synthetic.h, no captures or GPU needed. Every content
+// preset runs warmup + frames frames of its sequence through one generator context,
+// the frames are generated between the measurements and do not count.
+//
+// With --history the runs are appended to a JSON lines file (History.h), with --compare
+// every run is first tested against the recent runs of the same machine and config
+// (Compare.h) and the exit code is 2 when one of them is significantly slower.
+// With --transform the luminance transform of ffx_variable_shading_cpu_luminance.h
+// is applied to the input plane of every frame and timed with the generator.
+
+#include "Compare.h"
+
+#include "ffx_variable_shading_cpu_jobs.h"
+#include "ffx_variable_shading_cpu_luminance.h"
+#include "ffx_variable_shading_cpu_synthetic.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BenchmarkSettings
+{
+    uint32_t    width = 3840;
+    uint32_t    height = 2160;
+    uint32_t    frames = 64;
+    uint32_t    warmup = 4;
+    uint32_t    tileSize = 16;
+    bool        additionalShadingRates = false;
+    uint32_t    inputMipLevel = 0;
+    uint32_t    threadCount = 1;
+    uint32_t    luminanceTransform = FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_NONE;
+    float       varianceCutoff = 0.05f;
+    float       motionFactor = 0.05f;
+};
+
+struct BenchmarkResult
+{
+    std::string         content;
+    std::vector<double> milliseconds;   // of every measured frame
+    double              synthesisMs;    // average per frame, all threads
+    double              coarseFraction; // of the tiles over all measured frames
+};
+
+static void PrintUsage()
+{
+    printf(
+        "usage: FfxVariableShading_Benchmark [options]\n"
+        "\n"
+        "  --content NAME[,NAME...] synthetic content presets: typical, worst, flat (default: all)\n"
+        "  --resolution WxH        surface size (default 3840x2160)\n"
+        "  --frames N              measured frames per content (default 64)\n"
+        "  --warmup N              frames run before the measurement (default 4)\n"
+        "  --tile-size N           VRS tile size (default 16)\n"
+        "  --additional-rates      generate 2x4, 4x2 and 4x4 rates\n"
+        "  --mip N                 input mip level (FFX_VariableShading_SetInputMipLevel)\n"
+        "  --threshold T           vrsVarianceThreshold (default 0.05)\n"
+        "  --motion-factor M       vrsMotionFactor (default 0.05)\n"
+        "  --threads N             generator threads (default 1)\n"
+        "  --transform NAME        luminance transform: none, srgb, log2, pq, weber (default none)\n"
+        "  --history FILE          append the runs to FILE (JSON lines)\n"
+        "  --commit ID             commit recorded with the runs (default: git rev-parse --short HEAD)\n"
+        "  --compare               test the runs against the history of FILE, exit code 2 on a regression\n"
+        "  --baseline N            compare: runs of the history pooled into the baseline (default 5)\n"
+        "  --alpha A               compare: significance level of the Mann-Whitney test (default 0.01)\n"
+        "  --tolerance PCT         compare: median slowdowns up to PCT percent pass (default 2)\n"
+        );
+}
+
+// nearest rank percentile of sorted values
+static double GetPercentile(const std::vector<double>& sorted, double percentile)
+{
+    if (sorted.empty())
+        return 0.0;
+    size_t rank = (size_t)(percentile / 100.0 * (double)sorted.size() + 0.5);
+    return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+static bool RunContent(uint32_t preset, const BenchmarkSettings& settings, FFX_VariableShading_CpuThreadPool& pool, BenchmarkResult* pResult)
+{
+    const FFX_VariableShading_SyntheticContentDesc content = FFX_VariableShading_GetSyntheticPreset(preset, settings.width, settings.height);
+
+    FFX_VariableShading_CB cb = {};
+    cb.width = settings.width;
+    cb.height = settings.height;
+    cb.tileSize = settings.tileSize;
+    cb.varianceCutoff = settings.varianceCutoff;
+    cb.motionFactor = settings.motionFactor;
+    FFX_VariableShading_SetInputMipLevel(&cb, settings.inputMipLevel);
+
+    FFX_VariableShading_CpuContextDesc contextDesc = {};
+    contextDesc.cb = cb;
+    contextDesc.additionalShadingRates = settings.additionalShadingRates;
+    contextDesc.neighbourhoodShape = FFX_VARIABLESHADING_NEIGHBOURHOOD_DIAMOND;
+    contextDesc.neighbourhoodRadius = 1;
+    contextDesc.workerCount = std::min(settings.threadCount, FFX_VARIABLESHADING_CPU_CONTEXT_MAX_WORKERS);
+    contextDesc.allocateVrsImage = true;
+
+    FFX_VariableShading_CpuContext context;
+    if (!FFX_VariableShading_CreateCpuContext(&context, contextDesc, FFX_VariableShading_GetDefaultCpuAllocator()))
+        return false;
+
+    FFX_VariableShading_CpuGeneratorConfig config = FFX_VariableShading_GetDefaultCpuGeneratorConfig();
+    config.threadCount = contextDesc.workerCount;
+
+    const FFX_VariableShading_LuminanceTransformDesc transformDesc = FFX_VariableShading_GetDefaultLuminanceTransformDesc(settings.luminanceTransform);
+    std::vector<float> transformTable(FFX_VariableShading_GetLuminanceTableCount(transformDesc));
+    FFX_VariableShading_LuminanceTransform transform;
+    FFX_VariableShading_InitLuminanceTransform(&transform, transformDesc, transformTable.data());
+    std::vector<float> transformed;
+
+    // full resolution planes of the current and previous frame, the mip chain of the previous one
+    const size_t pixelCount = (size_t)settings.width * settings.height;
+    std::vector<float> luminance[2] = { std::vector<float>(pixelCount), std::vector<float>(pixelCount) };
+    std::vector<float> motionVectors(pixelCount * 2);
+    std::vector<float> mips[2];
+
+    const uint32_t bandHeight = 32;
+    const uint32_t bandCount = FFX_VariableShading_DivideRoundingUp(settings.height, bandHeight);
+    auto synthesize = [&](uint32_t frame)
+    {
+        float* lum = luminance[frame & 1].data();
+        pool.ParallelFor(bandCount, [&](uint32_t band)
+        {
+            const uint32_t firstRow = band * bandHeight;
+            const uint32_t rowCount = std::min(bandHeight, settings.height - firstRow);
+            FFX_VariableShading_GenerateSyntheticRows(content, frame, firstRow, rowCount, lum + (size_t)firstRow * settings.width, settings.width,
+                motionVectors.data() + (size_t)firstRow * settings.width * 2, settings.width * 2);
+        });
+    };
+
+    pResult->content = FFX_VariableShading_GetSyntheticPresetName(preset);
+    pResult->milliseconds.clear();
+    pResult->synthesisMs = 0.0;
+    uint64_t coarseTiles = 0, tiles = 0;
+
+    uint32_t firstTileX, firstTileY, tilesX, tilesY;
+    FFX_VariableShading_GetViewportTiles(&cb, firstTileX, firstTileY, tilesX, tilesY);
+
+    synthesize(0);
+    for (uint32_t frame = 1; frame <= settings.warmup + settings.frames; ++frame)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        synthesize(frame);
+
+        // the generator reprojects into the previous frame
+        const float* previous = luminance[(frame - 1) & 1].data();
+        uint32_t width = settings.width, height = settings.height;
+        for (uint32_t level = 0; level < settings.inputMipLevel; ++level)
+        {
+            std::vector<float>& mip = mips[level & 1];
+            mip.resize((size_t)((width + 1) / 2) * ((height + 1) / 2));
+            FFX_VariableShading_DownsampleLuminance(previous, width, height, width, mip.data(), (width + 1) / 2);
+            previous = mip.data();
+            width = (width + 1) / 2;
+            height = (height + 1) / 2;
+        }
+        pResult->synthesisMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        FFX_VariableShading_CpuInputs inputs = {};
+        inputs.luminance = previous;
+        inputs.luminancePitch = width;
+        inputs.motionVectors = motionVectors.data();
+        inputs.motionVectorPitch = settings.width * 2;
+        inputs.motionVectorWidth = settings.width;
+        inputs.motionVectorHeight = settings.height;
+        inputs.mipLevel = settings.inputMipLevel;
+        inputs.neighbourhoodShape = contextDesc.neighbourhoodShape;
+        inputs.neighbourhoodRadius = contextDesc.neighbourhoodRadius;
+
+        start = std::chrono::steady_clock::now();
+        if (settings.luminanceTransform != FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_NONE)
+        {
+            transformed.resize((size_t)width * height);
+            const uint32_t transformBandCount = FFX_VariableShading_DivideRoundingUp(height, bandHeight);
+            auto transformBand = [&](uint32_t band)
+            {
+                const uint32_t firstRow = band * bandHeight;
+                FFX_VariableShading_TransformLuminanceRows(transform, previous, width, width, height, firstRow, std::min(bandHeight, height - firstRow), transformed.data(), width);
+            };
+            if (config.threadCount > 1)
+                pool.ParallelFor(transformBandCount, transformBand);
+            else
+                for (uint32_t band = 0; band < transformBandCount; ++band)
+                    transformBand(band);
+            inputs.luminance = transformed.data();
+        }
+        if (config.threadCount > 1)
+        {
+            FFX_VariableShading_ThreadPoolParallelFor parallelFor = { &pool };
+            FFX_VariableShading_GenerateVrsImage(&context, cb, inputs, config, context.vrsImage, context.vrsImagePitch, parallelFor);
+        }
+        else
+        {
+            FFX_VariableShading_GenerateVrsImage(&context, cb, inputs, context.vrsImage, context.vrsImagePitch);
+        }
+        const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if (frame <= settings.warmup)
+            continue;
+
+        pResult->milliseconds.push_back(milliseconds);
+        for (uint32_t y = firstTileY; y < firstTileY + tilesY; ++y)
+        {
+            const uint8_t* row = context.vrsImage + (size_t)y * context.vrsImagePitch;
+            for (uint32_t x = firstTileX; x < firstTileX + tilesX; ++x)
+                coarseTiles += (row[x] != FFX_VARIABLESHADING_RATE_1X1);
+        }
+        tiles += (uint64_t)tilesX * tilesY;
+    }
+
+    pResult->synthesisMs /= (double)(settings.warmup + settings.frames);
+    pResult->coarseFraction = tiles ? (double)coarseTiles / (double)tiles : 0.0;
+
+    FFX_VariableShading_DestroyCpuContext(&context);
+    return true;
+}
+
+// everything that has to match for two runs to be comparable, besides the machine
+static std::string GetConfigString(const BenchmarkSettings& settings)
+{
+    char config[256];
+    snprintf(config, sizeof(config), "%ux%u tile %u mip %u rates %u threads %u frames %u threshold %g motion %g", settings.width, settings.height,
+        settings.tileSize, settings.inputMipLevel, settings.additionalShadingRates ? 1u : 0u, settings.threadCount, settings.frames,
+        settings.varianceCutoff, settings.motionFactor);
+    // runs without a transform keep the config of the runs from before the option
+    if (settings.luminanceTransform != FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_NONE)
+        return std::string(config) + " transform " + FFX_VariableShading_GetLuminanceTransformName(settings.luminanceTransform);
+    return config;
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkSettings settings;
+    CompareSettings compareSettings;
+    std::vector<uint32_t> presets;
+    std::string historyFile;
+    std::string commit;
+    bool compare = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const bool hasValue = (i + 1 < argc);
+
+        if (!strcmp(arg, "--content") && hasValue)
+        {
+            std::string list = argv[++i];
+            size_t begin = 0;
+            while (begin <= list.size())
+            {
+                const size_t end = std::min(list.find(',', begin), list.size());
+                const std::string name = list.substr(begin, end - begin);
+                uint32_t preset = 0;
+                while (preset < FFX_VARIABLESHADING_SYNTHETIC_PRESET_COUNT && name != FFX_VariableShading_GetSyntheticPresetName(preset))
+                    ++preset;
+                if (preset == FFX_VARIABLESHADING_SYNTHETIC_PRESET_COUNT)
+                {
+                    fprintf(stderr, "unknown content %s\n", name.c_str());
+                    return 1;
+                }
+                presets.push_back(preset);
+                begin = end + 1;
+            }
+        }
+        else if (!strcmp(arg, "--resolution") && hasValue)
+        {
+            if (sscanf(argv[++i], "%ux%u", &settings.width, &settings.height) != 2 || !settings.width || !settings.height)
+            {
+                fprintf(stderr, "invalid resolution %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (!strcmp(arg, "--frames") && hasValue)
+            settings.frames = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(arg, "--warmup") && hasValue)
+            settings.warmup = (uint32_t)std::max(0, atoi(argv[++i]));
+        else if (!strcmp(arg, "--tile-size") && hasValue)
+            settings.tileSize = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(arg, "--additional-rates"))
+            settings.additionalShadingRates = true;
+        else if (!strcmp(arg, "--mip") && hasValue)
+            settings.inputMipLevel = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(arg, "--threshold") && hasValue)
+            settings.varianceCutoff = (float)atof(argv[++i]);
+        else if (!strcmp(arg, "--motion-factor") && hasValue)
+            settings.motionFactor = (float)atof(argv[++i]);
+        else if (!strcmp(arg, "--threads") && hasValue)
+            settings.threadCount = (uint32_t)std::max(1, atoi(argv[++i]));
+        else if (!strcmp(arg, "--transform") && hasValue)
+        {
+            const char* name = argv[++i];
+            settings.luminanceTransform = 0;
+            while (settings.luminanceTransform < FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_COUNT && strcmp(name, FFX_VariableShading_GetLuminanceTransformName(settings.luminanceTransform)))
+                ++settings.luminanceTransform;
+            if (settings.luminanceTransform == FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_COUNT)
+            {
+                fprintf(stderr, "unknown transform %s\n", name);
+                return 1;
+            }
+        }
+        else if (!strcmp(arg, "--history") && hasValue)
+            historyFile = argv[++i];
+        else if (!strcmp(arg, "--commit") && hasValue)
+            commit = argv[++i];
+        else if (!strcmp(arg, "--compare"))
+            compare = true;
+        else if (!strcmp(arg, "--baseline") && hasValue)
+            compareSettings.baselineRuns = (uint32_t)std::max(1, atoi(argv[++i]));
+        else if (!strcmp(arg, "--alpha") && hasValue)
+            compareSettings.alpha = atof(argv[++i]);
+        else if (!strcmp(arg, "--tolerance") && hasValue)
+            compareSettings.tolerance = atof(argv[++i]) / 100.0;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (settings.tileSize != 8 && settings.tileSize != 16 && settings.tileSize != 32)
+    {
+        fprintf(stderr, "tile size has to be 8, 16 or 32\n");
+        return 1;
+    }
+
+    if (settings.inputMipLevel > FFX_VariableShading_GetMaxInputMipLevel(settings.tileSize))
+    {
+        fprintf(stderr, "input mip level %u needs tiles of at least %u pixels\n", settings.inputMipLevel, 8u << settings.inputMipLevel);
+        return 1;
+    }
+
+    if (compare && historyFile.empty())
+    {
+        fprintf(stderr, "--compare needs --history\n");
+        return 1;
+    }
+
+    std::vector<BenchmarkRecord> history;
+    if (!historyFile.empty() && !LoadBenchmarkHistory(historyFile, &history))
+    {
+        fprintf(stderr, "can't read %s\n", historyFile.c_str());
+        return 1;
+    }
+
+    if (presets.empty())
+    {
+        for (uint32_t preset = 0; preset < FFX_VARIABLESHADING_SYNTHETIC_PRESET_COUNT; ++preset)
+            presets.push_back(preset);
+    }
+
+    // the synthesis uses all cores even when the generator runs on one
+    FFX_VariableShading_CpuThreadPool pool(std::max(settings.threadCount, std::max(1u, std::thread::hardware_concurrency())));
+
+    printf("%ux%u, tile size %u, mip %u, %u generator thread(s), %u frames, transform %s\n", settings.width, settings.height, settings.tileSize, settings.inputMipLevel,
+        settings.threadCount, settings.frames, FFX_VariableShading_GetLuminanceTransformName(settings.luminanceTransform));
+    printf("  %-10s %9s %9s %9s %9s %9s %8s %10s\n", "content", "mean ms", "min", "p50", "p90", "p99", "coarse", "synth ms");
+
+    BenchmarkRecord common;
+    common.timestamp = (uint64_t)time(NULL);
+    common.commit = commit.empty() ? GetCurrentCommit() : commit;
+    common.machine = GetMachineFingerprint();
+    common.cpu = GetMachineDescription();
+    common.config = GetConfigString(settings);
+
+    std::vector<BenchmarkRecord> records;
+    for (uint32_t preset : presets)
+    {
+        BenchmarkResult result;
+        if (!RunContent(preset, settings, pool, &result))
+        {
+            fprintf(stderr, "can't create a generator context for %ux%u\n", settings.width, settings.height);
+            return 1;
+        }
+
+        std::vector<double> sorted = result.milliseconds;
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (double ms : sorted)
+            sum += ms;
+
+        BenchmarkRecord record = common;
+        record.content = result.content;
+        record.mean = sum / (double)sorted.size();
+        record.p50 = GetPercentile(sorted, 50.0);
+        record.p90 = GetPercentile(sorted, 90.0);
+        record.p99 = GetPercentile(sorted, 99.0);
+        record.coarse = result.coarseFraction;
+        record.samples = result.milliseconds;
+        records.push_back(record);
+
+        printf("  %-10s %9.3f %9.3f %9.3f %9.3f %9.3f %7.1f%% %10.2f\n", record.content.c_str(), record.mean, sorted.front(),
+            record.p50, record.p90, record.p99, 100.0 * record.coarse, result.synthesisMs);
+    }
+
+    int exitCode = 0;
+    if (compare)
+    {
+        printf("compared to the last %u runs of machine %s (%s)\n", compareSettings.baselineRuns, common.machine.c_str(), common.cpu.c_str());
+        for (BenchmarkRecord& record : records)
+        {
+            const CompareResult comparison = CompareToHistory(record, history, compareSettings);
+            if (!comparison.baselineRuns)
+            {
+                printf("  %-10s no baseline\n", record.content.c_str());
+                continue;
+            }
+
+            printf("  %-10s median %+6.2f%% [%+.2f%%, %+.2f%%]  p %.4f  %zu runs (%s)%s\n", record.content.c_str(), 100.0 * (comparison.medianRatio - 1.0),
+                100.0 * (comparison.ratioLow - 1.0), 100.0 * (comparison.ratioHigh - 1.0), comparison.pValue, comparison.baselineRuns,
+                comparison.baselineCommits.c_str(), comparison.regression ? "  REGRESSION" : "");
+            if (comparison.regression)
+            {
+                // appended flagged, so it does not become the baseline of the next run
+                record.regressed = true;
+                exitCode = 2;
+            }
+        }
+    }
+
+    if (!historyFile.empty() && !AppendBenchmarkRecords(historyFile, records))
+    {
+        fprintf(stderr, "can't write %s\n", historyFile.c_str());
+        return 1;
+    }
+
+    return exitCode;
+}
@@ -0,0 +1,142 @@
+// AMD FidelityFX Variable Shading Sample code
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "Compare.h"
+
+#include <algorithm>
+#include <cmath>
+
+double GetMedian(std::vector<double> values)
+{
+    if (values.empty())
+        return 0.0;
+
+    const size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + middle, values.end());
+    if (values.size() & 1)
+        return values[middle];
+    return 0.5 * (values[middle] + *std::max_element(values.begin(), values.begin() + middle));
+}
+
+double MannWhitneySlowerPValue(const std::vector<double>& current, const std::vector<double>& baseline)
+{
+    const size_t n1 = current.size();
+    const size_t n2 = baseline.size();
+    if (!n1 || !n2)
+        return 1.0;
+
+    // values tagged with their group, ranked with ties sharing the average rank
+    std::vector<std::pair<double, bool>> values;
+    values.reserve(n1 + n2);
+    for (double value : current)
+        values.push_back({ value, true });
+    for (double value : baseline)
+        values.push_back({ value, false });
+    std::sort(values.begin(), values.end());
+
+    const double n = (double)(n1 + n2);
+    double rankSum = 0.0;
+    double tieTerm = 0.0;
+    for (size_t i = 0; i < values.size();)
+    {
+        size_t j = i;
+        while (j < values.size() && values[j].first == values[i].first)
+            ++j;
+        const double rank = 0.5 * (double)(i + 1 + j);
+        for (size_t k = i; k < j; ++k)
+            rankSum += values[k].second ? rank : 0.0;
+        const double t = (double)(j - i);
+        tieTerm += t * t * t - t;
+        i = j;
+    }
+
+    const double u = rankSum - 0.5 * (double)n1 * (double)(n1 + 1);
+    const double mean = 0.5 * (double)n1 * (double)n2;
+    const double variance = (double)n1 * (double)n2 / 12.0 * ((n + 1.0) - tieTerm / (n * (n - 1.0)));
+    if (variance <= 0.0)
+        return 1.0;
+
+    // continuity corrected, large U means the current run is slower
+    const double z = (u - mean - 0.5) / std::sqrt(variance);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+CompareResult CompareToHistory(const BenchmarkRecord& current, const std::vector<BenchmarkRecord>& history, const CompareSettings& settings)
+{
+    CompareResult result;
+
+    std::vector<const BenchmarkRecord*> runs;
+    for (auto it = history.rbegin(); it != history.rend() && runs.size() < settings.baselineRuns; ++it)
+    {
+        if (!it->regressed && it->machine == current.machine && it->config == current.config && it->content == current.content)
+            runs.push_back(&*it);
+    }
+    if (runs.empty() || current.samples.empty())
+        return result;
+
+    const double currentMedian = GetMedian(current.samples);
+    result.slowerThanEveryRun = true;
+
+    std::vector<double> baseline;
+    for (auto it = runs.rbegin(); it != runs.rend(); ++it)
+    {
+        result.slowerThanEveryRun &= (currentMedian > GetMedian((*it)->samples));
+        baseline.insert(baseline.end(), (*it)->samples.begin(), (*it)->samples.end());
+        result.baselineCommits += (result.baselineCommits.empty() ? "" : ",") + (*it)->commit;
+    }
+    result.baselineRuns = runs.size();
+    result.baselineSamples = baseline.size();
+
+    const double baselineMedian = GetMedian(baseline);
+    result.medianRatio = (baselineMedian > 0.0) ? currentMedian / baselineMedian : 1.0;
+    result.pValue = MannWhitneySlowerPValue(current.samples, baseline);
+
+    // percentile bootstrap, both groups resampled independently
+    uint32_t state = settings.seed ? settings.seed : 1;
+    auto random = [&state](size_t count)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (size_t)((uint64_t)state * count >> 32);
+    };
+
+    std::vector<double> ratios;
+    std::vector<double> a(current.samples.size()), b(baseline.size());
+    for (uint32_t i = 0; i < settings.resamples; ++i)
+    {
+        for (double& value : a)
+            value = current.samples[random(current.samples.size())];
+        for (double& value : b)
+            value = baseline[random(baseline.size())];
+        const double median = GetMedian(b);
+        if (median > 0.0)
+            ratios.push_back(GetMedian(a) / median);
+    }
+    if (!ratios.empty())
+    {
+        std::sort(ratios.begin(), ratios.end());
+        const double tail = 0.5 * (1.0 - settings.confidence);
+        result.ratioLow = ratios[(size_t)(tail * (double)(ratios.size() - 1))];
+        result.ratioHigh = ratios[(size_t)((1.0 - tail) * (double)(ratios.size() - 1))];
+    }
+
+    result.regression = (result.pValue < settings.alpha) && (result.ratioLow > 1.0) && (result.medianRatio > 1.0 + settings.tolerance) && result.slowerThanEveryRun;
+    return result;
+}
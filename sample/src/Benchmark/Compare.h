@@ -0,0 +1,63 @@
+// AMD FidelityFX Variable Shading Sample code
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "History.h"
+
+// Comparison of a run against the recent history of the same machine, config and content.
+//
+// The baseline pools the samples of the last baselineRuns matching runs that were not flagged
+// as a regression themselves (otherwise rerunning a regressed build would hide it), so run to run
+// noise (frequency scaling, other processes) widens it. A run is a regression when
+//   - the one sided Mann-Whitney U test rejects "not slower" at alpha,
+//   - the bootstrap confidence interval of the median ratio lies above 1, and
+//   - the median ratio exceeds 1 + tolerance, and
+//   - the median is above the median of every baseline run.
+// Frames of one run are not independent (clocks and cache state drift between runs),
+// the last two conditions keep the frame level tests from failing on that drift and
+// on differences nobody cares about.
+struct CompareSettings
+{
+    uint32_t    baselineRuns = 5;
+    double      alpha = 0.01;
+    double      tolerance = 0.02;
+    double      confidence = 0.99;  // of the bootstrap interval
+    uint32_t    resamples = 2000;
+    uint32_t    seed = 1;
+};
+
+struct CompareResult
+{
+    size_t      baselineRuns = 0;   // 0: nothing to compare with
+    size_t      baselineSamples = 0;
+    std::string baselineCommits;    // oldest to newest, comma separated
+    double      medianRatio = 1.0;  // current / baseline, > 1 is slower
+    double      ratioLow = 1.0;     // bootstrap confidence interval of medianRatio
+    double      ratioHigh = 1.0;
+    double      pValue = 1.0;       // P(U >= observed) if the current run is not slower
+    bool        slowerThanEveryRun = false;
+    bool        regression = false;
+};
+
+// one sided p-value for "current is slower than baseline", normal approximation with tie correction
+double MannWhitneySlowerPValue(const std::vector<double>& current, const std::vector<double>& baseline);
+double GetMedian(std::vector<double> values);
+
+CompareResult CompareToHistory(const BenchmarkRecord& current, const std::vector<BenchmarkRecord>& history, const CompareSettings& settings);
@@ -0,0 +1,121 @@
+// AMD FidelityFX Variable Shading Sample code
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Deterministic checks of the statistics in Compare.cpp on known identical and shifted
+// distributions, run by ctest.
+
+#include "Compare.h"
+
+#include <stdio.h>
+#include <cmath>
+
+static int g_failures = 0;
+
+static void Check(bool condition, const char* what)
+{
+    if (!condition)
+    {
+        printf("FAILED: %s\n", what);
+        ++g_failures;
+    }
+}
+
+// count frame times around ms, +-4% spread by a fixed xorshift sequence
+static std::vector<double> MakeSamples(size_t count, double ms, uint32_t seed)
+{
+    std::vector<double> samples(count);
+    for (double& sample : samples)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        sample = ms * (0.96 + 0.08 * (double)seed / 4294967296.0);
+    }
+    return samples;
+}
+
+static BenchmarkRecord MakeRecord(const std::string& commit, std::vector<double> samples)
+{
+    BenchmarkRecord record;
+    record.commit = commit;
+    record.machine = "machine";
+    record.config = "config";
+    record.content = "typical";
+    record.samples = std::move(samples);
+    return record;
+}
+
+int main()
+{
+    // medians, even counts take the mean of the middle pair
+    Check(GetMedian({ 3.0, 1.0, 2.0 }) == 2.0, "median of an odd count");
+    Check(GetMedian({ 4.0, 1.0, 3.0, 2.0 }) == 2.5, "median of an even count");
+
+    // {4,5,6} against {1,2,3}: U = 9, mean 4.5, variance 5.25, z = 4 / sqrt(5.25) with continuity correction
+    const double expected = 0.5 * std::erfc(4.0 / std::sqrt(5.25) / std::sqrt(2.0));
+    Check(std::fabs(MannWhitneySlowerPValue({ 4.0, 5.0, 6.0 }, { 1.0, 2.0, 3.0 }) - expected) < 1e-12, "Mann-Whitney p-value of a known case");
+    Check(MannWhitneySlowerPValue({ 1.0, 2.0, 3.0 }, { 4.0, 5.0, 6.0 }) > 0.9, "Mann-Whitney: faster is not slower");
+    Check(MannWhitneySlowerPValue({ 2.0, 2.0 }, { 2.0, 2.0 }) == 1.0, "Mann-Whitney: all ties");
+
+    const std::vector<double> baseline = MakeSamples(200, 2.0, 1);
+    Check(MannWhitneySlowerPValue(baseline, baseline) > 0.4, "Mann-Whitney: identical distributions");
+    Check(MannWhitneySlowerPValue(MakeSamples(200, 2.0, 7), baseline) > 0.01, "Mann-Whitney: same distribution, other draw");
+    Check(MannWhitneySlowerPValue(MakeSamples(200, 2.2, 7), baseline) < 1e-6, "Mann-Whitney: 10% slower");
+
+    std::vector<BenchmarkRecord> history;
+    for (uint32_t run = 0; run < 5; ++run)
+        history.push_back(MakeRecord("run" + std::to_string(run), MakeSamples(100, 2.0, 11 + run)));
+
+    CompareSettings settings;
+    const CompareResult same = CompareToHistory(MakeRecord("same", MakeSamples(100, 2.0, 99)), history, settings);
+    Check(same.baselineRuns == 5 && same.baselineSamples == 500, "baseline pools the last runs");
+    Check(!same.regression, "same distribution is no regression");
+    Check(same.ratioLow <= 1.0 && same.ratioHigh >= 1.0, "bootstrap interval of the same distribution contains 1");
+
+    const CompareResult slower = CompareToHistory(MakeRecord("slower", MakeSamples(100, 2.2, 99)), history, settings);
+    Check(slower.regression, "10% slower is a regression");
+    Check(slower.ratioLow > 1.05 && slower.ratioHigh < 1.15 && std::fabs(slower.medianRatio - 1.1) < 0.02, "bootstrap interval around the 10% shift");
+
+    const CompareResult again = CompareToHistory(MakeRecord("slower", MakeSamples(100, 2.2, 99)), history, settings);
+    Check(again.ratioLow == slower.ratioLow && again.ratioHigh == slower.ratioHigh, "bootstrap is deterministic for a seed");
+
+    const CompareResult faster = CompareToHistory(MakeRecord("faster", MakeSamples(100, 1.8, 99)), history, settings);
+    Check(!faster.regression, "faster is no regression");
+
+    // a flagged run is no baseline, so the regression is found again on the next run
+    BenchmarkRecord flagged = MakeRecord("slower", MakeSamples(100, 2.2, 99));
+    flagged.regressed = true;
+    history.push_back(flagged);
+    const CompareResult rerun = CompareToHistory(MakeRecord("slower", MakeSamples(100, 2.2, 123)), history, settings);
+    Check(rerun.baselineCommits.find("slower") == std::string::npos, "flagged runs are excluded from the baseline");
+    Check(rerun.regression, "rerun of a regressed build is still a regression");
+
+    Check(CompareToHistory(MakeRecord("other", MakeSamples(10, 2.0, 5)), {}, settings).baselineRuns == 0, "no history, no baseline");
+
+    // the flag survives the history file
+    const std::string fileName = "CompareTest_history.jsonl";
+    remove(fileName.c_str());
+    std::vector<BenchmarkRecord> loaded;
+    Check(AppendBenchmarkRecords(fileName, { history.front(), flagged }) && LoadBenchmarkHistory(fileName, &loaded), "history file round trip");
+    Check(loaded.size() == 2 && !loaded[0].regressed && loaded[1].regressed, "regressed flag round trip");
+    remove(fileName.c_str());
+
+    printf("%s\n", g_failures ? "CompareTest FAILED" : "CompareTest passed");
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,256 @@
+// AMD FidelityFX Variable Shading Sample code
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "History.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define popen _popen
+#define pclose _pclose
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+static std::string GetCpuBrand()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 0x80000000);
+    if ((unsigned)info[0] >= 0x80000004u)
+    {
+        char brand[49] = {};
+        for (int i = 0; i < 3; ++i)
+            __cpuid((int*)(brand + 16 * i), 0x80000002 + i);
+        return brand;
+    }
+#elif defined(__x86_64__) || defined(__i386__)
+    unsigned info[4];
+    if (__get_cpuid_max(0x80000000u, NULL) >= 0x80000004u)
+    {
+        char brand[49] = {};
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            __get_cpuid(0x80000002u + i, &info[0], &info[1], &info[2], &info[3]);
+            memcpy(brand + 16 * i, info, sizeof(info));
+        }
+        return brand;
+    }
+#elif defined(__linux__)
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line))
+    {
+        if (!line.compare(0, 10, "model name") || !line.compare(0, 8, "Hardware") || !line.compare(0, 9, "CPU part"))
+            return line.substr(line.find(':') + 1);
+    }
+#endif
+    return "unknown cpu";
+}
+
+std::string GetMachineDescription()
+{
+    std::string cpu = GetCpuBrand();
+    const size_t first = cpu.find_first_not_of(' ');
+    cpu = (first == std::string::npos) ? std::string() : cpu.substr(first, cpu.find_last_not_of(' ') - first + 1);
+
+    char description[256];
+    snprintf(description, sizeof(description), "%s, %u threads, %s, %s", cpu.c_str(), std::thread::hardware_concurrency(),
+#if defined(_WIN32)
+        "windows",
+#elif defined(__linux__)
+        "linux",
+#elif defined(__APPLE__)
+        "macos",
+#else
+        "unknown os",
+#endif
+#if defined(_MSC_VER)
+        ("msvc " + std::to_string(_MSC_VER)).c_str()
+#elif defined(__clang__)
+        "clang " __clang_version__
+#elif defined(__GNUC__)
+        "gcc " __VERSION__
+#else
+        "unknown compiler"
+#endif
+        );
+    return description;
+}
+
+std::string GetMachineFingerprint()
+{
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : GetMachineDescription())
+    {
+        hash ^= (uint8_t)c;
+        hash *= 0x100000001b3ull;
+    }
+    char text[17];
+    snprintf(text, sizeof(text), "%016llx", (unsigned long long)hash);
+    return text;
+}
+
+std::string GetCurrentCommit()
+{
+#if defined(_WIN32)
+    FILE* pipe = popen("git rev-parse --short HEAD 2>NUL", "r");
+#else
+    FILE* pipe = popen("git rev-parse --short HEAD 2>/dev/null", "r");
+#endif
+    if (!pipe)
+        return "unknown";
+
+    char commit[64] = {};
+    const bool read = fgets(commit, sizeof(commit), pipe) != NULL;
+    const bool succeeded = (pclose(pipe) == 0) && read;
+    commit[strcspn(commit, "\r\n")] = 0;
+    return (succeeded && commit[0]) ? commit : "unknown";
+}
+
+//--------------------------------------------------------------------------------------//
+// JSON lines, only the subset written by AppendBenchmarkRecords                        //
+//--------------------------------------------------------------------------------------//
+static std::string EscapeString(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        if ((unsigned char)c >= 0x20)
+            escaped += c;
+    }
+    return escaped;
+}
+
+// position after "key": or NULL
+static const char* FindValue(const std::string& line, const char* key)
+{
+    const std::string pattern = std::string("\"") + key + "\":";
+    const size_t position = line.find(pattern);
+    return (position == std::string::npos) ? NULL : line.c_str() + position + pattern.size();
+}
+
+static bool ReadString(const std::string& line, const char* key, std::string* pValue)
+{
+    const char* p = FindValue(line, key);
+    if (!p || *p++ != '"')
+        return false;
+
+    pValue->clear();
+    for (; *p && *p != '"'; ++p)
+    {
+        if (*p == '\\' && p[1])
+            ++p;
+        *pValue += *p;
+    }
+    return *p == '"';
+}
+
+static bool ReadNumber(const std::string& line, const char* key, double* pValue)
+{
+    const char* p = FindValue(line, key);
+    if (!p)
+        return false;
+
+    char* end;
+    *pValue = strtod(p, &end);
+    return end != p;
+}
+
+static bool ReadNumbers(const std::string& line, const char* key, std::vector<double>* pValues)
+{
+    const char* p = FindValue(line, key);
+    if (!p || *p++ != '[')
+        return false;
+
+    pValues->clear();
+    while (*p && *p != ']')
+    {
+        char* end;
+        const double value = strtod(p, &end);
+        if (end == p)
+            return false;
+        pValues->push_back(value);
+        p = end;
+        if (*p == ',')
+            ++p;
+    }
+    return *p == ']';
+}
+
+bool LoadBenchmarkHistory(const std::string& fileName, std::vector<BenchmarkRecord>* pRecords)
+{
+    pRecords->clear();
+    std::ifstream f(fileName);
+    if (!f)
+        return true;
+
+    std::string line;
+    while (std::getline(f, line))
+    {
+        BenchmarkRecord record;
+        double timestamp = 0.0;
+        if (ReadNumber(line, "timestamp", &timestamp) &&
+            ReadString(line, "commit", &record.commit) &&
+            ReadString(line, "machine", &record.machine) &&
+            ReadString(line, "config", &record.config) &&
+            ReadString(line, "content", &record.content) &&
+            ReadNumbers(line, "samples", &record.samples) && !record.samples.empty())
+        {
+            record.timestamp = (uint64_t)timestamp;
+            ReadString(line, "cpu", &record.cpu);
+            ReadNumber(line, "mean", &record.mean);
+            ReadNumber(line, "p50", &record.p50);
+            ReadNumber(line, "p90", &record.p90);
+            ReadNumber(line, "p99", &record.p99);
+            ReadNumber(line, "coarse", &record.coarse);
+            record.regressed = (line.find("\"regressed\":true") != std::string::npos);
+            pRecords->push_back(record);
+        }
+    }
+    return !f.bad();
+}
+
+bool AppendBenchmarkRecords(const std::string& fileName, const std::vector<BenchmarkRecord>& records)
+{
+    FILE* f = fopen(fileName.c_str(), "a");
+    if (!f)
+        return false;
+
+    for (const BenchmarkRecord& record : records)
+    {
+        fprintf(f, "{\"timestamp\":%llu,\"commit\":\"%s\",\"machine\":\"%s\",\"cpu\":\"%s\",\"config\":\"%s\",\"content\":\"%s\","
+            "\"mean\":%.6g,\"p50\":%.6g,\"p90\":%.6g,\"p99\":%.6g,\"coarse\":%.4f,\"samples\":[",
+            (unsigned long long)record.timestamp, EscapeString(record.commit).c_str(), EscapeString(record.machine).c_str(), EscapeString(record.cpu).c_str(),
+            EscapeString(record.config).c_str(), EscapeString(record.content).c_str(), record.mean, record.p50, record.p90, record.p99, record.coarse);
+        for (size_t i = 0; i < record.samples.size(); ++i)
+            fprintf(f, "%s%.6g", i ? "," : "", record.samples[i]);
+        fprintf(f, "]%s}\n", record.regressed ? ",\"regressed\":true" : "");
+    }
+
+    return fclose(f) == 0;
+}
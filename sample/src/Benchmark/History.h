@@ -0,0 +1,60 @@
+// AMD FidelityFX Variable Shading Sample code
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// One benchmark run of one content preset, a line of the history file.
+//
+// The history is JSON lines, appended to and never rewritten, so it can live
+// next to the build and be merged with cat:
+//   {"timestamp":1700000000,"commit":"f8b16a9","machine":"3c1f...","cpu":"...","config":"3840x2160 tile 16 ...",
+//    "content":"typical","mean":1.9,"p50":1.8,"p90":2.1,"p99":2.4,"coarse":0.47,"samples":[1.8,1.9,...]}
+// Runs are comparable when machine, config and content match. Runs flagged as a regression
+// get "regressed":true, they stay in the file but are no baseline for later runs.
+struct BenchmarkRecord
+{
+    uint64_t            timestamp = 0;  // seconds since the epoch
+    std::string         commit;
+    std::string         machine;        // GetMachineFingerprint
+    std::string         cpu;            // GetMachineDescription, for people reading the file
+    std::string         config;
+    std::string         content;
+    double              mean = 0.0;
+    double              p50 = 0.0;
+    double              p90 = 0.0;
+    double              p99 = 0.0;
+    double              coarse = 0.0;   // fraction of coarse tiles
+    std::vector<double> samples;        // frame times in ms
+    bool                regressed = false;  // CompareToHistory found a regression, excluded from baselines
+};
+
+// CPU brand, logical cores, OS and compiler
+std::string GetMachineDescription();
+// hash of GetMachineDescription, 16 hex digits
+std::string GetMachineFingerprint();
+// git rev-parse --short HEAD in the working directory, "unknown" without git
+std::string GetCurrentCommit();
+
+// lines that don't parse are skipped, a missing file is an empty history
+bool LoadBenchmarkHistory(const std::string& fileName, std::vector<BenchmarkRecord>* pRecords);
+bool AppendBenchmarkRecords(const std::string& fileName, const std::vector<BenchmarkRecord>& records);
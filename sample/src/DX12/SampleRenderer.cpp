@@ -58,6 +58,7 @@ void SampleRenderer::OnCreate(Device* pDevice, SwapChain* pSwapChain)
 
     // initialize the GPU time stamps module
     m_gpuTimer.OnCreate(pDevice, backBufferCount);
+    m_traceGpuTrack = FFX_VariableShading_TraceRegisterTrack("GPU");
 
     // Quick helper to upload resources, it has it's own commandList and uses suballocation.
     // for 4K textures we'll need 100Megs
@@ -102,6 +103,7 @@ void SampleRenderer::OnCreate(Device* pDevice, SwapChain* pSwapChain)
     // Create tonemapping pass
     m_toneMappingPS.OnCreate(pDevice, &m_resourceViewHeaps, &m_constantBufferRing, &m_vidMemBufferPool, pSwapChain->GetFormat());
     m_toneMappingCS.OnCreate(pDevice, &m_resourceViewHeaps, &m_constantBufferRing);
+    m_softwareVrsToneMapping.OnCreate(pDevice, &m_resourceViewHeaps, &m_constantBufferRing);
     m_colorConversionPS.OnCreate(pDevice, &m_resourceViewHeaps, &m_constantBufferRing, &m_vidMemBufferPool, pSwapChain->GetFormat());
 
     // Initialize UI rendering resources
@@ -109,7 +111,7 @@ void SampleRenderer::OnCreate(Device* pDevice, SwapChain* pSwapChain)
 
     // initialize VRS generation CS
     m_variableShadingCode.OnCreate(pDevice, &m_resourceViewHeaps, &m_constantBufferRing, &m_vidMemBufferPool, pSwapChain->GetFormat());
-    m_resourceViewHeaps.AllocCBV_SRV_UAVDescriptor(2, &m_variableShadingInputsSRV);
+    m_resourceViewHeaps.AllocCBV_SRV_UAVDescriptor(3, &m_variableShadingInputsSRV);
     m_resourceViewHeaps.AllocRTVDescriptor(1, &m_oldBackBufferRTV);
     m_resourceViewHeaps.AllocCBV_SRV_UAVDescriptor(1, &m_oldBackBufferSRV);
 
@@ -132,6 +134,7 @@ void SampleRenderer::OnDestroy()
 
     m_imGUI.OnDestroy();
     m_colorConversionPS.OnDestroy();
+    m_softwareVrsToneMapping.OnDestroy();
     m_toneMappingCS.OnDestroy();
     m_toneMappingPS.OnDestroy();
     m_taa.OnDestroy();
@@ -193,6 +196,8 @@ void SampleRenderer::OnCreateWindowSizeDependentResources(SwapChain* pSwapChain,
     m_imGUI.UpdatePipeline((pSwapChain->GetDisplayMode() == DISPLAYMODE_SDR) ? pSwapChain->GetFormat() : m_gBuffer.m_HDR.GetFormat());
 
     m_variableShadingCode.OnCreateWindowSizeDependentResources(Width, Height);
+    m_linearVrsInput = (pSwapChain->GetDisplayMode() != DISPLAYMODE_SDR);
+    SetVrsLuminanceTransform(m_vrsLuminanceTransform);
 
     CD3DX12_RESOURCE_DESC RDesc = CD3DX12_RESOURCE_DESC::Tex2D((pSwapChain->GetDisplayMode() == DISPLAYMODE_SDR) ? DXGI_FORMAT_R8G8B8A8_UNORM : m_gBuffer.m_HDR.GetFormat(), Width, Height, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
     m_oldBackBuffer.InitRenderTarget(m_device, "OldBackbuffer", &RDesc, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
@@ -201,9 +206,28 @@ void SampleRenderer::OnCreateWindowSizeDependentResources(SwapChain* pSwapChain,
 
     m_oldBackBuffer.CreateSRV(0, &m_variableShadingInputsSRV);
     m_gBuffer.m_MotionVectors.CreateSRV(1, &m_variableShadingInputsSRV);
+    m_downSample.GetTexture()->CreateSRV(2, &m_variableShadingInputsSRV);
 }
 
 
+//--------------------------------------------------------------------------------------
+//
+// SetVrsLuminanceTransform
+//
+//--------------------------------------------------------------------------------------
+void SampleRenderer::SetVrsLuminanceTransform(int transform)
+{
+    m_vrsLuminanceTransform = transform;
+
+    // automatic: the SDR copy is already perceptual, the linear HDR copy gets sRGB encoded
+    uint32_t luminanceTransform = (uint32_t)(transform - 1);
+    if (transform == 0)
+    {
+        luminanceTransform = m_linearVrsInput ? FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_SRGB : FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_NONE;
+    }
+    m_variableShadingCode.SetLuminanceTransform(luminanceTransform, m_linearVrsInput);
+}
+
 //--------------------------------------------------------------------------------------
 //
 // OnDestroyWindowSizeDependentResources
@@ -444,6 +468,25 @@ void SampleRenderer::OnRender(State* pState, SwapChain* pSwapChain)
 
     m_gpuTimer.GetTimeStampUser({ "time (s)", pState->m_time });
 
+    // The timings are those of the frame submitted backBufferCount frames ago. The GPU timer only
+    // reports the duration of each pass, so the passes go back to back on the GPU track starting at
+    // the CPU time that frame was submitted.
+    uint64_t& traceSubmitTicks = m_traceSubmitTicks[m_traceFrameIndex++ % backBufferCount];
+    if (FFX_VariableShading_TraceRecording() && traceSubmitTicks != 0)
+    {
+        const double ticksPerMicrosecond = FFX_VariableShading_GetTimestampFrequency() / 1000000.0;
+        uint64_t start = traceSubmitTicks;
+        for (const TimeStamp& timeStamp : m_timeStamps)
+        {
+            if (timeStamp.m_label == "time (s)" || timeStamp.m_label == "Total GPU Time")
+                continue;
+
+            uint64_t end = start + (uint64_t)(timeStamp.m_microseconds * ticksPerMicrosecond);
+            FFX_VariableShading_TraceComplete(FFX_VariableShading_TraceInternString(timeStamp.m_label), "GPU", start, end, m_traceGpuTrack);
+            start = end;
+        }
+    }
+
     if (pState->m_useTAA)
     {
         static uint32_t Seed;
@@ -567,10 +610,17 @@ void SampleRenderer::OnRender(State* pState, SwapChain* pSwapChain)
             // Generate VRS rate image
             {
                 m_variableShadingCode.SetAdditionalShadingRatesAllowed(pState->m_allowAdditionalVrsRates);
+                m_variableShadingCode.SetCappedImageEnabled(pState->m_capTransparentVrsRates);
                 m_variableShadingCode.SetVarianceThreshold(pState->m_vrsVarianceThreshold);
                 m_variableShadingCode.SetMotionFactor(pState->m_vrsMotionFactor);
-
-                if (pState->m_vrsImageCombiner != 0)
+                m_variableShadingCode.SetTier1EmulationEnabled(pState->m_emulateShadingRateImage);
+                m_variableShadingCode.SetTileListsEnabled(pState->m_softwareVrsToneMapping && pState->m_softwareVrsTileLists);
+                m_variableShadingCode.SetTileStatsEnabled(pState->m_encoderQpMap);
+                m_variableShadingCode.SetInputMipLevel(pState->m_vrsInputMipLevel);
+                m_variableShadingCode.SetDilation((uint32_t)pState->m_vrsDilationShape, (uint32_t)pState->m_vrsDilationRadius);
+                m_variableShadingCode.SetOverlayPreview(pState->m_vrsOverlayTileSize ? 4u << pState->m_vrsOverlayTileSize : 0, (uint32_t)pState->m_vrsOverlayScale);
+
+                if ((pState->m_vrsImageCombiner != 0) || m_variableShadingCode.Tier1Emulation())
                 {
                     UserMarker marker(pCmdLst1, "Generate VRS Image");
 
@@ -578,6 +628,7 @@ void SampleRenderer::OnRender(State* pState, SwapChain* pSwapChain)
                         CD3DX12_RESOURCE_BARRIER barriers[] = {
                         CD3DX12_RESOURCE_BARRIER::Transition(m_gBuffer.m_HDR.GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
                         CD3DX12_RESOURCE_BARRIER::Transition(m_gBuffer.m_MotionVectors.GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+                        CD3DX12_RESOURCE_BARRIER::Transition(m_downSample.GetTexture()->GetResource(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
                         };
                         pCmdLst1->ResourceBarrier(ARRAYSIZE(barriers), barriers);
                     }
@@ -585,8 +636,23 @@ void SampleRenderer::OnRender(State* pState, SwapChain* pSwapChain)
                     // generate VRS map for the frame:
                     //   analyze blocks for variance
                     //   will result in feedback loop for still images (lower shading rate=> less variance)
+                    //   with an input mip level > 0 the previous frame's bloom downsample chain is read instead of the copy
                     m_variableShadingCode.ComputeVrsMap(pCmdLst1, &m_variableShadingInputsSRV);
 
+                    pCmdLst1->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_downSample.GetTexture()->GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+
+                    // Tier 1 can't bind the VRS image: read it back to derive per draw shading rates
+                    if (m_variableShadingCode.Tier1Emulation())
+                    {
+                        m_variableShadingCode.ReadbackVrsMap(pCmdLst1);
+                    }
+
+                    // per macroblock QP offsets for a video encoder, derived from the same analysis
+                    if (m_variableShadingCode.TileStats())
+                    {
+                        m_variableShadingCode.ReadbackTileStats(pCmdLst1);
+                    }
+
                     {
                         CD3DX12_RESOURCE_BARRIER barriers[] = {
                             CD3DX12_RESOURCE_BARRIER::Transition(m_gBuffer.m_HDR.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET),
@@ -610,6 +676,9 @@ void SampleRenderer::OnRender(State* pState, SwapChain* pSwapChain)
             // 
             {
                 m_renderPassForward.BeginPass(pCmdLst1, true);
+                // Cauldron's batch lists don't carry screen space bounds, so the sample uses the
+                // viewport as the draw rectangle; engines pass each draw's projected bounding rectangle
+                m_variableShadingCode.SetDrawShadingRate(m_variableShadingCode.GetDrawShadingRate(m_rectScissor), pCmdLst1);
                 m_gltfPBR->DrawBatchList(pCmdLst1, &m_shadowMapSRV, &opaque);
                 m_gpuTimer.GetTimeStamp(pCmdLst1, "PBR Forward");
                 m_renderPassForward.EndPass();
@@ -652,10 +721,15 @@ void SampleRenderer::OnRender(State* pState, SwapChain* pSwapChain)
             {
                 m_renderPassForward.BeginPass(pCmdLst1, false);
 
+                // blended surfaces show coarse rates more, they use the rates capped at 2x2
+                m_variableShadingCode.BindCappedVrsImage(pCmdLst1, true);
+
                 std::sort(transparent.begin(), transparent.end());
                 m_gltfPBR->DrawBatchList(pCmdLst1, &m_shadowMapSRV, &transparent);
                 m_gpuTimer.GetTimeStamp(pCmdLst1, "PBR Transparent");
 
+                m_variableShadingCode.BindCappedVrsImage(pCmdLst1, false);
+
                 m_renderPassForward.EndPass();
             }
         }
@@ -735,11 +809,35 @@ void SampleRenderer::OnRender(State* pState, SwapChain* pSwapChain)
             D3D12_RESOURCE_BARRIER hdrToUAV = CD3DX12_RESOURCE_BARRIER::Transition(m_gBuffer.m_HDR.GetResource(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
             pCmdLst1->ResourceBarrier(1, &hdrToUAV);
 
-            m_toneMappingCS.Draw(pCmdLst1, &m_gBuffer.m_HDRUAV, pState->m_exposure, pState->m_toneMapper, m_width, m_height);
+            if (pState->m_softwareVrsToneMapping && SoftwareVrsToneMappingSupported())
+            {
+                // evaluate one sample per coarse pixel of the VRS image
+                m_variableShadingCode.VrsMapStateBarrier(pCmdLst1, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                if (m_variableShadingCode.TileListsValid())
+                {
+                    // only launch threadgroups for tiles of each rate, no per pixel rate lookup
+                    m_softwareVrsToneMapping.DrawTileLists(pCmdLst1, &m_gBuffer.m_HDRUAV, &m_variableShadingCode, pState->m_exposure, pState->m_toneMapper, m_width, m_height, pState->m_showSoftwareVrsDifference);
+                }
+                else
+                {
+                    m_softwareVrsToneMapping.Draw(pCmdLst1, &m_gBuffer.m_HDRUAV, m_variableShadingCode.GetSRV(), pState->m_exposure, pState->m_toneMapper, m_width, m_height, m_variableShadingCode.TileSize(), pState->m_showSoftwareVrsDifference);
+                }
+                m_gpuTimer.GetTimeStamp(pCmdLst1, "Tone mapping (SW VRS)");
+            }
+            else
+            {
+                m_toneMappingCS.Draw(pCmdLst1, &m_gBuffer.m_HDRUAV, pState->m_exposure, pState->m_toneMapper, m_width, m_height);
+            }
         }
 
         // Copy Backbuffer for next frame--------------------------------------------------
+        // (not needed when the VRS image is generated from the downsample chain)
         //
+        if (m_variableShadingCode.InputMipLevel() > 0)
+        {
+            pCmdLst1->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_gBuffer.m_HDR.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+        }
+        else
         {
             D3D12_RESOURCE_BARRIER preResolve[2] = {
                 CD3DX12_RESOURCE_BARRIER::Transition(m_gBuffer.m_HDR.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE),
@@ -786,6 +884,7 @@ void SampleRenderer::OnRender(State* pState, SwapChain* pSwapChain)
     // submit command buffer #1
     ThrowIfFailed(pCmdLst1->Close());
     ID3D12CommandList* CmdListList1[] = { pCmdLst1 };
+    traceSubmitTicks = FFX_VariableShading_ReadTimestamp();
     m_device->GetGraphicsQueue()->ExecuteCommandLists(1, CmdListList1);
 
     // Wait for swapchain (we are going to render to it) -----------------------------------
@@ -822,7 +921,9 @@ void SampleRenderer::OnRender(State* pState, SwapChain* pSwapChain)
         }
 
         // Copy Backbuffer for next frame--------------------------------------------------
+        // (not needed when the VRS image is generated from the downsample chain)
         //
+        if (m_variableShadingCode.InputMipLevel() == 0)
         {
             D3D12_RESOURCE_BARRIER preResolve[2] = {
                 CD3DX12_RESOURCE_BARRIER::Transition(pSwapChain->GetCurrentBackBufferResource(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE),
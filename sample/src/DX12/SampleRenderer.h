@@ -28,6 +28,7 @@ static const int backBufferCount = 3;
 using namespace CAULDRON_DX12;
 
 #include "VariableShadingCode.h"
+#include "SoftwareVrsToneMapping.h"
 
 //
 // This class deals with the GPU side of the sample.
@@ -71,9 +72,21 @@ public:
         bool                m_enableShadingRateImage;
         float               m_vrsVarianceThreshold;
         float               m_vrsMotionFactor;
+        int                 m_vrsInputMipLevel;
+        int                 m_vrsLuminanceTransform;    // 0: automatic, otherwise FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_* + 1
+        int                 m_vrsDilationRadius;
+        int                 m_vrsDilationShape;
+        int                 m_vrsOverlayTileSize;
+        int                 m_vrsOverlayScale;
 
         bool                m_showVRSMap;
         bool                m_allowAdditionalVrsRates;
+        bool                m_capTransparentVrsRates;
+        bool                m_emulateShadingRateImage;
+        bool                m_softwareVrsToneMapping;
+        bool                m_showSoftwareVrsDifference;
+        bool                m_softwareVrsTileLists;
+        bool                m_encoderQpMap;
         int                 m_hideUI;
     };
 
@@ -96,6 +109,11 @@ public:
     D3D12_VARIABLE_SHADING_RATE_TIER GetVrsTier() { return m_variableShadingCode.SupportedTier(); }
     bool AdditionalShadingRates() { return m_variableShadingCode.AdditionalShadingRates(); }
     bool AdditionalShadingRatesSupported() { return m_variableShadingCode.AdditionalShadingRatesSupported(); }
+    uint32_t GetMaxVrsInputMipLevel() { return m_variableShadingCode.MaxInputMipLevel(); }
+    // State::m_vrsLuminanceTransform, recompiles the VRS image generation shaders, the GPU has to be idle
+    void SetVrsLuminanceTransform(int transform);
+    const std::vector<float>& GetEncoderQpOffsets() { return m_variableShadingCode.GetQpOffsets(); }
+    bool SoftwareVrsToneMappingSupported() { return m_variableShadingCode.SupportedTier() > D3D12_VARIABLE_SHADING_RATE_TIER_NOT_SUPPORTED; }
 
 private:
     Device*                         m_device;
@@ -105,6 +123,8 @@ private:
     D3D12_VIEWPORT                  m_viewport;
     D3D12_RECT                      m_rectScissor;
     bool                            m_hasTAA = false;
+    int                             m_vrsLuminanceTransform = 0;
+    bool                            m_linearVrsInput = false;   // the copy of the previous frame is linear in the HDR display modes
 
     // Initialize helper classes
     ResourceViewHeaps               m_resourceViewHeaps;
@@ -148,6 +168,7 @@ private:
     // VRS resources
     int                             m_lastVrsImageCombiner = -1;
     VariableShadingCode             m_variableShadingCode;
+    SoftwareVrsToneMapping          m_softwareVrsToneMapping;
     CBV_SRV_UAV                     m_variableShadingInputsSRV;
 
     Texture                         m_oldBackBuffer;
@@ -160,6 +181,11 @@ private:
 
     std::vector<TimeStamp>          m_timeStamps;
 
+    // timeline trace, CPU timestamp of the first submit of the last backBufferCount frames
+    uint32_t                        m_traceGpuTrack = 0;
+    uint32_t                        m_traceFrameIndex = 0;
+    uint64_t                        m_traceSubmitTicks[backBufferCount] = {};
+
     SaveTexture                     m_saveTexture;
     AsyncPool                       m_asyncPool;
 };
@@ -0,0 +1,199 @@
+// AMD FidelityFX Variable Shading Sample code
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "stdafx.h"
+#include "base\Device.h"
+#include "base\DynamicBufferRing.h"
+#include "base\Helper.h"
+
+#include "SoftwareVrsToneMapping.h"
+
+void SoftwareVrsToneMapping::OnCreate(Device* pDevice, ResourceViewHeaps* pResourceViewHeaps, DynamicBufferRing* pConstantBufferRing)
+{
+    TRACED;
+    m_pDevice = pDevice;
+    m_resourceViewHeaps = pResourceViewHeaps;
+    m_constantBufferRing = pConstantBufferRing;
+
+    // generate root Signature
+    {
+        CD3DX12_DESCRIPTOR_RANGE DescRange[4];
+        CD3DX12_ROOT_PARAMETER RTSlot[4];
+
+        // constant buffer
+        int parameterCount = 0;
+        DescRange[parameterCount].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
+        RTSlot[parameterCount++].InitAsConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_ALL);
+
+        // HDR color buffer, tonemapped in place
+        DescRange[parameterCount].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0);
+        RTSlot[parameterCount].InitAsDescriptorTable(1, &DescRange[parameterCount], D3D12_SHADER_VISIBILITY_ALL);
+        ++parameterCount;
+
+        // VRS image
+        DescRange[parameterCount].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+        RTSlot[parameterCount].InitAsDescriptorTable(1, &DescRange[parameterCount], D3D12_SHADER_VISIBILITY_ALL);
+        ++parameterCount;
+
+        // tile lists
+        DescRange[parameterCount].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1);
+        RTSlot[parameterCount].InitAsDescriptorTable(1, &DescRange[parameterCount], D3D12_SHADER_VISIBILITY_ALL);
+        ++parameterCount;
+
+        CD3DX12_ROOT_SIGNATURE_DESC descRootSignature = CD3DX12_ROOT_SIGNATURE_DESC();
+        descRootSignature.NumParameters = parameterCount;
+        descRootSignature.pParameters = RTSlot;
+        descRootSignature.NumStaticSamplers = 0;
+        descRootSignature.pStaticSamplers = nullptr;
+        descRootSignature.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+
+        ID3DBlob* pOutBlob, * pErrorBlob = NULL;
+
+        HRESULT hr = D3D12SerializeRootSignature(&descRootSignature, D3D_ROOT_SIGNATURE_VERSION_1, &pOutBlob, &pErrorBlob);
+        if (FAILED(hr))
+        {
+            Trace("Compilation failed with errors:\n%hs\n", (const char*)pErrorBlob->GetBufferPointer());
+        }
+
+        ThrowIfFailed(
+            m_pDevice->GetDevice()->CreateRootSignature(0, pOutBlob->GetBufferPointer(), pOutBlob->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature))
+        );
+        SetName(m_rootSignature, std::string("SoftwareVrsToneMappingRootSignature"));
+
+        pOutBlob->Release();
+        if (pErrorBlob)
+            pErrorBlob->Release();
+    }
+
+    D3D12_SHADER_BYTECODE shaderByteCode;
+    CompileShaderFromFile("SoftwareVrsToneMappingCS.hlsl", NULL, "mainCS", "-T cs_6_0", &shaderByteCode);
+
+    D3D12_COMPUTE_PIPELINE_STATE_DESC descPso = {};
+    descPso.CS = shaderByteCode;
+    descPso.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+    descPso.pRootSignature = m_rootSignature;
+    descPso.NodeMask = 0;
+
+    ThrowIfFailed(
+        m_pDevice->GetDevice()->CreateComputePipelineState(&descPso, IID_PPV_ARGS(&m_pipeline))
+    );
+    SetName(m_pipeline, "SoftwareVrsToneMappingPipeline");
+
+    CompileShaderFromFile("SoftwareVrsToneMappingCS.hlsl", NULL, "mainTileListCS", "-T cs_6_0", &shaderByteCode);
+    descPso.CS = shaderByteCode;
+
+    ThrowIfFailed(
+        m_pDevice->GetDevice()->CreateComputePipelineState(&descPso, IID_PPV_ARGS(&m_tileListPipeline))
+    );
+    SetName(m_tileListPipeline, "SoftwareVrsToneMappingTileListPipeline");
+}
+
+void SoftwareVrsToneMapping::OnDestroy()
+{
+    TRACED;
+
+    if (m_pipeline)
+    {
+        m_pipeline->Release();
+        m_pipeline = NULL;
+    }
+
+    if (m_tileListPipeline)
+    {
+        m_tileListPipeline->Release();
+        m_tileListPipeline = NULL;
+    }
+
+    if (m_rootSignature)
+    {
+        m_rootSignature->Release();
+        m_rootSignature = NULL;
+    }
+}
+
+void SoftwareVrsToneMapping::Draw(ID3D12GraphicsCommandList* pCmdLst, CBV_SRV_UAV* pHDRUAV, CBV_SRV_UAV* pVrsImageSRV, float exposure, int toneMapper, uint32_t width, uint32_t height, uint32_t tileSize, bool showDifference)
+{
+    TRACED;
+    assert(pCmdLst != nullptr);
+
+    UserMarker marker(pCmdLst, "SoftwareVrsToneMapping");
+
+    ToneMappingConsts* data;
+    D3D12_GPU_VIRTUAL_ADDRESS constantBuffer;
+    m_constantBufferRing->AllocConstantBuffer(sizeof(ToneMappingConsts), (void**)&data, &constantBuffer);
+    data->exposure = exposure;
+    data->toneMapper = toneMapper;
+    data->width = width;
+    data->height = height;
+    data->tileSize = tileSize;
+    data->showDifference = showDifference ? 1 : 0;
+
+    ID3D12DescriptorHeap* pSrvHeap = m_resourceViewHeaps->GetCBV_SRV_UAVHeap();
+    pCmdLst->SetDescriptorHeaps(1, &pSrvHeap);
+    pCmdLst->SetComputeRootSignature(m_rootSignature);
+
+    int params = 0;
+    pCmdLst->SetComputeRootConstantBufferView(params++, constantBuffer);
+    pCmdLst->SetComputeRootDescriptorTable(params++, pHDRUAV->GetGPU());
+    pCmdLst->SetComputeRootDescriptorTable(params++, pVrsImageSRV->GetGPU());
+
+    pCmdLst->SetPipelineState(m_pipeline);
+
+    uint32_t w = 0;
+    uint32_t h = 0;
+    FFX_VariableShading_SoftwareVrs_GetDispatchInfo(width, height, w, h);
+    pCmdLst->Dispatch(w, h, 1);
+}
+
+// one indirect dispatch per rate class, the shading rate is a constant for each of them
+void SoftwareVrsToneMapping::DrawTileLists(ID3D12GraphicsCommandList* pCmdLst, CBV_SRV_UAV* pHDRUAV, VariableShadingCode* pVariableShading, float exposure, int toneMapper, uint32_t width, uint32_t height, bool showDifference)
+{
+    TRACED;
+    assert(pCmdLst != nullptr);
+    assert(pVariableShading->TileListsValid());
+
+    UserMarker marker(pCmdLst, "SoftwareVrsToneMappingTileLists");
+
+    ID3D12DescriptorHeap* pSrvHeap = m_resourceViewHeaps->GetCBV_SRV_UAVHeap();
+    pCmdLst->SetDescriptorHeaps(1, &pSrvHeap);
+    pCmdLst->SetComputeRootSignature(m_rootSignature);
+    pCmdLst->SetComputeRootDescriptorTable(1, pHDRUAV->GetGPU());
+    pCmdLst->SetComputeRootDescriptorTable(2, pVariableShading->GetSRV()->GetGPU());
+    pCmdLst->SetComputeRootDescriptorTable(3, pVariableShading->GetTileListsSRV()->GetGPU());
+    pCmdLst->SetPipelineState(m_tileListPipeline);
+
+    for (uint32_t rateClass = 0; rateClass < FFX_VARIABLESHADING_RATE_CLASS_COUNT; ++rateClass)
+    {
+        ToneMappingConsts* data;
+        D3D12_GPU_VIRTUAL_ADDRESS constantBuffer;
+        m_constantBufferRing->AllocConstantBuffer(sizeof(ToneMappingConsts), (void**)&data, &constantBuffer);
+        data->exposure = exposure;
+        data->toneMapper = toneMapper;
+        data->width = width;
+        data->height = height;
+        data->tileSize = pVariableShading->TileSize();
+        data->showDifference = showDifference ? 1 : 0;
+        data->shadingRate = FFX_VariableShading_GetRateFromClass(rateClass);
+        data->tileListOffset = rateClass * pVariableShading->TileListCapacity();
+
+        pCmdLst->SetComputeRootConstantBufferView(0, constantBuffer);
+        pVariableShading->DispatchTileList(pCmdLst, rateClass);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+// AMD FidelityFX Variable Shading Sample code
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include "VariableShadingCode.h"
+
+#define FFX_CPP
+#include "ffx_variable_shading_software.h"
+
+//
+// In place compute tonemapping driven by the VRS image (software VRS), see ffx_variable_shading_software.h
+// With showDifference set it outputs the magnified difference to full rate tonemapping instead.
+// DrawTileLists dispatches indirectly once per rate class over the tile lists of the VRS image.
+//
+class SoftwareVrsToneMapping
+{
+public:
+    void OnCreate(Device* pDevice, ResourceViewHeaps* pResourceViewHeaps, DynamicBufferRing* pConstantBufferRing);
+    void OnDestroy();
+
+    void Draw(ID3D12GraphicsCommandList* pCmdLst, CBV_SRV_UAV* pHDRUAV, CBV_SRV_UAV* pVrsImageSRV, float exposure, int toneMapper, uint32_t width, uint32_t height, uint32_t tileSize, bool showDifference);
+    void DrawTileLists(ID3D12GraphicsCommandList* pCmdLst, CBV_SRV_UAV* pHDRUAV, VariableShadingCode* pVariableShading, float exposure, int toneMapper, uint32_t width, uint32_t height, bool showDifference);
+
+private:
+    Device*                     m_pDevice = nullptr;
+    ResourceViewHeaps*          m_resourceViewHeaps = nullptr;
+    DynamicBufferRing*          m_constantBufferRing = nullptr;
+
+    ID3D12RootSignature*        m_rootSignature = nullptr;
+    ID3D12PipelineState*        m_pipeline = nullptr;
+    ID3D12PipelineState*        m_tileListPipeline = nullptr;
+
+    struct ToneMappingConsts
+    {
+        float       exposure;
+        int         toneMapper;
+        int         width, height;
+        uint32_t    tileSize;
+        uint32_t    showDifference;
+        uint32_t    shadingRate;
+        uint32_t    tileListOffset;
+    };
+};
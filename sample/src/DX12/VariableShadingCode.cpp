@@ -66,17 +66,38 @@ void VariableShadingCode::OnCreate(
             }
         }
 
-        if (m_vrsInfo.VariableShadingRateTier > D3D12_VARIABLE_SHADING_RATE_TIER_1)
+        if (VrsImageSupported())
         {
             CreateVRSImageGenerationPipeline();
 
             CreateOverlayPipeline(overlayOutputFormat);
+
+            CreateDilationPipeline();
+
+            CreateDownsamplePipeline();
+
+            // ExecuteIndirect over the tile list dispatch arguments
+            D3D12_INDIRECT_ARGUMENT_DESC argumentDesc = {};
+            argumentDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
+
+            D3D12_COMMAND_SIGNATURE_DESC signatureDesc = {};
+            signatureDesc.ByteStride = sizeof(D3D12_DISPATCH_ARGUMENTS);
+            signatureDesc.NumArgumentDescs = 1;
+            signatureDesc.pArgumentDescs = &argumentDesc;
+            ThrowIfFailed(
+                m_pDevice->GetDevice()->CreateCommandSignature(&signatureDesc, NULL, IID_PPV_ARGS(&m_tileListCommandSignature))
+            );
+            SetName(m_tileListCommandSignature, "VRSTileListCommandSignature");
         }
     }
 
     m_cpuVisibleHeap.AllocDescriptor(1, &m_vrsImageUavCpuVisible);
-    m_resourceViewHeaps->AllocCBV_SRV_UAVDescriptor(1, &m_vrsImageUav);
+    m_resourceViewHeaps->AllocCBV_SRV_UAVDescriptor(5, &m_vrsImageUav);
     m_resourceViewHeaps->AllocCBV_SRV_UAVDescriptor(1, &m_vrsImageSrv);
+    m_resourceViewHeaps->AllocCBV_SRV_UAVDescriptor(1, &m_tileListsSrv);
+    m_resourceViewHeaps->AllocCBV_SRV_UAVDescriptor(3, &m_dilationUav);
+    m_resourceViewHeaps->AllocCBV_SRV_UAVDescriptor(1, &m_previewImageUav);
+    m_resourceViewHeaps->AllocCBV_SRV_UAVDescriptor(1, &m_previewImageSrv);
 }
 
 void VariableShadingCode::OnCreateWindowSizeDependentResources(uint32_t Width, uint32_t Height)
@@ -84,8 +105,9 @@ void VariableShadingCode::OnCreateWindowSizeDependentResources(uint32_t Width, u
     TRACED;
     m_width = Width;
     m_height = Height;
+    SetRenderViewport(0, 0, Width, Height);
 
-    if (SupportedTier() > D3D12_VARIABLE_SHADING_RATE_TIER_1)
+    if (VrsImageSupported())
     {
         // Recreate VRS image
         m_vrsImageWidth = FFX_VariableShading_DivideRoundingUp(m_width, TileSize());
@@ -97,15 +119,176 @@ void VariableShadingCode::OnCreateWindowSizeDependentResources(uint32_t Width, u
         m_vrsImage.CreateUAV(0, &m_vrsImageUavCpuVisible);
         m_vrsImage.CreateUAV(0, &m_vrsImageUav);
         m_vrsImage.CreateSRV(0, &m_vrsImageSrv);
+        m_vrsImage.CreateUAV(0, &m_dilationUav);
+
+        // Dilation scratch images, large enough for the padded domain of any radius
+        CD3DX12_RESOURCE_DESC RDescDilation = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8_UINT,
+            m_vrsImageWidth + 2 * FFX_VARIABLESHADING_DILATION_MAX_PADDING, m_vrsImageHeight + 2 * FFX_VARIABLESHADING_DILATION_MAX_PADDING,
+            1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        for (uint32_t i = 0; i < 2; ++i)
+        {
+            m_dilationImageStates[i] = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+            m_dilationImages[i].InitRenderTarget(m_pDevice, "VRSDilationImage", &RDescDilation, m_dilationImageStates[i]);
+            m_dilationImages[i].CreateUAV(1 + i, &m_dilationUav);
+        }
+
+        // Overlay preview image
+        CD3DX12_RESOURCE_DESC RDescPreview = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8_UINT,
+            FFX_VariableShading_DivideRoundingUp(m_width, MinPreviewTileSize), FFX_VariableShading_DivideRoundingUp(m_height, MinPreviewTileSize),
+            1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        m_previewImageState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+        m_previewImage.InitRenderTarget(m_pDevice, "VRSPreviewImage", &RDescPreview, m_previewImageState);
+        m_previewImage.CreateUAV(0, &m_previewImageUav);
+        m_previewImage.CreateSRV(0, &m_previewImageSrv);
+
+        // Tile lists: one list per rate class, each large enough to hold every tile
+        m_tileListArgumentsState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+        ThrowIfFailed(
+            m_pDevice->GetDevice()->CreateCommittedResource(
+                &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+                D3D12_HEAP_FLAG_NONE,
+                &CD3DX12_RESOURCE_DESC::Buffer(FFX_VARIABLESHADING_RATE_CLASS_COUNT * sizeof(D3D12_DISPATCH_ARGUMENTS), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+                m_tileListArgumentsState,
+                NULL,
+                IID_PPV_ARGS(&m_tileListArguments))
+        );
+        SetName(m_tileListArguments, "VRSTileListArguments");
+
+        m_tileListsState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+        ThrowIfFailed(
+            m_pDevice->GetDevice()->CreateCommittedResource(
+                &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+                D3D12_HEAP_FLAG_NONE,
+                &CD3DX12_RESOURCE_DESC::Buffer(FFX_VARIABLESHADING_RATE_CLASS_COUNT * TileListCapacity() * sizeof(uint32_t), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+                m_tileListsState,
+                NULL,
+                IID_PPV_ARGS(&m_tileLists))
+        );
+        SetName(m_tileLists, "VRSTileLists");
+
+        // raw view of the arguments, so the shader can InterlockedAdd the thread group counts
+        D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+        uavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+        uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+        uavDesc.Buffer.NumElements = FFX_VARIABLESHADING_RATE_CLASS_COUNT * sizeof(D3D12_DISPATCH_ARGUMENTS) / sizeof(uint32_t);
+        uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_RAW;
+        m_pDevice->GetDevice()->CreateUnorderedAccessView(m_tileListArguments, NULL, &uavDesc, m_vrsImageUav.GetCPU(1));
+
+        uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+        uavDesc.Buffer.NumElements = FFX_VARIABLESHADING_RATE_CLASS_COUNT * TileListCapacity();
+        uavDesc.Buffer.StructureByteStride = sizeof(uint32_t);
+        uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+        m_pDevice->GetDevice()->CreateUnorderedAccessView(m_tileLists, NULL, &uavDesc, m_vrsImageUav.GetCPU(2));
+
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srvDesc.Buffer.NumElements = FFX_VARIABLESHADING_RATE_CLASS_COUNT * TileListCapacity();
+        srvDesc.Buffer.StructureByteStride = sizeof(uint32_t);
+        m_pDevice->GetDevice()->CreateShaderResourceView(m_tileLists, &srvDesc, m_tileListsSrv.GetCPU());
+        m_tileListsValid = false;
+
+        // Tile stats plane and its readback buffers
+        CD3DX12_RESOURCE_DESC RDescTileStats = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32G32B32A32_FLOAT, m_vrsImageWidth, m_vrsImageHeight, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        m_tileStatsState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+        m_tileStats.InitRenderTarget(m_pDevice, "VRSTileStats", &RDescTileStats, m_tileStatsState);
+        m_tileStats.CreateUAV(3, &m_vrsImageUav);
+
+        // Capped VRS image
+        m_cappedVrsImageState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+        m_cappedVrsImage.InitRenderTarget(m_pDevice, "VRSImageCapped", &RDescVrsImage, m_cappedVrsImageState);
+        m_cappedVrsImage.CreateUAV(4, &m_vrsImageUav);
+
+        UINT64 readbackSize = 0;
+        RDescTileStats.Flags = D3D12_RESOURCE_FLAG_NONE;
+        m_pDevice->GetDevice()->GetCopyableFootprints(&RDescTileStats, 0, 1, 0, &m_tileStatsReadbackFootprint, NULL, NULL, &readbackSize);
+
+        for (uint32_t i = 0; i < ReadbackBufferCount; ++i)
+        {
+            ThrowIfFailed(
+                m_pDevice->GetDevice()->CreateCommittedResource(
+                    &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+                    D3D12_HEAP_FLAG_NONE,
+                    &CD3DX12_RESOURCE_DESC::Buffer(readbackSize),
+                    D3D12_RESOURCE_STATE_COPY_DEST,
+                    NULL,
+                    IID_PPV_ARGS(&m_tileStatsReadback[i]))
+            );
+            SetName(m_tileStatsReadback[i], "VRSTileStatsReadback");
+            m_tileStatsReadbackValid[i] = false;
+        }
+        m_tileStatsReadbackIndex = 0;
+        m_qpOffsets.clear();
+    }
+
+    if (SupportedTier() == D3D12_VARIABLE_SHADING_RATE_TIER_1)
+    {
+        // Readback buffers for Tier 1 emulation, one per frame in flight
+        UINT64 readbackSize = 0;
+        CD3DX12_RESOURCE_DESC RDescVrsImage = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8_UINT, m_vrsImageWidth, m_vrsImageHeight, 1, 1);
+        m_pDevice->GetDevice()->GetCopyableFootprints(&RDescVrsImage, 0, 1, 0, &m_vrsImageReadbackFootprint, NULL, NULL, &readbackSize);
+
+        for (uint32_t i = 0; i < ReadbackBufferCount; ++i)
+        {
+            ThrowIfFailed(
+                m_pDevice->GetDevice()->CreateCommittedResource(
+                    &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+                    D3D12_HEAP_FLAG_NONE,
+                    &CD3DX12_RESOURCE_DESC::Buffer(readbackSize),
+                    D3D12_RESOURCE_STATE_COPY_DEST,
+                    NULL,
+                    IID_PPV_ARGS(&m_vrsImageReadback[i]))
+            );
+            SetName(m_vrsImageReadback[i], "VRSImageReadback");
+            m_vrsImageReadbackValid[i] = false;
+        }
+        m_vrsImageReadbackIndex = 0;
+        m_rateQueryValid = false;
     }
 }
 
 void VariableShadingCode::OnDestroyWindowSizeDependentResources()
 {
     TRACED;
-    if (SupportedTier() > D3D12_VARIABLE_SHADING_RATE_TIER_1)
+    if (VrsImageSupported())
     {
         m_vrsImage.OnDestroy();
+        m_tileStats.OnDestroy();
+        m_cappedVrsImage.OnDestroy();
+        m_dilationImages[0].OnDestroy();
+        m_dilationImages[1].OnDestroy();
+        m_previewImage.OnDestroy();
+    }
+
+    for (uint32_t i = 0; i < ReadbackBufferCount; ++i)
+    {
+        if (m_tileStatsReadback[i])
+        {
+            m_tileStatsReadback[i]->Release();
+            m_tileStatsReadback[i] = NULL;
+        }
+    }
+
+    if (m_tileListArguments)
+    {
+        m_tileListArguments->Release();
+        m_tileListArguments = NULL;
+    }
+
+    if (m_tileLists)
+    {
+        m_tileLists->Release();
+        m_tileLists = NULL;
+    }
+
+    for (uint32_t i = 0; i < ReadbackBufferCount; ++i)
+    {
+        if (m_vrsImageReadback[i])
+        {
+            m_vrsImageReadback[i]->Release();
+            m_vrsImageReadback[i] = NULL;
+        }
     }
 }
 
@@ -119,14 +302,7 @@ void VariableShadingCode::OnDestroy()
         m_vrsImageGenerationRootSignature = NULL;
     }
 
-    for (int i = 0; i < 2; ++i)
-    {
-        if (m_vrsImageGenerationPipelines[i])
-        {
-            m_vrsImageGenerationPipelines[i]->Release();;
-            m_vrsImageGenerationPipelines[i] = NULL;
-        }
-    }
+    DestroyVRSImageGenerationPipelineStates();
 
     if (m_vrsOverlayRootSignature)
     {
@@ -140,19 +316,59 @@ void VariableShadingCode::OnDestroy()
         m_vrsOverlayPipeline = NULL;
     }
 
+    if (m_tileListCommandSignature)
+    {
+        m_tileListCommandSignature->Release();
+        m_tileListCommandSignature = NULL;
+    }
+
+    if (m_dilationRootSignature)
+    {
+        m_dilationRootSignature->Release();
+        m_dilationRootSignature = NULL;
+    }
+
+    if (m_dilationLinePipeline)
+    {
+        m_dilationLinePipeline->Release();
+        m_dilationLinePipeline = NULL;
+    }
+
+    if (m_dilationPlusPipeline)
+    {
+        m_dilationPlusPipeline->Release();
+        m_dilationPlusPipeline = NULL;
+    }
+
+    if (m_downsampleRootSignature)
+    {
+        m_downsampleRootSignature->Release();
+        m_downsampleRootSignature = NULL;
+    }
+
+    if (m_downsamplePipeline)
+    {
+        m_downsamplePipeline->Release();
+        m_downsamplePipeline = NULL;
+    }
+
     m_cpuVisibleHeap.OnDestroy();
 }
 
 // This function creates the VRS image generation pipeline(s)
-// m_vrsImageGenerationPipelines[0] does not support additional shading rates.
+// m_vrsImageGenerationPipelines[mip][0] does not support additional shading rates.
 // If the hardware supports additional shading rates, then
-// m_vrsImageGenerationPipelines[1] generates a VRS image using them
+// m_vrsImageGenerationPipelines[mip][1] generates a VRS image using them
+// m_vrsImageGenerationPipelines[mip][i | 2] additionally write the per rate tile lists
+// m_vrsImageGenerationPipelines[mip][i | 4] additionally write the tile stats plane
+// m_vrsImageGenerationPipelines[mip][i | 8] (additional shading rates only) additionally write the capped VRS image
+// mip is the input mip level, the tile size in texels of that level is TileSize() >> mip
 void VariableShadingCode::CreateVRSImageGenerationPipeline()
 {
     // generate root Signature
     {
-        uint32_t UAVTableSize = 1;
-        uint32_t SRVTableSize = 2; // color + motionvectors
+        uint32_t UAVTableSize = 5; // VRS image + tile list arguments + tile lists + tile stats + capped VRS image
+        uint32_t SRVTableSize = 3; // color + motionvectors + downsampled color mip chain
 
         CD3DX12_DESCRIPTOR_RANGE DescRange[3];
         CD3DX12_ROOT_PARAMETER RTSlot[3];
@@ -199,31 +415,105 @@ void VariableShadingCode::CreateVRSImageGenerationPipeline()
             pErrorBlob->Release();
     }
 
-    for (int i = 0; i < (AdditionalShadingRatesSupported() ? 2 : 1); ++i)
+    CreateVRSImageGenerationPipelineStates();
+}
+
+void VariableShadingCode::CreateVRSImageGenerationPipelineStates()
+{
+    for (uint32_t mip = 0; mip <= MaxInputMipLevel(); ++mip)
     {
-        // Tile size is fixed (queried from the device)
-        DefineList defines;
+        for (int i = 0; i < 16; ++i)
+        {
+            if ((i & 1) && !AdditionalShadingRatesSupported())
+                continue;
+            if ((i & 8) && !(i & 1))
+                continue;
+
+            // Tile size is fixed (queried from the device, or the emulated tile size on Tier 1)
+            DefineList defines;
+
+            char szTileSize[3];
+            _itoa_s(TileSize() >> mip, szTileSize, 10);
+            defines["FFX_VARIABLESHADING_TILESIZE"] = szTileSize;
+
+            char szMipLevel[2];
+            _itoa_s(mip, szMipLevel, 10);
+            defines["VRS_INPUT_MIPLEVEL"] = szMipLevel;
+
+            if (m_luminanceTransform != FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_NONE)
+            {
+                char szTransform[2];
+                _itoa_s(m_luminanceTransform, szTransform, 10);
+                defines["FFX_VARIABLESHADING_LUMINANCE_TRANSFORM"] = szTransform;
+                if (m_linearInput)
+                {
+                    defines["VRS_INPUT_LINEAR"] = "1";
+                }
+            }
+
+            if (i & 1)
+            {
+                defines["FFX_VARIABLESHADING_ADDITIONALSHADINGRATES"] = "1";
+            }
+
+            if (i & 2)
+            {
+                defines["FFX_VARIABLESHADING_TILELISTS"] = "1";
+            }
+
+            if (i & 4)
+            {
+                defines["FFX_VARIABLESHADING_TILESTATS"] = "1";
+            }
+
+            if (i & 8)
+            {
+                defines["FFX_VARIABLESHADING_CAPPEDIMAGE"] = "1";
+            }
+
+            D3D12_SHADER_BYTECODE shaderByteCode;
+            CompileShaderFromFile("VRSImageGenCS.hlsl", &defines, "mainCS", "-T cs_6_0", &shaderByteCode);
+
+            D3D12_COMPUTE_PIPELINE_STATE_DESC descPso = {};
+            descPso.CS = shaderByteCode;
+            descPso.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+            descPso.pRootSignature = m_vrsImageGenerationRootSignature;
+            descPso.NodeMask = 0;
 
-        char szTileSize[3];
-        _itoa_s(m_vrsInfo.ShadingRateImageTileSize, szTileSize, 10);
-        defines["FFX_VARIABLESHADING_TILESIZE"] = szTileSize;
+            m_pDevice->GetDevice()->CreateComputePipelineState(&descPso, IID_PPV_ARGS(&m_vrsImageGenerationPipelines[mip][i]));
+            m_vrsImageGenerationPipelines[mip][i]->SetName(L"VRSImageGenerationPipeline");
+        }
+    }
+}
 
-        if (i & 1)
+void VariableShadingCode::DestroyVRSImageGenerationPipelineStates()
+{
+    for (uint32_t mip = 0; mip < MaxInputMipLevelCount; ++mip)
+    {
+        for (int i = 0; i < 16; ++i)
         {
-            defines["FFX_VARIABLESHADING_ADDITIONALSHADINGRATES"] = "1";
+            if (m_vrsImageGenerationPipelines[mip][i])
+            {
+                m_vrsImageGenerationPipelines[mip][i]->Release();
+                m_vrsImageGenerationPipelines[mip][i] = NULL;
+            }
         }
+    }
+}
 
-        D3D12_SHADER_BYTECODE shaderByteCode;
-        CompileShaderFromFile("VRSImageGenCS.hlsl", &defines, "mainCS", "-T cs_6_0", &shaderByteCode);
+void VariableShadingCode::SetLuminanceTransform(uint32_t transform, bool linearInput)
+{
+    if ((transform == m_luminanceTransform) && (linearInput == m_linearInput))
+        return;
 
-        D3D12_COMPUTE_PIPELINE_STATE_DESC descPso = {};
-        descPso.CS = shaderByteCode;
-        descPso.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
-        descPso.pRootSignature = m_vrsImageGenerationRootSignature;
-        descPso.NodeMask = 0;
+    m_luminanceTransform = transform;
+    m_linearInput = linearInput;
 
-        m_pDevice->GetDevice()->CreateComputePipelineState(&descPso, IID_PPV_ARGS(&m_vrsImageGenerationPipelines[i]));
-        m_vrsImageGenerationPipelines[i]->SetName(L"VRSImageGenerationPipeline");
+    // the transform is compiled into the generation shaders
+    if (m_vrsImageGenerationRootSignature)
+    {
+        DestroyVRSImageGenerationPipelineStates();
+        CreateVRSImageGenerationPipelineStates();
     }
 }
 
@@ -327,6 +617,9 @@ void  VariableShadingCode::ClearVrsMap(ID3D12GraphicsCommandList* pCommandList)
         VrsMapStateBarrier(pCommandList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
         const UINT ClearColor[4] = {};
         pCommandList->ClearUnorderedAccessViewUint(m_vrsImageUav.GetGPU(), m_vrsImageUavCpuVisible.GetCPU(), m_vrsImage.GetResource(), ClearColor, 0, NULL);
+
+        // the tile lists no longer match the VRS image
+        m_tileListsValid = false;
     }
 }
 
@@ -335,7 +628,7 @@ void VariableShadingCode::ComputeVrsMap(ID3D12GraphicsCommandList* pCmdLst, CBV_
     TRACED;
     assert(pCmdLst != nullptr);
 
-    if (m_vrsInfo.VariableShadingRateTier > D3D12_VARIABLE_SHADING_RATE_TIER_1)
+    if (VrsImageSupported())
     {
 
         UserMarker marker(pCmdLst, "VariableShadingCodeCS");
@@ -343,13 +636,28 @@ void VariableShadingCode::ComputeVrsMap(ID3D12GraphicsCommandList* pCmdLst, CBV_
         FFX_VariableShading_CB* data;
         D3D12_GPU_VIRTUAL_ADDRESS constantBuffer;
         m_constantBufferRing->AllocConstantBuffer(sizeof(FFX_VariableShading_CB), (void**)&data, &constantBuffer);
-        data->width = m_width;
-        data->height = m_height;
+        data->width = m_viewportWidth;
+        data->height = m_viewportHeight;
+        data->viewportX = m_viewportX;
+        data->viewportY = m_viewportY;
         data->varianceCutoff = m_vrsThreshold;
         data->tileSize = TileSize();
         data->motionFactor = m_vrsMotionFactor;
+        FFX_VariableShading_SetInputMipLevel(data, m_inputMipLevel);
 
         VrsMapStateBarrier(pCmdLst, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        if (TileLists())
+        {
+            ResetTileLists(pCmdLst);
+        }
+        if (TileStats())
+        {
+            TileStatsStateBarrier(pCmdLst, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        }
+        if (CappedImage())
+        {
+            CappedVrsMapStateBarrier(pCmdLst, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        }
 
         // Bind Descriptor heaps and the root signature
         ID3D12DescriptorHeap* pSrvHeap = m_resourceViewHeaps->GetCBV_SRV_UAVHeap();
@@ -365,8 +673,8 @@ void VariableShadingCode::ComputeVrsMap(ID3D12GraphicsCommandList* pCmdLst, CBV_
 
         // Bind Pipeline
         //
-        uint32_t shaderIndex = AdditionalShadingRates() ? 1 : 0;
-        pCmdLst->SetPipelineState(m_vrsImageGenerationPipelines[shaderIndex]);
+        uint32_t shaderIndex = (AdditionalShadingRates() ? 1 : 0) | (TileLists() ? 2 : 0) | (TileStats() ? 4 : 0) | (CappedImage() ? 8 : 0);
+        pCmdLst->SetPipelineState(m_vrsImageGenerationPipelines[m_inputMipLevel][shaderIndex]);
 
         // Dispatch: compute VRS image
         //
@@ -375,6 +683,316 @@ void VariableShadingCode::ComputeVrsMap(ID3D12GraphicsCommandList* pCmdLst, CBV_
         FFX_VariableShading_GetDispatchInfo(data, AdditionalShadingRates(), w, h);
         pCmdLst->Dispatch(w, h, 1);
 
+        m_tileListsValid = TileLists();
+
+        if (m_dilationRadius)
+        {
+            DilateVrsMap(pCmdLst);
+        }
+    }
+}
+
+void VariableShadingCode::CreateDilationPipeline()
+{
+    // generate root Signature
+    {
+        CD3DX12_DESCRIPTOR_RANGE DescRange[2];
+        CD3DX12_ROOT_PARAMETER RTSlot[2];
+
+        // we'll have a constant buffer
+        int parameterCount = 0;
+        DescRange[parameterCount].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
+        RTSlot[parameterCount++].InitAsConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_ALL);
+
+        // and a UAV table: VRS image + 2 scratch images
+        DescRange[parameterCount].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 3, 0);
+        RTSlot[parameterCount].InitAsDescriptorTable(1, &DescRange[parameterCount], D3D12_SHADER_VISIBILITY_ALL);
+        ++parameterCount;
+
+        CD3DX12_ROOT_SIGNATURE_DESC descRootSignature = CD3DX12_ROOT_SIGNATURE_DESC();
+        descRootSignature.NumParameters = parameterCount;
+        descRootSignature.pParameters = RTSlot;
+        descRootSignature.NumStaticSamplers = 0;
+        descRootSignature.pStaticSamplers = nullptr;
+        descRootSignature.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+
+        ID3DBlob* pOutBlob, * pErrorBlob = NULL;
+
+        HRESULT hr = S_OK;
+        hr = D3D12SerializeRootSignature(&descRootSignature, D3D_ROOT_SIGNATURE_VERSION_1, &pOutBlob, &pErrorBlob);
+        if (FAILED(hr))
+        {
+            Trace("Compilation failed with errors:\n%hs\n", (const char*)pErrorBlob->GetBufferPointer());
+        }
+        ThrowIfFailed(
+            m_pDevice->GetDevice()->CreateRootSignature(0, pOutBlob->GetBufferPointer(), pOutBlob->GetBufferSize(), IID_PPV_ARGS(&m_dilationRootSignature))
+        );
+        SetName(m_dilationRootSignature, std::string("VRSDilationRootSignature"));
+
+        pOutBlob->Release();
+        if (pErrorBlob)
+            pErrorBlob->Release();
+    }
+
+    D3D12_SHADER_BYTECODE lineCode;
+    D3D12_SHADER_BYTECODE plusCode;
+    CompileShaderFromFile("VRSDilationCS.hlsl", NULL, "mainLineCS", "-T cs_6_0", &lineCode);
+    CompileShaderFromFile("VRSDilationCS.hlsl", NULL, "mainPlusCS", "-T cs_6_0", &plusCode);
+
+    D3D12_COMPUTE_PIPELINE_STATE_DESC descPso = {};
+    descPso.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+    descPso.pRootSignature = m_dilationRootSignature;
+    descPso.NodeMask = 0;
+
+    descPso.CS = lineCode;
+    ThrowIfFailed(m_pDevice->GetDevice()->CreateComputePipelineState(&descPso, IID_PPV_ARGS(&m_dilationLinePipeline)));
+    m_dilationLinePipeline->SetName(L"VRSDilationLinePipeline");
+
+    descPso.CS = plusCode;
+    ThrowIfFailed(m_pDevice->GetDevice()->CreateComputePipelineState(&descPso, IID_PPV_ARGS(&m_dilationPlusPipeline)));
+    m_dilationPlusPipeline->SetName(L"VRSDilationPlusPipeline");
+}
+
+// Runs the dilation passes over the VRS image: the first pass reads the VRS image, the passes in between
+// ping pong between the scratch images and the last one writes the VRS image. A single pass writes a
+// scratch image that is copied back.
+void VariableShadingCode::DilateVrsMap(ID3D12GraphicsCommandList* pCmdLst)
+{
+    UserMarker marker(pCmdLst, "VRSDilationCS");
+
+    struct DilationConstants
+    {
+        int32_t     resolution[2];
+        int32_t     direction[2];
+        uint32_t    radius;
+        int32_t     padding;
+        uint32_t    input;
+        uint32_t    output;
+    };
+
+    FFX_VariableShading_DilationPass passes[FFX_VARIABLESHADING_DILATION_MAX_PASSES];
+    const uint32_t passCount = FFX_VariableShading_GetDilationPasses(m_dilationShape, m_dilationRadius, passes);
+    const uint32_t padding = FFX_VariableShading_GetDilationPadding(m_dilationShape, m_dilationRadius);
+    const uint32_t domainWidth = m_vrsImageWidth + 2 * padding;
+    const uint32_t domainHeight = m_vrsImageHeight + 2 * padding;
+
+    DilationStateBarrier(pCmdLst, 0, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    DilationStateBarrier(pCmdLst, 1, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    ID3D12DescriptorHeap* pSrvHeap = m_resourceViewHeaps->GetCBV_SRV_UAVHeap();
+    pCmdLst->SetDescriptorHeaps(1, &pSrvHeap);
+    pCmdLst->SetComputeRootSignature(m_dilationRootSignature);
+    pCmdLst->SetComputeRootDescriptorTable(1, m_dilationUav.GetGPU());
+
+    for (uint32_t i = 0; i < passCount; ++i)
+    {
+        const FFX_VariableShading_DilationPass& pass = passes[i];
+        const bool plus = (pass.directionX == 0) && (pass.directionY == 0);
+
+        DilationConstants* data;
+        D3D12_GPU_VIRTUAL_ADDRESS constantBuffer;
+        m_constantBufferRing->AllocConstantBuffer(sizeof(DilationConstants), (void**)&data, &constantBuffer);
+        data->resolution[0] = (int32_t)domainWidth;
+        data->resolution[1] = (int32_t)domainHeight;
+        data->direction[0] = pass.directionX;
+        data->direction[1] = pass.directionY;
+        data->radius = pass.radius;
+        data->padding = (int32_t)padding;
+        data->input = (i == 0) ? 0 : 1 + ((i - 1) & 1);
+        data->output = (i + 1 == passCount && passCount > 1) ? 0 : 1 + (i & 1);
+
+        // every pass reads what the previous one wrote, the first one the VRS image of the generation
+        // dispatch, which is already in the UAV state, so only a UAV barrier orders them
+        pCmdLst->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(NULL));
+
+        pCmdLst->SetComputeRootConstantBufferView(0, constantBuffer);
+        pCmdLst->SetPipelineState(plus ? m_dilationPlusPipeline : m_dilationLinePipeline);
+
+        uint32_t w = 0;
+        uint32_t h = 0;
+        FFX_VariableShading_Dilation_GetDispatchInfo(pass, domainWidth, domainHeight, w, h);
+        pCmdLst->Dispatch(w, h, 1);
+    }
+
+    if (passCount == 1)
+    {
+        // a single pass has no padding, the domain is the VRS image
+        VrsMapStateBarrier(pCmdLst, D3D12_RESOURCE_STATE_COPY_DEST);
+        DilationStateBarrier(pCmdLst, 0, D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+        CD3DX12_TEXTURE_COPY_LOCATION dst(m_vrsImage.GetResource(), 0);
+        CD3DX12_TEXTURE_COPY_LOCATION src(m_dilationImages[0].GetResource(), 0);
+        D3D12_BOX box = { 0, 0, 0, m_vrsImageWidth, m_vrsImageHeight, 1 };
+        pCmdLst->CopyTextureRegion(&dst, 0, 0, 0, &src, &box);
+
+        VrsMapStateBarrier(pCmdLst, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }
+    else
+    {
+        pCmdLst->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(NULL));
+    }
+}
+
+void VariableShadingCode::DilationStateBarrier(ID3D12GraphicsCommandList* pCmdLst, uint32_t image, D3D12_RESOURCE_STATES state)
+{
+    if (m_dilationImageStates[image] != state)
+    {
+        pCmdLst->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_dilationImages[image].GetResource(), m_dilationImageStates[image], state));
+        m_dilationImageStates[image] = state;
+    }
+}
+
+void VariableShadingCode::CreateDownsamplePipeline()
+{
+    // generate root Signature
+    {
+        CD3DX12_DESCRIPTOR_RANGE DescRange[3];
+        CD3DX12_ROOT_PARAMETER RTSlot[3];
+
+        // we'll have a constant buffer
+        int parameterCount = 0;
+        DescRange[parameterCount].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
+        RTSlot[parameterCount++].InitAsConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_ALL);
+
+        // the VRS image as SRV
+        DescRange[parameterCount].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+        RTSlot[parameterCount].InitAsDescriptorTable(1, &DescRange[parameterCount], D3D12_SHADER_VISIBILITY_ALL);
+        ++parameterCount;
+
+        // and the derived image as UAV
+        DescRange[parameterCount].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0);
+        RTSlot[parameterCount].InitAsDescriptorTable(1, &DescRange[parameterCount], D3D12_SHADER_VISIBILITY_ALL);
+        ++parameterCount;
+
+        CD3DX12_ROOT_SIGNATURE_DESC descRootSignature = CD3DX12_ROOT_SIGNATURE_DESC();
+        descRootSignature.NumParameters = parameterCount;
+        descRootSignature.pParameters = RTSlot;
+        descRootSignature.NumStaticSamplers = 0;
+        descRootSignature.pStaticSamplers = nullptr;
+        descRootSignature.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+
+        ID3DBlob* pOutBlob, * pErrorBlob = NULL;
+
+        HRESULT hr = S_OK;
+        hr = D3D12SerializeRootSignature(&descRootSignature, D3D_ROOT_SIGNATURE_VERSION_1, &pOutBlob, &pErrorBlob);
+        if (FAILED(hr))
+        {
+            Trace("Compilation failed with errors:\n%hs\n", (const char*)pErrorBlob->GetBufferPointer());
+        }
+        ThrowIfFailed(
+            m_pDevice->GetDevice()->CreateRootSignature(0, pOutBlob->GetBufferPointer(), pOutBlob->GetBufferSize(), IID_PPV_ARGS(&m_downsampleRootSignature))
+        );
+        SetName(m_downsampleRootSignature, std::string("VRSDownsampleRootSignature"));
+
+        pOutBlob->Release();
+        if (pErrorBlob)
+            pErrorBlob->Release();
+    }
+
+    D3D12_SHADER_BYTECODE shaderCode;
+    CompileShaderFromFile("VRSDownsampleCS.hlsl", NULL, "mainCS", "-T cs_6_0", &shaderCode);
+
+    D3D12_COMPUTE_PIPELINE_STATE_DESC descPso = {};
+    descPso.CS = shaderCode;
+    descPso.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+    descPso.pRootSignature = m_downsampleRootSignature;
+    descPso.NodeMask = 0;
+
+    ThrowIfFailed(m_pDevice->GetDevice()->CreateComputePipelineState(&descPso, IID_PPV_ARGS(&m_downsamplePipeline)));
+    m_downsamplePipeline->SetName(L"VRSDownsamplePipeline");
+}
+
+// Derives the preview image from the VRS image, leaves it ready for the overlay
+void VariableShadingCode::DownsampleVrsMap(ID3D12GraphicsCommandList* pCmdLst, const FFX_VariableShading_DownsampleCB& cb)
+{
+    UserMarker marker(pCmdLst, "VRSDownsampleCS");
+
+    FFX_VariableShading_DownsampleCB* data;
+    D3D12_GPU_VIRTUAL_ADDRESS constantBuffer;
+    m_constantBufferRing->AllocConstantBuffer(sizeof(FFX_VariableShading_DownsampleCB), (void**)&data, &constantBuffer);
+    *data = cb;
+
+    VrsMapStateBarrier(pCmdLst, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    PreviewStateBarrier(pCmdLst, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    ID3D12DescriptorHeap* pSrvHeap = m_resourceViewHeaps->GetCBV_SRV_UAVHeap();
+    pCmdLst->SetDescriptorHeaps(1, &pSrvHeap);
+    pCmdLst->SetComputeRootSignature(m_downsampleRootSignature);
+    pCmdLst->SetComputeRootConstantBufferView(0, constantBuffer);
+    pCmdLst->SetComputeRootDescriptorTable(1, m_vrsImageSrv.GetGPU());
+    pCmdLst->SetComputeRootDescriptorTable(2, m_previewImageUav.GetGPU());
+    pCmdLst->SetPipelineState(m_downsamplePipeline);
+
+    uint32_t w = 0;
+    uint32_t h = 0;
+    FFX_VariableShading_Downsample_GetDispatchInfo(&cb, w, h);
+    pCmdLst->Dispatch(w, h, 1);
+
+    PreviewStateBarrier(pCmdLst, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+}
+
+void VariableShadingCode::PreviewStateBarrier(ID3D12GraphicsCommandList* pCmdLst, D3D12_RESOURCE_STATES state)
+{
+    if (m_previewImageState != state)
+    {
+        pCmdLst->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_previewImage.GetResource(), m_previewImageState, state));
+        m_previewImageState = state;
+    }
+}
+
+// sets the thread group counts of all tile lists to (0, 1, 1), the generation shader atomically increments X
+void VariableShadingCode::ResetTileLists(ID3D12GraphicsCommandList* pCmdLst)
+{
+    ID3D12GraphicsCommandList2* pCommandList2;
+    ThrowIfFailed(pCmdLst->QueryInterface(__uuidof(ID3D12GraphicsCommandList2), (void**)&pCommandList2));
+
+    TileListsStateBarrier(pCmdLst, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    D3D12_WRITEBUFFERIMMEDIATE_PARAMETER params[FFX_VARIABLESHADING_RATE_CLASS_COUNT * 3];
+    D3D12_GPU_VIRTUAL_ADDRESS address = m_tileListArguments->GetGPUVirtualAddress();
+    for (uint32_t i = 0; i < _countof(params); ++i)
+    {
+        params[i].Dest = address + i * sizeof(uint32_t);
+        params[i].Value = ((i % 3) == 0) ? 0 : 1;
+    }
+    pCommandList2->WriteBufferImmediate(_countof(params), params, NULL);
+
+    TileListsStateBarrier(pCmdLst, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    pCommandList2->Release();
+}
+
+void VariableShadingCode::DispatchTileList(ID3D12GraphicsCommandList* pCmdLst, uint32_t rateClass)
+{
+    assert(pCmdLst != nullptr);
+    assert(rateClass < FFX_VARIABLESHADING_RATE_CLASS_COUNT);
+
+    if (!TileListsValid())
+        return;
+
+    TileListsStateBarrier(pCmdLst, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    pCmdLst->ExecuteIndirect(m_tileListCommandSignature, 1, m_tileListArguments, rateClass * sizeof(D3D12_DISPATCH_ARGUMENTS), NULL, 0);
+}
+
+void VariableShadingCode::TileListsStateBarrier(ID3D12GraphicsCommandList* pCmdLst, D3D12_RESOURCE_STATES argumentsState, D3D12_RESOURCE_STATES listsState)
+{
+    CD3DX12_RESOURCE_BARRIER barriers[2];
+    UINT barrierCount = 0;
+
+    if (m_tileListArgumentsState != argumentsState)
+    {
+        barriers[barrierCount++] = CD3DX12_RESOURCE_BARRIER::Transition(m_tileListArguments, m_tileListArgumentsState, argumentsState);
+        m_tileListArgumentsState = argumentsState;
+    }
+    if (m_tileListsState != listsState)
+    {
+        barriers[barrierCount++] = CD3DX12_RESOURCE_BARRIER::Transition(m_tileLists, m_tileListsState, listsState);
+        m_tileListsState = listsState;
+    }
+
+    if (barrierCount)
+    {
+        pCmdLst->ResourceBarrier(barrierCount, barriers);
     }
 }
 
@@ -396,6 +1014,12 @@ void VariableShadingCode::StartVrsRendering(ID3D12GraphicsCommandList* pCmdLst)
 
                 pCommandList5->RSSetShadingRateImage(m_vrsImage.GetResource());
                 m_vrsImageBound = true;
+                m_cappedVrsImageBound = false;
+
+                if (CappedImage())
+                {
+                    CappedVrsMapStateBarrier(pCmdLst, D3D12_RESOURCE_STATE_SHADING_RATE_SOURCE);
+                }
             }
         }
 
@@ -404,6 +1028,7 @@ void VariableShadingCode::StartVrsRendering(ID3D12GraphicsCommandList* pCmdLst)
             m_baseShadingRate,
             m_combiners
         );
+        m_drawShadingRate = m_baseShadingRate;
 
         m_vrsEnabled = true;
 
@@ -450,6 +1075,7 @@ void VariableShadingCode::SetShadingRate(D3D12_SHADING_RATE baseShadingRate, con
                 combiners
             );
         }
+        m_drawShadingRate = m_baseShadingRate;
 
         pCommandList5->Release();
     }
@@ -495,26 +1121,64 @@ void VariableShadingCode::EndVrsRendering(ID3D12GraphicsCommandList* pCmdLst)
     }
 
     m_vrsImageBound = false;
+    m_cappedVrsImageBound = false;
     m_vrsEnabled = false;
 
     pCommandList5->Release();
 }
 
+void VariableShadingCode::BindCappedVrsImage(ID3D12GraphicsCommandList* pCmdLst, bool capped)
+{
+    TRACED;
+    assert(pCmdLst != nullptr);
+
+    // the capped image only replaces an image bound by StartVrsRendering
+    capped = capped && CappedImage();
+    if (!m_vrsImageBound || capped == m_cappedVrsImageBound)
+        return;
+
+    ID3D12GraphicsCommandList5* pCommandList5;
+    ThrowIfFailed(pCmdLst->QueryInterface(__uuidof(ID3D12GraphicsCommandList5), (void**)&pCommandList5));
+
+    pCommandList5->RSSetShadingRateImage(capped ? m_cappedVrsImage.GetResource() : m_vrsImage.GetResource());
+    m_cappedVrsImageBound = capped;
+
+    pCommandList5->Release();
+}
+
 void VariableShadingCode::DrawOverlay(ID3D12GraphicsCommandList* pCmdLst)
 {
     TRACED;
     assert(pCmdLst != nullptr);
 
-    if (SupportedTier() > D3D12_VARIABLE_SHADING_RATE_TIER_1)
+    if (VrsImageSupported())
     {
         UserMarker marker(pCmdLst, "VrsDrawOverlay");
 
+        uint32_t overlayTileSize = TileSize();
+        CBV_SRV_UAV* pOverlaySrv = &m_vrsImageSrv;
+        if ((m_previewTileSize && (m_previewTileSize != TileSize())) || m_previewScaleLog2)
+        {
+            // one preview tile covers tileSize << scaleLog2 window pixels
+            uint32_t tileSize = m_previewTileSize ? m_previewTileSize : TileSize();
+            FFX_VariableShading_DownsampleCB cb;
+            FFX_VariableShading_SetupDownsample(&cb, m_width, m_height, TileSize(),
+                FFX_VariableShading_DivideRoundingUp(m_width, 1 << m_previewScaleLog2), FFX_VariableShading_DivideRoundingUp(m_height, 1 << m_previewScaleLog2), tileSize,
+                AdditionalShadingRates() ? FFX_VARIABLESHADING_RATE1D_4X : FFX_VARIABLESHADING_RATE1D_2X);
+            DownsampleVrsMap(pCmdLst, cb);
+
+            overlayTileSize = tileSize << m_previewScaleLog2;
+            pOverlaySrv = &m_previewImageSrv;
+        }
+
         FFX_VariableShading_CB* data;
         D3D12_GPU_VIRTUAL_ADDRESS constantBuffer;
         m_constantBufferRing->AllocConstantBuffer(sizeof(FFX_VariableShading_CB), (void**)&data, &constantBuffer);
         data->width = m_width;
         data->height = m_height;
-        data->tileSize = TileSize();
+        data->tileSize = overlayTileSize;
+        data->viewportX = 0;
+        data->viewportY = 0;
 
         VrsMapStateBarrier(pCmdLst, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
@@ -529,7 +1193,7 @@ void VariableShadingCode::DrawOverlay(ID3D12GraphicsCommandList* pCmdLst)
             pCmdLst->SetDescriptorHeaps(1, &pSrvHeap);
             pCmdLst->SetGraphicsRootSignature(m_vrsOverlayRootSignature);
             pCmdLst->SetGraphicsRootConstantBufferView(0, constantBuffer);
-            pCmdLst->SetGraphicsRootDescriptorTable(1, m_vrsImageSrv.GetGPU());
+            pCmdLst->SetGraphicsRootDescriptorTable(1, pOverlaySrv->GetGPU());
 
             // Bind Pipeline
             //
@@ -542,6 +1206,80 @@ void VariableShadingCode::DrawOverlay(ID3D12GraphicsCommandList* pCmdLst)
     }
 }
 
+// Tier 1 emulation:
+// consumes the oldest readback buffer (the GPU is done with it) to update the per draw rate query,
+// then records a copy of the freshly generated VRS image into it
+void VariableShadingCode::ReadbackVrsMap(ID3D12GraphicsCommandList* pCmdLst)
+{
+    TRACED;
+    assert(pCmdLst != nullptr);
+
+    if (SupportedTier() != D3D12_VARIABLE_SHADING_RATE_TIER_1)
+        return;
+
+    ID3D12Resource* pReadback = m_vrsImageReadback[m_vrsImageReadbackIndex];
+
+    if (m_vrsImageReadbackValid[m_vrsImageReadbackIndex])
+    {
+        const uint8_t* pData = nullptr;
+        CD3DX12_RANGE readRange(0, m_vrsImageReadbackFootprint.Footprint.RowPitch * m_vrsImageHeight);
+        if (SUCCEEDED(pReadback->Map(0, &readRange, (void**)&pData)))
+        {
+            FFX_VariableShading_BuildRateQuery(&m_rateQuery, pData, m_vrsImageWidth, m_vrsImageHeight, m_vrsImageReadbackFootprint.Footprint.RowPitch, TileSize());
+            m_rateQueryValid = true;
+
+            CD3DX12_RANGE writeRange(0, 0);
+            pReadback->Unmap(0, &writeRange);
+        }
+    }
+
+    UserMarker marker(pCmdLst, "VrsReadback");
+
+    VrsMapStateBarrier(pCmdLst, D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+    CD3DX12_TEXTURE_COPY_LOCATION dst(pReadback, m_vrsImageReadbackFootprint);
+    CD3DX12_TEXTURE_COPY_LOCATION src(m_vrsImage.GetResource(), 0);
+    pCmdLst->CopyTextureRegion(&dst, 0, 0, 0, &src, NULL);
+
+    m_vrsImageReadbackValid[m_vrsImageReadbackIndex] = true;
+    m_vrsImageReadbackIndex = (m_vrsImageReadbackIndex + 1) % ReadbackBufferCount;
+}
+
+// Tier 1 emulation: returns the finest shading rate of the VRS image inside rect (in pixels)
+// falls back to the base shading rate as long as no VRS image has been read back
+D3D12_SHADING_RATE VariableShadingCode::GetDrawShadingRate(const D3D12_RECT& rect)
+{
+    if (!Tier1Emulation() || !m_rateQueryValid)
+        return m_baseShadingRate;
+
+    uint32_t rate = FFX_VariableShading_QueryRate(&m_rateQuery, rect.left, rect.top, rect.right, rect.bottom);
+    if (!AdditionalShadingRates())
+    {
+        rate = FFX_VariableShading_ClampRate(rate, FFX_VARIABLESHADING_RATE1D_2X);
+    }
+
+    // FFX_VARIABLESHADING_RATE_* uses the same encoding as D3D12_SHADING_RATE
+    return (D3D12_SHADING_RATE)rate;
+}
+
+// sets the per draw shading rate, redundant changes are skipped
+// sort draws with FFX_VariableShading_SortByShadingRate to keep the number of changes low
+void VariableShadingCode::SetDrawShadingRate(D3D12_SHADING_RATE shadingRate, ID3D12GraphicsCommandList* pCmdLst)
+{
+    assert(pCmdLst != nullptr);
+
+    if (!m_vrsEnabled || !Tier1Emulation() || (shadingRate == m_drawShadingRate))
+        return;
+
+    ID3D12GraphicsCommandList5* pCommandList5;
+    ThrowIfFailed(pCmdLst->QueryInterface(__uuidof(ID3D12GraphicsCommandList5), (void**)&pCommandList5));
+
+    // combiners are passthrough on Tier 1
+    pCommandList5->RSSetShadingRate(shadingRate, nullptr);
+    m_drawShadingRate = shadingRate;
+
+    pCommandList5->Release();
+}
 
 void VariableShadingCode::VrsMapStateBarrier(ID3D12GraphicsCommandList* pCmdLst, D3D12_RESOURCE_STATES state)
 {
@@ -549,7 +1287,7 @@ void VariableShadingCode::VrsMapStateBarrier(ID3D12GraphicsCommandList* pCmdLst,
     assert(pCmdLst != nullptr);
     assert(m_vrsImageBound == false);
 
-    if (SupportedTier() > D3D12_VARIABLE_SHADING_RATE_TIER_1)
+    if (VrsImageSupported())
     {
         if (m_vrsImageState != state)
         {
@@ -557,4 +1295,64 @@ void VariableShadingCode::VrsMapStateBarrier(ID3D12GraphicsCommandList* pCmdLst,
             m_vrsImageState = state;
         }
     }
+}
+
+// Encoder statistics:
+// consumes the oldest readback buffer to update the QP offsets, then records a copy of the current tile stats into it
+void VariableShadingCode::ReadbackTileStats(ID3D12GraphicsCommandList* pCmdLst)
+{
+    TRACED;
+    assert(pCmdLst != nullptr);
+
+    if (!TileStats())
+        return;
+
+    ID3D12Resource* pReadback = m_tileStatsReadback[m_tileStatsReadbackIndex];
+
+    if (m_tileStatsReadbackValid[m_tileStatsReadbackIndex])
+    {
+        const FFX_VariableShading_TileStats* pData = nullptr;
+        CD3DX12_RANGE readRange(0, m_tileStatsReadbackFootprint.Footprint.RowPitch * m_vrsImageHeight);
+        if (SUCCEEDED(pReadback->Map(0, &readRange, (void**)&pData)))
+        {
+            uint32_t macroblocksX, macroblocksY;
+            FFX_VariableShading_GetMacroblockCount(m_width, m_height, macroblocksX, macroblocksY);
+            m_qpOffsets.resize(macroblocksX * macroblocksY);
+
+            uint32_t statsPitch = m_tileStatsReadbackFootprint.Footprint.RowPitch / sizeof(FFX_VariableShading_TileStats);
+            FFX_VariableShading_ComputeQpOffsets(pData, statsPitch, TileSize(), m_width, m_height, m_qpOffsetParams, m_qpOffsets.data());
+
+            CD3DX12_RANGE writeRange(0, 0);
+            pReadback->Unmap(0, &writeRange);
+        }
+    }
+
+    UserMarker marker(pCmdLst, "VrsTileStatsReadback");
+
+    TileStatsStateBarrier(pCmdLst, D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+    CD3DX12_TEXTURE_COPY_LOCATION dst(pReadback, m_tileStatsReadbackFootprint);
+    CD3DX12_TEXTURE_COPY_LOCATION src(m_tileStats.GetResource(), 0);
+    pCmdLst->CopyTextureRegion(&dst, 0, 0, 0, &src, NULL);
+
+    m_tileStatsReadbackValid[m_tileStatsReadbackIndex] = true;
+    m_tileStatsReadbackIndex = (m_tileStatsReadbackIndex + 1) % ReadbackBufferCount;
+}
+
+void VariableShadingCode::TileStatsStateBarrier(ID3D12GraphicsCommandList* pCmdLst, D3D12_RESOURCE_STATES state)
+{
+    if (m_tileStatsState != state)
+    {
+        pCmdLst->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_tileStats.GetResource(), m_tileStatsState, state));
+        m_tileStatsState = state;
+    }
+}
+
+void VariableShadingCode::CappedVrsMapStateBarrier(ID3D12GraphicsCommandList* pCmdLst, D3D12_RESOURCE_STATES state)
+{
+    if (m_cappedVrsImageState != state)
+    {
+        pCmdLst->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_cappedVrsImage.GetResource(), m_cappedVrsImageState, state));
+        m_cappedVrsImageState = state;
+    }
 }
\ No newline at end of file
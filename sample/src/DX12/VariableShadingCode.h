@@ -25,6 +25,10 @@
 
 #define FFX_CPP
 #include "ffx_variable_shading.h"
+#include "ffx_variable_shading_cpu.h"
+#include "ffx_variable_shading_dilation.h"
+#include "ffx_variable_shading_downsample.h"
+#include "ffx_variable_shading_luminance.h"
 
 class VariableShadingCode
 {
@@ -39,6 +43,8 @@ public:
     void ComputeVrsMap(ID3D12GraphicsCommandList* pCmdLst, CBV_SRV_UAV* srvs);
     void DrawOverlay(ID3D12GraphicsCommandList* pCmdLst);
     Texture* GetTexture() { return &m_vrsImage; }
+    CBV_SRV_UAV* GetSRV() { return &m_vrsImageSrv; }
+    void VrsMapStateBarrier(ID3D12GraphicsCommandList* pCmdLst, D3D12_RESOURCE_STATES state);
 
     void StartVrsRendering(ID3D12GraphicsCommandList* pCmdLst);
     void EndVrsRendering(ID3D12GraphicsCommandList* pCmdLst);
@@ -46,19 +52,97 @@ public:
     void SetVarianceThreshold(float value) { m_vrsThreshold = value; }
     void SetMotionFactor(float value) { m_vrsMotionFactor = value; }
 
+    // Input mip level: 0 reads the copy of the previous frame, level L > 0 reads mip L - 1 of the
+    // DownSamplePS chain (srvs[2], its mip 0 is half resolution) instead
+    void SetInputMipLevel(uint32_t value) { m_inputMipLevel = (value < MaxInputMipLevel()) ? value : MaxInputMipLevel(); }
+    uint32_t InputMipLevel() { return m_inputMipLevel; }
+    uint32_t MaxInputMipLevel() { uint32_t maxLevel = FFX_VariableShading_GetMaxInputMipLevel(TileSize()); return (maxLevel < MaxInputMipLevelCount) ? maxLevel : MaxInputMipLevelCount - 1; }
+
+    // Luminance transform (FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_*) of the generation shaders, linearInput: the
+    // copy of the previous frame holds linear values (HDR display modes) instead of sRGB encoded ones.
+    // A change recompiles the generation pipelines, the GPU must not use them anymore
+    void SetLuminanceTransform(uint32_t transform, bool linearInput);
+    uint32_t LuminanceTransform() { return m_luminanceTransform; }
+
+    // Dilation: after generation every tile takes the finest rate within a square or diamond
+    // (FFX_VARIABLESHADING_NEIGHBOURHOOD_*) of radius tiles, 0 disables the passes.
+    // Tile lists and tile stats describe the VRS image before dilation.
+    void SetDilation(uint32_t shape, uint32_t radius) { m_dilationShape = shape; m_dilationRadius = radius; }
+
+    // Capped image: with additional shading rates ComputeVrsMap also writes the VRS image limited to 2x2
+    // (FFX_VARIABLESHADING_CAPPEDIMAGE) in the same pass. BindCappedVrsImage switches passes between the
+    // two images while VRS rendering is active. The capped image is not dilated.
+    void SetCappedImageEnabled(bool value) { m_cappedImageEnabled = value; }
+    bool CappedImage() { return VrsImageSupported() && AdditionalShadingRates() && m_cappedImageEnabled; }
+    void BindCappedVrsImage(ID3D12GraphicsCommandList* pCmdLst, bool capped);
+
+    // Overlay preview: DrawOverlay shows the VRS image derived (ffx_variable_shading_downsample.h) for
+    // another tile size (0 keeps TileSize()) and a surface of 1 / 2^scaleLog2 the window size, the way a
+    // device with that tile size or a reduced resolution pass would get it without generating it again
+    void SetOverlayPreview(uint32_t tileSize, uint32_t scaleLog2) { m_previewTileSize = tileSize; m_previewScaleLog2 = scaleLog2; }
+
+    // Dynamic resolution: the frame is rendered to the rectangle (x, y, width, height) inside the window sized targets,
+    // ComputeVrsMap only dispatches over and writes the tiles it covers, the VRS image keeps its window sized
+    // allocation. OnCreateWindowSizeDependentResources resets it to the whole window.
+    void SetRenderViewport(uint32_t x, uint32_t y, uint32_t width, uint32_t height) { m_viewportX = x; m_viewportY = y; m_viewportWidth = width; m_viewportHeight = height; }
+
     void SetAdditionalShadingRatesAllowed(bool value) { m_additionalShadingRatesAllowed = value; }
     D3D12_VARIABLE_SHADING_RATE_TIER    SupportedTier() { return m_vrsInfo.VariableShadingRateTier; }
-    uint32_t    TileSize() { return m_vrsInfo.ShadingRateImageTileSize; }
+    uint32_t    TileSize() { return (SupportedTier() > D3D12_VARIABLE_SHADING_RATE_TIER_1) ? m_vrsInfo.ShadingRateImageTileSize : Tier1EmulationTileSize; }
     bool AdditionalShadingRates() { return AdditionalShadingRatesSupported() && m_additionalShadingRatesAllowed; }
     bool AdditionalShadingRatesSupported() { return m_vrsInfo.AdditionalShadingRatesSupported; }
     bool UseMotionVectors() { return m_useMotionVectors; }
 
+    // Tier 1 emulation: the VRS image is generated anyway, read back to the CPU
+    // and per draw shading rates are derived from it
+    void SetTier1EmulationEnabled(bool value) { m_tier1EmulationEnabled = value; }
+    bool Tier1Emulation() { return (SupportedTier() == D3D12_VARIABLE_SHADING_RATE_TIER_1) && m_tier1EmulationEnabled; }
+    void ReadbackVrsMap(ID3D12GraphicsCommandList* pCmdLst);
+    D3D12_SHADING_RATE GetDrawShadingRate(const D3D12_RECT& rect);
+    void SetDrawShadingRate(D3D12_SHADING_RATE shadingRate, ID3D12GraphicsCommandList* pCmdLst);
+
+    // Per rate tile lists: ComputeVrsMap additionally compacts the tiles into one list per rate class
+    // (FFX_VARIABLESHADING_TILELISTS). List c starts at c * TileListCapacity() in the tile list buffer,
+    // DispatchTileList launches one threadgroup per tile of a class with the pipeline currently bound
+    void SetTileListsEnabled(bool value) { m_tileListsEnabled = value; }
+    bool TileLists() { return VrsImageSupported() && m_tileListsEnabled; }
+    bool TileListsValid() { return TileLists() && m_tileListsValid; }
+    uint32_t TileListCapacity() { return m_vrsImageWidth * m_vrsImageHeight; }
+    CBV_SRV_UAV* GetTileListsSRV() { return &m_tileListsSrv; }
+    void DispatchTileList(ID3D12GraphicsCommandList* pCmdLst, uint32_t rateClass);
+
+    // Encoder statistics: ComputeVrsMap additionally writes a per tile statistics plane (FFX_VARIABLESHADING_TILESTATS),
+    // ReadbackTileStats brings it to the CPU and converts it to per 16x16 macroblock QP offsets for a video encoder
+    void SetTileStatsEnabled(bool value) { m_tileStatsEnabled = value; }
+    bool TileStats() { return VrsImageSupported() && m_tileStatsEnabled; }
+    void ReadbackTileStats(ID3D12GraphicsCommandList* pCmdLst);
+    void SetQpOffsetParams(const FFX_VariableShading_QpOffsetParams& params) { m_qpOffsetParams = params; }
+    // empty until the first readback completed
+    const std::vector<float>& GetQpOffsets() { return m_qpOffsets; }
+
 private:
     void CreateVRSImageGenerationPipeline();
+    void CreateVRSImageGenerationPipelineStates();
+    void DestroyVRSImageGenerationPipelineStates();
     void CreateOverlayPipeline(DXGI_FORMAT outputFormat);
-    void VrsMapStateBarrier(ID3D12GraphicsCommandList* pCmdLst, D3D12_RESOURCE_STATES state);
+    void CreateDilationPipeline();
+    void DilateVrsMap(ID3D12GraphicsCommandList* pCmdLst);
+    void DilationStateBarrier(ID3D12GraphicsCommandList* pCmdLst, uint32_t image, D3D12_RESOURCE_STATES state);
+    void CreateDownsamplePipeline();
+    void DownsampleVrsMap(ID3D12GraphicsCommandList* pCmdLst, const FFX_VariableShading_DownsampleCB& cb);
+    void PreviewStateBarrier(ID3D12GraphicsCommandList* pCmdLst, D3D12_RESOURCE_STATES state);
+    bool VrsImageSupported() { return SupportedTier() > D3D12_VARIABLE_SHADING_RATE_TIER_NOT_SUPPORTED; }
+    void ResetTileLists(ID3D12GraphicsCommandList* pCmdLst);
+    void TileListsStateBarrier(ID3D12GraphicsCommandList* pCmdLst, D3D12_RESOURCE_STATES argumentsState, D3D12_RESOURCE_STATES listsState);
+    void TileStatsStateBarrier(ID3D12GraphicsCommandList* pCmdLst, D3D12_RESOURCE_STATES state);
+    void CappedVrsMapStateBarrier(ID3D12GraphicsCommandList* pCmdLst, D3D12_RESOURCE_STATES state);
 
 private:
+    // the tile size used for the VRS image when emulating Tier 2 on Tier 1 hardware
+    static const uint32_t               Tier1EmulationTileSize = 16;
+    // must be at least the number of frames in flight
+    static const uint32_t               ReadbackBufferCount = 3;
+
     Device* m_pDevice = nullptr;
 
     D3D12_SHADING_RATE                  m_baseShadingRate = D3D12_SHADING_RATE_1X1;
@@ -75,32 +159,100 @@ private:
 
     uint32_t                            m_width;
     uint32_t                            m_height;
+    uint32_t                            m_viewportX = 0;
+    uint32_t                            m_viewportY = 0;
+    uint32_t                            m_viewportWidth = 0;
+    uint32_t                            m_viewportHeight = 0;
 
     // VRS Resources
     uint32_t                            m_vrsImageWidth;
     uint32_t                            m_vrsImageHeight;
     Texture                             m_vrsImage;
     CBV_SRV_UAV                         m_vrsImageUavCpuVisible;
-    CBV_SRV_UAV                         m_vrsImageUav;
+    CBV_SRV_UAV                         m_vrsImageUav;          // VRS image, tile list arguments, tile lists, tile stats, capped VRS image
     CBV_SRV_UAV                         m_vrsImageSrv;
     D3D12_RESOURCE_STATES               m_vrsImageState;
 
     bool                                m_vrsImageBound = false;
+    bool                                m_cappedVrsImageBound = false;
     bool                                m_vrsEnabled = false;
 
+    // Tier 1 emulation resources
+    ID3D12Resource*                     m_vrsImageReadback[ReadbackBufferCount] = {};
+    bool                                m_vrsImageReadbackValid[ReadbackBufferCount] = {};
+    uint32_t                            m_vrsImageReadbackIndex = 0;
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT  m_vrsImageReadbackFootprint = {};
+    FFX_VariableShading_RateQuery       m_rateQuery;
+    bool                                m_rateQueryValid = false;
+    D3D12_SHADING_RATE                  m_drawShadingRate = D3D12_SHADING_RATE_1X1;
+    bool                                m_tier1EmulationEnabled = false;
+
+    // Tile list resources
+    ID3D12Resource*                     m_tileListArguments = nullptr;  // D3D12_DISPATCH_ARGUMENTS per rate class
+    ID3D12Resource*                     m_tileLists = nullptr;
+    D3D12_RESOURCE_STATES               m_tileListArgumentsState;
+    D3D12_RESOURCE_STATES               m_tileListsState;
+    CBV_SRV_UAV                         m_tileListsSrv;
+    ID3D12CommandSignature*             m_tileListCommandSignature = nullptr;
+    bool                                m_tileListsEnabled = false;
+    bool                                m_tileListsValid = false;
+
+    // Encoder statistics resources
+    Texture                             m_tileStats;
+    D3D12_RESOURCE_STATES               m_tileStatsState;
+    ID3D12Resource*                     m_tileStatsReadback[ReadbackBufferCount] = {};
+    bool                                m_tileStatsReadbackValid[ReadbackBufferCount] = {};
+    uint32_t                            m_tileStatsReadbackIndex = 0;
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT  m_tileStatsReadbackFootprint = {};
+    FFX_VariableShading_QpOffsetParams  m_qpOffsetParams = FFX_VariableShading_GetDefaultQpOffsetParams();
+    std::vector<float>                  m_qpOffsets;
+    bool                                m_tileStatsEnabled = false;
+
+    // Capped image resources
+    Texture                             m_cappedVrsImage;
+    D3D12_RESOURCE_STATES               m_cappedVrsImageState;
+    bool                                m_cappedImageEnabled = false;
+
+    // Dilation resources: two scratch images of the VRS image size padded by the maximum dilation padding
+    Texture                             m_dilationImages[2];
+    D3D12_RESOURCE_STATES               m_dilationImageStates[2];
+    CBV_SRV_UAV                         m_dilationUav;          // VRS image, scratch images
+    uint32_t                            m_dilationShape = FFX_VARIABLESHADING_NEIGHBOURHOOD_DIAMOND;
+    uint32_t                            m_dilationRadius = 0;
+
+    // Overlay preview resources: derived image, large enough for the smallest tile size at full resolution
+    static const uint32_t               MinPreviewTileSize = 8;
+    Texture                             m_previewImage;
+    D3D12_RESOURCE_STATES               m_previewImageState;
+    CBV_SRV_UAV                         m_previewImageUav;
+    CBV_SRV_UAV                         m_previewImageSrv;
+    uint32_t                            m_previewTileSize = 0;
+    uint32_t                            m_previewScaleLog2 = 0;
+
     // VRS configuration
     float                               m_vrsThreshold = 0.015f;
     float                               m_vrsMotionFactor = 0.01f;
     bool                                m_additionalShadingRatesAllowed = true;
     bool                                m_useMotionVectors = true;
+    uint32_t                            m_inputMipLevel = 0;
+    uint32_t                            m_luminanceTransform = 0;
+    bool                                m_linearInput = false;
 
     // The Direct3D12 device
     D3D12_FEATURE_DATA_D3D12_OPTIONS6   m_vrsInfo = {};
 
     // The compiled pipelines:
-    // for this sample we'll create 2 pipeline variants if additional shading rates are supported by the hardware
+    // for this sample we'll create 2 pipeline variants if additional shading rates are supported by the hardware,
+    // each with and without tile lists and tile stats (and the capped image with additional shading rates),
+    // for every input mip level the tile size allows
+    static const uint32_t               MaxInputMipLevelCount = 3;
     ID3D12RootSignature*                m_vrsImageGenerationRootSignature = nullptr;
-    ID3D12PipelineState*                m_vrsImageGenerationPipelines[2] = {};
+    ID3D12PipelineState*                m_vrsImageGenerationPipelines[MaxInputMipLevelCount][16] = {};
     ID3D12RootSignature*                m_vrsOverlayRootSignature = nullptr;
     ID3D12PipelineState*                m_vrsOverlayPipeline = nullptr;
+    ID3D12RootSignature*                m_dilationRootSignature = nullptr;
+    ID3D12PipelineState*                m_dilationLinePipeline = nullptr;
+    ID3D12PipelineState*                m_dilationPlusPipeline = nullptr;
+    ID3D12RootSignature*                m_downsampleRootSignature = nullptr;
+    ID3D12PipelineState*                m_downsamplePipeline = nullptr;
 };
@@ -139,6 +139,7 @@ void VariableShadingSample::OnCreate(HWND hWnd)
 
     // Create a instance of the renderer and initialize it, we need to do that for each GPU
     //
+    FFX_VariableShading_SetTraceThreadName("Main");
     m_node = new SampleRenderer();
     m_node->OnCreate(&m_device, &m_swapChain);
 
@@ -164,11 +165,23 @@ void VariableShadingSample::OnCreate(HWND hWnd)
     m_state.m_camera.LookAt(m_roll, m_pitch, m_distance, XMVectorSet(0, 0, 0, 0));
 
     m_state.m_allowAdditionalVrsRates = true;
+    m_state.m_capTransparentVrsRates = false;
+    m_state.m_emulateShadingRateImage = false;
+    m_state.m_softwareVrsToneMapping = false;
+    m_state.m_showSoftwareVrsDifference = false;
+    m_state.m_softwareVrsTileLists = false;
+    m_state.m_encoderQpMap = false;
     m_state.m_enableShadingRateImage = false;
     m_state.m_vrsImageCombiner = 0;
     m_state.m_showVRSMap = false;
     m_state.m_vrsVarianceThreshold = 0.05f;
     m_state.m_vrsMotionFactor = 0.05f;
+    m_state.m_vrsInputMipLevel = 0;
+    m_state.m_vrsLuminanceTransform = 0;
+    m_state.m_vrsDilationRadius = 0;
+    m_state.m_vrsDilationShape = 0;
+    m_state.m_vrsOverlayTileSize = 0;
+    m_state.m_vrsOverlayScale = 0;
     m_state.m_hideUI = false;
 
     LoadScene(0);
@@ -181,6 +194,8 @@ void VariableShadingSample::OnCreate(HWND hWnd)
 //--------------------------------------------------------------------------------------
 void VariableShadingSample::OnDestroy()
 {
+    m_traceWriter.Stop();
+
     ImGUI_Shutdown();
 
     m_device.GPUFlush();
@@ -321,6 +336,38 @@ void VariableShadingSample::LoadScene(int sceneIndex)
         LOAD(scene, "emisiveFactor", m_state.m_emisiveFactor);
         LOAD(scene, "skyDomeType", m_state.m_skyDomeType);
 
+        // VRS parameters: from the scene, overridden by VrsPresets\<scene name>.json if the preset sweep wrote one
+        json vrsPresets = scene;
+        std::ifstream vrsPresetFile("VrsPresets\\" + scene["name"].get<std::string>() + ".json");
+        if (vrsPresetFile)
+        {
+            try
+            {
+                vrsPresetFile >> vrsPresets;
+            }
+            catch (json::parse_error)
+            {
+                vrsPresets = scene;
+            }
+        }
+        LOAD(vrsPresets, "vrsVarianceThreshold", m_state.m_vrsVarianceThreshold);
+        LOAD(vrsPresets, "vrsMotionFactor", m_state.m_vrsMotionFactor);
+
+        m_vrsPresets.clear();
+        m_vrsPresetNames.clear();
+        m_activeVrsPreset = -1;
+        for (const auto& preset : vrsPresets.value("vrsPresets", json::array()))
+        {
+            VrsPreset p;
+            p.vrsVarianceThreshold = preset.value("vrsVarianceThreshold", m_state.m_vrsVarianceThreshold);
+            p.vrsMotionFactor = preset.value("vrsMotionFactor", m_state.m_vrsMotionFactor);
+            m_vrsPresets.push_back(p);
+
+            char name[64];
+            sprintf_s(name, "%.0f%% saved, error %.4f", 100.0f * preset.value("savings", 0.0f), preset.value("error", 0.0f));
+            m_vrsPresetNames.push_back(name);
+        }
+
         // Add a default light in case there are none
         //
         if (m_gltfLoader->m_lights.size() == 0)
@@ -419,6 +466,12 @@ void VariableShadingSample::BuildUI()
         {
             ImGui::Checkbox("Allow Additional VRS Rates", &m_state.m_allowAdditionalVrsRates);
             if (ImGui::IsItemHovered()) ImGui::SetTooltip("Allow/prohibit usage of 2x4, 4x2 and 4x4 shading rate");
+
+            if (m_state.m_allowAdditionalVrsRates)
+            {
+                ImGui::Checkbox("Cap Transparent VRS Rates at 2x2", &m_state.m_capTransparentVrsRates);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Transparent geometry uses a second VRS image written by the same pass, with rates capped at 2x2");
+            }
         }
 
         if (m_node->GetVrsTier() > D3D12_VARIABLE_SHADING_RATE_TIER_NOT_SUPPORTED)
@@ -431,14 +484,24 @@ void VariableShadingSample::BuildUI()
                 if (ImGui::IsItemHovered()) ImGui::SetTooltip("Set base shading rate (Tier1)");
             }
 
-            if (m_node->GetVrsTier() > D3D12_VARIABLE_SHADING_RATE_TIER_1)
+            if (m_node->GetVrsTier() == D3D12_VARIABLE_SHADING_RATE_TIER_1)
             {
                 ImGui::Separator();
-                if (ImGui::Checkbox("ShadingRateImage Enabled", &m_state.m_enableShadingRateImage))
+                ImGui::Checkbox("Emulate ShadingRateImage", &m_state.m_emulateShadingRateImage);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Generate the shading rate image anyway and derive per draw shading rates from it (Tier1)");
+            }
+
+            if ((m_node->GetVrsTier() > D3D12_VARIABLE_SHADING_RATE_TIER_1) || m_state.m_emulateShadingRateImage)
+            {
+                if (m_node->GetVrsTier() > D3D12_VARIABLE_SHADING_RATE_TIER_1)
                 {
-                    m_state.m_vrsImageCombiner = m_state.m_enableShadingRateImage ? 1 : 0;
+                    ImGui::Separator();
+                    if (ImGui::Checkbox("ShadingRateImage Enabled", &m_state.m_enableShadingRateImage))
+                    {
+                        m_state.m_vrsImageCombiner = m_state.m_enableShadingRateImage ? 1 : 0;
+                    }
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Enable shading rate image");
                 }
-                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Enable shading rate image");
 
                 ImGui::Checkbox("ShadingRateImage Overlay", &m_state.m_showVRSMap);
                 if (ImGui::IsItemHovered()) ImGui::SetTooltip("Enable overlay to visualize shading rate image");
@@ -457,20 +520,94 @@ void VariableShadingSample::BuildUI()
                         AddUiButton("4x2", ImVec4(1.0f, 0.5f, 1.0f, 0));
                         AddUiButton("4x4", ImVec4(0.0f, 1.0f, 1.0f, 0), false);
                     }
+
+                    const char* overlayTileSizes[] = { "Native", "8", "16", "32" };
+                    const char* overlayScales[] = { "Full", "Half", "Quarter" };
+                    ImGui::Combo("Overlay Tile Size", &m_state.m_vrsOverlayTileSize, overlayTileSizes, _countof(overlayTileSizes));
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Show the shading rate image derived for another tile size instead of generating it again");
+                    ImGui::Combo("Overlay Surface Size", &m_state.m_vrsOverlayScale, overlayScales, _countof(overlayScales));
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Show the shading rate image derived for a reduced resolution pass, e.g. half resolution particles");
                     ImGui::Unindent();
                 }
 
+                if (!m_vrsPresets.empty())
+                {
+                    std::vector<const char*> presetNames;
+                    for (const std::string& name : m_vrsPresetNames)
+                        presetNames.push_back(name.c_str());
+                    if (ImGui::Combo("VRS Preset", &m_activeVrsPreset, presetNames.data(), (int)presetNames.size()))
+                    {
+                        m_state.m_vrsVarianceThreshold = m_vrsPresets[m_activeVrsPreset].vrsVarianceThreshold;
+                        m_state.m_vrsMotionFactor = m_vrsPresets[m_activeVrsPreset].vrsMotionFactor;
+                    }
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Pareto optimal threshold and motion factor found by the offline preset sweep");
+                }
+
                 ImGui::SliderFloat("VRS variance Threshold", &m_state.m_vrsVarianceThreshold, 0.0f, 0.1f, "%.3f");
                 if (ImGui::IsItemHovered()) ImGui::SetTooltip("This value specifies how much variance in luminance is acceptable to reduce shading rate");
 
                 ImGui::SliderFloat("VRS Motion Factor", &m_state.m_vrsMotionFactor, 0.0f, 0.1f, "%.3f");
                 if (ImGui::IsItemHovered()) ImGui::SetTooltip("The lower this value, the faster a pixel has to move to get the shading rate reduced");
 
-                if (m_state.m_enableShadingRateImage)
-                    ImGui::Combo("ShadingRateImage Combiner", &m_state.m_vrsImageCombiner, combinersEnabled, _countof(combinersEnabled));
-                else
-                    ImGui::Combo("ShadingRateImage Combiner", &m_state.m_vrsImageCombiner, combinersDisabled, _countof(combinersDisabled));
-                if (ImGui::IsItemHovered()) ImGui::SetTooltip("How to combine shading rate from image with base shading rate");
+                if (m_node->GetMaxVrsInputMipLevel() > 0)
+                {
+                    ImGui::SliderInt("VRS Input Mip Level", &m_state.m_vrsInputMipLevel, 0, (int)m_node->GetMaxVrsInputMipLevel());
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("0 analyzes a full resolution copy of the previous frame, higher levels read the bloom downsample chain instead");
+                }
+
+                const char* luminanceTransforms[] = { "Auto", "None", "sRGB", "Log2", "PQ", "Weber" };
+                if (ImGui::Combo("VRS Luminance Transform", &m_state.m_vrsLuminanceTransform, luminanceTransforms, _countof(luminanceTransforms)))
+                {
+                    // the generation shaders are recompiled
+                    m_device.GPUFlush();
+                    m_node->SetVrsLuminanceTransform(m_state.m_vrsLuminanceTransform);
+                }
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Perceptual transform of linear luminance before the variance, so the threshold means the same for SDR and HDR output. Auto: sRGB in the HDR display modes");
+
+                ImGui::SliderInt("VRS Dilation Radius", &m_state.m_vrsDilationRadius, 0, 16);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Every tile takes the finest rate within this many tiles, a wider safety margin for fast moving content");
+                if (m_state.m_vrsDilationRadius > 0)
+                {
+                    const char* dilationShapes[] = { "Diamond", "Square" };
+                    ImGui::Combo("VRS Dilation Shape", &m_state.m_vrsDilationShape, dilationShapes, _countof(dilationShapes));
+                }
+
+                if (m_node->GetVrsTier() > D3D12_VARIABLE_SHADING_RATE_TIER_1)
+                {
+                    if (m_state.m_enableShadingRateImage)
+                        ImGui::Combo("ShadingRateImage Combiner", &m_state.m_vrsImageCombiner, combinersEnabled, _countof(combinersEnabled));
+                    else
+                        ImGui::Combo("ShadingRateImage Combiner", &m_state.m_vrsImageCombiner, combinersDisabled, _countof(combinersDisabled));
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("How to combine shading rate from image with base shading rate");
+                }
+
+                ImGui::Checkbox("Encoder QP Map", &m_state.m_encoderQpMap);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("Write per tile statistics and convert them to per macroblock QP offsets for a video encoder");
+                if (m_state.m_encoderQpMap && !m_node->GetEncoderQpOffsets().empty())
+                {
+                    const std::vector<float>& qpOffsets = m_node->GetEncoderQpOffsets();
+                    auto range = std::minmax_element(qpOffsets.begin(), qpOffsets.end());
+                    ImGui::Indent();
+                    ImGui::Text("QP offsets       : %.1f .. %.1f", *range.first, *range.second);
+                    ImGui::Unindent();
+                }
+
+                if (m_node->SoftwareVrsToneMappingSupported())
+                {
+                    ImGui::Separator();
+                    ImGui::Checkbox("SW VRS Tonemapping", &m_state.m_softwareVrsToneMapping);
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Compute tonemapping evaluates one sample per coarse pixel of the shading rate image (FreeSync HDR modes)");
+
+                    if (m_state.m_softwareVrsToneMapping)
+                    {
+                        ImGui::Indent();
+                        ImGui::Checkbox("Show Difference to Full Rate", &m_state.m_showSoftwareVrsDifference);
+                        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Output the magnified difference between software VRS and full rate tonemapping");
+                        ImGui::Checkbox("Use Tile Lists", &m_state.m_softwareVrsTileLists);
+                        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Dispatch indirectly over per rate tile lists written by the VRS image generation");
+                        ImGui::Unindent();
+                    }
+                }
             }
         }
         else
@@ -495,6 +632,22 @@ void VariableShadingSample::BuildUI()
             for (uint32_t i = 0; i < 128 - 1; i++) { values[i] = values[i + 1]; }
             ImGui::PlotLines("", values, 128, 0, "GPU frame time (us)", 0.0f, 30000.0f, ImVec2(0, 80));
         }
+
+        // Chrome JSON opens in chrome://tracing and ui.perfetto.dev, Perfetto protobuf in ui.perfetto.dev
+        const char* traceFormats[] = { "Chrome JSON", "Perfetto" };
+        const char* traceFiles[] = { "VariableShading.trace.json", "VariableShading.pftrace" };
+        if (m_traceWriter.Running())
+        {
+            ImGui::Text("Recording %s", traceFiles[m_traceFormat]);
+            if (ImGui::Button("Stop Trace"))
+                m_traceWriter.Stop();
+        }
+        else
+        {
+            ImGui::Combo("Trace Format", &m_traceFormat, traceFormats, _countof(traceFormats));
+            if (ImGui::Button("Start Trace"))
+                m_traceWriter.Start(traceFiles[m_traceFormat], (uint32_t)m_traceFormat);
+        }
     }
 
     ImGui::End();
@@ -554,6 +707,8 @@ void VariableShadingSample::BuildUI()
 //--------------------------------------------------------------------------------------
 void VariableShadingSample::OnRender()
 {
+    FFX_VARIABLESHADING_TRACE_SCOPE("Frame", "CPU");
+
     // Get timings
     //
     double timeNow = MillisecondsNow();
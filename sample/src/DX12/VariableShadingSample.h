@@ -78,9 +78,23 @@ private:
     std::vector<std::string>    m_sceneNames;
     int                         m_activeScene;
     int                         m_activeCamera;
+
+    // VRS parameter presets of the active scene, written by FfxVariableShading_PresetSweep
+    struct VrsPreset
+    {
+        float                   vrsVarianceThreshold;
+        float                   vrsMotionFactor;
+    };
+    std::vector<VrsPreset>      m_vrsPresets;
+    std::vector<std::string>    m_vrsPresetNames;
+    int                         m_activeVrsPreset = -1;
     bool                        m_stablePowerState;
     bool                        m_isCpuValidationLayerEnabled;
     bool                        m_isGpuValidationLayerEnabled;
 
     bool                        m_play;
+
+    // timeline trace of the CPU generator and the GPU passes, see ffx_variable_shading_trace.h
+    FFX_VariableShading_TraceWriter m_traceWriter;
+    int                         m_traceFormat = FFX_VARIABLESHADING_TRACE_FORMAT_CHROME_JSON;
 };
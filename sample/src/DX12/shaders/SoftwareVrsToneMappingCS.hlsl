@@ -0,0 +1,82 @@
+// AMD FidelityFX Variable Shading Sample code
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// This is the user side integration of ffx_variable_shading_software.h for an in place tonemapping pass
+// The shader needs to implement functions for reading the VRS image, evaluating the pass for one pixel
+// and writing the result
+// it also needs to provide the compute shader entry function and call FFX_VariableShading_SoftwareVrs_Execute
+// (or FFX_VariableShading_SoftwareVrs_ExecuteTile when dispatched over tile lists)
+
+#include "tonemappers.hlsl"
+
+// Constant Buffer
+cbuffer cbPerFrame : register(b0)
+{
+    float   u_exposure;
+    int     u_toneMapper;
+    int2    u_resolution;
+    uint    u_tileSize;
+    uint    u_showDifference;
+    uint    u_shadingRate;      // tile lists only
+    uint    u_tileListOffset;   // tile lists only
+}
+
+// Texture definitions
+RWTexture2D<float4>  HDR                : register(u0);
+Texture2D<uint>      vrsImage           : register(t0);
+StructuredBuffer<uint> tileLists        : register(t1);
+
+#define FFX_HLSL 1
+#include "ffx_variable_shading_software.h"
+
+uint FFX_VariableShading_ReadShadingRate(int2 tile)
+{
+    return vrsImage[tile];
+}
+
+float4 FFX_VariableShading_EvaluatePixel(int2 pos)
+{
+    float4 texColor = HDR[pos];
+    return float4(Tonemap(texColor.rgb, u_exposure, u_toneMapper), 1);
+}
+
+void FFX_VariableShading_WritePixel(int2 pos, float4 value)
+{
+    if (u_showDifference)
+    {
+        // validation: compare against full rate (pos has not been written yet, so HDR[pos] is still the input)
+        float4 fullRate = FFX_VariableShading_EvaluatePixel(pos);
+        value = float4(abs(value.rgb - fullRate.rgb) * 10.0f, 1);
+    }
+
+    HDR[pos] = value;
+}
+
+[numthreads(FFX_VariableShading_SoftwareVrs_ThreadCount1D, FFX_VariableShading_SoftwareVrs_ThreadCount1D, 1)]
+void mainCS(uint3 DTid : SV_DispatchThreadID)
+{
+    FFX_VariableShading_SoftwareVrs_Execute(DTid, u_resolution, u_tileSize);
+}
+
+[numthreads(FFX_VariableShading_SoftwareVrs_ThreadCount1D, FFX_VariableShading_SoftwareVrs_ThreadCount1D, 1)]
+void mainTileListCS(uint3 Gid : SV_GroupID, uint3 Gtid : SV_GroupThreadID)
+{
+    uint tile = tileLists[u_tileListOffset + Gid.x];
+    FFX_VariableShading_SoftwareVrs_ExecuteTile(int2(tile & 0xffff, tile >> 16), Gtid, u_resolution, u_tileSize, u_shadingRate);
+}
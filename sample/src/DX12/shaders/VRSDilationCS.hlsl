@@ -0,0 +1,80 @@
+// AMD FidelityFX Variable Shading Sample code
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// This is the user side integration of ffx_variable_shading_dilation.h
+// The shader needs to implement functions for reading and writing the shading rates of the
+// padded dilation domain, it also needs to provide the compute shader entry functions and call
+// FFX_VariableShading_Dilation_Line and FFX_VariableShading_Dilation_Plus
+
+// Constant Buffer
+cbuffer cbDilation : register(b0)
+{
+    int2    u_resolution;   // padded domain
+    int2    u_direction;
+    uint    u_radius;
+    int     u_padding;      // tiles between the domain and the VRS image
+    uint    u_input;        // index into images: 0 VRS image, 1 and 2 scratch images
+    uint    u_output;
+}
+
+// images[0] is the VRS image, the scratch images hold the whole padded domain
+RWTexture2D<uint>    images[3]          : register(u0);
+
+#define FFX_HLSL 1
+#include "ffx_variable_shading_dilation.h"
+
+uint FFX_VariableShading_ReadDilationInput(int2 tile)
+{
+    if (u_input != 0)
+        return images[u_input][tile];
+
+    uint width, height;
+    images[0].GetDimensions(width, height);
+    int2 pos = tile - u_padding;
+    if ((pos.x < 0) || (pos.y < 0) || (pos.x >= (int)width) || (pos.y >= (int)height))
+        return FFX_VariableShading_Dilation_Identity;
+    return images[0][pos];
+}
+
+void FFX_VariableShading_WriteDilationOutput(int2 tile, uint shadingRate)
+{
+    if (u_output != 0)
+    {
+        images[u_output][tile] = shadingRate;
+        return;
+    }
+
+    uint width, height;
+    images[0].GetDimensions(width, height);
+    int2 pos = tile - u_padding;
+    if ((pos.x >= 0) && (pos.y >= 0) && (pos.x < (int)width) && (pos.y < (int)height))
+        images[0][pos] = shadingRate;
+}
+
+[numthreads(64, 1, 1)]
+void mainLineCS(uint3 Gid : SV_GroupID, uint Gidx : SV_GroupIndex)
+{
+    FFX_VariableShading_Dilation_Line(Gid, Gidx, u_resolution, u_direction, u_radius);
+}
+
+[numthreads(8, 8, 1)]
+void mainPlusCS(uint3 DTid : SV_DispatchThreadID)
+{
+    FFX_VariableShading_Dilation_Plus(DTid, u_resolution);
+}
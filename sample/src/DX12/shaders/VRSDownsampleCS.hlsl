@@ -0,0 +1,56 @@
+// AMD FidelityFX Variable Shading Sample code
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// This is the user side integration of ffx_variable_shading_downsample.h
+// The shader needs to implement functions for reading the source VRS image and writing the
+// derived one, it also needs to provide the compute shader entry function and call
+// FFX_VariableShading_Downsample
+
+// Constant Buffer, FFX_VariableShading_DownsampleCB
+cbuffer cbDownsample : register(b0)
+{
+    uint2   u_srcSize;
+    uint2   u_dstSize;
+    uint2   u_scaleNum;
+    uint2   u_scaleDen;
+    int2    u_rateShift;
+    uint    u_maxRate1D;
+}
+
+Texture2D<uint>      texSource          : register(t0);
+RWTexture2D<uint>    imgDestination     : register(u0);
+
+#define FFX_HLSL 1
+#include "ffx_variable_shading_downsample.h"
+
+uint FFX_VariableShading_ReadDownsampleInput(int2 tile)
+{
+    return texSource[tile];
+}
+
+void FFX_VariableShading_WriteDownsampleOutput(int2 tile, uint shadingRate)
+{
+    imgDestination[tile] = shadingRate;
+}
+
+[numthreads(8, 8, 1)]
+void mainCS(uint3 DTid : SV_DispatchThreadID)
+{
+    FFX_VariableShading_Downsample(DTid, u_srcSize, u_dstSize, u_scaleNum, u_scaleDen, u_rateShift, u_maxRate1D);
+}
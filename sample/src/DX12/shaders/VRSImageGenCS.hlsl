@@ -25,23 +25,89 @@
 // Defines required:
 // FFX_VARIABLESHADING_TILESIZE
 // FFX_VARIABLESHADING_ADDITIONALSHADINGRATES (if additional shading rates should be used)
+// FFX_VARIABLESHADING_TILELISTS (if per rate tile lists should be written)
+// FFX_VARIABLESHADING_TILESTATS (if the per tile statistics plane for video encoders should be written)
+// FFX_VARIABLESHADING_CAPPEDIMAGE (if a second VRS image limited to 2x2 should be written)
+// VRS_INPUT_MIPLEVEL (optional, read level VRS_INPUT_MIPLEVEL - 1 of texColorMips instead of texColor,
+//                     FFX_VARIABLESHADING_TILESIZE has to be divided by 2^VRS_INPUT_MIPLEVEL)
+// FFX_VARIABLESHADING_LUMINANCE_TRANSFORM (optional, see ffx_variable_shading_luminance.h: the
+//                     transform of linear luminance the variance is computed on, default none)
+// VRS_INPUT_LINEAR (texColor holds linear values, the copy of the HDR display modes,
+//                     otherwise it is sRGB encoded; only read with a luminance transform)
+
+#ifndef VRS_INPUT_MIPLEVEL
+#define VRS_INPUT_MIPLEVEL 0
+#endif
+
+#ifndef VRS_INPUT_LINEAR
+#define VRS_INPUT_LINEAR 0
+#endif
 
 // Texture definitions
 RWTexture2D<uint>    imgDestination     : register(u0);
 Texture2D            texColor           : register(t0);
 Texture2D            texVelocity        : register(t1);
+RWByteAddressBuffer  bufTileListArgs    : register(u1); // D3D12_DISPATCH_ARGUMENTS per rate class
+RWStructuredBuffer<uint> bufTileLists   : register(u2);
+RWTexture2D<float4>  imgTileStats       : register(u3);
+RWTexture2D<uint>    imgCappedDestination : register(u4);
+Texture2D            texColorMips       : register(t2); // DownSamplePS chain of the HDR buffer, mip 0 is half resolution
 
 // must be after the declaration of imgDestination
 #define FFX_HLSL 1
 #include "ffx_Variable_Shading.h"
+#include "ffx_variable_shading_luminance.h"
+
+// linear luminance of the previous frame, pos is clamped to the input
+float VRS_ReadLinearLuminance(int2 pos)
+{
+#if VRS_INPUT_MIPLEVEL > 0
+    uint mipWidth, mipHeight, mipCount;
+    texColorMips.GetDimensions(VRS_INPUT_MIPLEVEL - 1, mipWidth, mipHeight, mipCount);
+    float3 color = texColorMips.Load(int3(clamp(pos, 0, int2(mipWidth, mipHeight) - 1), VRS_INPUT_MIPLEVEL - 1)).xyz;
+#else
+    uint width, height;
+    texColor.GetDimensions(width, height);
+    float3 color = texColor[clamp(pos, 0, int2(width, height) - 1)].xyz;
+#if !VRS_INPUT_LINEAR
+    color = float3(FFX_VariableShading_SrgbToLinear(color.r), FFX_VariableShading_SrgbToLinear(color.g), FFX_VariableShading_SrgbToLinear(color.b));
+#endif
+#endif
+    return dot(color, float3(0.30, 0.59, 0.11));
+}
 
 // read a value from previous frames color buffer and return luminance
 float FFX_VariableShading_ReadLuminance(int2 pos)
 {
+#if FFX_VARIABLESHADING_LUMINANCE_TRANSFORM == FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_WEBER
+    // contrast to the 3x3 neighbourhood, independent of the brightness
+    float sum = 0.0;
+    for (int y = -1; y <= 1; ++y)
+    {
+        for (int x = -1; x <= 1; ++x)
+        {
+            sum += VRS_ReadLinearLuminance(pos + int2(x, y));
+        }
+    }
+    return FFX_VariableShading_WeberContrast(VRS_ReadLinearLuminance(pos), sum / 9.0);
+#elif FFX_VARIABLESHADING_LUMINANCE_TRANSFORM != FFX_VARIABLESHADING_LUMINANCE_TRANSFORM_NONE
+    return FFX_VariableShading_TransformLuminance(VRS_ReadLinearLuminance(pos));
+#else
+#if VRS_INPUT_MIPLEVEL > 0
+    uint mipWidth, mipHeight, mipCount;
+    texColorMips.GetDimensions(VRS_INPUT_MIPLEVEL - 1, mipWidth, mipHeight, mipCount);
+    float3 color = texColorMips.Load(int3(min(pos, int2(mipWidth, mipHeight) - 1), VRS_INPUT_MIPLEVEL - 1)).xyz;
+
+    // the mip chain is linear HDR, compress it to a similar range as the tonemapped copy
+    float lum = dot(color, float3(0.30, 0.59, 0.11));
+    return lum / (1.0f + lum);
+#else
     float3 color = texColor[pos].xyz;
 
     // return color value converted to grayscale
     return dot(color, float3(0.30, 0.59, 0.11));
+#endif
+#endif
 
     // in some cases using different weights, linearizing the color values 
     // or multiplying luminance with a value based on specularity or depth
@@ -52,7 +118,8 @@ float FFX_VariableShading_ReadLuminance(int2 pos)
 float2 FFX_VariableShading_ReadMotionVec2D(int2 pos)
 {
     // return 0 to not use motion vectors
-    return texVelocity[pos].xy * float2(0.5f, -0.5f) * g_Resolution;
+    // g_Resolution is the resolution of the input mip level, so this returns motion in texels of that level
+    return texVelocity[pos << VRS_INPUT_MIPLEVEL].xy * float2(0.5f, -0.5f) * g_Resolution;
 }
 
 void FFX_VariableShading_WriteVrsImage(int2 pos, uint value)
@@ -60,6 +127,38 @@ void FFX_VariableShading_WriteVrsImage(int2 pos, uint value)
     imgDestination[pos] = value;
 }
 
+#if defined FFX_VARIABLESHADING_TILELISTS
+uint FFX_VariableShading_ReserveTileListEntries(uint rateClass, uint count)
+{
+    // ThreadGroupCountX is the number of entries in the list
+    uint index;
+    bufTileListArgs.InterlockedAdd(rateClass * 12, count, index);
+    return index;
+}
+
+void FFX_VariableShading_WriteTileListEntry(uint rateClass, uint index, int2 tile)
+{
+    // every list can hold all tiles of the VRS image, tiles are in VRS image coordinates even when the viewport is smaller
+    uint2 vrsImageSize;
+    imgDestination.GetDimensions(vrsImageSize.x, vrsImageSize.y);
+    bufTileLists[rateClass * vrsImageSize.x * vrsImageSize.y + index] = tile.x | (tile.y << 16);
+}
+#endif
+
+#if defined FFX_VARIABLESHADING_TILESTATS
+void FFX_VariableShading_WriteTileStats(int2 tile, float4 stats)
+{
+    imgTileStats[tile] = stats;
+}
+#endif
+
+#if defined FFX_VARIABLESHADING_CAPPEDIMAGE
+void FFX_VariableShading_WriteCappedVrsImage(int2 pos, uint value)
+{
+    imgCappedDestination[pos] = value;
+}
+#endif
+
 [numthreads(FFX_VariableShading_ThreadCount1D, FFX_VariableShading_ThreadCount1D, 1)]
 void mainCS(
     uint3 Gid  : SV_GroupID,
@@ -37,6 +37,7 @@ cbuffer FFX_Variable_Shading_CB0
     uint    g_TileSize;
     float   g_VarianceCutoff;
     float   g_MotionFactor;
+    int2    g_ViewportOffset;
 }
 
 Texture2D<uint> inU8 : register(t0);
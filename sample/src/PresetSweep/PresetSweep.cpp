@@ -0,0 +1,326 @@
+// AMD FidelityFX Variable Shading Sample code
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Offline sweep of the VRS image generation parameters (vrsVarianceThreshold, vrsMotionFactor)
+// over captured luminance/motion sequences. Writes the Pareto optimal settings (coarse pixel
+// savings vs. simulated error) of every scene to <out-dir>/<scene name>.json, which the sample
+// loads from VrsPresets/ next to VariableShadingSample.json.
+
+#include "Sweep.h"
+
+#include "ffx_variable_shading_cpu.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <thread>
+
+struct Scene
+{
+    std::string                 name;
+    std::vector<std::string>    files;
+};
+
+static void PrintUsage()
+{
+    printf(
+        "usage: FfxVariableShading_PresetSweep [options] --scene NAME SEQUENCE... [--scene NAME SEQUENCE...]\n"
+        "\n"
+        "  --search grid|bayes     search strategy (default grid)\n"
+        "  --threshold MIN:MAX:N   vrsVarianceThreshold range, log spaced (default 0.001:0.1:24)\n"
+        "  --motion MIN:MAX:N      vrsMotionFactor range, linear (default 0:0.1:11)\n"
+        "  --iterations N          bayes: number of batches after the initial design (default 16)\n"
+        "  --batch N               bayes: candidates per batch (default: thread count)\n"
+        "  --seed N                bayes: random seed (default 1)\n"
+        "  --tile-size N           VRS tile size (default 16)\n"
+        "  --additional-rates      generate 2x4, 4x2 and 4x4 rates\n"
+        "  --mip N                 input mip level (FFX_VariableShading_SetInputMipLevel)\n"
+        "  --swizzle               keep the luminance in tile sized blocks (FFX_VARIABLESHADING_LUMINANCE_LAYOUT_SWIZZLED)\n"
+        "  --neighbourhood [square:]R\n"
+        "                          burn in protection radius in coarse pixels, diamond unless square: (default 1)\n"
+        "  --motion-masking K      weight errors by 1 / (1 + K * motion in pixels) (default 0)\n"
+        "  --max-error E           default preset: max savings with an error <= E (default: knee of the front)\n"
+        "  --threads N             worker threads (default: hardware concurrency)\n"
+        "  --out-dir DIR           output directory (default .)\n"
+#if defined(FFX_VARIABLESHADING_TRACE)
+        "  --trace FILE            record a timeline, Perfetto protobuf for *.pftrace, Chrome JSON otherwise\n"
+#endif
+        );
+}
+
+static bool ParseRange(const char* text, SweepRange* pRange)
+{
+    float minValue, maxValue;
+    unsigned steps = pRange->steps;
+    int count = sscanf(text, "%f:%f:%u", &minValue, &maxValue, &steps);
+    if (count < 2 || maxValue < minValue || (pRange->logarithmic && minValue <= 0.0f))
+        return false;
+
+    pRange->minValue = minValue;
+    pRange->maxValue = maxValue;
+    pRange->steps = steps;
+    return true;
+}
+
+#if defined(FFX_VARIABLESHADING_PROFILE)
+static void PrintProfile()
+{
+    FFX_VariableShading_ProfileCounters totals;
+    FFX_VariableShading_GetProfileTotals(&totals);
+
+    uint64_t totalTicks = 0;
+    for (uint32_t stage = 0; stage < FFX_VARIABLESHADING_PROFILE_STAGE_COUNT; ++stage)
+        totalTicks += totals.stageTicks[stage];
+
+    const double ticksPerMs = FFX_VariableShading_GetTimestampFrequency() / 1000.0;
+    printf("  generator: %llu tiles on %u threads, %.1f MB read\n", (unsigned long long)totals.tiles, FFX_VariableShading_GetProfileThreadCount(), totals.bytesRead / (1024.0 * 1024.0));
+    for (uint32_t stage = 0; stage < FFX_VARIABLESHADING_PROFILE_STAGE_COUNT; ++stage)
+    {
+        printf("    %-16s %10.2f ms %5.1f%%\n", FFX_VariableShading_GetProfileStageName(stage), totals.stageTicks[stage] / ticksPerMs,
+            totalTicks ? 100.0 * totals.stageTicks[stage] / totalTicks : 0.0);
+    }
+    if (FFX_VariableShading_HardwareCountersAvailable())
+    {
+        printf("    IPC %.2f, cache misses %.1f%% of %llu references\n", totals.cpuCycles ? (double)totals.instructions / totals.cpuCycles : 0.0,
+            totals.cacheReferences ? 100.0 * totals.cacheMisses / totals.cacheReferences : 0.0, (unsigned long long)totals.cacheReferences);
+    }
+}
+#endif
+
+static bool WritePresets(const std::string& fileName, const std::string& sceneName, const std::vector<SweepResult>& front, size_t preset)
+{
+    FILE* f = fopen(fileName.c_str(), "w");
+    if (!f)
+        return false;
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"name\": \"%s\",\n", sceneName.c_str());
+    fprintf(f, "  \"vrsVarianceThreshold\": %.6g,\n", front[preset].params.vrsVarianceThreshold);
+    fprintf(f, "  \"vrsMotionFactor\": %.6g,\n", front[preset].params.vrsMotionFactor);
+    fprintf(f, "  \"vrsPresets\": [\n");
+    for (size_t i = 0; i < front.size(); ++i)
+    {
+        fprintf(f, "    { \"vrsVarianceThreshold\": %.6g, \"vrsMotionFactor\": %.6g, \"savings\": %.4f, \"error\": %.6f }%s\n",
+            front[i].params.vrsVarianceThreshold, front[i].params.vrsMotionFactor, front[i].savings, front[i].error, (i + 1 < front.size()) ? "," : "");
+    }
+    fprintf(f, "  ]\n");
+    fprintf(f, "}\n");
+
+    return fclose(f) == 0;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<Scene> scenes;
+    std::string search = "grid";
+    std::string outDir = ".";
+    SweepRange threshold = { 0.001f, 0.1f, 24, true };
+    SweepRange motionFactor = { 0.0f, 0.1f, 11, false };
+    SweepSettings settings;
+    uint32_t iterations = 16;
+    uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    uint32_t batchSize = 0;
+    uint32_t seed = 1;
+    double maxError = -1.0;
+    std::string traceFile;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const bool hasValue = (i + 1 < argc);
+
+        if (!strcmp(arg, "--scene") && hasValue)
+        {
+            scenes.push_back({ argv[++i], {} });
+        }
+        else if (!strcmp(arg, "--search") && hasValue)
+        {
+            search = argv[++i];
+        }
+        else if (!strcmp(arg, "--threshold") && hasValue)
+        {
+            if (!ParseRange(argv[++i], &threshold))
+            {
+                fprintf(stderr, "invalid threshold range %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (!strcmp(arg, "--motion") && hasValue)
+        {
+            if (!ParseRange(argv[++i], &motionFactor))
+            {
+                fprintf(stderr, "invalid motion factor range %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (!strcmp(arg, "--iterations") && hasValue)
+            iterations = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(arg, "--batch") && hasValue)
+            batchSize = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(arg, "--seed") && hasValue)
+            seed = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(arg, "--tile-size") && hasValue)
+            settings.tileSize = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(arg, "--additional-rates"))
+            settings.additionalShadingRates = true;
+        else if (!strcmp(arg, "--mip") && hasValue)
+            settings.inputMipLevel = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(arg, "--swizzle"))
+            settings.swizzledLuminance = true;
+        else if (!strcmp(arg, "--neighbourhood") && hasValue)
+        {
+            const char* value = argv[++i];
+            settings.neighbourhoodShape = FFX_VARIABLESHADING_NEIGHBOURHOOD_DIAMOND;
+            if (!strncmp(value, "square:", 7))
+            {
+                settings.neighbourhoodShape = FFX_VARIABLESHADING_NEIGHBOURHOOD_SQUARE;
+                value += 7;
+            }
+            settings.neighbourhoodRadius = (uint32_t)atoi(value);
+        }
+        else if (!strcmp(arg, "--motion-masking") && hasValue)
+            settings.motionMasking = (float)atof(argv[++i]);
+        else if (!strcmp(arg, "--max-error") && hasValue)
+            maxError = atof(argv[++i]);
+        else if (!strcmp(arg, "--threads") && hasValue)
+            threadCount = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(arg, "--out-dir") && hasValue)
+            outDir = argv[++i];
+#if defined(FFX_VARIABLESHADING_TRACE)
+        else if (!strcmp(arg, "--trace") && hasValue)
+            traceFile = argv[++i];
+#endif
+        else if (arg[0] != '-' && !scenes.empty())
+            scenes.back().files.push_back(arg);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (scenes.empty() || (search != "grid" && search != "bayes"))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if (settings.tileSize != 8 && settings.tileSize != 16 && settings.tileSize != 32)
+    {
+        fprintf(stderr, "tile size has to be 8, 16 or 32\n");
+        return 1;
+    }
+
+    if (settings.inputMipLevel > FFX_VariableShading_GetMaxInputMipLevel(settings.tileSize))
+    {
+        fprintf(stderr, "input mip level %u needs tiles of at least %u pixels\n", settings.inputMipLevel, 8u << settings.inputMipLevel);
+        return 1;
+    }
+
+#if defined(FFX_VARIABLESHADING_PROFILE)
+    FFX_VariableShading_SetHardwareCountersEnabled(true);
+#endif
+
+#if defined(FFX_VARIABLESHADING_TRACE)
+    FFX_VariableShading_TraceWriter traceWriter;
+    if (!traceFile.empty())
+    {
+        const bool perfetto = traceFile.size() > 8 && traceFile.compare(traceFile.size() - 8, 8, ".pftrace") == 0;
+        if (!traceWriter.Start(traceFile.c_str(), perfetto ? FFX_VARIABLESHADING_TRACE_FORMAT_PERFETTO : FFX_VARIABLESHADING_TRACE_FORMAT_CHROME_JSON))
+        {
+            fprintf(stderr, "can't write %s\n", traceFile.c_str());
+            return 1;
+        }
+        FFX_VariableShading_SetTraceThreadName("Main");
+    }
+#endif
+
+    for (const Scene& scene : scenes)
+    {
+        if (scene.files.empty())
+        {
+            fprintf(stderr, "no sequences for scene %s\n", scene.name.c_str());
+            return 1;
+        }
+
+        std::vector<VrsSequence> sequences(scene.files.size());
+        for (size_t i = 0; i < scene.files.size(); ++i)
+        {
+            std::string error;
+            if (!LoadVrsSequence(scene.files[i], &sequences[i], &error))
+            {
+                fprintf(stderr, "%s\n", error.c_str());
+                return 1;
+            }
+            if (sequences[i].frames.size() < 2)
+            {
+                fprintf(stderr, "%s: a sequence needs at least 2 frames\n", scene.files[i].c_str());
+                return 1;
+            }
+            sequences[i].name = scene.files[i];
+        }
+
+        FFX_VARIABLESHADING_TRACE_SCOPE("Scene", "Sweep");
+
+        SweepEvaluator evaluator;
+        evaluator.OnCreate(&sequences, settings);
+
+        std::vector<SweepResult> results;
+        if (search == "grid")
+            results = GridSearch(evaluator, threshold, motionFactor, threadCount);
+        else
+            results = BayesianSearch(evaluator, threshold, motionFactor, iterations, batchSize ? batchSize : threadCount, seed, threadCount);
+
+        evaluator.OnDestroy();
+
+#if defined(FFX_VARIABLESHADING_PROFILE)
+        PrintProfile();
+        FFX_VariableShading_ResetProfileCounters();
+#endif
+
+        std::vector<SweepResult> front = GetParetoFront(results);
+        size_t preset = SelectPreset(front, maxError);
+
+        printf("%s: %zu settings evaluated, %zu on the Pareto front\n", scene.name.c_str(), results.size(), front.size());
+        for (size_t i = 0; i < front.size(); ++i)
+        {
+            printf("  %c threshold %.4f  motion factor %.4f  savings %5.1f%%  error %.5f\n", (i == preset) ? '*' : ' ',
+                front[i].params.vrsVarianceThreshold, front[i].params.vrsMotionFactor, 100.0 * front[i].savings, front[i].error);
+        }
+
+        std::string fileName = outDir + "/" + scene.name + ".json";
+        if (!WritePresets(fileName, scene.name, front, preset))
+        {
+            fprintf(stderr, "can't write %s\n", fileName.c_str());
+            return 1;
+        }
+    }
+
+#if defined(FFX_VARIABLESHADING_TRACE)
+    if (traceWriter.Running())
+    {
+        traceWriter.Stop();
+        if (traceWriter.DroppedEvents())
+            fprintf(stderr, "trace: %llu events dropped\n", (unsigned long long)traceWriter.DroppedEvents());
+    }
+#endif
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+// AMD FidelityFX Variable Shading Sample code
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "Sequence.h"
+
+#include <fstream>
+#include <string.h>
+
+static const char     VrsSequenceMagic[4] = { 'F', 'V', 'R', 'S' };
+static const uint32_t VrsSequenceVersion = 1;
+
+bool LoadVrsSequence(const std::string& fileName, VrsSequence* pSequence, std::string* pError)
+{
+    std::ifstream f(fileName, std::ios::binary);
+    if (!f)
+    {
+        *pError = "can't open " + fileName;
+        return false;
+    }
+
+    char magic[4];
+    uint32_t header[4];
+    f.read(magic, sizeof(magic));
+    f.read((char*)header, sizeof(header));
+    if (!f || memcmp(magic, VrsSequenceMagic, sizeof(magic)) != 0 || header[0] != VrsSequenceVersion)
+    {
+        *pError = fileName + " is not a version 1 VRS sequence";
+        return false;
+    }
+
+    pSequence->width = header[1];
+    pSequence->height = header[2];
+    pSequence->frames.resize(header[3]);
+
+    const size_t pixelCount = (size_t)pSequence->width * pSequence->height;
+    for (VrsSequenceFrame& frame : pSequence->frames)
+    {
+        frame.luminance.resize(pixelCount);
+        frame.motion.resize(pixelCount * 2);
+        f.read((char*)frame.luminance.data(), frame.luminance.size() * sizeof(float));
+        f.read((char*)frame.motion.data(), frame.motion.size() * sizeof(float));
+    }
+
+    if (!f)
+    {
+        *pError = fileName + " is truncated";
+        return false;
+    }
+
+    return true;
+}
+
+bool SaveVrsSequence(const std::string& fileName, const VrsSequence& sequence)
+{
+    std::ofstream f(fileName, std::ios::binary);
+    if (!f)
+        return false;
+
+    const uint32_t header[4] = { VrsSequenceVersion, sequence.width, sequence.height, (uint32_t)sequence.frames.size() };
+    f.write(VrsSequenceMagic, sizeof(VrsSequenceMagic));
+    f.write((const char*)header, sizeof(header));
+    for (const VrsSequenceFrame& frame : sequence.frames)
+    {
+        f.write((const char*)frame.luminance.data(), frame.luminance.size() * sizeof(float));
+        f.write((const char*)frame.motion.data(), frame.motion.size() * sizeof(float));
+    }
+
+    return (bool)f;
+}
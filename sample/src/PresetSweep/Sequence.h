@@ -0,0 +1,51 @@
+// AMD FidelityFX Variable Shading Sample code
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// A captured sequence of generator inputs.
+//
+// File layout (.vrsseq, little endian):
+//   char     magic[4]      "FVRS"
+//   uint32_t version       1
+//   uint32_t width, height
+//   uint32_t frameCount
+//   per frame:
+//     float  luminance[height][width]       tonemapped luminance, roughly [0, 1]
+//     float  motion[height][width][2]       screen space motion in pixels (current - previous position)
+struct VrsSequenceFrame
+{
+    std::vector<float>  luminance;
+    std::vector<float>  motion;
+};
+
+struct VrsSequence
+{
+    std::string                     name;
+    uint32_t                        width = 0;
+    uint32_t                        height = 0;
+    std::vector<VrsSequenceFrame>   frames;
+};
+
+bool LoadVrsSequence(const std::string& fileName, VrsSequence* pSequence, std::string* pError);
+bool SaveVrsSequence(const std::string& fileName, const VrsSequence& sequence);
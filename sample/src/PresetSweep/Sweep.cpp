@@ -0,0 +1,508 @@
+// AMD FidelityFX Variable Shading Sample code
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "Sweep.h"
+
+#include "ffx_variable_shading_cpu.h"
+
+#include <atomic>
+#include <random>
+#include <thread>
+
+float SweepRange::GetValue(float t) const
+{
+    if (logarithmic)
+        return minValue * std::pow(maxValue / minValue, t);
+    return minValue + (maxValue - minValue) * t;
+}
+
+void ParallelFor(uint32_t count, uint32_t threadCount, const std::function<void(uint32_t)>& fn)
+{
+    threadCount = std::max(1u, std::min(threadCount, count));
+    if (threadCount == 1)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+            fn(i);
+        return;
+    }
+
+    std::atomic<uint32_t> next(0);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            for (uint32_t i = next++; i < count; i = next++)
+                fn(i);
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+//--------------------------------------------------------------------------------------
+//
+// SweepEvaluator
+//
+//--------------------------------------------------------------------------------------
+void SweepEvaluator::OnCreate(const std::vector<VrsSequence>* pSequences, const SweepSettings& settings)
+{
+    m_pSequences = pSequences;
+    m_settings = settings;
+
+    m_inputLuminance.resize(pSequences->size());
+    for (size_t s = 0; s < pSequences->size(); ++s)
+    {
+        const VrsSequence& sequence = (*pSequences)[s];
+        m_inputLuminance[s].resize(sequence.frames.size());
+        for (size_t f = 0; f < sequence.frames.size(); ++f)
+        {
+            std::vector<float> level = sequence.frames[f].luminance;
+            uint32_t width = sequence.width;
+            uint32_t height = sequence.height;
+            for (uint32_t mip = 0; mip < settings.inputMipLevel; ++mip)
+            {
+                std::vector<float> next(((width + 1) / 2) * ((height + 1) / 2));
+                FFX_VariableShading_DownsampleLuminance(level.data(), width, height, width, next.data(), (width + 1) / 2);
+                level.swap(next);
+                width = (width + 1) / 2;
+                height = (height + 1) / 2;
+            }
+            if (settings.swizzledLuminance)
+            {
+                const uint32_t blockSize = settings.tileSize >> settings.inputMipLevel;
+                std::vector<float> swizzled(FFX_VariableShading_GetSwizzledLuminanceSize(width, height, blockSize));
+                FFX_VariableShading_SwizzleLuminance(level.data(), width, height, width, blockSize, swizzled.data());
+                level.swap(swizzled);
+            }
+            m_inputLuminance[s][f].swap(level);
+        }
+    }
+}
+
+void SweepEvaluator::OnDestroy()
+{
+    m_inputLuminance.clear();
+    m_pSequences = nullptr;
+}
+
+SweepResult SweepEvaluator::Evaluate(const SweepParams& params) const
+{
+    FFX_VARIABLESHADING_TRACE_SCOPE("Evaluate", "Sweep");
+
+    uint64_t evaluations = 0;
+    uint64_t pixels = 0;
+    double weightedSquaredError = 0.0;
+    double weightSum = 0.0;
+
+    std::vector<uint8_t> vrsImage;
+    FFX_VariableShading_CpuGeneratorScratch scratch;
+    for (size_t s = 0; s < m_pSequences->size(); ++s)
+    {
+        const VrsSequence& sequence = (*m_pSequences)[s];
+
+        FFX_VariableShading_CB cb = {};
+        cb.width = sequence.width;
+        cb.height = sequence.height;
+        cb.tileSize = m_settings.tileSize;
+        cb.varianceCutoff = params.vrsVarianceThreshold;
+        cb.motionFactor = params.vrsMotionFactor;
+        FFX_VariableShading_SetInputMipLevel(&cb, m_settings.inputMipLevel);
+
+        const uint32_t vrsImageWidth = FFX_VariableShading_DivideRoundingUp(sequence.width, m_settings.tileSize);
+        const uint32_t vrsImageHeight = FFX_VariableShading_DivideRoundingUp(sequence.height, m_settings.tileSize);
+        vrsImage.resize(vrsImageWidth * vrsImageHeight);
+
+        for (size_t f = 1; f < sequence.frames.size(); ++f)
+        {
+            const VrsSequenceFrame& frame = sequence.frames[f];
+
+            FFX_VariableShading_CpuInputs inputs = {};
+            inputs.luminance = m_inputLuminance[s][f - 1].data();
+            inputs.luminancePitch = m_settings.swizzledLuminance ? FFX_VariableShading_GetSwizzledLuminancePitch(cb.width, cb.tileSize) : cb.width;
+            inputs.luminanceLayout = m_settings.swizzledLuminance ? FFX_VARIABLESHADING_LUMINANCE_LAYOUT_SWIZZLED : FFX_VARIABLESHADING_LUMINANCE_LAYOUT_LINEAR;
+            inputs.motionVectors = frame.motion.data();
+            inputs.motionVectorPitch = sequence.width * 2;
+            inputs.motionVectorWidth = sequence.width;
+            inputs.motionVectorHeight = sequence.height;
+            inputs.mipLevel = m_settings.inputMipLevel;
+            inputs.neighbourhoodShape = m_settings.neighbourhoodShape;
+            inputs.neighbourhoodRadius = m_settings.neighbourhoodRadius;
+            FFX_VariableShading_GenerateVrsImage(cb, m_settings.additionalShadingRates, inputs, vrsImage.data(), vrsImageWidth, scratch);
+
+            const float* luminance = frame.luminance.data();
+            const float* motion = frame.motion.data();
+            const uint32_t width = sequence.width;
+            evaluations += FFX_VariableShading_ExecuteRateAware(vrsImage.data(), vrsImageWidth, m_settings.tileSize, sequence.width, sequence.height,
+                [&](uint32_t x, uint32_t y) { return luminance[y * width + x]; },
+                [&](uint32_t x, uint32_t y, float value)
+                {
+                    double weight = 1.0;
+                    if (m_settings.motionMasking > 0.0f)
+                    {
+                        const float* mv = &motion[(y * width + x) * 2];
+                        weight = 1.0 / (1.0 + m_settings.motionMasking * std::sqrt(mv[0] * mv[0] + mv[1] * mv[1]));
+                    }
+                    double difference = value - luminance[y * width + x];
+                    weightedSquaredError += weight * difference * difference;
+                    weightSum += weight;
+                });
+            pixels += (uint64_t)sequence.width * sequence.height;
+        }
+    }
+
+    SweepResult result = {};
+    result.params = params;
+    result.savings = pixels ? 1.0 - (double)evaluations / (double)pixels : 0.0;
+    result.error = (weightSum > 0.0) ? std::sqrt(weightedSquaredError / weightSum) : 0.0;
+    return result;
+}
+
+//--------------------------------------------------------------------------------------
+//
+// Grid search
+//
+//--------------------------------------------------------------------------------------
+std::vector<SweepResult> GridSearch(const SweepEvaluator& evaluator, const SweepRange& threshold, const SweepRange& motionFactor, uint32_t threadCount)
+{
+    const uint32_t thresholdSteps = std::max(threshold.steps, 1u);
+    const uint32_t motionSteps = std::max(motionFactor.steps, 1u);
+
+    std::vector<SweepResult> results(thresholdSteps * motionSteps);
+    ParallelFor((uint32_t)results.size(), threadCount, [&](uint32_t i)
+    {
+        uint32_t t = i % thresholdSteps;
+        uint32_t m = i / thresholdSteps;
+
+        SweepParams params;
+        params.vrsVarianceThreshold = threshold.GetValue((thresholdSteps > 1) ? (float)t / (float)(thresholdSteps - 1) : 0.0f);
+        params.vrsMotionFactor = motionFactor.GetValue((motionSteps > 1) ? (float)m / (float)(motionSteps - 1) : 0.0f);
+        results[i] = evaluator.Evaluate(params);
+    });
+
+    return results;
+}
+
+//--------------------------------------------------------------------------------------
+//
+// Bayesian search
+//
+//--------------------------------------------------------------------------------------
+namespace
+{
+    struct UnitPoint
+    {
+        double  x, y;
+    };
+
+    // Gaussian process with a squared exponential kernel on standardized observations
+    class GaussianProcess
+    {
+    public:
+        bool Fit(const std::vector<UnitPoint>& points, const std::vector<double>& values)
+        {
+            const size_t n = points.size();
+            m_points = points;
+
+            m_mean = 0.0;
+            for (double v : values)
+                m_mean += v;
+            m_mean /= (double)n;
+            double variance = 0.0;
+            for (double v : values)
+                variance += (v - m_mean) * (v - m_mean);
+            m_scale = std::sqrt(variance / (double)n);
+            if (m_scale < 1e-12)
+                m_scale = 1.0;
+
+            // Cholesky decomposition of K + noise * I
+            m_cholesky.assign(n * n, 0.0);
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (size_t j = 0; j <= i; ++j)
+                {
+                    double sum = Kernel(points[i], points[j]) + ((i == j) ? Noise : 0.0);
+                    for (size_t k = 0; k < j; ++k)
+                        sum -= m_cholesky[i * n + k] * m_cholesky[j * n + k];
+
+                    if (i == j)
+                    {
+                        if (sum <= 0.0)
+                            return false;
+                        m_cholesky[i * n + i] = std::sqrt(sum);
+                    }
+                    else
+                    {
+                        m_cholesky[i * n + j] = sum / m_cholesky[j * n + j];
+                    }
+                }
+            }
+
+            // alpha = K^-1 * y
+            m_alpha.resize(n);
+            for (size_t i = 0; i < n; ++i)
+                m_alpha[i] = (values[i] - m_mean) / m_scale;
+            SolveLower(m_alpha);
+            SolveUpper(m_alpha);
+            return true;
+        }
+
+        void Predict(const UnitPoint& p, double& mean, double& sigma) const
+        {
+            const size_t n = m_points.size();
+            std::vector<double> k(n);
+            for (size_t i = 0; i < n; ++i)
+                k[i] = Kernel(p, m_points[i]);
+
+            double mu = 0.0;
+            for (size_t i = 0; i < n; ++i)
+                mu += k[i] * m_alpha[i];
+
+            SolveLower(k);
+            double variance = 1.0;
+            for (size_t i = 0; i < n; ++i)
+                variance -= k[i] * k[i];
+
+            mean = m_mean + mu * m_scale;
+            sigma = std::sqrt(std::max(variance, 1e-12)) * m_scale;
+        }
+
+    private:
+        static constexpr double LengthScale = 0.2;
+        static constexpr double Noise = 1e-6;
+
+        static double Kernel(const UnitPoint& a, const UnitPoint& b)
+        {
+            double dx = a.x - b.x;
+            double dy = a.y - b.y;
+            return std::exp(-(dx * dx + dy * dy) / (2.0 * LengthScale * LengthScale));
+        }
+
+        void SolveLower(std::vector<double>& v) const
+        {
+            const size_t n = m_points.size();
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (size_t k = 0; k < i; ++k)
+                    v[i] -= m_cholesky[i * n + k] * v[k];
+                v[i] /= m_cholesky[i * n + i];
+            }
+        }
+
+        void SolveUpper(std::vector<double>& v) const
+        {
+            const size_t n = m_points.size();
+            for (size_t i = n; i-- > 0;)
+            {
+                for (size_t k = i + 1; k < n; ++k)
+                    v[i] -= m_cholesky[k * n + i] * v[k];
+                v[i] /= m_cholesky[i * n + i];
+            }
+        }
+
+        std::vector<UnitPoint>  m_points;
+        std::vector<double>     m_cholesky;
+        std::vector<double>     m_alpha;
+        double                  m_mean = 0.0;
+        double                  m_scale = 1.0;
+    };
+
+    double ExpectedImprovement(double best, double mean, double sigma)
+    {
+        double z = (best - mean) / sigma;
+        double cdf = 0.5 * std::erfc(-z / std::sqrt(2.0));
+        double pdf = std::exp(-0.5 * z * z) / std::sqrt(2.0 * 3.14159265358979323846);
+        return (best - mean) * cdf + sigma * pdf;
+    }
+
+    // augmented Chebyshev scalarization of the normalized objectives
+    std::vector<double> Scalarize(const std::vector<SweepResult>& results, double weight)
+    {
+        double minError = results[0].error, maxError = results[0].error;
+        double minSavings = results[0].savings, maxSavings = results[0].savings;
+        for (const SweepResult& r : results)
+        {
+            minError = std::min(minError, r.error);
+            maxError = std::max(maxError, r.error);
+            minSavings = std::min(minSavings, r.savings);
+            maxSavings = std::max(maxSavings, r.savings);
+        }
+
+        std::vector<double> values(results.size());
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            double e = (maxError > minError) ? (results[i].error - minError) / (maxError - minError) : 0.0;
+            double c = (maxSavings > minSavings) ? (maxSavings - results[i].savings) / (maxSavings - minSavings) : 0.0;
+            values[i] = std::max(weight * e, (1.0 - weight) * c) + 0.05 * (weight * e + (1.0 - weight) * c);
+        }
+        return values;
+    }
+}
+
+std::vector<SweepResult> BayesianSearch(const SweepEvaluator& evaluator, const SweepRange& threshold, const SweepRange& motionFactor, uint32_t iterations, uint32_t batchSize, uint32_t seed, uint32_t threadCount)
+{
+    static const uint32_t CandidateCount = 2048;
+    static const double   MinDistance = 0.01;
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    batchSize = std::max(batchSize, 1u);
+
+    std::vector<UnitPoint> points;
+    std::vector<SweepResult> results;
+
+    auto evaluateBatch = [&](const std::vector<UnitPoint>& batch)
+    {
+        std::vector<SweepResult> batchResults(batch.size());
+        ParallelFor((uint32_t)batch.size(), threadCount, [&](uint32_t i)
+        {
+            SweepParams params;
+            params.vrsVarianceThreshold = threshold.GetValue((float)batch[i].x);
+            params.vrsMotionFactor = motionFactor.GetValue((float)batch[i].y);
+            batchResults[i] = evaluator.Evaluate(params);
+        });
+        points.insert(points.end(), batch.begin(), batch.end());
+        results.insert(results.end(), batchResults.begin(), batchResults.end());
+    };
+
+    // initial design: latin hypercube
+    {
+        const uint32_t initialCount = std::max(2 * batchSize, 8u);
+        std::vector<uint32_t> columnX(initialCount), columnY(initialCount);
+        for (uint32_t i = 0; i < initialCount; ++i)
+            columnX[i] = columnY[i] = i;
+        std::shuffle(columnX.begin(), columnX.end(), rng);
+        std::shuffle(columnY.begin(), columnY.end(), rng);
+
+        std::vector<UnitPoint> batch(initialCount);
+        for (uint32_t i = 0; i < initialCount; ++i)
+        {
+            batch[i].x = (columnX[i] + uniform(rng)) / (double)initialCount;
+            batch[i].y = (columnY[i] + uniform(rng)) / (double)initialCount;
+        }
+        evaluateBatch(batch);
+    }
+
+    for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+    {
+        std::vector<UnitPoint> batch;
+        for (uint32_t b = 0; b < batchSize; ++b)
+        {
+            std::vector<double> values = Scalarize(results, uniform(rng));
+            GaussianProcess gp;
+            if (!gp.Fit(points, values))
+                break;
+            const double best = *std::min_element(values.begin(), values.end());
+
+            double bestImprovement = -1.0;
+            UnitPoint bestCandidate = { uniform(rng), uniform(rng) };
+            for (uint32_t c = 0; c < CandidateCount; ++c)
+            {
+                UnitPoint candidate = { uniform(rng), uniform(rng) };
+
+                // keep the batch spread out and don't re-evaluate known points
+                bool tooClose = false;
+                for (const std::vector<UnitPoint>* pSet : { &points, &batch })
+                {
+                    for (const UnitPoint& p : *pSet)
+                        tooClose |= (std::abs(p.x - candidate.x) < MinDistance) && (std::abs(p.y - candidate.y) < MinDistance);
+                }
+                if (tooClose)
+                    continue;
+
+                double mean, sigma;
+                gp.Predict(candidate, mean, sigma);
+                double improvement = ExpectedImprovement(best, mean, sigma);
+                if (improvement > bestImprovement)
+                {
+                    bestImprovement = improvement;
+                    bestCandidate = candidate;
+                }
+            }
+            batch.push_back(bestCandidate);
+        }
+
+        if (batch.empty())
+            break;
+        evaluateBatch(batch);
+    }
+
+    return results;
+}
+
+//--------------------------------------------------------------------------------------
+//
+// Pareto front
+//
+//--------------------------------------------------------------------------------------
+std::vector<SweepResult> GetParetoFront(const std::vector<SweepResult>& results)
+{
+    std::vector<SweepResult> sorted = results;
+    std::sort(sorted.begin(), sorted.end(), [](const SweepResult& a, const SweepResult& b)
+    {
+        return (a.error != b.error) ? (a.error < b.error) : (a.savings > b.savings);
+    });
+
+    std::vector<SweepResult> front;
+    for (const SweepResult& r : sorted)
+    {
+        if (front.empty() || (r.savings > front.back().savings))
+            front.push_back(r);
+    }
+    return front;
+}
+
+size_t SelectPreset(const std::vector<SweepResult>& front, double maxError)
+{
+    if (front.empty())
+        return 0;
+
+    if (maxError >= 0.0)
+    {
+        // savings increase along the front
+        size_t index = 0;
+        for (size_t i = 0; i < front.size(); ++i)
+        {
+            if (front[i].error <= maxError)
+                index = i;
+        }
+        return index;
+    }
+
+    // knee: furthest point from the line through both ends of the normalized front
+    const SweepResult& first = front.front();
+    const SweepResult& last = front.back();
+    const double errorRange = std::max(last.error - first.error, 1e-12);
+    const double savingsRange = std::max(last.savings - first.savings, 1e-12);
+
+    size_t knee = front.size() / 2;
+    double maxDistance = 0.0;
+    for (size_t i = 1; i + 1 < front.size(); ++i)
+    {
+        double e = (front[i].error - first.error) / errorRange;
+        double s = (front[i].savings - first.savings) / savingsRange;
+        double distance = s - e;
+        if (distance > maxDistance)
+        {
+            maxDistance = distance;
+            knee = i;
+        }
+    }
+    return knee;
+}
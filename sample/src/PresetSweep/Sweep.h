@@ -0,0 +1,98 @@
+// AMD FidelityFX Variable Shading Sample code
+//
+// Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "Sequence.h"
+
+#include <functional>
+
+// generator configuration that stays fixed during a sweep
+struct SweepSettings
+{
+    uint32_t    tileSize = 16;
+    bool        additionalShadingRates = false;
+    uint32_t    inputMipLevel = 0;
+    bool        swizzledLuminance = false;  // FFX_VARIABLESHADING_LUMINANCE_LAYOUT_SWIZZLED input planes
+    uint32_t    neighbourhoodShape = 0; // FFX_VARIABLESHADING_NEIGHBOURHOOD_*
+    uint32_t    neighbourhoodRadius = 0;
+    float       motionMasking = 0.0f;   // error weight is 1 / (1 + motionMasking * motion in pixels)
+};
+
+// the swept parameters, named after SampleRenderer::State
+struct SweepParams
+{
+    float       vrsVarianceThreshold;
+    float       vrsMotionFactor;
+};
+
+struct SweepResult
+{
+    SweepParams params;
+    double      savings;    // fraction of pixel shader invocations saved, 0..1
+    double      error;      // RMS luminance error of the simulated coarse shading
+};
+
+// swept interval of one parameter, logarithmic ranges need minValue > 0
+struct SweepRange
+{
+    float       minValue;
+    float       maxValue;
+    uint32_t    steps;
+    bool        logarithmic;
+
+    float GetValue(float t) const;
+};
+
+void ParallelFor(uint32_t count, uint32_t threadCount, const std::function<void(uint32_t)>& fn);
+
+// Replays the sequences through the CPU generator: the VRS image of frame i is generated from
+// the luminance of frame i - 1 and the motion vectors of frame i (as the sample does on the GPU)
+// and then applied to frame i, broadcasting the upper left pixel of each coarse pixel
+// (FFX_VariableShading_ExecuteRateAware).
+class SweepEvaluator
+{
+public:
+    void OnCreate(const std::vector<VrsSequence>* pSequences, const SweepSettings& settings);
+    void OnDestroy();
+
+    // thread safe
+    SweepResult Evaluate(const SweepParams& params) const;
+
+private:
+    const std::vector<VrsSequence>*         m_pSequences = nullptr;
+    SweepSettings                           m_settings;
+
+    // luminance of every frame at m_settings.inputMipLevel, [sequence][frame], swizzled with m_settings.swizzledLuminance
+    std::vector<std::vector<std::vector<float>>> m_inputLuminance;
+};
+
+std::vector<SweepResult> GridSearch(const SweepEvaluator& evaluator, const SweepRange& threshold, const SweepRange& motionFactor, uint32_t threadCount);
+
+// Multi objective Bayesian optimization (ParEGO): every candidate of a batch minimizes a randomly
+// weighted Chebyshev scalarization of (error, 1 - savings) by expected improvement under a Gaussian
+// process fitted in the unit square spanned by the two ranges (steps are ignored).
+std::vector<SweepResult> BayesianSearch(const SweepEvaluator& evaluator, const SweepRange& threshold, const SweepRange& motionFactor, uint32_t iterations, uint32_t batchSize, uint32_t seed, uint32_t threadCount);
+
+// non dominated results (lower error, higher savings), sorted by increasing error
+std::vector<SweepResult> GetParetoFront(const std::vector<SweepResult>& results);
+
+// index of the default preset on a Pareto front: the highest savings with an error of at most
+// maxError, or the knee of the front if maxError is negative
+size_t SelectPreset(const std::vector<SweepResult>& front, double maxError);